@@ -0,0 +1,86 @@
+/*
+ * ProFTPD - mod_lint arena API
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#ifndef MOD_LINT_ARENA_H
+#define MOD_LINT_ARENA_H
+
+#include "mod_lint.h"
+
+/* An arena is a bump allocator backed by anonymous memory mappings, rather
+ * than by the pool allocator.  Destroying an arena unmaps all of its memory,
+ * returning it to the OS; nothing lingers in the daemon's heap, to be
+ * inherited by every forked session process.
+ *
+ * Memory allocated from an arena is not freed individually.
+ */
+struct lint_arena;
+
+/* Creates an arena, whose mappings are at least chunksz bytes (rounded up
+ * to the page size).  Use a chunksz of zero for the default.
+ */
+struct lint_arena *lint_arena_create(size_t chunksz);
+void lint_arena_destroy(struct lint_arena *arena);
+
+void *lint_arena_alloc(struct lint_arena *arena, size_t sz);
+void *lint_arena_calloc(struct lint_arena *arena, size_t sz);
+char *lint_arena_strdup(struct lint_arena *arena, const char *str);
+
+/* Grows the given allocation to newsz bytes, in place when possible; the
+ * returned pointer is to be used instead of ptr.  Intended for growing
+ * arrays.
+ */
+void *lint_arena_realloc(struct lint_arena *arena, void *ptr, size_t oldsz,
+  size_t newsz);
+
+/* Returns the number of bytes currently mapped by the arena. */
+size_t lint_arena_mapped(struct lint_arena *arena);
+
+/* Sets a memory budget for the arena: once its anonymous mappings would
+ * exceed max_anon bytes, further chunks are instead mapped, shared, from an
+ * unlinked temporary file in spill_dir, which the kernel may write back to
+ * disk, and read back in as needed.  A max_anon of zero disables spilling.
+ */
+int lint_arena_set_spill(struct lint_arena *arena, size_t max_anon,
+  const char *spill_dir);
+
+/* For use in a forked child: remaps any spilled chunks privately, so that
+ * the child's writes are not seen by its parent or siblings, and disables
+ * further spilling.
+ */
+int lint_arena_detach(struct lint_arena *arena);
+
+struct lint_arena_stats {
+  /* Currently mapped bytes, including those spilled. */
+  size_t mapped;
+  size_t spilled;
+
+  /* The peak bytes held in memory (i.e. not spilled), and spilled. */
+  size_t peak_mapped;
+  size_t peak_spilled;
+};
+
+int lint_arena_get_stats(struct lint_arena *arena,
+  struct lint_arena_stats *stats);
+
+#endif /* MOD_LINT_ARENA_H */
@@ -0,0 +1,72 @@
+/*
+ * ProFTPD - mod_lint capture API
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#ifndef MOD_LINT_CAPTURE_H
+#define MOD_LINT_CAPTURE_H
+
+#include "mod_lint.h"
+#include "lint/arena.h"
+
+/* The capture log records the parsed lines, and the configs added for them,
+ * with as little work as possible, while the config is being parsed; they
+ * are resolved later, in one pass.  Records and texts are appended to
+ * fixed-size chunks, which are never moved or copied as the log grows.
+ */
+struct lint_capture;
+
+struct lint_capture *lint_capture_alloc(struct lint_arena *arena);
+
+/* Appends a copy of the given text, the server in which it appears, and
+ * its source, to the log.
+ */
+int lint_capture_add_line(struct lint_capture *cap, const char *text,
+  size_t textsz, server_rec *s, const char *source_file,
+  unsigned int source_lineno);
+
+/* Sets the server of the most recently captured line, e.g. for a
+ * <VirtualHost> line, whose server is only created once it is handled.
+ */
+int lint_capture_set_server(struct lint_capture *cap, server_rec *s);
+
+/* Records the given config as added after the most recently captured
+ * line.
+ */
+int lint_capture_add_config(struct lint_capture *cap, const config_rec *c);
+
+unsigned int lint_capture_count(struct lint_capture *cap);
+
+/* Calls the given callbacks for each captured line, in order, and for each
+ * captured config, after the line it followed.  Iteration stops if a
+ * callback returns -1.
+ */
+struct lint_capture_visitor {
+  int (*line)(void *data, const char *text, size_t textsz, server_rec *s,
+    const char *source_file, unsigned int source_lineno);
+  int (*config)(void *data, const config_rec *c);
+};
+
+int lint_capture_visit(struct lint_capture *cap,
+  const struct lint_capture_visitor *visitor, void *data);
+
+#endif /* MOD_LINT_CAPTURE_H */
@@ -27,18 +27,54 @@
 
 #include "mod_lint.h"
 
+struct lint_cop_ctx;
+
+/* Cops are immutable; any per-call state, such as the module handling the
+ * config, is provided via the context.  This allows cops to be used
+ * concurrently.
+ */
 struct lint_cop {
   const char *name;
-  module *m;
 
-  const char *(*get_directive)(pool *p, config_rec *c);
+  const char *(*get_directive)(pool *p, const struct lint_cop_ctx *ctx,
+    config_rec *c);
 };
 
-const struct lint_cop *lint_cop_get_config_cop(config_rec *c);
-const struct lint_cop *lint_cop_get_module_cop(module *m);
+struct lint_cop_ctx {
+  const struct lint_cop *cop;
+
+  /* The module whose config this is, if known. */
+  module *m;
+};
+
+/* Look up the cop for the given config, or module.  If a context is
+ * provided, it is filled in, for use with lint_cop_get_directive().
+ */
+const struct lint_cop *lint_cop_get_config_cop(config_rec *c,
+  struct lint_cop_ctx *ctx);
+const struct lint_cop *lint_cop_get_module_cop(module *m,
+  struct lint_cop_ctx *ctx);
 
 /* Provides the directive name for a config_rec. */
-const char *lint_cop_get_directive(const struct lint_cop *cop, pool *p,
+const char *lint_cop_get_directive(const struct lint_cop_ctx *ctx, pool *p,
   config_rec *c);
 
+/* Registers a cop, e.g. from another module's init function.  If the
+ * config_name is NULL, the cop is used for all of the given module's
+ * configs; otherwise, it is used for configs of that name, which are not
+ * handled by a directive of the same name.  Registered cops take
+ * precedence over the built-in cops.
+ */
+int lint_cop_register(module *m, const char *config_name,
+  const struct lint_cop *cop);
+int lint_cop_unregister(module *m, const char *config_name);
+
+/* Unregisters all of the cops registered by the named module, e.g.
+ * "mod_foo.c", returning the number of cops unregistered.
+ */
+int lint_cop_unregister_module(const char *module_file);
+
+/* Releases all registered cops. */
+void lint_cop_free(void);
+
 #endif /* MOD_LINT_COP_H */
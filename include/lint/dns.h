@@ -0,0 +1,72 @@
+/*
+ * ProFTPD - mod_lint DNS API
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+#ifndef MOD_LINT_DNS_H
+#define MOD_LINT_DNS_H
+
+#include "mod_lint.h"
+
+/* Tracks the names, used as addresses by directives such as <VirtualHost>,
+ * DefaultAddress, Bind and MasqueradeAddress, which require DNS resolution
+ * at startup; and the numeric addresses to which they were resolved, if
+ * known.
+ */
+struct lint_dns;
+
+struct lint_dns *lint_dns_alloc(pool *p);
+
+/* Parses the given line.  If its directive takes addresses, the arguments
+ * are returned, in order, as a list of char *; otherwise NULL is returned,
+ * with errno set to ENOENT.
+ */
+array_header *lint_dns_parse_line(pool *p, const char *text);
+
+/* Returns TRUE if the given address is a name, rather than numeric. */
+int lint_dns_is_name(const char *addr);
+
+/* Records a name, and its numeric address, if known (else NULL). */
+int lint_dns_add_name(struct lint_dns *dns, const char *name,
+  const char *addr);
+
+/* Returns the numeric address for the name, or NULL (with errno set to
+ * ENOENT) if not known.
+ */
+const char *lint_dns_get_addr(struct lint_dns *dns, const char *name);
+
+/* Returns the number of names recorded. */
+unsigned int lint_dns_count(struct lint_dns *dns);
+
+/* Hashes the names recorded, and their numeric addresses, independent of
+ * the order in which they were added.
+ */
+int lint_dns_hash(struct lint_dns *dns, uint64_t *hash);
+
+/* Copies the given config file, substituting the known numeric addresses
+ * for names.  Returns the number of substitutions made.
+ */
+int lint_dns_write_numeric(struct lint_dns *dns, const char *src_path,
+  const char *dst_path);
+
+#endif /* MOD_LINT_DNS_H */
@@ -0,0 +1,45 @@
+/*
+ * ProFTPD - mod_lint hash API
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#ifndef MOD_LINT_HASH_H
+#define MOD_LINT_HASH_H
+
+#include "mod_lint.h"
+
+/* Non-cryptographic (FNV-1a) 64-bit hashing, for detecting changed
+ * content.
+ */
+#define LINT_HASH_INIT		0xcbf29ce484222325ULL
+
+uint64_t lint_hash_update(uint64_t hash, const void *data, size_t datasz);
+uint64_t lint_hash_data(const void *data, size_t datasz);
+
+/* Hashes the contents of the given file.  If a skip_prefix is provided, and
+ * the file starts with that prefix, then the entire first line of the file
+ * is excluded from the hash.
+ */
+int lint_hash_file(pool *p, const char *path, const char *skip_prefix,
+  uint64_t *hash, off_t *filesz);
+
+#endif /* MOD_LINT_HASH_H */
@@ -0,0 +1,78 @@
+/*
+ * ProFTPD - mod_lint performance API
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+#ifndef MOD_LINT_PERF_H
+#define MOD_LINT_PERF_H
+
+#include "mod_lint.h"
+
+/* Phases, timed using the monotonic clock. */
+#define LINT_PERF_PHASE_INGEST		0
+#define LINT_PERF_PHASE_ASSOCIATE	1
+#define LINT_PERF_PHASE_HEADER		2
+#define LINT_PERF_PHASE_DEFINES		3
+#define LINT_PERF_PHASE_MODULES		4
+#define LINT_PERF_PHASE_SERVER_CONFIG	5
+#define LINT_PERF_PHASE_CLASSES		6
+#define LINT_PERF_PHASE_CTRLS		7
+#define LINT_PERF_PHASE_VHOSTS		8
+#define LINT_PERF_PHASE_COMMIT		9
+#define LINT_PERF_NPHASES		10
+
+/* Counters */
+#define LINT_PERF_COUNT_LINES		0
+#define LINT_PERF_COUNT_UNKNOWN		1
+#define LINT_PERF_COUNT_CONFIG_RECS	2
+#define LINT_PERF_COUNT_LOOKUPS		3
+#define LINT_PERF_COUNT_BYTES_WRITTEN	4
+#define LINT_PERF_COUNT_SYSCALLS	5
+#define LINT_PERF_NCOUNTS		6
+
+struct lint_perf {
+  uint64_t phase_ns[LINT_PERF_NPHASES];
+  uint64_t counts[LINT_PERF_NCOUNTS];
+};
+
+void lint_perf_reset(struct lint_perf *perf);
+
+/* Returns the current monotonic time, in nanoseconds. */
+uint64_t lint_perf_now(void);
+
+/* Adds the time elapsed since the given start time to the phase. */
+int lint_perf_add_time(struct lint_perf *perf, unsigned int phase,
+  uint64_t start_ns);
+
+/* Returns the name of the given phase/counter, or NULL if unknown. */
+const char *lint_perf_get_phase_name(unsigned int phase);
+const char *lint_perf_get_count_name(unsigned int counter);
+
+/* Logs the timings and counters, to the "lint.perf" trace channel. */
+void lint_perf_trace(const struct lint_perf *perf);
+
+/* Writes the timings and counters, as JSON, to the given path. */
+int lint_perf_write_json(pool *p, const struct lint_perf *perf,
+  const char *path);
+
+#endif /* MOD_LINT_PERF_H */
@@ -0,0 +1,60 @@
+/*
+ * ProFTPD - mod_lint parse profile API
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+#ifndef MOD_LINT_PROFILE_H
+#define MOD_LINT_PROFILE_H
+
+#include "mod_lint.h"
+
+/* A parse profile attributes the time between successive parse events
+ * (parsed lines, added configs) to the most recently parsed line, and thus
+ * to its source file, its directive, and the module handling it.  Times are
+ * provided by the caller, in nanoseconds.
+ */
+struct lint_profile;
+
+struct lint_profile *lint_profile_alloc(pool *p);
+
+int lint_profile_add_line(struct lint_profile *prof, uint64_t now_ns,
+  const char *source_file, unsigned int source_lineno, const char *directive,
+  const char *module_name);
+int lint_profile_add_config(struct lint_profile *prof, uint64_t now_ns);
+
+/* Ends the profile.  The time since the last event is not attributed to any
+ * line, and is reported separately.
+ */
+int lint_profile_finish(struct lint_profile *prof, uint64_t now_ns);
+
+/* Writes the ranked report, of the files, directives, modules and lines
+ * taking the most time, to the given path.
+ */
+int lint_profile_write(struct lint_profile *prof, const char *path);
+
+/* Writes the time per stack of included files, module and directive, in
+ * the "folded" format used by flame graph tools, to the given path.
+ */
+int lint_profile_write_folded(struct lint_profile *prof, const char *path);
+
+#endif /* MOD_LINT_PROFILE_H */
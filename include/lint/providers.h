@@ -0,0 +1,52 @@
+/*
+ * ProFTPD - mod_lint cop providers API
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#ifndef MOD_LINT_PROVIDERS_H
+#define MOD_LINT_PROVIDERS_H
+
+#include "mod_lint.h"
+#include "lint/cop.h"
+
+/* These lookups are implemented by lib/lint/cop/providers.c, which is
+ * generated from lib/lint/cop/providers.spec.
+ */
+
+/* Returns the cop for configs from the named module. */
+const struct lint_cop *lint_providers_get_module_cop(
+  const char *module_name);
+
+/* Returns the cop for configs of the given name, which are not handled by
+ * a directive of the same name.
+ */
+const struct lint_cop *lint_providers_get_config_cop(
+  const char *config_name);
+
+/* Looks up the directive which the named cop emits for configs of the
+ * given name; the directive is NULL if no directive is emitted.  Returns
+ * -1, with errno set to ENOENT, if the cop has no such entry.
+ */
+int lint_providers_get_directive(const char *cop_name,
+  const char *config_name, const char **directive);
+
+#endif /* MOD_LINT_PROVIDERS_H */
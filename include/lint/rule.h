@@ -0,0 +1,138 @@
+/*
+ * ProFTPD - mod_lint rule API
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+#ifndef MOD_LINT_RULE_H
+#define MOD_LINT_RULE_H
+
+#include "mod_lint.h"
+#include "lint/store.h"
+
+/* Rules check the parsed config, and report findings.  Rather than each
+ * rule walking the parsed lines and the config tree itself, rules subscribe
+ * to the directives, config names, and config types of interest; the engine
+ * visits each line, and each config, exactly once, dispatching them to the
+ * subscribed rules via lookup tables built before the walk.  Thus the cost
+ * of a lint run grows with the size of the config, not with the number of
+ * rules.
+ */
+struct lint_rule_ctx;
+
+/* Like cops, rules are immutable; any per-run state is provided via the
+ * data given when adding the rule to an engine.
+ */
+struct lint_rule {
+  const char *name;
+
+  /* NULL-terminated lists of the directives, as stored in the parsed lines
+   * (e.g. "<VirtualHost>"), and config names, to which the rule subscribes.
+   * A name of "*" subscribes to all lines, or configs.  Directives are
+   * matched ignoring case.
+   */
+  const char **directives;
+  const char **config_names;
+
+  /* The CONF_ types (e.g. CONF_DIR|CONF_LIMIT) of the configs to which the
+   * rule subscribes, if any.  A rule subscribed to a config by both name and
+   * type is called for each.
+   */
+  int config_types;
+
+  int (*check_line)(struct lint_rule_ctx *ctx, unsigned int idx);
+  int (*check_config)(struct lint_rule_ctx *ctx, config_rec *c);
+
+  /* Called once all lines and configs have been visited; optional. */
+  int (*finish)(struct lint_rule_ctx *ctx);
+};
+
+struct lint_rule_ctx {
+  const struct lint_rule *rule;
+  void *data;
+
+  /* Scratch pool, cleared after the run. */
+  pool *pool;
+
+  struct lint_store *store;
+
+  /* The server whose line, or config, is being checked. */
+  server_rec *server;
+
+  struct lint_rule_engine *engine;
+};
+
+struct lint_rule_finding {
+  const char *rule;
+
+  /* The source of the finding, if known, else NULL. */
+  const char *source_file;
+  unsigned int source_lineno;
+
+  const char *text;
+};
+
+struct lint_rule_engine;
+
+struct lint_rule_engine *lint_rule_engine_alloc(pool *p);
+
+int lint_rule_engine_add(struct lint_rule_engine *engine,
+  const struct lint_rule *rule, void *data);
+
+/* Visits the parsed lines, and then the configs of the given servers, the
+ * first of which is the main server.  Lines are attributed to the server
+ * recorded for them in the store, else to the main server.
+ */
+int lint_rule_engine_run(struct lint_rule_engine *engine,
+  struct lint_store *store, xaset_t *servers);
+
+/* Returns the findings of the rules run, in the order in which they were
+ * reported, as a list of struct lint_rule_finding.
+ */
+array_header *lint_rule_engine_get_findings(struct lint_rule_engine *engine);
+
+/* Reports a finding for the given line index, or for no line, if -1. */
+int lint_rule_add_finding(struct lint_rule_ctx *ctx, int idx,
+  const char *fmt, ...);
+
+/* Built-in rules. */
+
+/* Reports address directive names requiring DNS resolution at startup;
+ * its data is a struct lint_dns, in which the names are recorded.
+ */
+const struct lint_rule *lint_rule_get_dns_rule(void);
+
+/* Reports the per-connection cost of parsing the config, with ServerType
+ * inetd; its data is a struct lint_rule_inetd_data.
+ */
+struct lint_rule_inetd_data {
+  /* The measured time, in nanoseconds, taken to parse the config. */
+  uint64_t parse_ns;
+
+  /* The size of the config, as counted by the rule. */
+  unsigned int nlines;
+  uint64_t nbytes;
+};
+
+const struct lint_rule *lint_rule_get_inetd_rule(void);
+
+#endif /* MOD_LINT_RULE_H */
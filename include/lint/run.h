@@ -0,0 +1,58 @@
+/*
+ * ProFTPD - mod_lint run API
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#ifndef MOD_LINT_RUN_H
+#define MOD_LINT_RUN_H
+
+#include "mod_lint.h"
+#include "lint/text.h"
+
+/* A run is a file of lines, e.g. as rendered by a separate worker process
+ * for a contiguous range of items.  Writing the runs of consecutive ranges
+ * one after the other thus produces the same lines as rendering all of the
+ * items in a single process.
+ */
+
+/* Writes the buffered lines, in order, as a run to the given path. */
+int lint_run_write(pool *p, const char *path, array_header *buffered_lines);
+
+/* Checks that the run at the given path is complete, e.g. that the process
+ * writing it did not die partway.  If nrecords is not NULL, it is set to
+ * the number of records in the run.
+ */
+int lint_run_verify(pool *p, const char *path, unsigned int *nrecords);
+
+/* Returns the lines of the run at the given path, as a list of strings (char
+ * *) allocated from the given pool.  If the run is not complete, NULL is
+ * returned, with errno set to EINVAL.
+ */
+array_header *lint_run_read(pool *p, const char *path);
+
+/* Writes the lines of the runs at the given paths (an array of char *), in
+ * order, to the writer.  If any of the runs is not complete, nothing is
+ * written, and -1 is returned, with errno set to EINVAL.
+ */
+int lint_run_concat(pool *p, struct lint_text_writer *w, array_header *paths);
+
+#endif /* MOD_LINT_RUN_H */
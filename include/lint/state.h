@@ -0,0 +1,60 @@
+/*
+ * ProFTPD - mod_lint state API
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#ifndef MOD_LINT_STATE_H
+#define MOD_LINT_STATE_H
+
+#include "mod_lint.h"
+
+/* The state records content hashes for a set of named items, e.g. the
+ * source files of a parsed config, such that later runs can determine
+ * what, if anything, has changed.
+ */
+struct lint_state;
+
+struct lint_state *lint_state_alloc(pool *p);
+
+/* Records the hash of the given source file's contents. */
+int lint_state_add_file(struct lint_state *state, const char *path);
+
+/* Records an arbitrary named hash, replacing any previous hash for that
+ * name.
+ */
+int lint_state_add_hash(struct lint_state *state, const char *name,
+  uint64_t hash);
+
+/* Returns the number of recorded items. */
+unsigned int lint_state_count(struct lint_state *state);
+
+/* Compares the given states, returning the number of items which were added,
+ * removed, or changed.  The names of these items are optionally added to the
+ * provided array (of char *).
+ */
+int lint_state_compare(struct lint_state *state, struct lint_state *prev,
+  array_header *changed);
+
+struct lint_state *lint_state_read(pool *p, const char *path);
+int lint_state_write(struct lint_state *state, const char *path);
+
+#endif /* MOD_LINT_STATE_H */
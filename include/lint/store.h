@@ -0,0 +1,115 @@
+/*
+ * ProFTPD - mod_lint parsed line store API
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#ifndef MOD_LINT_STORE_H
+#define MOD_LINT_STORE_H
+
+#include "mod_lint.h"
+#include "lint/arena.h"
+
+/* The store holds the parsed config lines, in order of appearance, in a
+ * compact columnar layout: directive names and source file paths are
+ * interned, and the line texts are held in a single contiguous slab.
+ * Lines are identified by their index, in order of appearance.
+ *
+ * Note that pointers to line text are only valid until the next line is
+ * added.  All of the store's memory comes from the given arena, and is
+ * released when the arena is destroyed.
+ */
+struct lint_store;
+
+struct lint_store *lint_store_alloc(struct lint_arena *arena);
+
+/* Adds a line, returning its index. */
+int lint_store_add_line(struct lint_store *store, const char *directive,
+  const char *text, size_t textsz, const char *source_file,
+  unsigned int source_lineno);
+
+unsigned int lint_store_count(struct lint_store *store);
+
+const char *lint_store_get_directive(struct lint_store *store,
+  unsigned int idx);
+const char *lint_store_get_text(struct lint_store *store, unsigned int idx,
+  size_t *textsz);
+const char *lint_store_get_source_file(struct lint_store *store,
+  unsigned int idx);
+unsigned int lint_store_get_source_lineno(struct lint_store *store,
+  unsigned int idx);
+
+/* Records the server in which the line appears; unset servers are NULL. */
+int lint_store_set_server(struct lint_store *store, unsigned int idx,
+  server_rec *s);
+server_rec *lint_store_get_server(struct lint_store *store, unsigned int idx);
+
+/* Returns the interned ID of the line's directive; and the ID of the given
+ * directive, if any lines for it have been added (else -1, with errno set
+ * to ENOENT).  These IDs are dense, allowing for lookup tables indexed by
+ * directive.  Directives are matched ignoring case, here and in the
+ * lookups below; a directive's name is as in the first line added for it.
+ */
+int lint_store_get_directive_id(struct lint_store *store, unsigned int idx);
+int lint_store_find_directive_id(struct lint_store *store,
+  const char *directive);
+
+/* Associates the given config with the most recently added line. */
+int lint_store_add_config(struct lint_store *store, const config_rec *c);
+
+/* Returns the configs associated with a line, and their count; returns
+ * NULL if there are none.
+ */
+const config_rec **lint_store_get_configs(struct lint_store *store,
+  unsigned int idx, unsigned int *count);
+
+/* Returns the index of the line with which the given config is associated,
+ * or -1 (with errno set to ENOENT) if there is none.
+ */
+int lint_store_find_config_line(struct lint_store *store,
+  const config_rec *c);
+
+/* Returns the index of the first line for the given directive, or -1 if
+ * there are no such lines.  To iterate through all of the lines for the
+ * same directive, use:
+ *
+ *   int idx;
+ *
+ *   idx = lint_store_find_line(store, "Foo");
+ *   while (idx >= 0) {
+ *     idx = lint_store_next_line(store, idx);
+ *   }
+ */
+int lint_store_find_line(struct lint_store *store, const char *directive);
+int lint_store_next_line(struct lint_store *store, unsigned int idx);
+
+/* Returns the number of lines for the given directive. */
+unsigned int lint_store_count_lines(struct lint_store *store,
+  const char *directive);
+
+/* Returns the ID of the interned copy of the given string, interning it
+ * if necessary.
+ */
+int lint_store_intern(struct lint_store *store, const char *str);
+const char *lint_store_get_interned(struct lint_store *store,
+  unsigned int id);
+
+#endif /* MOD_LINT_STORE_H */
@@ -0,0 +1,53 @@
+/*
+ * ProFTPD - mod_lint symbol table API
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#ifndef MOD_LINT_SYMTAB_H
+#define MOD_LINT_SYMTAB_H
+
+#include "mod_lint.h"
+#include "lint/arena.h"
+#include "lint/cop.h"
+
+/* The symbol table caches, per directive/config name, the module which
+ * handles that directive, and the cop for configs of that name; each name
+ * is resolved once, and subsequent lookups are a single hash probe.  Its
+ * memory comes from the given arena.
+ */
+struct lint_symtab;
+
+struct lint_symtab *lint_symtab_alloc(struct lint_arena *arena);
+
+/* Returns the module which handles the given directive, or NULL (with
+ * errno set to ENOENT) if no module handles it.
+ */
+module *lint_symtab_get_module(struct lint_symtab *symtab,
+  const char *directive);
+
+/* Returns the cop for the given config, filling in the context, if
+ * provided, as for lint_cop_get_config_cop().
+ */
+const struct lint_cop *lint_symtab_get_cop(struct lint_symtab *symtab,
+  config_rec *c, struct lint_cop_ctx *ctx);
+
+#endif /* MOD_LINT_SYMTAB_H */
@@ -27,9 +27,34 @@
 
 #include "mod_lint.h"
 
+#include <sys/uio.h>
+
+/* The number of segments a buffered line holds without further allocation;
+ * enough for the common indent, text, newline shape.
+ */
+#define LINT_TEXT_INLINE_SEGS		4
+
+/* A buffered line is a list of segments, referencing existing strings
+ * rather than copies of them; referenced strings must outlive the line.
+ */
 struct lint_buffered_line {
-  const char *text;
+  pool *pool;
+
+  struct iovec *segs;
+  unsigned int nsegs;
   size_t textsz;
+
+  /* The first 8 bytes of the text, big-endian and NUL-padded, so that
+   * comparing keys orders lines as strcmp(3) would; the full text is only
+   * consulted when keys tie.
+   */
+  uint64_t key;
+
+  /* Insertion order within the list, used to keep sorting stable. */
+  unsigned int seq;
+
+  unsigned int segs_cap;
+  struct iovec inline_segs[LINT_TEXT_INLINE_SEGS];
 };
 
 int lint_text_add_fmt(pool *p, array_header *buffered_lines, const char *fmt,
@@ -37,10 +62,87 @@ int lint_text_add_fmt(pool *p, array_header *buffered_lines, const char *fmt,
 int lint_text_add_msg(pool *p, array_header *buffered_lines, const char *fmt,
   va_list msg);
 
+/* Typed line builder, for lines which need no format parsing: create a line,
+ * append its pieces, then add it to the list.  Strings are referenced, not
+ * copied.
+ */
+struct lint_buffered_line *lint_text_line_create(pool *p);
+int lint_text_line_add_indent(struct lint_buffered_line *bl,
+  unsigned int depth);
+int lint_text_line_add_str(struct lint_buffered_line *bl, const char *str);
+int lint_text_line_add_strn(struct lint_buffered_line *bl, const char *str,
+  size_t len);
+int lint_text_line_add_quoted(struct lint_buffered_line *bl, const char *str);
+int lint_text_line_add_uint(struct lint_buffered_line *bl, unsigned long num);
+int lint_text_line_add_int(struct lint_buffered_line *bl, long num);
+
+/* Appends "on" or "off". */
+int lint_text_line_add_bool(struct lint_buffered_line *bl, int on);
+
+/* Appends the text of the given lines, in order, e.g. the sorted lines of
+ * a nested section, so that they are sorted and written as one block.
+ */
+int lint_text_line_add_lines(struct lint_buffered_line *bl,
+  array_header *buffered_lines);
+
+/* Terminates the line with a newline, and adds it to the list. */
+int lint_text_add_line(array_header *buffered_lines,
+  struct lint_buffered_line *bl);
+
+/* Returns the text of the line as one string, allocated from the given
+ * pool.
+ */
+const char *lint_text_line_get_text(pool *p,
+  const struct lint_buffered_line *bl);
+
 int lint_text_write_fmt(pr_fh_t *fh, const char *fmt, ...);
 int lint_text_write_msg(pr_fh_t *fh, const char *fmt, va_list msg);
 int lint_text_write_text(pr_fh_t *fh, const char *text, size_t textsz);
 
 int lint_text_write_buffered_lines(pr_fh_t *fh, array_header *buffered_lines);
 
+/* Sorts the buffered lines, in the order in which they are written: that of
+ * strcmp(3) on the text, with equal lines kept in insertion order.
+ */
+void lint_text_sort_buffered_lines(array_header *buffered_lines);
+
+/* A writer accumulates text into large blocks, flushing them to the
+ * underlying file handle with a single writev(2), rather than one write(2)
+ * per line.
+ */
+struct lint_text_writer;
+
+struct lint_text_writer *lint_text_writer_create(pool *p, pr_fh_t *fh);
+
+int lint_text_writer_fmt(struct lint_text_writer *w, const char *fmt, ...);
+int lint_text_writer_msg(struct lint_text_writer *w, const char *fmt,
+  va_list msg);
+int lint_text_writer_text(struct lint_text_writer *w, const char *text,
+  size_t textsz);
+int lint_text_writer_line(struct lint_text_writer *w,
+  const struct lint_buffered_line *bl);
+int lint_text_writer_buffered_lines(struct lint_text_writer *w,
+  array_header *buffered_lines);
+
+/* Writes out any pending blocks. */
+int lint_text_writer_flush(struct lint_text_writer *w);
+
+struct lint_text_writer_stats {
+  uint64_t bytes_written;
+
+  /* The number of write(2)/writev(2) calls made. */
+  uint64_t nwrites;
+};
+
+/* Returns the stats for the blocks written thus far, i.e. excluding any
+ * pending blocks.
+ */
+int lint_text_writer_get_stats(struct lint_text_writer *w,
+  struct lint_text_writer_stats *stats);
+
+/* Flushes any pending blocks, then closes the underlying file handle.  The
+ * writer may not be used after this, even on error.
+ */
+int lint_text_writer_close(struct lint_text_writer *w);
+
 #endif /* MOD_LINT_TEXT_H */
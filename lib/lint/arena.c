@@ -0,0 +1,517 @@
+/*
+ * ProFTPD: mod_lint arena implementation
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_lint.h"
+#include "lint/arena.h"
+
+#include <sys/mman.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+# define MAP_ANONYMOUS	MAP_ANON
+#endif
+
+#define LINT_ARENA_DEFAULT_CHUNKSZ	(256 * 1024)
+#define LINT_ARENA_ALIGN		sizeof(void *)
+
+#define LINT_ARENA_FL_DEDICATED		0x0001
+#define LINT_ARENA_FL_SPILLED		0x0002
+
+/* Each mapping starts with its chunk header. */
+struct lint_arena_chunk {
+  struct lint_arena_chunk *next;
+  size_t size;
+  size_t used;
+  int flags;
+
+  /* For spilled chunks, the chunk's offset in the spill file. */
+  off_t offset;
+};
+
+struct lint_arena {
+  /* The first chunk is always the current chunk for small allocations;
+   * the chunk which holds this struct is the last one.
+   */
+  struct lint_arena_chunk *chunks;
+  size_t chunksz;
+  size_t mapped;
+
+  /* Once the anonymous mappings would exceed max_anon bytes, new chunks
+   * are mapped from the (unlinked) spill file instead.
+   */
+  size_t max_anon;
+  const char *spill_dir;
+  int spill_fd;
+  off_t spill_len;
+
+  size_t spilled;
+  size_t peak_mapped;
+  size_t peak_spilled;
+};
+
+static const char *trace_channel = "lint.arena";
+
+static size_t arena_align(size_t sz) {
+  return (sz + (LINT_ARENA_ALIGN - 1)) & ~(LINT_ARENA_ALIGN - 1);
+}
+
+static size_t arena_chunk_hdrsz(void) {
+  return arena_align(sizeof(struct lint_arena_chunk));
+}
+
+static size_t arena_page_align(size_t sz) {
+  size_t pagesz;
+
+  pagesz = (size_t) sysconf(_SC_PAGESIZE);
+  return (sz + (pagesz - 1)) & ~(pagesz - 1);
+}
+
+static struct lint_arena_chunk *arena_init_chunk(void *ptr, size_t sz) {
+  struct lint_arena_chunk *chunk;
+
+  chunk = ptr;
+  chunk->next = NULL;
+  chunk->size = sz;
+  chunk->used = arena_chunk_hdrsz();
+  chunk->flags = 0;
+  chunk->offset = 0;
+
+  return chunk;
+}
+
+static struct lint_arena_chunk *arena_map_anon_chunk(size_t sz) {
+  void *ptr;
+
+  ptr = mmap(NULL, sz, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1,
+    0);
+  if (ptr == MAP_FAILED) {
+    int xerrno = errno;
+
+    pr_trace_msg(trace_channel, 1, "error mapping %lu bytes: %s",
+      (unsigned long) sz, strerror(xerrno));
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  return arena_init_chunk(ptr, sz);
+}
+
+static int arena_open_spill(struct lint_arena *arena) {
+  char path[PR_TUNABLE_PATH_MAX+1];
+  int fd, xerrno;
+
+  pr_snprintf(path, sizeof(path)-1, "%s/mod_lint-spill.XXXXXX",
+    arena->spill_dir);
+  path[sizeof(path)-1] = '\0';
+
+  fd = mkstemp(path);
+  xerrno = errno;
+
+  if (fd < 0) {
+    pr_trace_msg(trace_channel, 1, "error creating spill file in '%s': %s",
+      arena->spill_dir, strerror(xerrno));
+    errno = xerrno;
+    return -1;
+  }
+
+  /* The file is only ever accessed via its mappings. */
+  (void) unlink(path);
+
+  pr_trace_msg(trace_channel, 5, "spilling arena chunks to '%s' (unlinked)",
+    path);
+
+  arena->spill_fd = fd;
+  return 0;
+}
+
+static struct lint_arena_chunk *arena_map_spill_chunk(struct lint_arena *arena,
+    size_t sz) {
+  void *ptr;
+  struct lint_arena_chunk *chunk;
+
+  if (arena->spill_fd < 0 &&
+      arena_open_spill(arena) < 0) {
+    return NULL;
+  }
+
+  if (ftruncate(arena->spill_fd, arena->spill_len + sz) < 0) {
+    pr_trace_msg(trace_channel, 1, "error extending spill file: %s",
+      strerror(errno));
+    return NULL;
+  }
+
+  ptr = mmap(NULL, sz, PROT_READ|PROT_WRITE, MAP_SHARED, arena->spill_fd,
+    arena->spill_len);
+  if (ptr == MAP_FAILED) {
+    pr_trace_msg(trace_channel, 1, "error mapping %lu spilled bytes: %s",
+      (unsigned long) sz, strerror(errno));
+    return NULL;
+  }
+
+  chunk = arena_init_chunk(ptr, sz);
+  chunk->flags |= LINT_ARENA_FL_SPILLED;
+  chunk->offset = arena->spill_len;
+
+  arena->spill_len += sz;
+  return chunk;
+}
+
+/* Maps a new chunk, spilling it to disk if the arena is over its budget,
+ * and accounts for it.
+ */
+static struct lint_arena_chunk *arena_map_chunk(struct lint_arena *arena,
+    size_t sz) {
+  struct lint_arena_chunk *chunk = NULL;
+
+  sz = arena_page_align(sz);
+
+  if (arena->max_anon > 0 &&
+      (arena->mapped - arena->spilled) + sz > arena->max_anon) {
+    chunk = arena_map_spill_chunk(arena, sz);
+    if (chunk == NULL) {
+      pr_trace_msg(trace_channel, 3,
+        "unable to spill %lu bytes, using memory instead", (unsigned long) sz);
+    }
+  }
+
+  if (chunk == NULL) {
+    chunk = arena_map_anon_chunk(sz);
+    if (chunk == NULL) {
+      return NULL;
+    }
+  }
+
+  arena->mapped += chunk->size;
+  if (chunk->flags & LINT_ARENA_FL_SPILLED) {
+    arena->spilled += chunk->size;
+  }
+
+  if (arena->mapped - arena->spilled > arena->peak_mapped) {
+    arena->peak_mapped = arena->mapped - arena->spilled;
+  }
+
+  if (arena->spilled > arena->peak_spilled) {
+    arena->peak_spilled = arena->spilled;
+  }
+
+  return chunk;
+}
+
+static void arena_unmap_chunk(struct lint_arena_chunk *chunk) {
+  if (munmap((void *) chunk, chunk->size) < 0) {
+    pr_trace_msg(trace_channel, 1, "error unmapping %lu bytes: %s",
+      (unsigned long) chunk->size, strerror(errno));
+  }
+}
+
+struct lint_arena *lint_arena_create(size_t chunksz) {
+  struct lint_arena_chunk *chunk;
+  struct lint_arena *arena;
+
+  if (chunksz == 0) {
+    chunksz = LINT_ARENA_DEFAULT_CHUNKSZ;
+  }
+
+  chunk = arena_map_anon_chunk(arena_page_align(chunksz));
+  if (chunk == NULL) {
+    return NULL;
+  }
+
+  arena = (struct lint_arena *) ((char *) chunk + chunk->used);
+  chunk->used += arena_align(sizeof(struct lint_arena));
+
+  arena->chunks = chunk;
+  arena->chunksz = chunk->size;
+  arena->mapped = chunk->size;
+  arena->peak_mapped = chunk->size;
+  arena->spill_fd = -1;
+
+  return arena;
+}
+
+void lint_arena_destroy(struct lint_arena *arena) {
+  struct lint_arena_chunk *chunk;
+
+  if (arena == NULL) {
+    return;
+  }
+
+  pr_trace_msg(trace_channel, 9, "unmapping arena (%lu bytes, %lu spilled)",
+    (unsigned long) arena->mapped, (unsigned long) arena->spilled);
+
+  if (arena->spill_fd >= 0) {
+    (void) close(arena->spill_fd);
+  }
+
+  /* The arena itself lives in the last chunk; take care not to touch it
+   * once unmapped.
+   */
+  chunk = arena->chunks;
+  while (chunk != NULL) {
+    struct lint_arena_chunk *next;
+
+    next = chunk->next;
+    arena_unmap_chunk(chunk);
+    chunk = next;
+  }
+}
+
+void *lint_arena_alloc(struct lint_arena *arena, size_t sz) {
+  struct lint_arena_chunk *chunk;
+  void *ptr;
+
+  if (arena == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  sz = arena_align(sz > 0 ? sz : 1);
+  chunk = arena->chunks;
+
+  if (chunk->size - chunk->used < sz) {
+    if (sz > arena->chunksz / 4) {
+      /* Large allocations get their own mapping, so that we do not waste
+       * the remainder of the current chunk.
+       */
+      chunk = arena_map_chunk(arena, arena_chunk_hdrsz() + sz);
+      if (chunk == NULL) {
+        return NULL;
+      }
+
+      chunk->flags |= LINT_ARENA_FL_DEDICATED;
+      chunk->next = arena->chunks->next;
+      arena->chunks->next = chunk;
+
+    } else {
+      chunk = arena_map_chunk(arena, arena->chunksz);
+      if (chunk == NULL) {
+        return NULL;
+      }
+
+      chunk->next = arena->chunks;
+      arena->chunks = chunk;
+    }
+  }
+
+  ptr = (char *) chunk + chunk->used;
+  chunk->used += sz;
+
+  return ptr;
+}
+
+void *lint_arena_calloc(struct lint_arena *arena, size_t sz) {
+  /* Arena memory is never reused, and fresh mappings (anonymous, or of
+   * newly extended regions of the spill file) are zero-filled.
+   */
+  return lint_arena_alloc(arena, sz);
+}
+
+char *lint_arena_strdup(struct lint_arena *arena, const char *str) {
+  char *dup;
+  size_t len;
+
+  if (arena == NULL ||
+      str == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  len = strlen(str);
+  dup = lint_arena_alloc(arena, len + 1);
+  if (dup == NULL) {
+    return NULL;
+  }
+
+  memcpy(dup, str, len + 1);
+  return dup;
+}
+
+/* Finds the chunk, dedicated to the given allocation, along with its
+ * predecessor in the list.
+ */
+static struct lint_arena_chunk *arena_find_dedicated(struct lint_arena *arena,
+    void *ptr, struct lint_arena_chunk **prev) {
+  struct lint_arena_chunk *chunk;
+
+  *prev = NULL;
+  for (chunk = arena->chunks; chunk != NULL; chunk = chunk->next) {
+    if ((chunk->flags & LINT_ARENA_FL_DEDICATED) &&
+        (char *) chunk + arena_chunk_hdrsz() == (char *) ptr) {
+      return chunk;
+    }
+
+    *prev = chunk;
+  }
+
+  return NULL;
+}
+
+void *lint_arena_realloc(struct lint_arena *arena, void *ptr, size_t oldsz,
+    size_t newsz) {
+  struct lint_arena_chunk *chunk, *prev = NULL;
+  void *new_ptr;
+
+  if (arena == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  if (ptr == NULL) {
+    return lint_arena_alloc(arena, newsz);
+  }
+
+  if (newsz <= oldsz) {
+    return ptr;
+  }
+
+  /* If this was the most recent allocation from the current chunk, and
+   * there is room, grow it in place.
+   */
+  chunk = arena->chunks;
+  if ((char *) ptr + arena_align(oldsz) == (char *) chunk + chunk->used &&
+      chunk->size - chunk->used >= arena_align(newsz) - arena_align(oldsz)) {
+    chunk->used += (arena_align(newsz) - arena_align(oldsz));
+    return ptr;
+  }
+
+  new_ptr = lint_arena_alloc(arena, newsz);
+  if (new_ptr == NULL) {
+    return NULL;
+  }
+
+  memcpy(new_ptr, ptr, oldsz);
+
+  /* An outgrown dedicated mapping can be returned to the OS now. */
+  chunk = arena_find_dedicated(arena, ptr, &prev);
+  if (chunk != NULL) {
+    if (prev != NULL) {
+      prev->next = chunk->next;
+
+    } else {
+      arena->chunks = chunk->next;
+    }
+
+    arena->mapped -= chunk->size;
+    if (chunk->flags & LINT_ARENA_FL_SPILLED) {
+      arena->spilled -= chunk->size;
+    }
+
+    arena_unmap_chunk(chunk);
+  }
+
+  return new_ptr;
+}
+
+size_t lint_arena_mapped(struct lint_arena *arena) {
+  if (arena == NULL) {
+    return 0;
+  }
+
+  return arena->mapped;
+}
+
+int lint_arena_set_spill(struct lint_arena *arena, size_t max_anon,
+    const char *spill_dir) {
+  if (arena == NULL ||
+      (max_anon > 0 && spill_dir == NULL)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  arena->max_anon = max_anon;
+  arena->spill_dir = NULL;
+
+  if (spill_dir != NULL) {
+    arena->spill_dir = lint_arena_strdup(arena, spill_dir);
+    if (arena->spill_dir == NULL) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int lint_arena_detach(struct lint_arena *arena) {
+  struct lint_arena_chunk *chunk;
+
+  if (arena == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (arena->spill_fd < 0) {
+    return 0;
+  }
+
+  /* Replace each shared mapping with a private one of the same file region,
+   * at the same address, so that its contents are kept, but our writes are
+   * no longer seen by other processes.  Note that the arena struct itself
+   * is always in anonymous memory.
+   */
+  for (chunk = arena->chunks; chunk != NULL; chunk = chunk->next) {
+    void *ptr;
+    size_t sz;
+    off_t offset;
+
+    if (!(chunk->flags & LINT_ARENA_FL_SPILLED)) {
+      continue;
+    }
+
+    sz = chunk->size;
+    offset = chunk->offset;
+
+    ptr = mmap((void *) chunk, sz, PROT_READ|PROT_WRITE,
+      MAP_PRIVATE|MAP_FIXED, arena->spill_fd, offset);
+    if (ptr == MAP_FAILED) {
+      int xerrno = errno;
+
+      pr_trace_msg(trace_channel, 1, "error remapping spilled chunk: %s",
+        strerror(xerrno));
+      errno = xerrno;
+      return -1;
+    }
+  }
+
+  /* Any further chunks are anonymous. */
+  (void) close(arena->spill_fd);
+  arena->spill_fd = -1;
+  arena->max_anon = 0;
+
+  return 0;
+}
+
+int lint_arena_get_stats(struct lint_arena *arena,
+    struct lint_arena_stats *stats) {
+  if (arena == NULL ||
+      stats == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  stats->mapped = arena->mapped;
+  stats->spilled = arena->spilled;
+  stats->peak_mapped = arena->peak_mapped;
+  stats->peak_spilled = arena->peak_spilled;
+
+  return 0;
+}
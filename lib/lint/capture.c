@@ -0,0 +1,332 @@
+/*
+ * ProFTPD: mod_lint parse-time capture log
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+#include "mod_lint.h"
+#include "lint/capture.h"
+#include "lint/arena.h"
+
+/* Records and configs are appended to chunks of these many entries; texts
+ * are appended to chunks of this size.  Texts larger than a quarter of a
+ * chunk get their own allocation.
+ */
+#define LINT_CAPTURE_CHUNK_ENTRIES	2048
+#define LINT_CAPTURE_TEXT_CHUNK_SIZE	(64 * 1024)
+
+struct capture_record {
+  const char *text;
+  server_rec *server;
+  uint32_t textsz;
+  uint32_t file_id;
+  uint32_t lineno;
+  uint32_t config_count;
+};
+
+struct record_chunk {
+  struct record_chunk *next;
+  unsigned int count;
+  struct capture_record records[LINT_CAPTURE_CHUNK_ENTRIES];
+};
+
+struct config_chunk {
+  struct config_chunk *next;
+  unsigned int count;
+  const config_rec *configs[LINT_CAPTURE_CHUNK_ENTRIES];
+};
+
+struct lint_capture {
+  struct lint_arena *arena;
+
+  struct record_chunk *first_records, *last_records;
+  struct config_chunk *first_configs, *last_configs;
+  unsigned int record_count;
+
+  char *text;
+  size_t text_avail;
+
+  /* Source files are copied once per change of file, not per line. */
+  const char **files;
+  unsigned int file_count;
+  unsigned int file_alloc;
+};
+
+static const char *trace_channel = "lint.capture";
+
+struct lint_capture *lint_capture_alloc(struct lint_arena *arena) {
+  struct lint_capture *cap;
+
+  if (arena == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  cap = lint_arena_calloc(arena, sizeof(struct lint_capture));
+  if (cap == NULL) {
+    return NULL;
+  }
+
+  cap->arena = arena;
+
+  /* Preallocate the first chunks, so that the common case of a small config
+   * allocates nothing more while parsing.
+   */
+  cap->first_records = cap->last_records = lint_arena_calloc(arena,
+    sizeof(struct record_chunk));
+  cap->first_configs = cap->last_configs = lint_arena_calloc(arena,
+    sizeof(struct config_chunk));
+  cap->text = lint_arena_alloc(arena, LINT_CAPTURE_TEXT_CHUNK_SIZE);
+  cap->text_avail = LINT_CAPTURE_TEXT_CHUNK_SIZE;
+
+  if (cap->first_records == NULL ||
+      cap->first_configs == NULL ||
+      cap->text == NULL) {
+    return NULL;
+  }
+
+  return cap;
+}
+
+static char *capture_text(struct lint_capture *cap, const char *text,
+    size_t textsz) {
+  char *ptr;
+
+  if (textsz + 1 > cap->text_avail) {
+    if (textsz + 1 > LINT_CAPTURE_TEXT_CHUNK_SIZE / 4) {
+      ptr = lint_arena_alloc(cap->arena, textsz + 1);
+      if (ptr == NULL) {
+        return NULL;
+      }
+
+      memcpy(ptr, text, textsz);
+      ptr[textsz] = '\0';
+      return ptr;
+    }
+
+    cap->text = lint_arena_alloc(cap->arena, LINT_CAPTURE_TEXT_CHUNK_SIZE);
+    if (cap->text == NULL) {
+      cap->text_avail = 0;
+      return NULL;
+    }
+
+    cap->text_avail = LINT_CAPTURE_TEXT_CHUNK_SIZE;
+  }
+
+  ptr = cap->text;
+  memcpy(ptr, text, textsz);
+  ptr[textsz] = '\0';
+
+  cap->text += (textsz + 1);
+  cap->text_avail -= (textsz + 1);
+  return ptr;
+}
+
+static int capture_file(struct lint_capture *cap, const char *source_file) {
+  if (cap->file_count > 0 &&
+      strcmp(cap->files[cap->file_count-1], source_file) == 0) {
+    return (int) cap->file_count - 1;
+  }
+
+  if (cap->file_count == cap->file_alloc) {
+    unsigned int new_alloc;
+    void *ptr;
+
+    new_alloc = cap->file_alloc > 0 ? cap->file_alloc * 2 : 16;
+    ptr = lint_arena_realloc(cap->arena, cap->files,
+      sizeof(const char *) * cap->file_alloc,
+      sizeof(const char *) * new_alloc);
+    if (ptr == NULL) {
+      return -1;
+    }
+
+    cap->files = ptr;
+    cap->file_alloc = new_alloc;
+  }
+
+  cap->files[cap->file_count] = lint_arena_strdup(cap->arena, source_file);
+  if (cap->files[cap->file_count] == NULL) {
+    return -1;
+  }
+
+  return (int) cap->file_count++;
+}
+
+int lint_capture_add_line(struct lint_capture *cap, const char *text,
+    size_t textsz, server_rec *s, const char *source_file,
+    unsigned int source_lineno) {
+  struct record_chunk *chunk;
+  struct capture_record *rec;
+  const char *captured;
+  int file_id;
+
+  if (cap == NULL ||
+      text == NULL ||
+      source_file == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  chunk = cap->last_records;
+  if (chunk->count == LINT_CAPTURE_CHUNK_ENTRIES) {
+    chunk = lint_arena_alloc(cap->arena, sizeof(struct record_chunk));
+    if (chunk == NULL) {
+      return -1;
+    }
+
+    chunk->next = NULL;
+    chunk->count = 0;
+    cap->last_records->next = chunk;
+    cap->last_records = chunk;
+  }
+
+  captured = capture_text(cap, text, textsz);
+  if (captured == NULL) {
+    return -1;
+  }
+
+  file_id = capture_file(cap, source_file);
+  if (file_id < 0) {
+    return -1;
+  }
+
+  rec = &(chunk->records[chunk->count++]);
+  rec->text = captured;
+  rec->server = s;
+  rec->textsz = (uint32_t) textsz;
+  rec->file_id = (uint32_t) file_id;
+  rec->lineno = source_lineno;
+  rec->config_count = 0;
+
+  cap->record_count++;
+  return 0;
+}
+
+int lint_capture_set_server(struct lint_capture *cap, server_rec *s) {
+  struct record_chunk *records;
+
+  if (cap == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  records = cap->last_records;
+  if (records->count == 0) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  records->records[records->count-1].server = s;
+  return 0;
+}
+
+int lint_capture_add_config(struct lint_capture *cap, const config_rec *c) {
+  struct config_chunk *chunk;
+  struct record_chunk *records;
+
+  if (cap == NULL ||
+      c == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  records = cap->last_records;
+  if (records->count == 0) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  chunk = cap->last_configs;
+  if (chunk->count == LINT_CAPTURE_CHUNK_ENTRIES) {
+    chunk = lint_arena_alloc(cap->arena, sizeof(struct config_chunk));
+    if (chunk == NULL) {
+      return -1;
+    }
+
+    chunk->next = NULL;
+    chunk->count = 0;
+    cap->last_configs->next = chunk;
+    cap->last_configs = chunk;
+  }
+
+  chunk->configs[chunk->count++] = c;
+  records->records[records->count-1].config_count++;
+  return 0;
+}
+
+unsigned int lint_capture_count(struct lint_capture *cap) {
+  if (cap == NULL) {
+    return 0;
+  }
+
+  return cap->record_count;
+}
+
+int lint_capture_visit(struct lint_capture *cap,
+    const struct lint_capture_visitor *visitor, void *data) {
+  struct record_chunk *records;
+  struct config_chunk *configs;
+  unsigned int config_idx = 0;
+
+  if (cap == NULL ||
+      visitor == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  configs = cap->first_configs;
+
+  for (records = cap->first_records; records; records = records->next) {
+    register unsigned int i;
+
+    for (i = 0; i < records->count; i++) {
+      register unsigned int j;
+      struct capture_record *rec;
+
+      rec = &(records->records[i]);
+
+      if (visitor->line != NULL &&
+          visitor->line(data, rec->text, rec->textsz, rec->server,
+            cap->files[rec->file_id], rec->lineno) < 0) {
+        return -1;
+      }
+
+      for (j = 0; j < rec->config_count; j++) {
+        if (config_idx == configs->count) {
+          configs = configs->next;
+          config_idx = 0;
+        }
+
+        if (visitor->config != NULL &&
+            visitor->config(data, configs->configs[config_idx]) < 0) {
+          return -1;
+        }
+
+        config_idx++;
+      }
+    }
+  }
+
+  pr_trace_msg(trace_channel, 17, "visited %u captured lines",
+    cap->record_count);
+  return 0;
+}
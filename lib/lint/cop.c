@@ -24,34 +24,38 @@
 
 #include "mod_lint.h"
 #include "lint/cop.h"
+#include "lint/providers.h"
 
 /* Known cops. */
-struct lint_cop *lint_cop_get_core_cop(void);
-struct lint_cop *lint_cop_get_default_cop(void);
+const struct lint_cop *lint_cop_get_default_cop(void);
 
-struct lint_cop_provider {
-  const char *name;
-  struct lint_cop *(*get_cop)(void);
-};
+/* Cops registered at runtime, by other modules, keyed by module name and
+ * by config name.
+ */
+struct lint_cop_registration {
+  module *m;
+  const char *module_name;
 
-static struct lint_cop_provider module_providers[] = {
-  { "core",	lint_cop_get_core_cop },
-  { NULL, 	NULL }
+  /* The module's file name, as provided when the module is unloaded. */
+  const char *module_file;
+  const struct lint_cop *cop;
 };
 
+static pool *cop_pool = NULL;
+static pr_table_t *module_cops = NULL;
+static pr_table_t *config_cops = NULL;
+
+static const char *trace_channel = "lint.cop";
+
 /* Here's where things get messy.  We need to maintain our own heuristic,
- * a list of known config_rec names and their corresponding modules.
+ * a list of known config_rec names and their corresponding modules.  These
+ * lists are in lib/lint/cop/providers.spec, from which the lookup tables
+ * are generated.
  */
-static struct lint_cop_provider config_providers[] = {
-  { "GroupID",		lint_cop_get_core_cop },
-  { "GroupName",	lint_cop_get_core_cop },
-  { "UserID",		lint_cop_get_core_cop },
-  { "UserName",		lint_cop_get_core_cop },
-  { NULL, 		NULL }
-};
 
-const struct lint_cop *lint_cop_get_config_cop(config_rec *c) {
-  register unsigned int i;
+const struct lint_cop *lint_cop_get_config_cop(config_rec *c,
+    struct lint_cop_ctx *ctx) {
+  const struct lint_cop *cop;
   conftable *conftab = NULL;
   int idx = -1;
   unsigned int hash = 0;
@@ -67,51 +71,238 @@ const struct lint_cop *lint_cop_get_config_cop(config_rec *c) {
 
   conftab = pr_stash_get_symbol2(PR_SYM_CONF, c->name, NULL, &idx, &hash);
   if (conftab != NULL) {
-    return lint_cop_get_module_cop(conftab->m);
+    return lint_cop_get_module_cop(conftab->m, ctx);
   }
 
-  for (i = 0; config_providers[i].name != NULL; i++) {
-    if (strcmp(c->name, config_providers[i].name) == 0) {
-      return (*config_providers[i].get_cop)();
+  if (config_cops != NULL) {
+    const struct lint_cop_registration *reg;
+
+    reg = pr_table_get(config_cops, c->name, NULL);
+    if (reg != NULL) {
+      if (ctx != NULL) {
+        ctx->cop = reg->cop;
+        ctx->m = reg->m;
+      }
+
+      return reg->cop;
     }
   }
 
-  errno = ENOENT;
-  return NULL;
+  cop = lint_providers_get_config_cop(c->name);
+  if (cop == NULL) {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  if (ctx != NULL) {
+    ctx->cop = cop;
+    ctx->m = NULL;
+  }
+
+  return cop;
 }
 
-const struct lint_cop *lint_cop_get_module_cop(module *m) {
-  register unsigned int i;
-  struct lint_cop *cop = NULL;
+const struct lint_cop *lint_cop_get_module_cop(module *m,
+    struct lint_cop_ctx *ctx) {
+  const struct lint_cop *cop = NULL;
 
   if (m == NULL) {
     errno = EINVAL;
     return NULL;
   }
 
-  for (i = 0; module_providers[i].name != NULL; i++) {
-    if (strcmp(m->name, module_providers[i].name) == 0) {
-      cop = (*module_providers[i].get_cop)();
-      break;
+  if (module_cops != NULL) {
+    const struct lint_cop_registration *reg;
+
+    reg = pr_table_get(module_cops, m->name, NULL);
+    if (reg != NULL) {
+      cop = reg->cop;
     }
   }
 
+  if (cop == NULL) {
+    cop = lint_providers_get_module_cop(m->name);
+  }
+
   if (cop == NULL) {
     cop = lint_cop_get_default_cop();
   }
 
-  cop->m = m;
+  if (ctx != NULL) {
+    ctx->cop = cop;
+    ctx->m = m;
+  }
+
   return cop;
 }
 
-const char *lint_cop_get_directive(const struct lint_cop *cop, pool *p,
+const char *lint_cop_get_directive(const struct lint_cop_ctx *ctx, pool *p,
     config_rec *c) {
-  if (cop == NULL ||
+  if (ctx == NULL ||
+      ctx->cop == NULL ||
       p == NULL ||
       c == NULL) {
     errno = EINVAL;
     return NULL;
   }
 
-  return (cop->get_directive)(p, c);
+  return (ctx->cop->get_directive)(p, ctx, c);
+}
+
+int lint_cop_register(module *m, const char *config_name,
+    const struct lint_cop *cop) {
+  struct lint_cop_registration *reg;
+  pr_table_t *tab;
+  const char *key;
+
+  if (m == NULL ||
+      cop == NULL ||
+      cop->get_directive == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (cop_pool == NULL) {
+    cop_pool = make_sub_pool(permanent_pool);
+    pr_pool_tag(cop_pool, "Lint cop pool");
+
+    module_cops = pr_table_alloc(cop_pool, 0);
+    config_cops = pr_table_alloc(cop_pool, 0);
+  }
+
+  if (config_name != NULL) {
+    tab = config_cops;
+    key = config_name;
+
+  } else {
+    tab = module_cops;
+    key = m->name;
+  }
+
+  if (pr_table_get(tab, key, NULL) != NULL) {
+    errno = EEXIST;
+    return -1;
+  }
+
+  reg = pcalloc(cop_pool, sizeof(struct lint_cop_registration));
+  reg->m = m;
+  reg->module_name = pstrdup(cop_pool, m->name);
+  reg->module_file = pstrcat(cop_pool, "mod_", m->name, ".c", NULL);
+  reg->cop = cop;
+
+  if (pr_table_add(tab, pstrdup(cop_pool, key), reg,
+      sizeof(struct lint_cop_registration)) < 0) {
+    return -1;
+  }
+
+  pr_trace_msg(trace_channel, 9, "registered '%s' cop for %s %s%s%s",
+    cop->name, reg->module_file, config_name ? "config '" : "configs",
+    config_name ? config_name : "", config_name ? "'" : "");
+  return 0;
+}
+
+int lint_cop_unregister(module *m, const char *config_name) {
+  const struct lint_cop_registration *reg;
+  pr_table_t *tab;
+  const char *key;
+
+  if (m == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (cop_pool == NULL) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  if (config_name != NULL) {
+    tab = config_cops;
+    key = config_name;
+
+  } else {
+    tab = module_cops;
+    key = m->name;
+  }
+
+  reg = pr_table_get(tab, key, NULL);
+  if (reg == NULL ||
+      strcmp(reg->module_name, m->name) != 0) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  (void) pr_table_remove(tab, key, NULL);
+  return 0;
+}
+
+static int unregister_module_cops(pr_table_t *tab, const char *module_file) {
+  register unsigned int i;
+  pool *tmp_pool;
+  array_header *keys;
+  const void *key;
+  int count = 0;
+
+  tmp_pool = make_sub_pool(cop_pool);
+  keys = make_array(tmp_pool, 0, sizeof(const char *));
+
+  /* Collect the keys first, since we cannot remove entries while
+   * iterating.
+   */
+  (void) pr_table_rewind(tab);
+  key = pr_table_next(tab);
+  while (key != NULL) {
+    const struct lint_cop_registration *reg;
+
+    reg = pr_table_get(tab, key, NULL);
+    if (reg != NULL &&
+        strcmp(reg->module_file, module_file) == 0) {
+      *((const char **) push_array(keys)) = key;
+    }
+
+    key = pr_table_next(tab);
+  }
+
+  for (i = 0; i < keys->nelts; i++) {
+    const char *k;
+
+    k = ((const char **) keys->elts)[i];
+    (void) pr_table_remove(tab, k, NULL);
+    count++;
+  }
+
+  destroy_pool(tmp_pool);
+  return count;
+}
+
+int lint_cop_unregister_module(const char *module_file) {
+  int count;
+
+  if (module_file == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (cop_pool == NULL) {
+    return 0;
+  }
+
+  count = unregister_module_cops(module_cops, module_file);
+  count += unregister_module_cops(config_cops, module_file);
+
+  if (count > 0) {
+    pr_trace_msg(trace_channel, 9, "unregistered %d %s for %s", count,
+      count != 1 ? "cops" : "cop", module_file);
+  }
+
+  return count;
+}
+
+void lint_cop_free(void) {
+  if (cop_pool != NULL) {
+    destroy_pool(cop_pool);
+    cop_pool = NULL;
+    module_cops = NULL;
+    config_cops = NULL;
+  }
 }
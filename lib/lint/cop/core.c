@@ -24,30 +24,30 @@
 
 #include "mod_lint.h"
 #include "lint/cop.h"
+#include "lint/providers.h"
 
-static const char *get_directive(pool *p, config_rec *c) {
-  if (strcmp(c->name, "DirUmask") == 0 ||
-      strcmp(c->name, "GroupID") == 0 ||
-      strcmp(c->name, "UserID") == 0) {
-    errno = ENOENT;
-    return NULL;
-  }
+static const char *get_directive(pool *p, const struct lint_cop_ctx *ctx,
+    config_rec *c) {
+  const char *directive = NULL;
 
-  if (strcmp(c->name, "GroupName") == 0) {
-    return "Group";
+  /* Configs whose names differ from their directives are listed in
+   * lib/lint/cop/providers.spec.
+   */
+  if (lint_providers_get_directive("core", c->name, &directive) < 0) {
+    return c->name;
   }
 
-  if (strcmp(c->name, "UserName") == 0) {
-    return "User";
+  if (directive == NULL) {
+    errno = ENOENT;
   }
 
-  return c->name;
+  return directive;
 }
 
-struct lint_cop core_cop = {
-  "core",	NULL,	get_directive
+static const struct lint_cop core_cop = {
+  "core",	get_directive
 };
 
-struct lint_cop *lint_cop_get_core_cop(void) {
+const struct lint_cop *lint_cop_get_core_cop(void) {
   return &core_cop;
 }
@@ -25,14 +25,15 @@
 #include "mod_lint.h"
 #include "lint/cop.h"
 
-static const char *get_directive(pool *p, config_rec *c) {
+static const char *get_directive(pool *p, const struct lint_cop_ctx *ctx,
+    config_rec *c) {
   return c->name;
 }
 
-struct lint_cop default_cop = {
-  "default",	NULL,	get_directive
+static const struct lint_cop default_cop = {
+  "default",	get_directive
 };
 
-struct lint_cop *lint_cop_get_default_cop(void) {
+const struct lint_cop *lint_cop_get_default_cop(void) {
   return &default_cop;
 }
@@ -0,0 +1,165 @@
+/*
+ * ProFTPD - mod_lint cop providers
+ *
+ * This file is generated from providers.spec by providers.pl; do not edit
+ * it directly.
+ */
+
+#include "mod_lint.h"
+#include "lint/providers.h"
+
+const struct lint_cop *lint_cop_get_core_cop(void);
+
+struct lint_provider_entry {
+  const char *key;
+  const char *key2;
+  const struct lint_cop *(*get_cop)(void);
+  const char *directive;
+};
+
+#define LINT_PROVIDERS_MODULE_NSLOTS	1
+
+static const uint32_t module_seeds[1] = {
+  1
+};
+
+static const struct lint_provider_entry module_entries[1] = {
+  { "core", NULL, lint_cop_get_core_cop, NULL }
+};
+
+#define LINT_PROVIDERS_CONFIG_NSLOTS	4
+
+static const uint32_t config_seeds[4] = {
+  0,
+  1,
+  0,
+  2
+};
+
+static const struct lint_provider_entry config_entries[4] = {
+  { "GroupID", NULL, lint_cop_get_core_cop, NULL },
+  { "UserID", NULL, lint_cop_get_core_cop, NULL },
+  { "GroupName", NULL, lint_cop_get_core_cop, NULL },
+  { "UserName", NULL, lint_cop_get_core_cop, NULL }
+};
+
+#define LINT_PROVIDERS_DIRECTIVE_NSLOTS	5
+
+static const uint32_t directive_seeds[5] = {
+  2,
+  3,
+  1,
+  7,
+  0
+};
+
+static const struct lint_provider_entry directive_entries[5] = {
+  { "core", "UserID", NULL, NULL },
+  { "core", "UserName", NULL, "User" },
+  { "core", "DirUmask", NULL, NULL },
+  { "core", "GroupName", NULL, "Group" },
+  { "core", "GroupID", NULL, NULL }
+};
+
+static uint32_t providers_hash(uint32_t seed, const char *key,
+    const char *key2) {
+  register unsigned int i;
+  uint32_t h = 2166136261U;
+  unsigned char seed_bytes[4];
+  const unsigned char *ptr;
+
+  seed_bytes[0] = (seed >> 24) & 0xff;
+  seed_bytes[1] = (seed >> 16) & 0xff;
+  seed_bytes[2] = (seed >> 8) & 0xff;
+  seed_bytes[3] = seed & 0xff;
+
+  for (i = 0; i < sizeof(seed_bytes); i++) {
+    h = (h ^ seed_bytes[i]) * 16777619U;
+  }
+
+  for (ptr = (const unsigned char *) key; *ptr; ptr++) {
+    h = (h ^ *ptr) * 16777619U;
+  }
+
+  if (key2 != NULL) {
+    h *= 16777619U;
+
+    for (ptr = (const unsigned char *) key2; *ptr; ptr++) {
+      h = (h ^ *ptr) * 16777619U;
+    }
+  }
+
+  h ^= (h >> 16);
+  h *= 0x85ebca6bU;
+  h ^= (h >> 13);
+  h *= 0xc2b2ae35U;
+  h ^= (h >> 16);
+
+  return h;
+}
+
+static const struct lint_provider_entry *providers_find(
+    const uint32_t *seeds, const struct lint_provider_entry *entries,
+    uint32_t nslots, const char *key, const char *key2) {
+  const struct lint_provider_entry *entry;
+  uint32_t seed;
+
+  seed = seeds[providers_hash(0, key, key2) % nslots];
+  entry = &(entries[providers_hash(seed, key, key2) % nslots]);
+
+  if (entry->key == NULL ||
+      strcmp(entry->key, key) != 0) {
+    return NULL;
+  }
+
+  if (key2 != NULL &&
+      (entry->key2 == NULL ||
+       strcmp(entry->key2, key2) != 0)) {
+    return NULL;
+  }
+
+  return entry;
+}
+
+const struct lint_cop *lint_providers_get_module_cop(
+    const char *module_name) {
+  const struct lint_provider_entry *entry;
+
+  entry = providers_find(module_seeds, module_entries,
+    LINT_PROVIDERS_MODULE_NSLOTS, module_name, NULL);
+  if (entry == NULL) {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  return (entry->get_cop)();
+}
+
+const struct lint_cop *lint_providers_get_config_cop(
+    const char *config_name) {
+  const struct lint_provider_entry *entry;
+
+  entry = providers_find(config_seeds, config_entries,
+    LINT_PROVIDERS_CONFIG_NSLOTS, config_name, NULL);
+  if (entry == NULL) {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  return (entry->get_cop)();
+}
+
+int lint_providers_get_directive(const char *cop_name,
+    const char *config_name, const char **directive) {
+  const struct lint_provider_entry *entry;
+
+  entry = providers_find(directive_seeds, directive_entries,
+    LINT_PROVIDERS_DIRECTIVE_NSLOTS, cop_name, config_name);
+  if (entry == NULL) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  *directive = entry->directive;
+  return 0;
+}
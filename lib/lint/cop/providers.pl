@@ -0,0 +1,314 @@
+#!/usr/bin/env perl
+#
+# Generates the mod_lint cop provider lookup tables, as minimal perfect hash
+# tables, from the declarative spec:
+#
+#   perl providers.pl providers.spec > providers.c
+#
+# Each table is built using "hash and displace": keys are first hashed
+# into buckets, and then, largest bucket first, each bucket is assigned the
+# smallest seed which places all of its keys into free slots.  A lookup is
+# thus two hashes, and a single key comparison, regardless of table size.
+
+use strict;
+use warnings;
+
+my $spec_path = shift(@ARGV);
+unless (defined($spec_path)) {
+  die("usage: $0 <spec>\n");
+}
+
+my $modules = [];
+my $configs = [];
+my $directives = [];
+my $cops = {};
+
+open(my $spec, '<', $spec_path) or die("Can't read $spec_path: $!\n");
+while (my $line = <$spec>) {
+  chomp($line);
+  $line =~ s/#.*$//;
+  next if $line =~ /^\s*$/;
+
+  my @fields = split(/\s+/, $line);
+  my $kind = shift(@fields);
+
+  if ($kind eq 'module' && scalar(@fields) == 2) {
+    push(@$modules, { key => $fields[0], key2 => undef, cop => $fields[1] });
+    $cops->{$fields[1]} = 1;
+
+  } elsif ($kind eq 'config' && scalar(@fields) == 2) {
+    push(@$configs, { key => $fields[0], key2 => undef, cop => $fields[1] });
+    $cops->{$fields[1]} = 1;
+
+  } elsif ($kind eq 'directive' && scalar(@fields) == 3) {
+    push(@$directives, { key => $fields[0], key2 => $fields[1],
+      directive => ($fields[2] eq '-' ? undef : $fields[2]) });
+
+  } else {
+    die("$spec_path:$.: malformed line\n");
+  }
+}
+close($spec);
+
+# 32-bit multiplication, modulo 2^32, without overflowing 64-bit integers.
+sub mul32 {
+  my ($a, $b) = @_;
+
+  return (($a * ($b & 0xffff)) +
+    ((($a * ($b >> 16)) & 0xffff) << 16)) & 0xffffffff;
+}
+
+# 32-bit FNV-1a, over the seed bytes and then the key bytes, and then mixed,
+# since the low bits of FNV-1a alone are poorly distributed; the second key,
+# if any, follows a NUL separator.  This must match providers_hash() in the
+# generated C code.
+sub hash_key {
+  my ($seed, $key, $key2) = @_;
+  my $h = 2166136261;
+
+  my $data = pack('N', $seed) . $key;
+  if (defined($key2)) {
+    $data .= "\0" . $key2;
+  }
+
+  foreach my $c (unpack('C*', $data)) {
+    $h = (($h ^ $c) * 16777619) & 0xffffffff;
+  }
+
+  $h ^= ($h >> 16);
+  $h = mul32($h, 0x85ebca6b);
+  $h ^= ($h >> 13);
+  $h = mul32($h, 0xc2b2ae35);
+  $h ^= ($h >> 16);
+
+  return $h;
+}
+
+sub build_table {
+  my ($name, $entries) = @_;
+  my $n = scalar(@$entries);
+  my $nslots = $n > 0 ? $n : 1;
+
+  my $seen = {};
+  foreach my $entry (@$entries) {
+    my $id = $entry->{key} . (defined($entry->{key2}) ? "\0$entry->{key2}" : '');
+    die("duplicate $name entry: $entry->{key}\n") if $seen->{$id}++;
+  }
+
+  my $buckets = [];
+  foreach my $entry (@$entries) {
+    my $idx = hash_key(0, $entry->{key}, $entry->{key2}) % $nslots;
+    push(@{ $buckets->[$idx] }, $entry);
+  }
+
+  my $seeds = [ (0) x $nslots ];
+  my $slots = [ (undef) x $nslots ];
+
+  my @order = sort {
+    scalar(@{ $buckets->[$b] || [] }) <=> scalar(@{ $buckets->[$a] || [] }) ||
+    $a <=> $b
+  } (0..($nslots - 1));
+
+  foreach my $b (@order) {
+    my $bucket = $buckets->[$b];
+    next unless defined($bucket);
+
+    my $seed = 1;
+    while (1) {
+      my $taken = {};
+      my $ok = 1;
+
+      foreach my $entry (@$bucket) {
+        my $slot = hash_key($seed, $entry->{key}, $entry->{key2}) % $nslots;
+        if (defined($slots->[$slot]) || $taken->{$slot}) {
+          $ok = 0;
+          last;
+        }
+
+        $taken->{$slot} = $entry;
+      }
+
+      if ($ok) {
+        foreach my $slot (keys(%$taken)) {
+          $slots->[$slot] = $taken->{$slot};
+        }
+
+        $seeds->[$b] = $seed;
+        last;
+      }
+
+      $seed++;
+      die("unable to place $name bucket $b\n") if $seed > 1000000;
+    }
+  }
+
+  return ($seeds, $slots);
+}
+
+sub c_str {
+  my $str = shift;
+  return defined($str) ? "\"$str\"" : 'NULL';
+}
+
+sub emit_table {
+  my ($name, $entries) = @_;
+  my ($seeds, $slots) = build_table($name, $entries);
+  my $nslots = scalar(@$seeds);
+
+  print "#define LINT_PROVIDERS_", uc($name), "_NSLOTS\t$nslots\n\n";
+
+  print "static const uint32_t ${name}_seeds[$nslots] = {\n";
+  print join(",\n", map { "  $_" } @$seeds), "\n};\n\n";
+
+  print "static const struct lint_provider_entry ${name}_entries[$nslots] = {\n";
+  my @lines;
+  foreach my $entry (@$slots) {
+    if (!defined($entry)) {
+      push(@lines, "  { NULL, NULL, NULL, NULL }");
+      next;
+    }
+
+    my $get_cop = defined($entry->{cop}) ?
+      "lint_cop_get_$entry->{cop}_cop" : 'NULL';
+    push(@lines, sprintf("  { %s, %s, %s, %s }", c_str($entry->{key}),
+      c_str($entry->{key2}), $get_cop, c_str($entry->{directive})));
+  }
+  print join(",\n", @lines), "\n};\n\n";
+}
+
+print <<EOC;
+/*
+ * ProFTPD - mod_lint cop providers
+ *
+ * This file is generated from providers.spec by providers.pl; do not edit
+ * it directly.
+ */
+
+#include "mod_lint.h"
+#include "lint/providers.h"
+
+EOC
+
+foreach my $cop (sort(keys(%$cops))) {
+  print "const struct lint_cop *lint_cop_get_${cop}_cop(void);\n";
+}
+
+print <<EOC;
+
+struct lint_provider_entry {
+  const char *key;
+  const char *key2;
+  const struct lint_cop *(*get_cop)(void);
+  const char *directive;
+};
+
+EOC
+
+emit_table('module', $modules);
+emit_table('config', $configs);
+emit_table('directive', $directives);
+
+print <<'EOC';
+static uint32_t providers_hash(uint32_t seed, const char *key,
+    const char *key2) {
+  register unsigned int i;
+  uint32_t h = 2166136261U;
+  unsigned char seed_bytes[4];
+  const unsigned char *ptr;
+
+  seed_bytes[0] = (seed >> 24) & 0xff;
+  seed_bytes[1] = (seed >> 16) & 0xff;
+  seed_bytes[2] = (seed >> 8) & 0xff;
+  seed_bytes[3] = seed & 0xff;
+
+  for (i = 0; i < sizeof(seed_bytes); i++) {
+    h = (h ^ seed_bytes[i]) * 16777619U;
+  }
+
+  for (ptr = (const unsigned char *) key; *ptr; ptr++) {
+    h = (h ^ *ptr) * 16777619U;
+  }
+
+  if (key2 != NULL) {
+    h *= 16777619U;
+
+    for (ptr = (const unsigned char *) key2; *ptr; ptr++) {
+      h = (h ^ *ptr) * 16777619U;
+    }
+  }
+
+  h ^= (h >> 16);
+  h *= 0x85ebca6bU;
+  h ^= (h >> 13);
+  h *= 0xc2b2ae35U;
+  h ^= (h >> 16);
+
+  return h;
+}
+
+static const struct lint_provider_entry *providers_find(
+    const uint32_t *seeds, const struct lint_provider_entry *entries,
+    uint32_t nslots, const char *key, const char *key2) {
+  const struct lint_provider_entry *entry;
+  uint32_t seed;
+
+  seed = seeds[providers_hash(0, key, key2) % nslots];
+  entry = &(entries[providers_hash(seed, key, key2) % nslots]);
+
+  if (entry->key == NULL ||
+      strcmp(entry->key, key) != 0) {
+    return NULL;
+  }
+
+  if (key2 != NULL &&
+      (entry->key2 == NULL ||
+       strcmp(entry->key2, key2) != 0)) {
+    return NULL;
+  }
+
+  return entry;
+}
+
+const struct lint_cop *lint_providers_get_module_cop(
+    const char *module_name) {
+  const struct lint_provider_entry *entry;
+
+  entry = providers_find(module_seeds, module_entries,
+    LINT_PROVIDERS_MODULE_NSLOTS, module_name, NULL);
+  if (entry == NULL) {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  return (entry->get_cop)();
+}
+
+const struct lint_cop *lint_providers_get_config_cop(
+    const char *config_name) {
+  const struct lint_provider_entry *entry;
+
+  entry = providers_find(config_seeds, config_entries,
+    LINT_PROVIDERS_CONFIG_NSLOTS, config_name, NULL);
+  if (entry == NULL) {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  return (entry->get_cop)();
+}
+
+int lint_providers_get_directive(const char *cop_name,
+    const char *config_name, const char **directive) {
+  const struct lint_provider_entry *entry;
+
+  entry = providers_find(directive_seeds, directive_entries,
+    LINT_PROVIDERS_DIRECTIVE_NSLOTS, cop_name, config_name);
+  if (entry == NULL) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  *directive = entry->directive;
+  return 0;
+}
+EOC
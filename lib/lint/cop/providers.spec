@@ -0,0 +1,32 @@
+# mod_lint cop providers
+#
+# This file is the source for the generated providers.c; after changing it,
+# regenerate that file using:
+#
+#   make lib/lint/cop/providers.c
+#
+# Each line is one of:
+#
+#   module <module-name> <cop>
+#     The cop for configs from the given module.
+#
+#   config <config-name> <cop>
+#     The cop for configs, of the given name, which are not handled by a
+#     directive of the same name.
+#
+#   directive <cop> <config-name> <directive>
+#     The directive which the given cop emits for configs of the given name;
+#     a directive of "-" means that no directive is emitted for such configs.
+
+module		core		core
+
+config		GroupID		core
+config		GroupName	core
+config		UserID		core
+config		UserName	core
+
+directive	core		DirUmask	-
+directive	core		GroupID		-
+directive	core		GroupName	Group
+directive	core		UserID		-
+directive	core		UserName	User
@@ -0,0 +1,545 @@
+/*
+ * ProFTPD: mod_lint DNS implementation
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+#include "mod_lint.h"
+#include "lint/dns.h"
+#include "lint/text.h"
+#include "lint/hash.h"
+
+#include <sys/mman.h>
+#include <arpa/inet.h>
+
+struct dns_name {
+  const char *name;
+  const char *addr;
+};
+
+struct lint_dns {
+  pool *pool;
+
+  /* Keyed by the lowercased name. */
+  pr_table_t *names;
+};
+
+/* The directives whose arguments are addresses. */
+static const char *address_directives[] = {
+  "<VirtualHost",
+  "Bind",
+  "DefaultAddress",
+  "MasqueradeAddress",
+  NULL
+};
+
+static const char *trace_channel = "lint.dns";
+
+struct lint_dns *lint_dns_alloc(pool *p) {
+  pool *dns_pool;
+  struct lint_dns *dns;
+
+  if (p == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  dns_pool = make_sub_pool(p);
+  pr_pool_tag(dns_pool, "Lint DNS pool");
+
+  dns = pcalloc(dns_pool, sizeof(struct lint_dns));
+  dns->pool = dns_pool;
+  dns->names = pr_table_nalloc(dns_pool, 0, 32);
+
+  return dns;
+}
+
+/* Returns the length of the leading directive of the text, if it is an
+ * address directive, else zero.
+ */
+static size_t address_directive_len(const char *text) {
+  register unsigned int i;
+  const char *ptr;
+  size_t len;
+
+  for (ptr = text; *ptr && !PR_ISSPACE(*ptr); ptr++) {
+  }
+
+  len = ptr - text;
+  for (i = 0; address_directives[i] != NULL; i++) {
+    if (strlen(address_directives[i]) == len &&
+        strncasecmp(text, address_directives[i], len) == 0) {
+      return len;
+    }
+  }
+
+  return 0;
+}
+
+array_header *lint_dns_parse_line(pool *p, const char *text) {
+  array_header *args;
+  const char *ptr;
+  size_t len;
+  int container;
+
+  if (p == NULL ||
+      text == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  for (; *text && PR_ISSPACE(*text); text++) {
+  }
+
+  len = address_directive_len(text);
+  if (len == 0) {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  container = (*text == '<');
+  args = make_array(p, 2, sizeof(char *));
+
+  ptr = text + len;
+  while (*ptr) {
+    const char *arg;
+    size_t arglen;
+
+    if (PR_ISSPACE(*ptr)) {
+      ptr++;
+      continue;
+    }
+
+    if (*ptr == '"') {
+      arg = ++ptr;
+      for (; *ptr && *ptr != '"'; ptr++) {
+      }
+
+      arglen = ptr - arg;
+      if (*ptr == '"') {
+        ptr++;
+      }
+
+    } else {
+      arg = ptr;
+      for (; *ptr && !PR_ISSPACE(*ptr); ptr++) {
+      }
+
+      arglen = ptr - arg;
+    }
+
+    /* The closing bracket of a container is not part of its arguments. */
+    if (container == TRUE &&
+        arglen > 0 &&
+        arg[arglen-1] == '>') {
+      arglen--;
+    }
+
+    if (arglen > 0) {
+      *((char **) push_array(args)) = pstrndup(p, arg, arglen);
+    }
+  }
+
+  return args;
+}
+
+int lint_dns_is_name(const char *addr) {
+  unsigned char buf[sizeof(struct in6_addr)];
+  char ipstr[INET6_ADDRSTRLEN + 1];
+  size_t len;
+
+  if (addr == NULL) {
+    return FALSE;
+  }
+
+  if (inet_pton(AF_INET, addr, buf) == 1 ||
+      inet_pton(AF_INET6, addr, buf) == 1) {
+    return FALSE;
+  }
+
+  /* IPv6 addresses may be bracketed. */
+  len = strlen(addr);
+  if (len > 2 &&
+      len < sizeof(ipstr) + 2 &&
+      addr[0] == '[' &&
+      addr[len-1] == ']') {
+    memcpy(ipstr, addr + 1, len - 2);
+    ipstr[len-2] = '\0';
+
+    if (inet_pton(AF_INET6, ipstr, buf) == 1) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static const char *get_key(pool *p, const char *name) {
+  char *key, *ptr;
+
+  key = pstrdup(p, name);
+  for (ptr = key; *ptr; ptr++) {
+    *ptr = tolower((int) *ptr);
+  }
+
+  return key;
+}
+
+int lint_dns_add_name(struct lint_dns *dns, const char *name,
+    const char *addr) {
+  struct dns_name *dn;
+  const char *key;
+
+  if (dns == NULL ||
+      name == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  key = get_key(dns->pool, name);
+  dn = (struct dns_name *) pr_table_get(dns->names, key, NULL);
+  if (dn != NULL) {
+    if (dn->addr == NULL &&
+        addr != NULL) {
+      dn->addr = pstrdup(dns->pool, addr);
+    }
+
+    return 0;
+  }
+
+  dn = pcalloc(dns->pool, sizeof(struct dns_name));
+  dn->name = pstrdup(dns->pool, name);
+  if (addr != NULL) {
+    dn->addr = pstrdup(dns->pool, addr);
+  }
+
+  return pr_table_add(dns->names, key, dn, sizeof(struct dns_name *));
+}
+
+const char *lint_dns_get_addr(struct lint_dns *dns, const char *name) {
+  const struct dns_name *dn;
+  char key[256];
+  size_t i;
+
+  if (dns == NULL ||
+      name == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  for (i = 0; name[i] && i < sizeof(key)-1; i++) {
+    key[i] = tolower((int) name[i]);
+  }
+  key[i] = '\0';
+
+  dn = pr_table_get(dns->names, key, NULL);
+  if (dn == NULL ||
+      dn->addr == NULL) {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  return dn->addr;
+}
+
+unsigned int lint_dns_count(struct lint_dns *dns) {
+  if (dns == NULL) {
+    return 0;
+  }
+
+  return (unsigned int) pr_table_count(dns->names);
+}
+
+static int namecmp(const void *a, const void *b) {
+  return strcmp(*((const char **) a), *((const char **) b));
+}
+
+int lint_dns_hash(struct lint_dns *dns, uint64_t *hash) {
+  register unsigned int i;
+  pool *tmp_pool;
+  array_header *keys;
+  const void *key;
+  const char **elts;
+  uint64_t h = LINT_HASH_INIT;
+
+  if (dns == NULL ||
+      hash == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  tmp_pool = make_sub_pool(dns->pool);
+  keys = make_array(tmp_pool, pr_table_count(dns->names),
+    sizeof(const char *));
+
+  (void) pr_table_rewind(dns->names);
+  key = pr_table_next(dns->names);
+  while (key != NULL) {
+    *((const char **) push_array(keys)) = key;
+    key = pr_table_next(dns->names);
+  }
+
+  elts = keys->elts;
+  qsort(elts, keys->nelts, sizeof(const char *), namecmp);
+
+  for (i = 0; i < keys->nelts; i++) {
+    const struct dns_name *dn;
+
+    dn = pr_table_get(dns->names, elts[i], NULL);
+    h = lint_hash_update(h, elts[i], strlen(elts[i]) + 1);
+    if (dn != NULL &&
+        dn->addr != NULL) {
+      h = lint_hash_update(h, dn->addr, strlen(dn->addr) + 1);
+
+    } else {
+      h = lint_hash_update(h, "", 1);
+    }
+  }
+
+  destroy_pool(tmp_pool);
+
+  *hash = h;
+  return 0;
+}
+
+/* Writes the line, substituting the known addresses, returning the number
+ * of substitutions made.
+ */
+static int write_numeric_line(struct lint_dns *dns, pool *p,
+    struct lint_text_writer *w, const char *line, size_t linesz) {
+  register unsigned int i;
+  const char *text, *indent;
+  char **args;
+  array_header *list;
+  size_t indentsz, dirsz;
+  int nsubs = 0;
+
+  indent = text = pstrndup(p, line, linesz);
+  for (; *text && PR_ISSPACE(*text); text++) {
+  }
+  indentsz = text - indent;
+
+  list = lint_dns_parse_line(p, text);
+  if (list == NULL) {
+    return 0;
+  }
+
+  args = list->elts;
+  for (i = 0; i < list->nelts; i++) {
+    const char *addr;
+
+    if (lint_dns_is_name(args[i]) == FALSE) {
+      continue;
+    }
+
+    addr = lint_dns_get_addr(dns, args[i]);
+    if (addr != NULL) {
+      args[i] = (char *) addr;
+      nsubs++;
+    }
+  }
+
+  if (nsubs == 0) {
+    return 0;
+  }
+
+  dirsz = address_directive_len(text);
+  if (lint_text_writer_text(w, indent, indentsz + dirsz) < 0) {
+    return -1;
+  }
+
+  for (i = 0; i < list->nelts; i++) {
+    if (lint_text_writer_fmt(w, " %s", args[i]) < 0) {
+      return -1;
+    }
+  }
+
+  if (lint_text_writer_text(w, *text == '<' ? ">\n" : "\n",
+      *text == '<' ? 2 : 1) < 0) {
+    return -1;
+  }
+
+  return nsubs;
+}
+
+int lint_dns_write_numeric(struct lint_dns *dns, const char *src_path,
+    const char *dst_path) {
+  pool *tmp_pool;
+  pr_fh_t *fh;
+  struct lint_text_writer *w = NULL;
+  struct stat st;
+  const char *data = NULL, *ptr, *end;
+  char *tmp_path;
+  int fd, nsubs = 0, res = 0, xerrno = 0;
+
+  if (dns == NULL ||
+      src_path == NULL ||
+      dst_path == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  fd = open(src_path, O_RDONLY);
+  if (fd < 0) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 3, "error opening '%s': %s", src_path,
+      strerror(xerrno));
+    errno = xerrno;
+    return -1;
+  }
+
+  if (fstat(fd, &st) < 0) {
+    xerrno = errno;
+
+    (void) close(fd);
+    errno = xerrno;
+    return -1;
+  }
+
+  if (st.st_size > 0) {
+    data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      xerrno = errno;
+
+      (void) close(fd);
+      pr_trace_msg(trace_channel, 3, "error mapping '%s': %s", src_path,
+        strerror(xerrno));
+      errno = xerrno;
+      return -1;
+    }
+  }
+
+  (void) close(fd);
+
+  tmp_pool = make_sub_pool(dns->pool);
+  pr_pool_tag(tmp_pool, "Lint DNS numeric pool");
+
+  /* Write to a temporary file, then rename into place. */
+  tmp_path = pstrcat(tmp_pool, dst_path, ".XXXXXX", NULL);
+  fh = NULL;
+
+  fd = mkstemp(tmp_path);
+  if (fd < 0) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 1,
+      "error creating temporary file for '%s': %s", dst_path,
+      strerror(xerrno));
+    res = -1;
+
+  } else {
+    (void) fchmod(fd, 0644);
+    (void) close(fd);
+
+    fh = pr_fsio_open(tmp_path, O_WRONLY|O_TRUNC);
+    if (fh == NULL) {
+      xerrno = errno;
+
+      pr_trace_msg(trace_channel, 1, "error opening '%s': %s", tmp_path,
+        strerror(xerrno));
+      (void) pr_fsio_unlink(tmp_path);
+      res = -1;
+    }
+  }
+
+  if (fh != NULL) {
+    w = lint_text_writer_create(tmp_pool, fh);
+    if (w == NULL) {
+      xerrno = errno;
+
+      (void) pr_fsio_close(fh);
+      (void) pr_fsio_unlink(tmp_path);
+      fh = NULL;
+      res = -1;
+    }
+  }
+
+  ptr = data;
+  end = data + st.st_size;
+  while (res == 0 &&
+         ptr < end) {
+    const char *eol, *text;
+    size_t linesz;
+    int count = 0;
+
+    eol = memchr(ptr, '\n', end - ptr);
+    linesz = (eol != NULL ? eol : end) - ptr;
+
+    for (text = ptr; text < ptr + linesz && PR_ISSPACE(*text); text++) {
+    }
+
+    if (address_directive_len(text) > 0) {
+      count = write_numeric_line(dns, tmp_pool, w, ptr, linesz);
+    }
+
+    if (count == 0) {
+      count = lint_text_writer_text(w, ptr, linesz) < 0 ||
+        lint_text_writer_text(w, "\n", 1) < 0 ? -1 : 0;
+    }
+
+    if (count < 0) {
+      xerrno = errno;
+      res = -1;
+      break;
+    }
+
+    nsubs += count;
+    ptr += linesz + 1;
+  }
+
+  if (data != NULL) {
+    (void) munmap((void *) data, (size_t) st.st_size);
+  }
+
+  if (fh != NULL) {
+    if (w != NULL &&
+        lint_text_writer_close(w) < 0 &&
+        res == 0) {
+      xerrno = errno;
+      res = -1;
+    }
+
+    if (res == 0 &&
+        pr_fsio_rename(tmp_path, dst_path) < 0) {
+      xerrno = errno;
+      res = -1;
+    }
+
+    if (res < 0) {
+      pr_trace_msg(trace_channel, 1, "error writing '%s': %s", dst_path,
+        strerror(xerrno));
+      (void) pr_fsio_unlink(tmp_path);
+    }
+  }
+
+  destroy_pool(tmp_pool);
+
+  if (res < 0) {
+    errno = xerrno;
+    return -1;
+  }
+
+  pr_trace_msg(trace_channel, 9, "wrote '%s' with %d %s substituted",
+    dst_path, nsubs, nsubs != 1 ? "addresses" : "address");
+  return nsubs;
+}
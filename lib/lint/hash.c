@@ -0,0 +1,123 @@
+/*
+ * ProFTPD: mod_lint hash implementation
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_lint.h"
+#include "lint/hash.h"
+
+#include <sys/mman.h>
+
+#define LINT_HASH_PRIME		0x100000001b3ULL
+
+static const char *trace_channel = "lint.hash";
+
+uint64_t lint_hash_update(uint64_t hash, const void *data, size_t datasz) {
+  register size_t i;
+  const unsigned char *ptr;
+
+  ptr = data;
+  for (i = 0; i < datasz; i++) {
+    hash ^= ptr[i];
+    hash *= LINT_HASH_PRIME;
+  }
+
+  return hash;
+}
+
+uint64_t lint_hash_data(const void *data, size_t datasz) {
+  return lint_hash_update(LINT_HASH_INIT, data, datasz);
+}
+
+int lint_hash_file(pool *p, const char *path, const char *skip_prefix,
+    uint64_t *hash, off_t *filesz) {
+  int fd, xerrno;
+  struct stat st;
+  const char *data, *ptr;
+  size_t datasz;
+
+  if (p == NULL ||
+      path == NULL ||
+      hash == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 9, "error opening '%s': %s", path,
+      strerror(xerrno));
+    errno = xerrno;
+    return -1;
+  }
+
+  if (fstat(fd, &st) < 0) {
+    xerrno = errno;
+
+    (void) close(fd);
+    errno = xerrno;
+    return -1;
+  }
+
+  if (filesz != NULL) {
+    *filesz = st.st_size;
+  }
+
+  if (st.st_size == 0) {
+    (void) close(fd);
+    *hash = LINT_HASH_INIT;
+    return 0;
+  }
+
+  datasz = (size_t) st.st_size;
+  data = mmap(NULL, datasz, PROT_READ, MAP_PRIVATE, fd, 0);
+  xerrno = errno;
+  (void) close(fd);
+
+  if (data == MAP_FAILED) {
+    pr_trace_msg(trace_channel, 3, "error mapping '%s': %s", path,
+      strerror(xerrno));
+    errno = xerrno;
+    return -1;
+  }
+
+  ptr = data;
+  if (skip_prefix != NULL) {
+    size_t prefixsz;
+
+    prefixsz = strlen(skip_prefix);
+    if (datasz >= prefixsz &&
+        memcmp(data, skip_prefix, prefixsz) == 0) {
+      const char *eol;
+
+      eol = memchr(data, '\n', datasz);
+      ptr = (eol != NULL ? eol + 1 : data + datasz);
+    }
+  }
+
+  *hash = lint_hash_data(ptr, datasz - (ptr - data));
+
+  (void) munmap((void *) data, datasz);
+  return 0;
+}
@@ -0,0 +1,199 @@
+/*
+ * ProFTPD: mod_lint performance implementation
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+#include "mod_lint.h"
+#include "lint/perf.h"
+
+static const char *phase_names[LINT_PERF_NPHASES] = {
+  "ingest",
+  "associate",
+  "header",
+  "defines",
+  "modules",
+  "server_config",
+  "classes",
+  "ctrls",
+  "vhosts",
+  "commit"
+};
+
+static const char *count_names[LINT_PERF_NCOUNTS] = {
+  "lines",
+  "unknown_directives",
+  "config_recs",
+  "lookups",
+  "bytes_written",
+  "syscalls"
+};
+
+static const char *trace_channel = "lint.perf";
+
+void lint_perf_reset(struct lint_perf *perf) {
+  if (perf != NULL) {
+    memset(perf, 0, sizeof(struct lint_perf));
+  }
+}
+
+uint64_t lint_perf_now(void) {
+  struct timespec ts;
+
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0) {
+    return 0;
+  }
+
+  return ((uint64_t) ts.tv_sec * 1000000000ULL) + (uint64_t) ts.tv_nsec;
+}
+
+int lint_perf_add_time(struct lint_perf *perf, unsigned int phase,
+    uint64_t start_ns) {
+  uint64_t now_ns;
+
+  if (perf == NULL ||
+      phase >= LINT_PERF_NPHASES) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  now_ns = lint_perf_now();
+  if (now_ns > start_ns) {
+    perf->phase_ns[phase] += (now_ns - start_ns);
+  }
+
+  return 0;
+}
+
+const char *lint_perf_get_phase_name(unsigned int phase) {
+  if (phase >= LINT_PERF_NPHASES) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  return phase_names[phase];
+}
+
+const char *lint_perf_get_count_name(unsigned int counter) {
+  if (counter >= LINT_PERF_NCOUNTS) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  return count_names[counter];
+}
+
+void lint_perf_trace(const struct lint_perf *perf) {
+  register unsigned int i;
+
+  if (perf == NULL ||
+      pr_trace_get_level(trace_channel) < 5) {
+    return;
+  }
+
+  for (i = 0; i < LINT_PERF_NPHASES; i++) {
+    pr_trace_msg(trace_channel, 5, "phase %s: %lu us", phase_names[i],
+      (unsigned long) (perf->phase_ns[i] / 1000));
+  }
+
+  for (i = 0; i < LINT_PERF_NCOUNTS; i++) {
+    pr_trace_msg(trace_channel, 5, "count %s: %llu", count_names[i],
+      (unsigned long long) perf->counts[i]);
+  }
+}
+
+int lint_perf_write_json(pool *p, const struct lint_perf *perf,
+    const char *path) {
+  register unsigned int i;
+  pool *tmp_pool;
+  pr_fh_t *fh;
+  char *json, *tmp_path, buf[128];
+  int xerrno;
+
+  if (p == NULL ||
+      perf == NULL ||
+      path == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  tmp_pool = make_sub_pool(p);
+  pr_pool_tag(tmp_pool, "Lint perf JSON pool");
+
+  json = pstrdup(tmp_pool, "{\n  \"phases_ns\": {");
+  for (i = 0; i < LINT_PERF_NPHASES; i++) {
+    pr_snprintf(buf, sizeof(buf)-1, "%s\n    \"%s\": %llu",
+      i > 0 ? "," : "", phase_names[i],
+      (unsigned long long) perf->phase_ns[i]);
+    buf[sizeof(buf)-1] = '\0';
+    json = pstrcat(tmp_pool, json, buf, NULL);
+  }
+
+  json = pstrcat(tmp_pool, json, "\n  },\n  \"counts\": {", NULL);
+  for (i = 0; i < LINT_PERF_NCOUNTS; i++) {
+    pr_snprintf(buf, sizeof(buf)-1, "%s\n    \"%s\": %llu",
+      i > 0 ? "," : "", count_names[i],
+      (unsigned long long) perf->counts[i]);
+    buf[sizeof(buf)-1] = '\0';
+    json = pstrcat(tmp_pool, json, buf, NULL);
+  }
+
+  json = pstrcat(tmp_pool, json, "\n  }\n}\n", NULL);
+
+  /* Write to a temporary file, then rename into place. */
+  tmp_path = pstrcat(tmp_pool, path, ".tmp", NULL);
+  fh = pr_fsio_open(tmp_path, O_CREAT|O_WRONLY|O_TRUNC);
+  if (fh == NULL) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 1, "error opening '%s': %s", tmp_path,
+      strerror(xerrno));
+    destroy_pool(tmp_pool);
+    errno = xerrno;
+    return -1;
+  }
+
+  if (pr_fsio_write(fh, json, strlen(json)) < 0) {
+    xerrno = errno;
+
+    (void) pr_fsio_close(fh);
+    (void) pr_fsio_unlink(tmp_path);
+    destroy_pool(tmp_pool);
+    errno = xerrno;
+    return -1;
+  }
+
+  if (pr_fsio_close(fh) < 0 ||
+      pr_fsio_rename(tmp_path, path) < 0) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 1, "error writing '%s': %s", path,
+      strerror(xerrno));
+    (void) pr_fsio_unlink(tmp_path);
+    destroy_pool(tmp_pool);
+    errno = xerrno;
+    return -1;
+  }
+
+  destroy_pool(tmp_pool);
+  return 0;
+}
@@ -0,0 +1,525 @@
+/*
+ * ProFTPD: mod_lint parse profile implementation
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+#include "mod_lint.h"
+#include "lint/profile.h"
+#include "lint/text.h"
+
+/* The number of individual lines reported. */
+#define LINT_PROFILE_TOP_LINES		20
+
+/* The tables may well have more than the default maximum number of
+ * entries, e.g. for configs with many included files.
+ */
+#define LINT_PROFILE_MAX_ENTRIES	(1024 * 1024)
+
+struct profile_entry {
+  const char *name;
+  uint64_t ns;
+  unsigned long nlines;
+  unsigned long nconfigs;
+};
+
+struct profile_index {
+  pr_table_t *tab;
+
+  /* List of struct profile_entry *, in order of addition. */
+  array_header *entries;
+};
+
+struct profile_line {
+  const char *source_file;
+  unsigned int source_lineno;
+  const char *directive;
+  uint64_t ns;
+};
+
+struct lint_profile {
+  pool *pool;
+
+  struct profile_index files;
+  struct profile_index directives;
+  struct profile_index modules;
+  struct profile_index stacks;
+
+  /* The stack of source files, outermost first, as the included files are
+   * entered and left.
+   */
+  array_header *file_stack;
+  const char *file_stack_key;
+
+  /* The entries of the most recently parsed line, to which elapsed time is
+   * attributed.
+   */
+  struct profile_entry *curr_file, *curr_directive, *curr_module, *curr_stack;
+  struct profile_line curr_line;
+
+  struct profile_line top_lines[LINT_PROFILE_TOP_LINES];
+  unsigned int ntop_lines;
+
+  uint64_t first_ns, last_ns, end_ns;
+  unsigned long nlines, nconfigs;
+};
+
+static const char *trace_channel = "lint.profile";
+
+static void index_init(pool *p, struct profile_index *idx) {
+  unsigned int max_ents = LINT_PROFILE_MAX_ENTRIES;
+
+  idx->tab = pr_table_nalloc(p, 0, 64);
+  (void) pr_table_ctl(idx->tab, PR_TABLE_CTL_SET_MAX_ENTS, &max_ents);
+  idx->entries = make_array(p, 64, sizeof(struct profile_entry *));
+}
+
+static struct profile_entry *index_get(pool *p, struct profile_index *idx,
+    const char *name) {
+  struct profile_entry *entry;
+
+  entry = (struct profile_entry *) pr_table_get(idx->tab, name, NULL);
+  if (entry != NULL) {
+    return entry;
+  }
+
+  entry = pcalloc(p, sizeof(struct profile_entry));
+  entry->name = pstrdup(p, name);
+
+  if (pr_table_add(idx->tab, entry->name, entry, sizeof(void *)) < 0) {
+    pr_trace_msg(trace_channel, 3, "error adding '%s' to profile: %s",
+      name, strerror(errno));
+  }
+
+  *((struct profile_entry **) push_array(idx->entries)) = entry;
+  return entry;
+}
+
+struct lint_profile *lint_profile_alloc(pool *p) {
+  pool *prof_pool;
+  struct lint_profile *prof;
+
+  if (p == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  prof_pool = make_sub_pool(p);
+  pr_pool_tag(prof_pool, "Lint profile pool");
+
+  prof = pcalloc(prof_pool, sizeof(struct lint_profile));
+  prof->pool = prof_pool;
+
+  index_init(prof_pool, &(prof->files));
+  index_init(prof_pool, &(prof->directives));
+  index_init(prof_pool, &(prof->modules));
+  index_init(prof_pool, &(prof->stacks));
+  prof->file_stack = make_array(prof_pool, 8, sizeof(char *));
+
+  return prof;
+}
+
+/* Attributes the time since the last event to the current line. */
+static void profile_advance(struct lint_profile *prof, uint64_t now_ns) {
+  uint64_t delta_ns;
+
+  if (prof->curr_file == NULL ||
+      now_ns <= prof->last_ns) {
+    if (prof->last_ns < now_ns) {
+      prof->last_ns = now_ns;
+    }
+
+    return;
+  }
+
+  delta_ns = now_ns - prof->last_ns;
+  prof->curr_file->ns += delta_ns;
+  prof->curr_directive->ns += delta_ns;
+  prof->curr_module->ns += delta_ns;
+  prof->curr_stack->ns += delta_ns;
+  prof->curr_line.ns += delta_ns;
+
+  prof->last_ns = now_ns;
+}
+
+/* Keeps the current line, if it is among the slowest lines seen. */
+static void profile_rank_line(struct lint_profile *prof) {
+  register unsigned int i;
+  struct profile_line *line;
+
+  line = &(prof->curr_line);
+  if (line->source_file == NULL ||
+      line->ns == 0) {
+    return;
+  }
+
+  if (prof->ntop_lines == LINT_PROFILE_TOP_LINES &&
+      prof->top_lines[prof->ntop_lines-1].ns >= line->ns) {
+    return;
+  }
+
+  /* Insertion sort, slowest first. */
+  i = prof->ntop_lines;
+  if (i == LINT_PROFILE_TOP_LINES) {
+    i--;
+
+  } else {
+    prof->ntop_lines++;
+  }
+
+  while (i > 0 &&
+         prof->top_lines[i-1].ns < line->ns) {
+    prof->top_lines[i] = prof->top_lines[i-1];
+    i--;
+  }
+
+  prof->top_lines[i] = *line;
+}
+
+/* Tracks the stack of included files: returning to a file already on the
+ * stack pops the files above it; any other file is pushed.
+ */
+static void profile_enter_file(struct lint_profile *prof,
+    const char *source_file) {
+  const char **files;
+  unsigned int i, nfiles;
+
+  files = prof->file_stack->elts;
+  nfiles = prof->file_stack->nelts;
+
+  if (nfiles > 0 &&
+      strcmp(files[nfiles-1], source_file) == 0) {
+    return;
+  }
+
+  for (i = nfiles; i > 0; i--) {
+    if (strcmp(files[i-1], source_file) == 0) {
+      break;
+    }
+  }
+
+  if (i > 0) {
+    prof->file_stack->nelts = i;
+
+  } else {
+    *((const char **) push_array(prof->file_stack)) = prof->curr_file->name;
+  }
+
+  files = prof->file_stack->elts;
+  prof->file_stack_key = files[0];
+  for (i = 1; i < prof->file_stack->nelts; i++) {
+    prof->file_stack_key = pstrcat(prof->pool, prof->file_stack_key, ";",
+      files[i], NULL);
+  }
+}
+
+int lint_profile_add_line(struct lint_profile *prof, uint64_t now_ns,
+    const char *source_file, unsigned int source_lineno, const char *directive,
+    const char *module_name) {
+  char stack_key[PR_TUNABLE_PATH_MAX * 2];
+
+  if (prof == NULL ||
+      source_file == NULL ||
+      directive == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (module_name == NULL) {
+    module_name = "(unknown)";
+  }
+
+  if (prof->first_ns == 0) {
+    prof->first_ns = prof->last_ns = now_ns;
+  }
+
+  profile_advance(prof, now_ns);
+  profile_rank_line(prof);
+
+  prof->curr_file = index_get(prof->pool, &(prof->files), source_file);
+  prof->curr_directive = index_get(prof->pool, &(prof->directives),
+    directive);
+  prof->curr_module = index_get(prof->pool, &(prof->modules), module_name);
+
+  profile_enter_file(prof, source_file);
+  pr_snprintf(stack_key, sizeof(stack_key)-1, "%s;%s;%s",
+    prof->file_stack_key, module_name, directive);
+  stack_key[sizeof(stack_key)-1] = '\0';
+  prof->curr_stack = index_get(prof->pool, &(prof->stacks), stack_key);
+
+  prof->curr_file->nlines++;
+  prof->curr_directive->nlines++;
+  prof->curr_module->nlines++;
+  prof->curr_stack->nlines++;
+  prof->nlines++;
+
+  prof->curr_line.source_file = prof->curr_file->name;
+  prof->curr_line.source_lineno = source_lineno;
+  prof->curr_line.directive = prof->curr_directive->name;
+  prof->curr_line.ns = 0;
+
+  return 0;
+}
+
+int lint_profile_add_config(struct lint_profile *prof, uint64_t now_ns) {
+  if (prof == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  profile_advance(prof, now_ns);
+
+  if (prof->curr_file != NULL) {
+    prof->curr_file->nconfigs++;
+    prof->curr_directive->nconfigs++;
+    prof->curr_module->nconfigs++;
+    prof->curr_stack->nconfigs++;
+  }
+
+  prof->nconfigs++;
+  return 0;
+}
+
+int lint_profile_finish(struct lint_profile *prof, uint64_t now_ns) {
+  if (prof == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  profile_rank_line(prof);
+  prof->curr_file = NULL;
+  prof->curr_line.source_file = NULL;
+
+  prof->end_ns = now_ns > prof->last_ns ? now_ns : prof->last_ns;
+  return 0;
+}
+
+static int entrycmp(const void *a, const void *b) {
+  const struct profile_entry *ea, *eb;
+
+  ea = *((const struct profile_entry **) a);
+  eb = *((const struct profile_entry **) b);
+
+  if (ea->ns != eb->ns) {
+    return ea->ns > eb->ns ? -1 : 1;
+  }
+
+  return strcmp(ea->name, eb->name);
+}
+
+static struct lint_text_writer *profile_open(pool *p, const char *path,
+    const char **tmp_path) {
+  pr_fh_t *fh;
+  struct lint_text_writer *w;
+  int xerrno;
+
+  /* Write to a temporary file, then rename into place. */
+  *tmp_path = pstrcat(p, path, ".tmp", NULL);
+  fh = pr_fsio_open(*tmp_path, O_CREAT|O_WRONLY|O_TRUNC);
+  if (fh == NULL) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 1, "error opening '%s': %s", *tmp_path,
+      strerror(xerrno));
+    errno = xerrno;
+    return NULL;
+  }
+
+  w = lint_text_writer_create(p, fh);
+  if (w == NULL) {
+    xerrno = errno;
+
+    (void) pr_fsio_close(fh);
+    (void) pr_fsio_unlink(*tmp_path);
+    errno = xerrno;
+    return NULL;
+  }
+
+  return w;
+}
+
+static int profile_close(struct lint_text_writer *w, int res,
+    const char *tmp_path, const char *path) {
+  int xerrno;
+
+  xerrno = errno;
+  if (lint_text_writer_close(w) < 0 &&
+      res == 0) {
+    xerrno = errno;
+    res = -1;
+  }
+
+  if (res == 0 &&
+      pr_fsio_rename(tmp_path, path) < 0) {
+    xerrno = errno;
+    res = -1;
+  }
+
+  if (res < 0) {
+    pr_trace_msg(trace_channel, 1, "error writing '%s': %s", path,
+      strerror(xerrno));
+    (void) pr_fsio_unlink(tmp_path);
+  }
+
+  errno = xerrno;
+  return res;
+}
+
+static int profile_write_index(struct lint_text_writer *w,
+    struct profile_index *idx, const char *label, uint64_t total_ns) {
+  register unsigned int i;
+  struct profile_entry **entries;
+
+  entries = idx->entries->elts;
+  qsort(entries, idx->entries->nelts, sizeof(struct profile_entry *),
+    entrycmp);
+
+  if (lint_text_writer_fmt(w, "\n# %s\n# %12s %6s %8s %8s  %s\n", label,
+      "ms", "%", "lines", "configs", "name") < 0) {
+    return -1;
+  }
+
+  for (i = 0; i < idx->entries->nelts; i++) {
+    double pct;
+
+    pct = total_ns > 0 ? (entries[i]->ns * 100.0) / total_ns : 0.0;
+    if (lint_text_writer_fmt(w, "  %12.3f %5.1f%% %8lu %8lu  %s\n",
+        entries[i]->ns / 1000000.0, pct, entries[i]->nlines,
+        entries[i]->nconfigs, entries[i]->name) < 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int lint_profile_write(struct lint_profile *prof, const char *path) {
+  register unsigned int i;
+  pool *tmp_pool;
+  struct lint_text_writer *w;
+  const char *tmp_path = NULL;
+  uint64_t total_ns, unattributed_ns;
+  int res = 0;
+
+  if (prof == NULL ||
+      path == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  tmp_pool = make_sub_pool(prof->pool);
+  pr_pool_tag(tmp_pool, "Lint profile write pool");
+
+  w = profile_open(tmp_pool, path, &tmp_path);
+  if (w == NULL) {
+    int xerrno = errno;
+
+    destroy_pool(tmp_pool);
+    errno = xerrno;
+    return -1;
+  }
+
+  total_ns = prof->end_ns > prof->first_ns ? prof->end_ns - prof->first_ns : 0;
+  unattributed_ns = prof->end_ns > prof->last_ns ?
+    prof->end_ns - prof->last_ns : 0;
+
+  if (lint_text_writer_fmt(w,
+      "# " MOD_LINT_VERSION " parse profile\n"
+      "# %lu lines, %lu configs, %.3f ms total (%.3f ms after the last line)\n",
+      prof->nlines, prof->nconfigs, total_ns / 1000000.0,
+      unattributed_ns / 1000000.0) < 0 ||
+      profile_write_index(w, &(prof->files), "Files (self time)",
+        total_ns) < 0 ||
+      profile_write_index(w, &(prof->directives), "Directives",
+        total_ns) < 0 ||
+      profile_write_index(w, &(prof->modules), "Modules", total_ns) < 0) {
+    res = -1;
+  }
+
+  if (res == 0 &&
+      lint_text_writer_fmt(w, "\n# Slowest lines\n# %12s  %s\n", "ms",
+        "line") < 0) {
+    res = -1;
+  }
+
+  for (i = 0; res == 0 && i < prof->ntop_lines; i++) {
+    struct profile_line *line;
+
+    line = &(prof->top_lines[i]);
+    if (lint_text_writer_fmt(w, "  %12.3f  %s:%u %s\n", line->ns / 1000000.0,
+        line->source_file, line->source_lineno, line->directive) < 0) {
+      res = -1;
+    }
+  }
+
+  res = profile_close(w, res, tmp_path, path);
+  destroy_pool(tmp_pool);
+  return res;
+}
+
+int lint_profile_write_folded(struct lint_profile *prof, const char *path) {
+  register unsigned int i;
+  pool *tmp_pool;
+  struct lint_text_writer *w;
+  struct profile_entry **entries;
+  const char *tmp_path = NULL;
+  int res = 0;
+
+  if (prof == NULL ||
+      path == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  tmp_pool = make_sub_pool(prof->pool);
+  pr_pool_tag(tmp_pool, "Lint profile write pool");
+
+  w = profile_open(tmp_pool, path, &tmp_path);
+  if (w == NULL) {
+    int xerrno = errno;
+
+    destroy_pool(tmp_pool);
+    errno = xerrno;
+    return -1;
+  }
+
+  /* Flame graph tools want integral sample counts; we use microseconds. */
+  entries = prof->stacks.entries->elts;
+  for (i = 0; i < prof->stacks.entries->nelts; i++) {
+    uint64_t us;
+
+    us = entries[i]->ns / 1000;
+    if (us == 0) {
+      continue;
+    }
+
+    if (lint_text_writer_fmt(w, "%s %llu\n", entries[i]->name,
+        (unsigned long long) us) < 0) {
+      res = -1;
+      break;
+    }
+  }
+
+  res = profile_close(w, res, tmp_path, path);
+  destroy_pool(tmp_pool);
+  return res;
+}
@@ -0,0 +1,383 @@
+/*
+ * ProFTPD: mod_lint rule engine
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_lint.h"
+#include "lint/rule.h"
+
+struct lint_rule_engine {
+  pool *pool;
+
+  /* The contexts of the added rules, in the order added. */
+  array_header *ctxs;
+
+  array_header *findings;
+};
+
+/* The number of CONF_ type bits dispatched; see CONF_PARAM. */
+#define LINT_RULE_NCONFIG_TYPES		16
+
+static const char *trace_channel = "lint.rule";
+
+struct lint_rule_engine *lint_rule_engine_alloc(pool *p) {
+  pool *engine_pool;
+  struct lint_rule_engine *engine;
+
+  if (p == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  engine_pool = make_sub_pool(p);
+  pr_pool_tag(engine_pool, "Lint rule engine pool");
+
+  engine = pcalloc(engine_pool, sizeof(struct lint_rule_engine));
+  engine->pool = engine_pool;
+  engine->ctxs = make_array(engine_pool, 4, sizeof(struct lint_rule_ctx *));
+  engine->findings = make_array(engine_pool, 4,
+    sizeof(struct lint_rule_finding));
+
+  return engine;
+}
+
+int lint_rule_engine_add(struct lint_rule_engine *engine,
+    const struct lint_rule *rule, void *data) {
+  struct lint_rule_ctx *ctx;
+
+  if (engine == NULL ||
+      rule == NULL ||
+      rule->name == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (rule->check_line == NULL &&
+      rule->check_config == NULL &&
+      rule->finish == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  ctx = pcalloc(engine->pool, sizeof(struct lint_rule_ctx));
+  ctx->rule = rule;
+  ctx->data = data;
+  ctx->engine = engine;
+
+  *((struct lint_rule_ctx **) push_array(engine->ctxs)) = ctx;
+  return 0;
+}
+
+static void add_dispatch(pool *p, array_header **rules,
+    struct lint_rule_ctx *ctx) {
+  if (*rules == NULL) {
+    *rules = make_array(p, 1, sizeof(struct lint_rule_ctx *));
+  }
+
+  *((struct lint_rule_ctx **) push_array(*rules)) = ctx;
+}
+
+static unsigned int dispatch_line(array_header *rules, server_rec *s,
+    unsigned int idx) {
+  register unsigned int i;
+  struct lint_rule_ctx **ctxs;
+
+  if (rules == NULL) {
+    return 0;
+  }
+
+  ctxs = rules->elts;
+  for (i = 0; i < rules->nelts; i++) {
+    ctxs[i]->server = s;
+
+    if ((ctxs[i]->rule->check_line)(ctxs[i], idx) < 0) {
+      pr_trace_msg(trace_channel, 3, "'%s' rule error checking line %u: %s",
+        ctxs[i]->rule->name, idx, strerror(errno));
+    }
+  }
+
+  return rules->nelts;
+}
+
+static unsigned int dispatch_config(array_header *rules, server_rec *s,
+    config_rec *c) {
+  register unsigned int i;
+  struct lint_rule_ctx **ctxs;
+
+  if (rules == NULL) {
+    return 0;
+  }
+
+  ctxs = rules->elts;
+  for (i = 0; i < rules->nelts; i++) {
+    ctxs[i]->server = s;
+
+    if ((ctxs[i]->rule->check_config)(ctxs[i], c) < 0) {
+      pr_trace_msg(trace_channel, 3, "'%s' rule error checking config: %s",
+        ctxs[i]->rule->name, strerror(errno));
+    }
+  }
+
+  return rules->nelts;
+}
+
+static void visit_configs(xaset_t *set, server_rec *s, pr_table_t *rules,
+    array_header **type_rules, array_header *all_rules,
+    unsigned int *nconfigs, unsigned int *ndispatches) {
+  config_rec *c;
+
+  if (set == NULL) {
+    return;
+  }
+
+  for (c = (config_rec *) set->xas_list; c; c = c->next) {
+    register unsigned int i;
+
+    (*nconfigs)++;
+
+    if (c->name != NULL) {
+      array_header *name_rules;
+
+      name_rules = (array_header *) pr_table_get(rules, c->name, NULL);
+      *ndispatches += dispatch_config(name_rules, s, c);
+    }
+
+    for (i = 0; i < LINT_RULE_NCONFIG_TYPES; i++) {
+      if (c->config_type & (1 << i)) {
+        *ndispatches += dispatch_config(type_rules[i], s, c);
+      }
+    }
+
+    *ndispatches += dispatch_config(all_rules, s, c);
+
+    visit_configs(c->subset, s, rules, type_rules, all_rules, nconfigs,
+      ndispatches);
+  }
+}
+
+int lint_rule_engine_run(struct lint_rule_engine *engine,
+    struct lint_store *store, xaset_t *servers) {
+  register unsigned int i, j;
+  pool *tmp_pool;
+  struct lint_rule_ctx **ctxs;
+  array_header **line_rules, *all_line_rules = NULL, *all_config_rules = NULL;
+  array_header *type_rules[LINT_RULE_NCONFIG_TYPES];
+  pr_table_t *config_rules;
+  unsigned int nline_rules = 0, nlines, nconfigs = 0, ndispatches = 0;
+  server_rec *main_srv, *s;
+
+  if (engine == NULL ||
+      servers == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  tmp_pool = make_sub_pool(engine->pool);
+  pr_pool_tag(tmp_pool, "Lint rule run pool");
+
+  ctxs = engine->ctxs->elts;
+
+  /* Build the dispatch tables: for lines, indexed by the stored directive
+   * ID; and for configs, keyed by config name, and indexed by type bit.
+   */
+  memset(type_rules, 0, sizeof(type_rules));
+
+  for (i = 0; i < engine->ctxs->nelts; i++) {
+    const char **names;
+
+    ctxs[i]->pool = tmp_pool;
+    ctxs[i]->store = store;
+
+    names = ctxs[i]->rule->directives;
+    for (j = 0;
+         ctxs[i]->rule->check_line != NULL && names != NULL && names[j];
+         j++) {
+      int directive_id;
+
+      directive_id = lint_store_find_directive_id(store, names[j]);
+      if (directive_id >= 0 &&
+          (unsigned int) directive_id >= nline_rules) {
+        nline_rules = directive_id + 1;
+      }
+    }
+  }
+
+  line_rules = pcalloc(tmp_pool, sizeof(array_header *) * (nline_rules + 1));
+  config_rules = pr_table_alloc(tmp_pool, 0);
+
+  for (i = 0; i < engine->ctxs->nelts; i++) {
+    const struct lint_rule *rule;
+    const char **names;
+
+    rule = ctxs[i]->rule;
+
+    names = rule->directives;
+    for (j = 0; rule->check_line != NULL && names != NULL && names[j]; j++) {
+      int directive_id;
+
+      if (strcmp(names[j], "*") == 0) {
+        add_dispatch(tmp_pool, &all_line_rules, ctxs[i]);
+        continue;
+      }
+
+      /* Directives without lines need no dispatching. */
+      directive_id = lint_store_find_directive_id(store, names[j]);
+      if (directive_id >= 0) {
+        add_dispatch(tmp_pool, &(line_rules[directive_id]), ctxs[i]);
+      }
+    }
+
+    names = rule->config_names;
+    for (j = 0; rule->check_config != NULL && names != NULL && names[j];
+         j++) {
+      array_header *name_rules;
+
+      if (strcmp(names[j], "*") == 0) {
+        add_dispatch(tmp_pool, &all_config_rules, ctxs[i]);
+        continue;
+      }
+
+      name_rules = (array_header *) pr_table_get(config_rules, names[j], NULL);
+      if (name_rules == NULL) {
+        name_rules = make_array(tmp_pool, 1, sizeof(struct lint_rule_ctx *));
+        (void) pr_table_add(config_rules, pstrdup(tmp_pool, names[j]),
+          name_rules, sizeof(array_header *));
+      }
+
+      add_dispatch(tmp_pool, &name_rules, ctxs[i]);
+    }
+
+    for (j = 0; rule->check_config != NULL && j < LINT_RULE_NCONFIG_TYPES;
+         j++) {
+      if (rule->config_types & (1 << j)) {
+        add_dispatch(tmp_pool, &(type_rules[j]), ctxs[i]);
+      }
+    }
+  }
+
+  /* Visit the lines, in order, each with the server recorded for it; lines
+   * without one are attributed to the main server.
+   */
+  main_srv = (server_rec *) servers->xas_list;
+
+  nlines = lint_store_count(store);
+  for (i = 0; i < nlines; i++) {
+    int directive_id;
+
+    s = lint_store_get_server(store, i);
+    if (s == NULL) {
+      s = main_srv;
+    }
+
+    directive_id = lint_store_get_directive_id(store, i);
+    if ((unsigned int) directive_id < nline_rules) {
+      ndispatches += dispatch_line(line_rules[directive_id], s, i);
+    }
+
+    ndispatches += dispatch_line(all_line_rules, s, i);
+  }
+
+  /* Then the config tree, of each server. */
+  for (s = main_srv; s; s = s->next) {
+    visit_configs(s->conf, s, config_rules, type_rules, all_config_rules,
+      &nconfigs, &ndispatches);
+  }
+
+  for (i = 0; i < engine->ctxs->nelts; i++) {
+    if (ctxs[i]->rule->finish == NULL) {
+      continue;
+    }
+
+    ctxs[i]->server = main_srv;
+    if ((ctxs[i]->rule->finish)(ctxs[i]) < 0) {
+      pr_trace_msg(trace_channel, 3, "'%s' rule error finishing: %s",
+        ctxs[i]->rule->name, strerror(errno));
+    }
+  }
+
+  for (i = 0; i < engine->ctxs->nelts; i++) {
+    ctxs[i]->pool = NULL;
+    ctxs[i]->store = NULL;
+    ctxs[i]->server = NULL;
+  }
+
+  destroy_pool(tmp_pool);
+
+  pr_trace_msg(trace_channel, 9,
+    "ran %u %s over %u lines and %u configs (%u dispatches), with %u %s",
+    engine->ctxs->nelts, engine->ctxs->nelts != 1 ? "rules" : "rule", nlines,
+    nconfigs, ndispatches, engine->findings->nelts,
+    engine->findings->nelts != 1 ? "findings" : "finding");
+  return 0;
+}
+
+array_header *lint_rule_engine_get_findings(struct lint_rule_engine *engine) {
+  if (engine == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  return engine->findings;
+}
+
+int lint_rule_add_finding(struct lint_rule_ctx *ctx, int idx,
+    const char *fmt, ...) {
+  char buf[PR_TUNABLE_BUFFER_SIZE];
+  va_list msg;
+  pool *engine_pool;
+  struct lint_rule_finding *finding;
+
+  if (ctx == NULL ||
+      ctx->engine == NULL ||
+      fmt == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  va_start(msg, fmt);
+  (void) pr_vsnprintf(buf, sizeof(buf), fmt, msg);
+  va_end(msg);
+  buf[sizeof(buf)-1] = '\0';
+
+  engine_pool = ctx->engine->pool;
+
+  finding = push_array(ctx->engine->findings);
+  finding->rule = ctx->rule->name;
+  finding->source_file = NULL;
+  finding->source_lineno = 0;
+  finding->text = pstrdup(engine_pool, buf);
+
+  if (idx >= 0 &&
+      ctx->store != NULL) {
+    const char *source_file;
+
+    source_file = lint_store_get_source_file(ctx->store, idx);
+    if (source_file != NULL) {
+      finding->source_file = pstrdup(engine_pool, source_file);
+      finding->source_lineno = lint_store_get_source_lineno(ctx->store, idx);
+    }
+  }
+
+  pr_trace_msg(trace_channel, 15, "'%s' rule finding: %s", finding->rule,
+    finding->text);
+  return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * ProFTPD - mod_lint DNS rule
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_lint.h"
+#include "lint/rule.h"
+#include "lint/dns.h"
+
+static const char *directives[] = {
+  "<VirtualHost>", "DefaultAddress", "Bind", "MasqueradeAddress", NULL
+};
+
+/* Returns the numeric address to which the given argument, of the given
+ * address directive line, was resolved, from the server, or the configs
+ * added for that line.
+ */
+static const char *get_resolved_addr(const char *directive, unsigned int argi,
+    server_rec *s, const config_rec **configs, unsigned int nconfigs) {
+  register unsigned int i;
+  unsigned int nbinds = 0;
+
+  if (strcasecmp(directive, "MasqueradeAddress") == 0) {
+    for (i = 0; i < nconfigs; i++) {
+      if (configs[i]->name != NULL &&
+          strcmp(configs[i]->name, "MasqueradeAddress") == 0 &&
+          configs[i]->argv[0] != NULL) {
+        return pr_netaddr_get_ipstr(configs[i]->argv[0]);
+      }
+    }
+
+    return NULL;
+  }
+
+  /* For <VirtualHost> and DefaultAddress, the first address is that of the
+   * server; any others, as for Bind, are added as "_bind_" configs.
+   */
+  if (strcasecmp(directive, "Bind") != 0) {
+    if (argi == 0) {
+      return s != NULL && s->addr != NULL ?
+        pr_netaddr_get_ipstr(s->addr) : NULL;
+    }
+
+    argi--;
+  }
+
+  for (i = 0; i < nconfigs; i++) {
+    if (configs[i]->name == NULL ||
+        strcmp(configs[i]->name, "_bind_") != 0) {
+      continue;
+    }
+
+    if (nbinds++ == argi) {
+      const char *addr;
+
+      addr = configs[i]->argv[0];
+      return lint_dns_is_name(addr) == FALSE ? addr : NULL;
+    }
+  }
+
+  return NULL;
+}
+
+static int check_line(struct lint_rule_ctx *ctx, unsigned int idx) {
+  register unsigned int i;
+  const char *directive;
+  const config_rec **configs;
+  unsigned int nconfigs = 0;
+  array_header *args;
+  char **elts;
+
+  args = lint_dns_parse_line(ctx->pool,
+    lint_store_get_text(ctx->store, idx, NULL));
+  if (args == NULL) {
+    return 0;
+  }
+
+  directive = lint_store_get_directive(ctx->store, idx);
+  configs = lint_store_get_configs(ctx->store, idx, &nconfigs);
+
+  elts = args->elts;
+  for (i = 0; i < args->nelts; i++) {
+    const char *addr;
+
+    if (lint_dns_is_name(elts[i]) == FALSE) {
+      continue;
+    }
+
+    addr = get_resolved_addr(directive, i, ctx->server, configs, nconfigs);
+    if (ctx->data != NULL) {
+      (void) lint_dns_add_name(ctx->data, elts[i], addr);
+    }
+
+    (void) lint_rule_add_finding(ctx, idx,
+      "%s address '%s' requires DNS resolution at startup%s%s", directive,
+      elts[i], addr != NULL ? "; resolved to " : "", addr != NULL ? addr : "");
+  }
+
+  return 0;
+}
+
+static const struct lint_rule dns_rule = {
+  "dns", directives, NULL, 0, check_line, NULL, NULL
+};
+
+const struct lint_rule *lint_rule_get_dns_rule(void) {
+  return &dns_rule;
+}
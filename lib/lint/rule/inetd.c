@@ -0,0 +1,71 @@
+/*
+ * ProFTPD - mod_lint inetd rule
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_lint.h"
+#include "lint/rule.h"
+
+static const char *directives[] = { "*", NULL };
+
+static int check_line(struct lint_rule_ctx *ctx, unsigned int idx) {
+  struct lint_rule_inetd_data *data;
+  size_t textsz = 0;
+
+  data = ctx->data;
+  if (data == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  (void) lint_store_get_text(ctx->store, idx, &textsz);
+
+  data->nlines++;
+  data->nbytes += textsz + 1;
+  return 0;
+}
+
+static int finish(struct lint_rule_ctx *ctx) {
+  struct lint_rule_inetd_data *data;
+
+  data = ctx->data;
+  if (data == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  return lint_rule_add_finding(ctx, -1,
+    "ServerType inetd: every connection parses the config anew "
+    "(%u lines, %llu bytes); parsing took %.3f ms (%.1f us per line), "
+    "i.e. about %.1f secs per 1000 connections", data->nlines,
+    (unsigned long long) data->nbytes, data->parse_ns / 1000000.0,
+    data->nlines > 0 ? (data->parse_ns / 1000.0) / data->nlines : 0.0,
+    data->parse_ns / 1000000.0);
+}
+
+static const struct lint_rule inetd_rule = {
+  "inetd", directives, NULL, 0, check_line, NULL, finish
+};
+
+const struct lint_rule *lint_rule_get_inetd_rule(void) {
+  return &inetd_rule;
+}
@@ -0,0 +1,359 @@
+/*
+ * ProFTPD: mod_lint run implementation
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_lint.h"
+#include "lint/run.h"
+
+#include <sys/mman.h>
+
+/* A run file is the magic, followed by the records, each of which is the
+ * (native-endian, 32-bit) length of its text, then the text and a NUL, and
+ * ends with a trailer: the end marker, and the number of records.  A run
+ * without its trailer is incomplete.
+ */
+#define LINT_RUN_MAGIC			"LINTRUN1"
+#define LINT_RUN_MAGIC_LEN		8
+#define LINT_RUN_END_MARKER		0xffffffffU
+#define LINT_RUN_TRAILER_LEN		8
+
+struct lint_run {
+  const char *path;
+  const char *data;
+  size_t datasz;
+
+  /* The number of records, once mapped. */
+  uint32_t nrecords;
+
+  /* The current record. */
+  const char *text;
+  uint32_t textsz;
+  size_t offset;
+};
+
+static const char *trace_channel = "lint.run";
+
+int lint_run_write(pool *p, const char *path, array_header *buffered_lines) {
+  register unsigned int i;
+  pr_fh_t *fh;
+  struct lint_text_writer *w;
+  uint32_t count = 0, end_marker = LINT_RUN_END_MARKER;
+  int xerrno;
+
+  if (p == NULL ||
+      path == NULL ||
+      buffered_lines == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  fh = pr_fsio_open(path, O_WRONLY|O_CREAT|O_TRUNC);
+  if (fh == NULL) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 1, "error opening '%s': %s", path,
+      strerror(xerrno));
+    errno = xerrno;
+    return -1;
+  }
+
+  w = lint_text_writer_create(p, fh);
+  if (w == NULL) {
+    xerrno = errno;
+
+    (void) pr_fsio_close(fh);
+    errno = xerrno;
+    return -1;
+  }
+
+  if (lint_text_writer_text(w, LINT_RUN_MAGIC, LINT_RUN_MAGIC_LEN) < 0) {
+    xerrno = errno;
+
+    (void) lint_text_writer_close(w);
+    errno = xerrno;
+    return -1;
+  }
+
+  for (i = 0; i < buffered_lines->nelts; i++) {
+    struct lint_buffered_line *bl;
+    uint32_t textsz;
+
+    bl = ((struct lint_buffered_line **) buffered_lines->elts)[i];
+    textsz = (uint32_t) bl->textsz;
+
+    if (lint_text_writer_text(w, (const char *) &textsz,
+          sizeof(textsz)) < 0 ||
+        lint_text_writer_line(w, bl) < 0 ||
+        lint_text_writer_text(w, "", 1) < 0) {
+      xerrno = errno;
+
+      (void) lint_text_writer_close(w);
+      errno = xerrno;
+      return -1;
+    }
+
+    count++;
+  }
+
+  if (lint_text_writer_text(w, (const char *) &end_marker,
+        sizeof(end_marker)) < 0 ||
+      lint_text_writer_text(w, (const char *) &count, sizeof(count)) < 0) {
+    xerrno = errno;
+
+    (void) lint_text_writer_close(w);
+    errno = xerrno;
+    return -1;
+  }
+
+  return lint_text_writer_close(w);
+}
+
+static void run_unmap(struct lint_run *run) {
+  if (run->data != NULL) {
+    (void) munmap((void *) run->data, run->datasz);
+    run->data = NULL;
+  }
+}
+
+/* Maps the run, and checks that it is complete: well-formed records,
+ * followed by a trailer with the matching count.
+ */
+static int run_map(struct lint_run *run) {
+  int fd, xerrno;
+  struct stat st;
+  size_t offset;
+  uint32_t count = 0, trailer_count;
+
+  fd = open(run->path, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+
+  if (fstat(fd, &st) < 0) {
+    xerrno = errno;
+
+    (void) close(fd);
+    errno = xerrno;
+    return -1;
+  }
+
+  if ((size_t) st.st_size < LINT_RUN_MAGIC_LEN + LINT_RUN_TRAILER_LEN) {
+    (void) close(fd);
+    pr_trace_msg(trace_channel, 3, "run '%s' is truncated (%lu bytes)",
+      run->path, (unsigned long) st.st_size);
+    errno = EINVAL;
+    return -1;
+  }
+
+  run->datasz = (size_t) st.st_size;
+  run->data = mmap(NULL, run->datasz, PROT_READ, MAP_PRIVATE, fd, 0);
+  xerrno = errno;
+  (void) close(fd);
+
+  if (run->data == MAP_FAILED) {
+    run->data = NULL;
+    pr_trace_msg(trace_channel, 3, "error mapping '%s': %s", run->path,
+      strerror(xerrno));
+    errno = xerrno;
+    return -1;
+  }
+
+  if (memcmp(run->data, LINT_RUN_MAGIC, LINT_RUN_MAGIC_LEN) != 0) {
+    pr_trace_msg(trace_channel, 3, "run '%s' is missing its magic",
+      run->path);
+    run_unmap(run);
+    errno = EINVAL;
+    return -1;
+  }
+
+  offset = LINT_RUN_MAGIC_LEN;
+  while (offset + sizeof(uint32_t) <= run->datasz) {
+    uint32_t textsz;
+
+    memcpy(&textsz, run->data + offset, sizeof(textsz));
+    if (textsz == LINT_RUN_END_MARKER) {
+      break;
+    }
+
+    if (offset + sizeof(textsz) + textsz + 1 > run->datasz ||
+        run->data[offset + sizeof(textsz) + textsz] != '\0') {
+      break;
+    }
+
+    offset += sizeof(textsz) + textsz + 1;
+    count++;
+  }
+
+  if (offset + LINT_RUN_TRAILER_LEN != run->datasz) {
+    pr_trace_msg(trace_channel, 3, "run '%s' is incomplete", run->path);
+    run_unmap(run);
+    errno = EINVAL;
+    return -1;
+  }
+
+  memcpy(&trailer_count, run->data + offset + sizeof(uint32_t),
+    sizeof(trailer_count));
+  if (trailer_count != count) {
+    pr_trace_msg(trace_channel, 3,
+      "run '%s' has %lu records, but its trailer says %lu", run->path,
+      (unsigned long) count, (unsigned long) trailer_count);
+    run_unmap(run);
+    errno = EINVAL;
+    return -1;
+  }
+
+  run->nrecords = count;
+  run->offset = LINT_RUN_MAGIC_LEN;
+  return 0;
+}
+
+/* Advances to the next record, returning FALSE at the end of the run. */
+static int run_next(struct lint_run *run) {
+  uint32_t textsz;
+
+  memcpy(&textsz, run->data + run->offset, sizeof(textsz));
+  if (textsz == LINT_RUN_END_MARKER) {
+    run->text = NULL;
+    return FALSE;
+  }
+
+  run->text = run->data + run->offset + sizeof(textsz);
+  run->textsz = textsz;
+  run->offset += sizeof(textsz) + textsz + 1;
+  return TRUE;
+}
+
+int lint_run_verify(pool *p, const char *path, unsigned int *nrecords) {
+  struct lint_run run;
+
+  if (p == NULL ||
+      path == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  memset(&run, 0, sizeof(run));
+  run.path = path;
+
+  if (run_map(&run) < 0) {
+    return -1;
+  }
+
+  if (nrecords != NULL) {
+    *nrecords = run.nrecords;
+  }
+
+  run_unmap(&run);
+  return 0;
+}
+
+array_header *lint_run_read(pool *p, const char *path) {
+  struct lint_run run;
+  array_header *texts;
+
+  if (p == NULL ||
+      path == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  memset(&run, 0, sizeof(run));
+  run.path = path;
+
+  if (run_map(&run) < 0) {
+    return NULL;
+  }
+
+  texts = make_array(p, run.nrecords, sizeof(char *));
+  while (run_next(&run) == TRUE) {
+    *((char **) push_array(texts)) = pstrndup(p, run.text, run.textsz);
+  }
+
+  run_unmap(&run);
+  return texts;
+}
+
+int lint_run_concat(pool *p, struct lint_text_writer *w,
+    array_header *paths) {
+  register unsigned int i;
+  pool *tmp_pool;
+  struct lint_run *runs;
+  unsigned int nruns;
+  int res = 0, xerrno = 0;
+
+  if (p == NULL ||
+      w == NULL ||
+      paths == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  nruns = paths->nelts;
+  if (nruns == 0) {
+    return 0;
+  }
+
+  tmp_pool = make_sub_pool(p);
+  runs = pcalloc(tmp_pool, sizeof(struct lint_run) * nruns);
+
+  /* Map, and verify, all of the runs before writing anything. */
+  for (i = 0; i < nruns; i++) {
+    runs[i].path = ((char **) paths->elts)[i];
+
+    if (run_map(&(runs[i])) < 0) {
+      register unsigned int j;
+
+      xerrno = errno;
+      for (j = 0; j < i; j++) {
+        run_unmap(&(runs[j]));
+      }
+
+      destroy_pool(tmp_pool);
+      errno = xerrno;
+      return -1;
+    }
+  }
+
+  for (i = 0; res == 0 && i < nruns; i++) {
+    while (run_next(&(runs[i])) == TRUE) {
+      res = lint_text_writer_text(w, runs[i].text, runs[i].textsz);
+      if (res < 0) {
+        xerrno = errno;
+        break;
+      }
+    }
+  }
+
+  for (i = 0; i < nruns; i++) {
+    run_unmap(&(runs[i]));
+  }
+
+  destroy_pool(tmp_pool);
+
+  if (res < 0) {
+    errno = xerrno;
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,369 @@
+/*
+ * ProFTPD: mod_lint state implementation
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_lint.h"
+#include "lint/state.h"
+#include "lint/hash.h"
+
+#define LINT_STATE_HEADER	"# " MOD_LINT_VERSION " state\n"
+
+/* Configs may span many thousands of files; the index is not to be limited
+ * by the default maximum number of table entries.
+ */
+#define LINT_STATE_MAX_ITEMS	(1024 * 1024)
+
+/* Item kinds */
+#define LINT_STATE_KIND_FILE	'F'
+#define LINT_STATE_KIND_HASH	'H'
+
+struct lint_state_item {
+  char kind;
+  const char *name;
+  uint64_t hash;
+};
+
+struct lint_state {
+  pool *pool;
+
+  /* List of struct lint_state_item *, in order of addition. */
+  array_header *items;
+
+  /* Index of items, keyed by "kind:name". */
+  pr_table_t *index;
+};
+
+static const char *trace_channel = "lint.state";
+
+struct lint_state *lint_state_alloc(pool *p) {
+  pool *state_pool;
+  struct lint_state *state;
+  unsigned int max_ents = LINT_STATE_MAX_ITEMS;
+
+  if (p == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  state_pool = make_sub_pool(p);
+  pr_pool_tag(state_pool, "Lint state pool");
+
+  state = pcalloc(state_pool, sizeof(struct lint_state));
+  state->pool = state_pool;
+  state->items = make_array(state_pool, 0, sizeof(struct lint_state_item *));
+  state->index = pr_table_nalloc(state_pool, 0, 256);
+  (void) pr_table_ctl(state->index, PR_TABLE_CTL_SET_MAX_ENTS, &max_ents);
+
+  return state;
+}
+
+static int add_item(struct lint_state *state, char kind, const char *name,
+    uint64_t hash) {
+  struct lint_state_item *item;
+  char kind_str[3];
+  const char *key;
+
+  kind_str[0] = kind;
+  kind_str[1] = ':';
+  kind_str[2] = '\0';
+  key = pstrcat(state->pool, kind_str, name, NULL);
+
+  item = (struct lint_state_item *) pr_table_get(state->index, key, NULL);
+  if (item != NULL) {
+    /* Already recorded; update the hash. */
+    item->hash = hash;
+    return 0;
+  }
+
+  item = pcalloc(state->pool, sizeof(struct lint_state_item));
+  item->kind = kind;
+  item->name = pstrdup(state->pool, name);
+  item->hash = hash;
+
+  if (pr_table_add(state->index, key, item,
+      sizeof(struct lint_state_item)) < 0) {
+    return -1;
+  }
+
+  *((struct lint_state_item **) push_array(state->items)) = item;
+  return 0;
+}
+
+int lint_state_add_file(struct lint_state *state, const char *path) {
+  uint64_t hash;
+  pool *tmp_pool;
+  int res, xerrno;
+
+  if (state == NULL ||
+      path == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  tmp_pool = make_sub_pool(state->pool);
+  res = lint_hash_file(tmp_pool, path, NULL, &hash, NULL);
+  xerrno = errno;
+  destroy_pool(tmp_pool);
+
+  if (res < 0) {
+    pr_trace_msg(trace_channel, 3, "error hashing '%s': %s", path,
+      strerror(xerrno));
+    errno = xerrno;
+    return -1;
+  }
+
+  return add_item(state, LINT_STATE_KIND_FILE, path, hash);
+}
+
+int lint_state_add_hash(struct lint_state *state, const char *name,
+    uint64_t hash) {
+  if (state == NULL ||
+      name == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  return add_item(state, LINT_STATE_KIND_HASH, name, hash);
+}
+
+unsigned int lint_state_count(struct lint_state *state) {
+  if (state == NULL) {
+    return 0;
+  }
+
+  return state->items->nelts;
+}
+
+static int count_missing(struct lint_state *state, struct lint_state *other,
+    array_header *changed, int check_hash) {
+  register unsigned int i;
+  struct lint_state_item **items;
+  int count = 0;
+
+  items = state->items->elts;
+  for (i = 0; i < state->items->nelts; i++) {
+    const struct lint_state_item *other_item;
+    char kind_str[3];
+    const char *key;
+
+    kind_str[0] = items[i]->kind;
+    kind_str[1] = ':';
+    kind_str[2] = '\0';
+    key = pstrcat(state->pool, kind_str, items[i]->name, NULL);
+
+    other_item = pr_table_get(other->index, key, NULL);
+    if (other_item != NULL &&
+        (check_hash == FALSE || other_item->hash == items[i]->hash)) {
+      continue;
+    }
+
+    pr_trace_msg(trace_channel, 9, "'%s' %s", items[i]->name,
+      other_item == NULL ? "added/removed" : "changed");
+
+    if (changed != NULL) {
+      *((char **) push_array(changed)) = pstrdup(changed->pool,
+        items[i]->name);
+    }
+
+    count++;
+  }
+
+  return count;
+}
+
+int lint_state_compare(struct lint_state *state, struct lint_state *prev,
+    array_header *changed) {
+  int count;
+
+  if (state == NULL ||
+      prev == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  /* Look for items that were added or changed, then for items that were
+   * removed.
+   */
+  count = count_missing(state, prev, changed, TRUE);
+  count += count_missing(prev, state, changed, FALSE);
+
+  return count;
+}
+
+struct lint_state *lint_state_read(pool *p, const char *path) {
+  struct lint_state *state;
+  pr_fh_t *fh;
+  char buf[PR_TUNABLE_PATH_MAX + 64];
+  int xerrno;
+
+  if (p == NULL ||
+      path == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  fh = pr_fsio_open(path, O_RDONLY);
+  if (fh == NULL) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 9, "error opening '%s': %s", path,
+      strerror(xerrno));
+    errno = xerrno;
+    return NULL;
+  }
+
+  state = lint_state_alloc(p);
+
+  /* Each line is "<kind> <hash> <name>", following our header. */
+  if (pr_fsio_gets(buf, sizeof(buf)-1, fh) == NULL ||
+      strcmp(buf, LINT_STATE_HEADER) != 0) {
+    pr_trace_msg(trace_channel, 3, "'%s' is not a %s state file", path,
+      MOD_LINT_VERSION);
+    (void) pr_fsio_close(fh);
+    destroy_pool(state->pool);
+    errno = EINVAL;
+    return NULL;
+  }
+
+  while (pr_fsio_gets(buf, sizeof(buf)-1, fh) != NULL) {
+    unsigned long long hash;
+    char kind, *name, *ptr;
+    size_t buflen;
+
+    pr_signals_handle();
+
+    buflen = strlen(buf);
+    if (buflen > 0 &&
+        buf[buflen-1] == '\n') {
+      buf[buflen-1] = '\0';
+    }
+
+    kind = buf[0];
+    if ((kind != LINT_STATE_KIND_FILE && kind != LINT_STATE_KIND_HASH) ||
+        buf[1] != ' ') {
+      continue;
+    }
+
+    hash = strtoull(buf + 2, &ptr, 16);
+    if (ptr == NULL ||
+        *ptr != ' ') {
+      continue;
+    }
+
+    name = ptr + 1;
+    (void) add_item(state, kind, name, (uint64_t) hash);
+  }
+
+  (void) pr_fsio_close(fh);
+  return state;
+}
+
+int lint_state_write(struct lint_state *state, const char *path) {
+  register unsigned int i;
+  pr_fh_t *fh;
+  char *tmp_path;
+  struct lint_state_item **items;
+  int fd, xerrno;
+
+  if (state == NULL ||
+      path == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  /* Write to a uniquely named temporary file, then rename into place, so
+   * that concurrent writers, e.g. inetd connections, do not interleave.
+   */
+  tmp_path = pstrcat(state->pool, path, ".XXXXXX", NULL);
+  fd = mkstemp(tmp_path);
+  if (fd < 0) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 1, "error creating temporary file for '%s': %s",
+      path, strerror(xerrno));
+    errno = xerrno;
+    return -1;
+  }
+
+  (void) fchmod(fd, 0644);
+  (void) close(fd);
+
+  fh = pr_fsio_open(tmp_path, O_WRONLY|O_TRUNC);
+  if (fh == NULL) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 1, "error opening '%s': %s", tmp_path,
+      strerror(xerrno));
+    (void) pr_fsio_unlink(tmp_path);
+    errno = xerrno;
+    return -1;
+  }
+
+  if (pr_fsio_write(fh, LINT_STATE_HEADER, strlen(LINT_STATE_HEADER)) < 0) {
+    xerrno = errno;
+
+    (void) pr_fsio_close(fh);
+    (void) pr_fsio_unlink(tmp_path);
+    errno = xerrno;
+    return -1;
+  }
+
+  items = state->items->elts;
+  for (i = 0; i < state->items->nelts; i++) {
+    char buf[PR_TUNABLE_PATH_MAX + 64];
+    int buflen;
+
+    buflen = pr_snprintf(buf, sizeof(buf)-1, "%c %016llx %s\n",
+      items[i]->kind, (unsigned long long) items[i]->hash, items[i]->name);
+    buf[sizeof(buf)-1] = '\0';
+
+    if (pr_fsio_write(fh, buf, buflen) < 0) {
+      xerrno = errno;
+
+      (void) pr_fsio_close(fh);
+      (void) pr_fsio_unlink(tmp_path);
+      errno = xerrno;
+      return -1;
+    }
+  }
+
+  if (pr_fsio_close(fh) < 0) {
+    xerrno = errno;
+
+    (void) pr_fsio_unlink(tmp_path);
+    errno = xerrno;
+    return -1;
+  }
+
+  if (pr_fsio_rename(tmp_path, path) < 0) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 1, "error renaming '%s' to '%s': %s",
+      tmp_path, path, strerror(xerrno));
+    (void) pr_fsio_unlink(tmp_path);
+    errno = xerrno;
+    return -1;
+  }
+
+  return 0;
+}
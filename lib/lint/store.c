@@ -0,0 +1,749 @@
+/*
+ * ProFTPD: mod_lint parsed line store
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_lint.h"
+#include "lint/store.h"
+#include "lint/arena.h"
+#include "lint/hash.h"
+
+#define LINT_STORE_NO_LINE		0xffffffffU
+#define LINT_STORE_NO_STR		0xffffffffU
+
+struct lint_store {
+  struct lint_arena *arena;
+
+  /* Per-line columns, indexed by line index. */
+  uint32_t *directive_ids;
+  uint32_t *file_ids;
+  uint32_t *linenos;
+  uint32_t *text_offsets;
+  uint32_t *next_lines;
+  uint32_t *config_offsets;
+  uint32_t *config_counts;
+  server_rec **servers;
+  unsigned int line_count;
+  unsigned int line_alloc;
+
+  /* The associated configs of all lines, one after another, in order of
+   * their lines; each line's configs are found via its offset and count
+   * (a compressed sparse row layout).
+   */
+  const config_rec **configs;
+  unsigned int config_count;
+  unsigned int config_alloc;
+
+  /* Open-addressed hash table, from the associated configs to their lines,
+   * built when first needed; its size is a power of two, at least twice
+   * the number of configs.
+   */
+  const config_rec **config_slots;
+  uint32_t *config_slot_lines;
+  unsigned int config_slot_count;
+
+  /* The line texts, NUL-terminated, one after another. */
+  char *slab;
+  size_t slab_len;
+  size_t slab_alloc;
+
+  /* Interned strings, and the per-directive line index, indexed by ID. */
+  const char **strs;
+  uint32_t *first_lines;
+  uint32_t *last_lines;
+  uint32_t *directive_line_counts;
+  unsigned int str_count;
+  unsigned int str_alloc;
+
+  /* Open-addressed hash table of interned string IDs; its size is a power
+   * of two, kept at most half full.
+   */
+  uint32_t *slots;
+  unsigned int slot_count;
+
+  /* Likewise, of the IDs of directives, which are matched ignoring case, as
+   * the parser does; the first spelling seen is the one interned.
+   */
+  uint32_t *directive_slots;
+  unsigned int directive_slot_count;
+  unsigned int directive_count;
+};
+
+static const char *trace_channel = "lint.store";
+
+static int grow_column(struct lint_store *store, void **col, size_t eltsz,
+    unsigned int old_nelts, unsigned int new_nelts) {
+  void *ptr;
+
+  ptr = lint_arena_realloc(store->arena, *col, eltsz * old_nelts,
+    eltsz * new_nelts);
+  if (ptr == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  *col = ptr;
+  return 0;
+}
+
+struct lint_store *lint_store_alloc(struct lint_arena *arena) {
+  struct lint_store *store;
+
+  if (arena == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  store = lint_arena_calloc(arena, sizeof(struct lint_store));
+  if (store == NULL) {
+    return NULL;
+  }
+
+  store->arena = arena;
+  return store;
+}
+
+/* Returns the slot for the given string: either the slot holding its ID,
+ * or the empty slot where its ID belongs.
+ */
+static uint32_t *find_slot(struct lint_store *store, const char *str) {
+  unsigned int mask, i;
+
+  mask = store->slot_count - 1;
+  i = (unsigned int) lint_hash_data(str, strlen(str)) & mask;
+
+  while (store->slots[i] != LINT_STORE_NO_STR) {
+    if (strcmp(store->strs[store->slots[i]], str) == 0) {
+      break;
+    }
+
+    i = (i + 1) & mask;
+  }
+
+  return &(store->slots[i]);
+}
+
+static int grow_slots(struct lint_store *store) {
+  register unsigned int i;
+  unsigned int new_count;
+  uint32_t *new_slots;
+
+  new_count = store->slot_count > 0 ? store->slot_count * 2 : 64;
+  new_slots = lint_arena_alloc(store->arena, sizeof(uint32_t) * new_count);
+  if (new_slots == NULL) {
+    return -1;
+  }
+
+  memset(new_slots, 0xff, sizeof(uint32_t) * new_count);
+  store->slots = new_slots;
+  store->slot_count = new_count;
+
+  /* Rehash the existing IDs. */
+  for (i = 0; i < store->str_count; i++) {
+    *(find_slot(store, store->strs[i])) = i;
+  }
+
+  return 0;
+}
+
+static unsigned int hash_directive(const char *directive) {
+  uint64_t hash = LINT_HASH_INIT;
+
+  for (; *directive; directive++) {
+    unsigned char c;
+
+    c = tolower((int) *directive);
+    hash = lint_hash_update(hash, &c, 1);
+  }
+
+  return (unsigned int) hash;
+}
+
+/* Returns the slot for the given directive: either the slot holding its
+ * ID, or the empty slot where its ID belongs.
+ */
+static uint32_t *find_directive_slot(struct lint_store *store,
+    const char *directive) {
+  unsigned int mask, i;
+
+  mask = store->directive_slot_count - 1;
+  i = hash_directive(directive) & mask;
+
+  while (store->directive_slots[i] != LINT_STORE_NO_STR) {
+    if (strcasecmp(store->strs[store->directive_slots[i]], directive) == 0) {
+      break;
+    }
+
+    i = (i + 1) & mask;
+  }
+
+  return &(store->directive_slots[i]);
+}
+
+static int grow_directive_slots(struct lint_store *store) {
+  register unsigned int i;
+  unsigned int new_count, old_count;
+  uint32_t *old_slots;
+
+  old_slots = store->directive_slots;
+  old_count = store->directive_slot_count;
+
+  new_count = old_count > 0 ? old_count * 2 : 64;
+  store->directive_slots = lint_arena_alloc(store->arena,
+    sizeof(uint32_t) * new_count);
+  if (store->directive_slots == NULL) {
+    store->directive_slots = old_slots;
+    errno = ENOMEM;
+    return -1;
+  }
+
+  memset(store->directive_slots, 0xff, sizeof(uint32_t) * new_count);
+  store->directive_slot_count = new_count;
+
+  /* Rehash the existing directive IDs. */
+  for (i = 0; i < old_count; i++) {
+    if (old_slots[i] != LINT_STORE_NO_STR) {
+      *(find_directive_slot(store, store->strs[old_slots[i]])) = old_slots[i];
+    }
+  }
+
+  return 0;
+}
+
+/* Returns the ID of the given directive, interning it if necessary. */
+static int intern_directive(struct lint_store *store, const char *directive) {
+  uint32_t *slot;
+  int id;
+
+  if ((store->directive_count + 1) * 2 > store->directive_slot_count &&
+      grow_directive_slots(store) < 0) {
+    return -1;
+  }
+
+  slot = find_directive_slot(store, directive);
+  if (*slot != LINT_STORE_NO_STR) {
+    return (int) *slot;
+  }
+
+  id = lint_store_intern(store, directive);
+  if (id < 0) {
+    return -1;
+  }
+
+  *slot = (uint32_t) id;
+  store->directive_count++;
+  return id;
+}
+
+int lint_store_intern(struct lint_store *store, const char *str) {
+  uint32_t *slot, id;
+  char *dup;
+
+  if (store == NULL ||
+      str == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (store->slot_count > 0) {
+    slot = find_slot(store, str);
+    if (*slot != LINT_STORE_NO_STR) {
+      return (int) *slot;
+    }
+  }
+
+  if (store->str_count == store->str_alloc) {
+    unsigned int new_alloc;
+
+    new_alloc = store->str_alloc > 0 ? store->str_alloc * 2 : 32;
+    if (grow_column(store, (void **) &(store->strs), sizeof(const char *),
+          store->str_alloc, new_alloc) < 0 ||
+        grow_column(store, (void **) &(store->first_lines), sizeof(uint32_t),
+          store->str_alloc, new_alloc) < 0 ||
+        grow_column(store, (void **) &(store->last_lines), sizeof(uint32_t),
+          store->str_alloc, new_alloc) < 0 ||
+        grow_column(store, (void **) &(store->directive_line_counts),
+          sizeof(uint32_t), store->str_alloc, new_alloc) < 0) {
+      return -1;
+    }
+
+    store->str_alloc = new_alloc;
+  }
+
+  if ((store->str_count + 1) * 2 > store->slot_count) {
+    if (grow_slots(store) < 0) {
+      pr_trace_msg(trace_channel, 3, "error interning '%s': %s", str,
+        strerror(errno));
+      return -1;
+    }
+  }
+
+  dup = lint_arena_strdup(store->arena, str);
+  if (dup == NULL) {
+    return -1;
+  }
+
+  id = store->str_count;
+  store->strs[id] = dup;
+  store->first_lines[id] = LINT_STORE_NO_LINE;
+  store->last_lines[id] = LINT_STORE_NO_LINE;
+  store->directive_line_counts[id] = 0;
+  store->str_count++;
+
+  *(find_slot(store, dup)) = id;
+  return (int) id;
+}
+
+const char *lint_store_get_interned(struct lint_store *store,
+    unsigned int id) {
+  if (store == NULL ||
+      id >= store->str_count) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  return store->strs[id];
+}
+
+int lint_store_add_line(struct lint_store *store, const char *directive,
+    const char *text, size_t textsz, const char *source_file,
+    unsigned int source_lineno) {
+  int directive_id, file_id;
+  unsigned int idx;
+
+  if (store == NULL ||
+      directive == NULL ||
+      text == NULL ||
+      source_file == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (store->slab_len + textsz + 1 > (size_t) LINT_STORE_NO_LINE) {
+    /* Our 32-bit text offsets cannot address this much text. */
+    errno = EFBIG;
+    return -1;
+  }
+
+  directive_id = intern_directive(store, directive);
+  if (directive_id < 0) {
+    return -1;
+  }
+
+  file_id = lint_store_intern(store, source_file);
+  if (file_id < 0) {
+    return -1;
+  }
+
+  if (store->line_count == store->line_alloc) {
+    unsigned int new_alloc;
+
+    new_alloc = store->line_alloc > 0 ? store->line_alloc * 2 : 256;
+    if (grow_column(store, (void **) &(store->directive_ids),
+          sizeof(uint32_t), store->line_alloc, new_alloc) < 0 ||
+        grow_column(store, (void **) &(store->file_ids), sizeof(uint32_t),
+          store->line_alloc, new_alloc) < 0 ||
+        grow_column(store, (void **) &(store->linenos), sizeof(uint32_t),
+          store->line_alloc, new_alloc) < 0 ||
+        grow_column(store, (void **) &(store->text_offsets), sizeof(uint32_t),
+          store->line_alloc, new_alloc) < 0 ||
+        grow_column(store, (void **) &(store->next_lines), sizeof(uint32_t),
+          store->line_alloc, new_alloc) < 0 ||
+        grow_column(store, (void **) &(store->config_offsets),
+          sizeof(uint32_t), store->line_alloc, new_alloc) < 0 ||
+        grow_column(store, (void **) &(store->config_counts),
+          sizeof(uint32_t), store->line_alloc, new_alloc) < 0 ||
+        grow_column(store, (void **) &(store->servers), sizeof(server_rec *),
+          store->line_alloc, new_alloc) < 0) {
+      return -1;
+    }
+
+    store->line_alloc = new_alloc;
+  }
+
+  if (store->slab_len + textsz + 1 > store->slab_alloc) {
+    size_t new_alloc;
+
+    new_alloc = store->slab_alloc > 0 ? store->slab_alloc * 2 : 16384;
+    while (new_alloc < store->slab_len + textsz + 1) {
+      new_alloc *= 2;
+    }
+
+    if (grow_column(store, (void **) &(store->slab), 1, store->slab_alloc,
+        new_alloc) < 0) {
+      return -1;
+    }
+
+    store->slab_alloc = new_alloc;
+  }
+
+  idx = store->line_count;
+
+  memcpy(store->slab + store->slab_len, text, textsz);
+  store->slab[store->slab_len + textsz] = '\0';
+  store->text_offsets[idx] = (uint32_t) store->slab_len;
+  store->slab_len += (textsz + 1);
+
+  store->directive_ids[idx] = directive_id;
+  store->file_ids[idx] = file_id;
+  store->linenos[idx] = source_lineno;
+  store->next_lines[idx] = LINT_STORE_NO_LINE;
+  store->config_offsets[idx] = store->config_count;
+  store->config_counts[idx] = 0;
+  store->servers[idx] = NULL;
+
+  /* Maintain the per-directive index. */
+  if (store->first_lines[directive_id] == LINT_STORE_NO_LINE) {
+    store->first_lines[directive_id] = idx;
+
+  } else {
+    store->next_lines[store->last_lines[directive_id]] = idx;
+  }
+
+  store->last_lines[directive_id] = idx;
+  store->directive_line_counts[directive_id]++;
+
+  store->line_count++;
+  return (int) idx;
+}
+
+unsigned int lint_store_count(struct lint_store *store) {
+  if (store == NULL) {
+    return 0;
+  }
+
+  return store->line_count;
+}
+
+const char *lint_store_get_directive(struct lint_store *store,
+    unsigned int idx) {
+  if (store == NULL ||
+      idx >= store->line_count) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  return store->strs[store->directive_ids[idx]];
+}
+
+int lint_store_get_directive_id(struct lint_store *store, unsigned int idx) {
+  if (store == NULL ||
+      idx >= store->line_count) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  return (int) store->directive_ids[idx];
+}
+
+const char *lint_store_get_text(struct lint_store *store, unsigned int idx,
+    size_t *textsz) {
+  const char *text;
+
+  if (store == NULL ||
+      idx >= store->line_count) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  text = store->slab + store->text_offsets[idx];
+
+  if (textsz != NULL) {
+    size_t next_offset;
+
+    next_offset = (idx + 1 < store->line_count) ?
+      store->text_offsets[idx + 1] : store->slab_len;
+    *textsz = next_offset - store->text_offsets[idx] - 1;
+  }
+
+  return text;
+}
+
+const char *lint_store_get_source_file(struct lint_store *store,
+    unsigned int idx) {
+  if (store == NULL ||
+      idx >= store->line_count) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  return store->strs[store->file_ids[idx]];
+}
+
+unsigned int lint_store_get_source_lineno(struct lint_store *store,
+    unsigned int idx) {
+  if (store == NULL ||
+      idx >= store->line_count) {
+    errno = EINVAL;
+    return 0;
+  }
+
+  return store->linenos[idx];
+}
+
+int lint_store_set_server(struct lint_store *store, unsigned int idx,
+    server_rec *s) {
+  if (store == NULL ||
+      idx >= store->line_count) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  store->servers[idx] = s;
+  return 0;
+}
+
+server_rec *lint_store_get_server(struct lint_store *store, unsigned int idx) {
+  if (store == NULL ||
+      idx >= store->line_count) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  return store->servers[idx];
+}
+
+int lint_store_add_config(struct lint_store *store, const config_rec *c) {
+  unsigned int idx;
+
+  if (store == NULL ||
+      c == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (store->line_count == 0) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  if (store->config_count == store->config_alloc) {
+    unsigned int new_alloc;
+
+    new_alloc = store->config_alloc > 0 ? store->config_alloc * 2 : 256;
+    if (grow_column(store, (void **) &(store->configs),
+          sizeof(const config_rec *), store->config_alloc, new_alloc) < 0) {
+      return -1;
+    }
+
+    store->config_alloc = new_alloc;
+  }
+
+  /* Since configs are only ever associated with the last line, that line's
+   * configs are always at the end of the array.
+   */
+  idx = store->line_count - 1;
+  store->configs[store->config_count++] = c;
+  store->config_counts[idx]++;
+
+  /* Any reverse index is now stale. */
+  store->config_slot_count = 0;
+
+  return 0;
+}
+
+const config_rec **lint_store_get_configs(struct lint_store *store,
+    unsigned int idx, unsigned int *count) {
+  if (store == NULL ||
+      idx >= store->line_count ||
+      count == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  *count = store->config_counts[idx];
+  if (*count == 0) {
+    return NULL;
+  }
+
+  return store->configs + store->config_offsets[idx];
+}
+
+static unsigned int config_slot(const config_rec *c, unsigned int mask) {
+  return (unsigned int) lint_hash_data(&c, sizeof(c)) & mask;
+}
+
+static int index_configs(struct lint_store *store) {
+  register unsigned int i, j;
+  unsigned int slot_count, mask;
+
+  slot_count = 64;
+  while (slot_count < store->config_count * 2) {
+    slot_count *= 2;
+  }
+
+  store->config_slots = lint_arena_calloc(store->arena,
+    sizeof(const config_rec *) * slot_count);
+  store->config_slot_lines = lint_arena_alloc(store->arena,
+    sizeof(uint32_t) * slot_count);
+  if (store->config_slots == NULL ||
+      store->config_slot_lines == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  mask = slot_count - 1;
+  for (i = 0; i < store->line_count; i++) {
+    for (j = 0; j < store->config_counts[i]; j++) {
+      const config_rec *c;
+      unsigned int k;
+
+      c = store->configs[store->config_offsets[i] + j];
+      k = config_slot(c, mask);
+      while (store->config_slots[k] != NULL &&
+             store->config_slots[k] != c) {
+        k = (k + 1) & mask;
+      }
+
+      /* A config associated more than once keeps its first line. */
+      if (store->config_slots[k] == NULL) {
+        store->config_slots[k] = c;
+        store->config_slot_lines[k] = i;
+      }
+    }
+  }
+
+  store->config_slot_count = slot_count;
+  return 0;
+}
+
+int lint_store_find_config_line(struct lint_store *store,
+    const config_rec *c) {
+  unsigned int mask, k;
+
+  if (store == NULL ||
+      c == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (store->config_count == 0) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  if (store->config_slot_count == 0 &&
+      index_configs(store) < 0) {
+    return -1;
+  }
+
+  mask = store->config_slot_count - 1;
+  k = config_slot(c, mask);
+  while (store->config_slots[k] != NULL) {
+    if (store->config_slots[k] == c) {
+      return (int) store->config_slot_lines[k];
+    }
+
+    k = (k + 1) & mask;
+  }
+
+  errno = ENOENT;
+  return -1;
+}
+
+static int find_directive_id(struct lint_store *store, const char *directive) {
+  const uint32_t *slot;
+
+  if (store->directive_slot_count == 0) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  slot = find_directive_slot(store, directive);
+  if (*slot == LINT_STORE_NO_STR) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  return (int) *slot;
+}
+
+int lint_store_find_directive_id(struct lint_store *store,
+    const char *directive) {
+  int directive_id;
+
+  if (store == NULL ||
+      directive == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  directive_id = find_directive_id(store, directive);
+  if (directive_id < 0 ||
+      store->first_lines[directive_id] == LINT_STORE_NO_LINE) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  return directive_id;
+}
+
+int lint_store_find_line(struct lint_store *store, const char *directive) {
+  int directive_id;
+
+  if (store == NULL ||
+      directive == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  directive_id = find_directive_id(store, directive);
+  if (directive_id < 0 ||
+      store->first_lines[directive_id] == LINT_STORE_NO_LINE) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  return (int) store->first_lines[directive_id];
+}
+
+int lint_store_next_line(struct lint_store *store, unsigned int idx) {
+  if (store == NULL ||
+      idx >= store->line_count) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (store->next_lines[idx] == LINT_STORE_NO_LINE) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  return (int) store->next_lines[idx];
+}
+
+unsigned int lint_store_count_lines(struct lint_store *store,
+    const char *directive) {
+  int directive_id;
+
+  if (store == NULL ||
+      directive == NULL) {
+    return 0;
+  }
+
+  directive_id = find_directive_id(store, directive);
+  if (directive_id < 0) {
+    return 0;
+  }
+
+  return store->directive_line_counts[directive_id];
+}
@@ -0,0 +1,218 @@
+/*
+ * ProFTPD: mod_lint symbol table implementation
+ * Copyright (c) 2021 TJ Saunders
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+#include "mod_lint.h"
+#include "lint/symtab.h"
+#include "lint/hash.h"
+
+#define LINT_SYMTAB_FL_HAVE_MODULE	0x0001
+#define LINT_SYMTAB_FL_HAVE_COP		0x0002
+
+struct lint_symbol {
+  const char *name;
+  unsigned int flags;
+
+  module *m;
+  struct lint_cop_ctx cop_ctx;
+  int cop_errno;
+};
+
+struct lint_symtab {
+  struct lint_arena *arena;
+
+  /* Open-addressed table of symbols; its size is a power of two, kept at
+   * most half full.
+   */
+  struct lint_symbol **slots;
+  unsigned int slot_count;
+  unsigned int symbol_count;
+};
+
+static const char *trace_channel = "lint.symtab";
+
+struct lint_symtab *lint_symtab_alloc(struct lint_arena *arena) {
+  struct lint_symtab *symtab;
+
+  if (arena == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  symtab = lint_arena_calloc(arena, sizeof(struct lint_symtab));
+  if (symtab == NULL) {
+    return NULL;
+  }
+
+  symtab->arena = arena;
+  return symtab;
+}
+
+static struct lint_symbol **find_slot(struct lint_symbol **slots,
+    unsigned int slot_count, const char *name) {
+  unsigned int mask, i;
+
+  mask = slot_count - 1;
+  i = (unsigned int) lint_hash_data(name, strlen(name)) & mask;
+
+  while (slots[i] != NULL) {
+    if (strcmp(slots[i]->name, name) == 0) {
+      break;
+    }
+
+    i = (i + 1) & mask;
+  }
+
+  return &(slots[i]);
+}
+
+static int grow_slots(struct lint_symtab *symtab) {
+  register unsigned int i;
+  unsigned int new_count;
+  struct lint_symbol **new_slots;
+
+  new_count = symtab->slot_count > 0 ? symtab->slot_count * 2 : 256;
+  new_slots = lint_arena_calloc(symtab->arena,
+    sizeof(struct lint_symbol *) * new_count);
+  if (new_slots == NULL) {
+    return -1;
+  }
+
+  for (i = 0; i < symtab->slot_count; i++) {
+    if (symtab->slots[i] != NULL) {
+      *(find_slot(new_slots, new_count, symtab->slots[i]->name)) =
+        symtab->slots[i];
+    }
+  }
+
+  symtab->slots = new_slots;
+  symtab->slot_count = new_count;
+  return 0;
+}
+
+static struct lint_symbol *get_symbol(struct lint_symtab *symtab,
+    const char *name) {
+  struct lint_symbol **slot, *sym;
+
+  if (symtab->slot_count > 0) {
+    slot = find_slot(symtab->slots, symtab->slot_count, name);
+    if (*slot != NULL) {
+      return *slot;
+    }
+  }
+
+  if ((symtab->symbol_count + 1) * 2 > symtab->slot_count) {
+    if (grow_slots(symtab) < 0) {
+      return NULL;
+    }
+  }
+
+  sym = lint_arena_calloc(symtab->arena, sizeof(struct lint_symbol));
+  if (sym == NULL) {
+    return NULL;
+  }
+
+  sym->name = lint_arena_strdup(symtab->arena, name);
+  if (sym->name == NULL) {
+    return NULL;
+  }
+
+  *(find_slot(symtab->slots, symtab->slot_count, name)) = sym;
+  symtab->symbol_count++;
+
+  pr_trace_msg(trace_channel, 17, "added symbol '%s' (%u symbols)", name,
+    symtab->symbol_count);
+  return sym;
+}
+
+module *lint_symtab_get_module(struct lint_symtab *symtab,
+    const char *directive) {
+  struct lint_symbol *sym;
+
+  if (symtab == NULL ||
+      directive == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  sym = get_symbol(symtab, directive);
+  if (sym == NULL) {
+    return NULL;
+  }
+
+  if (!(sym->flags & LINT_SYMTAB_FL_HAVE_MODULE)) {
+    conftable *conftab;
+    int idx = -1;
+    unsigned int hash = 0;
+
+    conftab = pr_stash_get_symbol2(PR_SYM_CONF, directive, NULL, &idx, &hash);
+    if (conftab != NULL) {
+      sym->m = conftab->m;
+    }
+
+    sym->flags |= LINT_SYMTAB_FL_HAVE_MODULE;
+  }
+
+  if (sym->m == NULL) {
+    errno = ENOENT;
+  }
+
+  return sym->m;
+}
+
+const struct lint_cop *lint_symtab_get_cop(struct lint_symtab *symtab,
+    config_rec *c, struct lint_cop_ctx *ctx) {
+  struct lint_symbol *sym;
+
+  if (symtab == NULL ||
+      c == NULL ||
+      c->name == NULL ||
+      c->config_type != CONF_PARAM) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  sym = get_symbol(symtab, c->name);
+  if (sym == NULL) {
+    return NULL;
+  }
+
+  if (!(sym->flags & LINT_SYMTAB_FL_HAVE_COP)) {
+    if (lint_cop_get_config_cop(c, &(sym->cop_ctx)) == NULL) {
+      sym->cop_errno = errno;
+    }
+
+    sym->flags |= LINT_SYMTAB_FL_HAVE_COP;
+  }
+
+  if (sym->cop_ctx.cop == NULL) {
+    errno = sym->cop_errno;
+    return NULL;
+  }
+
+  if (ctx != NULL) {
+    *ctx = sym->cop_ctx;
+  }
+
+  return sym->cop_ctx.cop;
+}
@@ -24,11 +24,238 @@
 
 #include "mod_lint.h"
 #include "lint/text.h"
+#include "lint/arena.h"
 
 #define LINT_BUFFER_SIZE		PR_TUNABLE_BUFFER_SIZE * 2
 
+/* Writer blocks are 64 KB; we accumulate up to 16 such blocks (1 MB) before
+ * flushing them out.
+ */
+#define LINT_WRITER_BLOCK_SIZE		(64 * 1024)
+#define LINT_WRITER_MAX_BLOCKS		16
+
+/* Unbuffered writes of buffered lines gather up to this many segments per
+ * writev(2).
+ */
+#define LINT_WRITE_MAX_SEGS		64
+
+struct lint_text_writer {
+  pool *pool;
+  pr_fh_t *fh;
+
+  /* The blocks are allocated as needed, from an arena rather than the pool,
+   * so that the memory is returned to the OS once the writer is closed.
+   * They are reused after each flush.
+   */
+  struct lint_arena *arena;
+  char *blocks[LINT_WRITER_MAX_BLOCKS];
+  size_t block_lens[LINT_WRITER_MAX_BLOCKS];
+  unsigned int nblocks;
+  unsigned int curr_block;
+
+  struct lint_text_writer_stats stats;
+};
+
+/* Lists shorter than this are sorted by comparison rather than by radix. */
+#define LINT_SORT_RADIX_MIN		64
+
+/* Sort entries carry the key inline, so that the radix passes scan one
+ * contiguous array rather than chasing a pointer per line.
+ */
+struct sort_entry {
+  uint64_t key;
+  struct lint_buffered_line *bl;
+};
+
+/* Indentation segments reference slices of this, rather than copies. */
+static const char indent_spaces[] = "                                ";
+#define LINT_INDENT_WIDTH		2
+
 static const char *trace_channel = "lint.text";
 
+static uint64_t line_key(const struct lint_buffered_line *bl) {
+  register unsigned int i;
+  unsigned int nbytes = 0;
+  uint64_t key = 0;
+
+  for (i = 0; i < bl->nsegs && nbytes < sizeof(key); i++) {
+    register size_t j;
+    const unsigned char *ptr;
+
+    ptr = bl->segs[i].iov_base;
+    for (j = 0; j < bl->segs[i].iov_len && nbytes < sizeof(key); j++) {
+      if (ptr[j] == '\0') {
+        /* As for strcmp(3), the text ends at the first NUL. */
+        i = bl->nsegs;
+        break;
+      }
+
+      key = (key << 8) | ptr[j];
+      nbytes++;
+    }
+  }
+
+  if (nbytes < sizeof(key)) {
+    key <<= (8 * (sizeof(key) - nbytes));
+  }
+
+  return key;
+}
+
+/* Compares the text of two lines, as strcmp(3) would, walking their
+ * segments.
+ */
+static int line_textcmp(const struct lint_buffered_line *a,
+    const struct lint_buffered_line *b) {
+  unsigned int ai = 0, bi = 0;
+  size_t aoff = 0, boff = 0;
+
+  while (TRUE) {
+    int ac = 0, bc = 0;
+
+    while (ai < a->nsegs &&
+           aoff == a->segs[ai].iov_len) {
+      ai++;
+      aoff = 0;
+    }
+
+    while (bi < b->nsegs &&
+           boff == b->segs[bi].iov_len) {
+      bi++;
+      boff = 0;
+    }
+
+    if (ai < a->nsegs) {
+      ac = ((const unsigned char *) a->segs[ai].iov_base)[aoff++];
+    }
+
+    if (bi < b->nsegs) {
+      bc = ((const unsigned char *) b->segs[bi].iov_base)[boff++];
+    }
+
+    if (ac != bc ||
+        ac == 0) {
+      return ac - bc;
+    }
+  }
+}
+
+static int line_add_seg(struct lint_buffered_line *bl, const char *str,
+    size_t len) {
+  struct iovec *seg;
+
+  if (len == 0) {
+    return 0;
+  }
+
+  if (bl->nsegs == bl->segs_cap) {
+    struct iovec *segs;
+    unsigned int segs_cap;
+
+    segs_cap = bl->segs_cap * 2;
+    segs = palloc(bl->pool, sizeof(struct iovec) * segs_cap);
+    memcpy(segs, bl->segs, sizeof(struct iovec) * bl->nsegs);
+
+    bl->segs = segs;
+    bl->segs_cap = segs_cap;
+  }
+
+  seg = &(bl->segs[bl->nsegs++]);
+  seg->iov_base = (void *) str;
+  seg->iov_len = len;
+  bl->textsz += len;
+
+  return 0;
+}
+
+static int line_push(array_header *buffered_lines,
+  struct lint_buffered_line *bl);
+
+/* Vectored writes of the given iovecs to the file descriptor, handling
+ * short writes.  Note that the FSIO API does not provide a vectored write.
+ * If provided, the stats are updated with the writes made.
+ */
+static int write_iovs(pr_fh_t *fh, struct iovec *iov, int iovcnt,
+    struct lint_text_writer_stats *stats) {
+  while (iovcnt > 0) {
+    ssize_t res;
+
+    res = writev(fh->fh_fd, iov, iovcnt);
+    if (stats != NULL) {
+      stats->nwrites++;
+    }
+
+    if (res < 0) {
+      int xerrno = errno;
+
+      if (xerrno == EINTR) {
+        pr_signals_handle();
+        continue;
+      }
+
+      pr_trace_msg(trace_channel, 1, "error writing to '%s': %s",
+        fh->fh_path, strerror(xerrno));
+      errno = xerrno;
+      return -1;
+    }
+
+    if (stats != NULL) {
+      stats->bytes_written += res;
+    }
+
+    pr_trace_msg(trace_channel, 19, "wrote %lu bytes (%d %s) to '%s'",
+      (unsigned long) res, iovcnt, iovcnt != 1 ? "segments" : "segment",
+      fh->fh_path);
+
+    /* Handle any short writes, by skipping past the fully written segments,
+     * and adjusting the partially written one.
+     */
+    while (iovcnt > 0 &&
+           (size_t) res >= iov->iov_len) {
+      res -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+
+    if (iovcnt > 0) {
+      iov->iov_base = ((char *) iov->iov_base) + res;
+      iov->iov_len -= res;
+    }
+  }
+
+  return 0;
+}
+
+/* Formats the message into the given buffer, or, if it does not fit, into
+ * a buffer allocated from the given pool, rather than truncating it.
+ */
+static char *format_msg(pool *p, char *buf, size_t bufsz, size_t *textsz,
+    const char *fmt, va_list msg) {
+  int len;
+  va_list msg_copy;
+  char *text;
+
+  va_copy(msg_copy, msg);
+  len = pr_vsnprintf(buf, bufsz, fmt, msg);
+
+  if (len < 0) {
+    va_end(msg_copy);
+    errno = EINVAL;
+    return NULL;
+  }
+
+  text = buf;
+  if ((size_t) len >= bufsz) {
+    text = palloc(p, len + 1);
+    (void) pr_vsnprintf(text, len + 1, fmt, msg_copy);
+  }
+
+  va_end(msg_copy);
+
+  *textsz = len;
+  return text;
+}
+
 int lint_text_write_text(pr_fh_t *fh, const char *text, size_t textsz) {
   int res, xerrno;
 
@@ -57,8 +284,10 @@ int lint_text_write_text(pr_fh_t *fh, const char *text, size_t textsz) {
 }
 
 int lint_text_write_msg(pr_fh_t *fh, const char *fmt, va_list msg) {
-  char buf[LINT_BUFFER_SIZE];
-  size_t buflen;
+  int res, xerrno;
+  char buf[LINT_BUFFER_SIZE], *text;
+  size_t textsz;
+  pool *tmp_pool;
 
   if (fh == NULL ||
       fmt == NULL) {
@@ -66,12 +295,19 @@ int lint_text_write_msg(pr_fh_t *fh, const char *fmt, va_list msg) {
     return -1;
   }
 
-  buflen = pr_vsnprintf(buf, sizeof(buf)-1, fmt, msg);
+  tmp_pool = make_sub_pool(fh->fh_pool);
+  text = format_msg(tmp_pool, buf, sizeof(buf), &textsz, fmt, msg);
+  if (text == NULL) {
+    destroy_pool(tmp_pool);
+    return -1;
+  }
 
-  /* Always make sure the buffer is NUL-terminated. */
-  buf[sizeof(buf)-1] = '\0';
+  res = lint_text_write_text(fh, text, textsz);
+  xerrno = errno;
 
-  return lint_text_write_text(fh, buf, buflen);
+  destroy_pool(tmp_pool);
+  errno = xerrno;
+  return res;
 }
 
 int lint_text_write_fmt(pr_fh_t *fh, const char *fmt, ...) {
@@ -95,8 +331,8 @@ int lint_text_write_fmt(pr_fh_t *fh, const char *fmt, ...) {
 
 int lint_text_add_msg(pool *p, array_header *buffered_lines, const char *fmt,
     va_list msg) {
-  char buf[LINT_BUFFER_SIZE];
-  size_t buflen;
+  char buf[LINT_BUFFER_SIZE], *text;
+  size_t textsz;
   struct lint_buffered_line *bl;
 
   if (p == NULL ||
@@ -106,17 +342,19 @@ int lint_text_add_msg(pool *p, array_header *buffered_lines, const char *fmt,
     return -1;
   }
 
-  buflen = pr_vsnprintf(buf, sizeof(buf)-1, fmt, msg);
+  text = format_msg(p, buf, sizeof(buf), &textsz, fmt, msg);
+  if (text == NULL) {
+    return -1;
+  }
 
-  /* Always make sure the buffer is NUL-terminated. */
-  buf[sizeof(buf)-1] = '\0';
+  if (text == buf) {
+    text = pstrndup(p, buf, textsz);
+  }
 
-  bl = pcalloc(p, sizeof(struct lint_buffered_line));
-  bl->text = pstrdup(p, buf);
-  bl->textsz = buflen;
+  bl = lint_text_line_create(p);
+  (void) line_add_seg(bl, text, textsz);
 
-  *((struct lint_buffered_line **) push_array(buffered_lines)) = bl;
-  return 0;
+  return line_push(buffered_lines, bl);
 }
 
 int lint_text_add_fmt(pool *p, array_header *buffered_lines, const char *fmt,
@@ -140,16 +378,327 @@ int lint_text_add_fmt(pool *p, array_header *buffered_lines, const char *fmt,
   return res;
 }
 
+struct lint_buffered_line *lint_text_line_create(pool *p) {
+  struct lint_buffered_line *bl;
+
+  if (p == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  bl = pcalloc(p, sizeof(struct lint_buffered_line));
+  bl->pool = p;
+  bl->segs = bl->inline_segs;
+  bl->segs_cap = LINT_TEXT_INLINE_SEGS;
+
+  return bl;
+}
+
+int lint_text_line_add_indent(struct lint_buffered_line *bl,
+    unsigned int depth) {
+  size_t len;
+
+  if (bl == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  len = depth * LINT_INDENT_WIDTH;
+  while (len > 0) {
+    size_t seglen;
+
+    seglen = len < sizeof(indent_spaces)-1 ? len : sizeof(indent_spaces)-1;
+    (void) line_add_seg(bl, indent_spaces, seglen);
+    len -= seglen;
+  }
+
+  return 0;
+}
+
+int lint_text_line_add_strn(struct lint_buffered_line *bl, const char *str,
+    size_t len) {
+  if (bl == NULL ||
+      str == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  return line_add_seg(bl, str, len);
+}
+
+int lint_text_line_add_str(struct lint_buffered_line *bl, const char *str) {
+  if (bl == NULL ||
+      str == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  return line_add_seg(bl, str, strlen(str));
+}
+
+int lint_text_line_add_quoted(struct lint_buffered_line *bl, const char *str) {
+  if (bl == NULL ||
+      str == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  (void) line_add_seg(bl, "\"", 1);
+  (void) line_add_seg(bl, str, strlen(str));
+  return line_add_seg(bl, "\"", 1);
+}
+
+int lint_text_line_add_uint(struct lint_buffered_line *bl, unsigned long num) {
+  char buf[32], *ptr;
+
+  if (bl == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  ptr = buf + sizeof(buf);
+  do {
+    *--ptr = '0' + (num % 10);
+    num /= 10;
+  } while (num > 0);
+
+  return line_add_seg(bl, pstrndup(bl->pool, ptr, buf + sizeof(buf) - ptr),
+    buf + sizeof(buf) - ptr);
+}
+
+int lint_text_line_add_int(struct lint_buffered_line *bl, long num) {
+  if (bl == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (num < 0) {
+    (void) line_add_seg(bl, "-", 1);
+    return lint_text_line_add_uint(bl, -((unsigned long) num));
+  }
+
+  return lint_text_line_add_uint(bl, (unsigned long) num);
+}
+
+int lint_text_line_add_bool(struct lint_buffered_line *bl, int on) {
+  if (bl == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  return on ? line_add_seg(bl, "on", 2) : line_add_seg(bl, "off", 3);
+}
+
+int lint_text_line_add_lines(struct lint_buffered_line *bl,
+    array_header *buffered_lines) {
+  register unsigned int i, j;
+  struct lint_buffered_line **lines;
+
+  if (bl == NULL ||
+      buffered_lines == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  lines = buffered_lines->elts;
+  for (i = 0; i < buffered_lines->nelts; i++) {
+    for (j = 0; j < lines[i]->nsegs; j++) {
+      (void) line_add_seg(bl, lines[i]->segs[j].iov_base,
+        lines[i]->segs[j].iov_len);
+    }
+  }
+
+  return 0;
+}
+
+static int line_push(array_header *buffered_lines,
+    struct lint_buffered_line *bl) {
+  bl->key = line_key(bl);
+  bl->seq = buffered_lines->nelts;
+
+  *((struct lint_buffered_line **) push_array(buffered_lines)) = bl;
+  return 0;
+}
+
+int lint_text_add_line(array_header *buffered_lines,
+    struct lint_buffered_line *bl) {
+  if (buffered_lines == NULL ||
+      bl == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  (void) line_add_seg(bl, "\n", 1);
+  return line_push(buffered_lines, bl);
+}
+
+const char *lint_text_line_get_text(pool *p,
+    const struct lint_buffered_line *bl) {
+  register unsigned int i;
+  char *text, *ptr;
+
+  if (p == NULL ||
+      bl == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  ptr = text = palloc(p, bl->textsz + 1);
+  for (i = 0; i < bl->nsegs; i++) {
+    memcpy(ptr, bl->segs[i].iov_base, bl->segs[i].iov_len);
+    ptr += bl->segs[i].iov_len;
+  }
+
+  *ptr = '\0';
+  return text;
+}
+
 static int buffered_linecmp(const void *a, const void *b) {
   const struct lint_buffered_line *bla, *blb;
+  int res;
+
+  bla = ((const struct sort_entry *) a)->bl;
+  blb = ((const struct sort_entry *) b)->bl;
+
+  if (bla->key != blb->key) {
+    return bla->key < blb->key ? -1 : 1;
+  }
+
+  /* Equal keys whose last byte is NUL mean the texts are equal; otherwise,
+   * the full texts need comparing.
+   */
+  if ((bla->key & 0xff) != 0) {
+    res = line_textcmp(bla, blb);
+    if (res != 0) {
+      return res;
+    }
+  }
+
+  return bla->seq < blb->seq ? -1 : (bla->seq > blb->seq ? 1 : 0);
+}
+
+/* A stable LSD radix sort on the keys, one byte per pass.  Passes over a
+ * byte which is the same for every key (e.g. common indentation) are
+ * skipped.
+ */
+static void radix_sort_entries(struct sort_entry *entries,
+    struct sort_entry *scratch, unsigned int nentries) {
+  register unsigned int i;
+  unsigned int shift;
+  uint64_t all_and = ~((uint64_t) 0), all_or = 0, varying;
+  struct sort_entry *orig = entries;
+
+  for (i = 0; i < nentries; i++) {
+    all_and &= entries[i].key;
+    all_or |= entries[i].key;
+  }
+
+  varying = all_and ^ all_or;
+
+  for (shift = 0; shift < 64; shift += 8) {
+    unsigned int counts[256], offset;
+    struct sort_entry *tmp;
+
+    if (((varying >> shift) & 0xff) == 0) {
+      continue;
+    }
+
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i < nentries; i++) {
+      counts[(entries[i].key >> shift) & 0xff]++;
+    }
+
+    offset = 0;
+    for (i = 0; i < 256; i++) {
+      unsigned int count;
+
+      count = counts[i];
+      counts[i] = offset;
+      offset += count;
+    }
 
-  bla = *((struct lint_buffered_line **) a);
-  blb = *((struct lint_buffered_line **) b);
-  return strcmp(bla->text, blb->text);
+    for (i = 0; i < nentries; i++) {
+      scratch[counts[(entries[i].key >> shift) & 0xff]++] = entries[i];
+    }
+
+    tmp = entries;
+    entries = scratch;
+    scratch = tmp;
+  }
+
+  /* After an odd number of passes, the sorted entries are in the caller's
+   * scratch array; copy them home.
+   */
+  if (entries != orig) {
+    memcpy(orig, entries, sizeof(struct sort_entry) * nentries);
+  }
+}
+
+void lint_text_sort_buffered_lines(array_header *buffered_lines) {
+  register unsigned int i;
+  pool *tmp_pool;
+  struct lint_buffered_line **lines;
+  struct sort_entry *entries, *scratch;
+  unsigned int nlines;
+
+  if (buffered_lines == NULL ||
+      buffered_lines->nelts < 2) {
+    return;
+  }
+
+  lines = buffered_lines->elts;
+  nlines = buffered_lines->nelts;
+
+  tmp_pool = make_sub_pool(buffered_lines->pool);
+  pr_pool_tag(tmp_pool, "Lint sort pool");
+
+  entries = palloc(tmp_pool, sizeof(struct sort_entry) * nlines * 2);
+  scratch = entries + nlines;
+
+  for (i = 0; i < nlines; i++) {
+    entries[i].key = lines[i]->key;
+    entries[i].bl = lines[i];
+  }
+
+  if (nlines < LINT_SORT_RADIX_MIN) {
+    qsort(entries, nlines, sizeof(struct sort_entry), buffered_linecmp);
+
+  } else {
+    unsigned int start;
+
+    radix_sort_entries(entries, scratch, nlines);
+
+    /* The radix passes order the lines by key, stably; runs of tied keys
+     * are then ordered by the rest of their text.
+     */
+    start = 0;
+    for (i = 1; i <= nlines; i++) {
+      if (i < nlines &&
+          entries[i].key == entries[start].key) {
+        continue;
+      }
+
+      if (i - start > 1 &&
+          (entries[start].key & 0xff) != 0) {
+        qsort(entries + start, i - start, sizeof(struct sort_entry),
+          buffered_linecmp);
+      }
+
+      start = i;
+    }
+  }
+
+  for (i = 0; i < nlines; i++) {
+    lines[i] = entries[i].bl;
+  }
+
+  destroy_pool(tmp_pool);
 }
 
 int lint_text_write_buffered_lines(pr_fh_t *fh, array_header *buffered_lines) {
   register unsigned int i;
+  struct iovec iovs[LINT_WRITE_MAX_SEGS];
+  int iovcnt = 0;
 
   if (fh == NULL) {
     errno = EINVAL;
@@ -161,19 +710,281 @@ int lint_text_write_buffered_lines(pr_fh_t *fh, array_header *buffered_lines) {
   }
 
   /* Sort the lines first */
-  qsort((void *) buffered_lines->elts, buffered_lines->nelts,
-    sizeof(struct lint_buffered_line *), buffered_linecmp);
+  lint_text_sort_buffered_lines(buffered_lines);
 
+  /* Gather the segments of as many lines as fit into one writev(2). */
   for (i = 0; i < buffered_lines->nelts; i++) {
-    int res;
+    register unsigned int j;
     struct lint_buffered_line *bl;
 
     bl = ((struct lint_buffered_line **) buffered_lines->elts)[i];
-    res = lint_text_write_text(fh, bl->text, bl->textsz);
-    if (res < 0) {
+    for (j = 0; j < bl->nsegs; j++) {
+      if (iovcnt == LINT_WRITE_MAX_SEGS) {
+        if (write_iovs(fh, iovs, iovcnt, NULL) < 0) {
+          return -1;
+        }
+
+        iovcnt = 0;
+      }
+
+      iovs[iovcnt++] = bl->segs[j];
+    }
+  }
+
+  if (iovcnt > 0 &&
+      write_iovs(fh, iovs, iovcnt, NULL) < 0) {
+    return -1;
+  }
+
+  return 0;
+}
+
+static void writer_cleanup(void *data) {
+  struct lint_text_writer *w;
+
+  w = data;
+  lint_arena_destroy(w->arena);
+  w->arena = NULL;
+}
+
+struct lint_text_writer *lint_text_writer_create(pool *p, pr_fh_t *fh) {
+  pool *writer_pool;
+  struct lint_text_writer *w;
+
+  if (p == NULL ||
+      fh == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  writer_pool = make_sub_pool(p);
+  pr_pool_tag(writer_pool, "Lint text writer pool");
+
+  w = pcalloc(writer_pool, sizeof(struct lint_text_writer));
+  w->pool = writer_pool;
+  w->fh = fh;
+
+  w->arena = lint_arena_create(LINT_WRITER_BLOCK_SIZE * 4);
+  if (w->arena == NULL) {
+    int xerrno = errno;
+
+    destroy_pool(writer_pool);
+    errno = xerrno;
+    return NULL;
+  }
+
+  register_cleanup2(writer_pool, w, writer_cleanup);
+  return w;
+}
+
+int lint_text_writer_flush(struct lint_text_writer *w) {
+  register unsigned int i;
+  struct iovec iovs[LINT_WRITER_MAX_BLOCKS];
+  int iovcnt = 0;
+
+  if (w == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  for (i = 0; i < w->nblocks; i++) {
+    if (w->block_lens[i] == 0) {
+      break;
+    }
+
+    iovs[iovcnt].iov_base = w->blocks[i];
+    iovs[iovcnt].iov_len = w->block_lens[i];
+    iovcnt++;
+  }
+
+  if (write_iovs(w->fh, iovs, iovcnt, &(w->stats)) < 0) {
+    return -1;
+  }
+
+  for (i = 0; i < w->nblocks; i++) {
+    w->block_lens[i] = 0;
+  }
+
+  w->curr_block = 0;
+  return 0;
+}
+
+int lint_text_writer_text(struct lint_text_writer *w, const char *text,
+    size_t textsz) {
+
+  if (w == NULL ||
+      text == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  pr_trace_msg(trace_channel, 29, "buffering text: '%.*s' (%lu)",
+    (int) textsz, text, (unsigned long) textsz);
+
+  while (textsz > 0) {
+    size_t avail, len;
+
+    if (w->curr_block == w->nblocks) {
+      w->blocks[w->nblocks] = lint_arena_alloc(w->arena,
+        LINT_WRITER_BLOCK_SIZE);
+      if (w->blocks[w->nblocks] == NULL) {
+        return -1;
+      }
+
+      w->block_lens[w->nblocks] = 0;
+      w->nblocks++;
+    }
+
+    avail = LINT_WRITER_BLOCK_SIZE - w->block_lens[w->curr_block];
+    len = textsz < avail ? textsz : avail;
+
+    memcpy(w->blocks[w->curr_block] + w->block_lens[w->curr_block], text, len);
+    w->block_lens[w->curr_block] += len;
+    text += len;
+    textsz -= len;
+
+    if (w->block_lens[w->curr_block] == LINT_WRITER_BLOCK_SIZE) {
+      w->curr_block++;
+
+      if (w->curr_block == LINT_WRITER_MAX_BLOCKS) {
+        if (lint_text_writer_flush(w) < 0) {
+          return -1;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
+int lint_text_writer_msg(struct lint_text_writer *w, const char *fmt,
+    va_list msg) {
+  int res, xerrno;
+  char buf[LINT_BUFFER_SIZE], *text;
+  size_t textsz;
+  pool *tmp_pool;
+
+  if (w == NULL ||
+      fmt == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  tmp_pool = make_sub_pool(w->pool);
+  text = format_msg(tmp_pool, buf, sizeof(buf), &textsz, fmt, msg);
+  if (text == NULL) {
+    destroy_pool(tmp_pool);
+    return -1;
+  }
+
+  res = lint_text_writer_text(w, text, textsz);
+  xerrno = errno;
+
+  destroy_pool(tmp_pool);
+  errno = xerrno;
+  return res;
+}
+
+int lint_text_writer_fmt(struct lint_text_writer *w, const char *fmt, ...) {
+  int res, xerrno;
+  va_list msg;
+
+  if (w == NULL ||
+      fmt == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  va_start(msg, fmt);
+  res = lint_text_writer_msg(w, fmt, msg);
+  xerrno = errno;
+  va_end(msg);
+
+  errno = xerrno;
+  return res;
+}
+
+int lint_text_writer_line(struct lint_text_writer *w,
+    const struct lint_buffered_line *bl) {
+  register unsigned int i;
+
+  if (w == NULL ||
+      bl == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  for (i = 0; i < bl->nsegs; i++) {
+    if (lint_text_writer_text(w, bl->segs[i].iov_base,
+        bl->segs[i].iov_len) < 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int lint_text_writer_buffered_lines(struct lint_text_writer *w,
+    array_header *buffered_lines) {
+  register unsigned int i;
+
+  if (w == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (buffered_lines == NULL) {
+    return 0;
+  }
+
+  lint_text_sort_buffered_lines(buffered_lines);
+
+  for (i = 0; i < buffered_lines->nelts; i++) {
+    struct lint_buffered_line *bl;
+
+    bl = ((struct lint_buffered_line **) buffered_lines->elts)[i];
+    if (lint_text_writer_line(w, bl) < 0) {
       return -1;
     }
   }
 
   return 0;
 }
+
+int lint_text_writer_get_stats(struct lint_text_writer *w,
+    struct lint_text_writer_stats *stats) {
+  if (w == NULL ||
+      stats == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  memcpy(stats, &(w->stats), sizeof(struct lint_text_writer_stats));
+  return 0;
+}
+
+int lint_text_writer_close(struct lint_text_writer *w) {
+  int res, xerrno = 0;
+
+  if (w == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  res = lint_text_writer_flush(w);
+  if (res < 0) {
+    xerrno = errno;
+  }
+
+  if (pr_fsio_close(w->fh) < 0) {
+    if (res == 0) {
+      xerrno = errno;
+      res = -1;
+    }
+  }
+
+  destroy_pool(w->pool);
+
+  errno = xerrno;
+  return res;
+}
@@ -28,6 +28,21 @@
 #include "mod_lint.h"
 #include "lint/text.h"
 #include "lint/cop.h"
+#include "lint/hash.h"
+#include "lint/state.h"
+#include "lint/arena.h"
+#include "lint/capture.h"
+#include "lint/store.h"
+#include "lint/symtab.h"
+#include "lint/run.h"
+#include "lint/perf.h"
+#include "lint/profile.h"
+#include "lint/dns.h"
+#include "lint/rule.h"
+
+#if defined(__linux__)
+# include <sys/syscall.h>
+#endif /* Linux */
 
 extern module *static_modules[];
 extern module *loaded_modules;
@@ -44,81 +59,230 @@ module lint_module;
 pool *lint_pool = NULL;
 
 static int lint_engine = TRUE;
+static unsigned long lint_opts = 0UL;
 
-struct lint_parsed_line {
-  struct lint_parsed_line *next, *prev;
-  const char *directive;
-  const char *text;
-  module *handling_module;
-  const char *source_file;
-  unsigned int source_lineno;
-  array_header *associated_configs;
+/* LintOptions */
+#define LINT_OPT_BACKGROUND		0x0001
+#define LINT_OPT_PERF_STATS		0x0002
+#define LINT_OPT_NUMERIC_ADDRESSES	0x0004
+
+/* When emitting in the background, the emitting process runs at this
+ * niceness, and at idle I/O priority where supported.
+ */
+#define LINT_BACKGROUND_NICENESS	10
+
+/* LintSyncPolicy values */
+#define LINT_SYNC_POLICY_NONE		0
+#define LINT_SYNC_POLICY_FILE		1
+#define LINT_SYNC_POLICY_DIRECTORY	2
+
+static int lint_sync_policy = LINT_SYNC_POLICY_NONE;
+
+/* LintWorkers: the number of processes used for rendering the
+ * <VirtualHost> sections.
+ */
+static unsigned int lint_workers = 1;
+
+/* LintStateFile: the rendered <VirtualHost> sections are cached in a file
+ * alongside the state file, so that only the vhosts whose lines changed are
+ * rendered again.
+ */
+static const char *lint_vhost_cache_path = NULL;
+
+/* LintTimeBudget: the number of milliseconds allowed for emitting the
+ * config.  The budget is checked between sections, and between vhosts; once
+ * exceeded, the emitted lines so far are written to a partial file.
+ */
+static uint64_t lint_time_budget = 0;
+
+struct lint_timer {
+  uint64_t start_ns;
+  const char *section;
+  unsigned int nsections;
+
+  /* Where the budget was exceeded, if it was. */
+  int exceeded;
+  unsigned int vhost_idx, nvhosts;
+};
+
+static struct lint_timer lint_timer;
+
+/* Phase timings and counters, reported via the "lint.perf" trace channel,
+ * and optionally a JSON stats file.  The ingest phase is measured from the
+ * first parsed line until postparse, rather than per line, to keep timing
+ * out of the per-line path.
+ */
+static struct lint_perf lint_perf;
+static uint64_t lint_ingest_start_ns = 0;
+
+/* LintProfileFile: the time spent parsing is attributed, per source file,
+ * directive and module, as soon as this directive is parsed.
+ */
+static const char *lint_profile_path = NULL;
+static struct lint_profile *lint_profile = NULL;
+
+/* The names used as addresses, requiring DNS resolution at startup. */
+static struct lint_dns *lint_dns = NULL;
+
+/* LintMode values */
+#define LINT_MODE_NORMALIZE		0
+#define LINT_MODE_PASSTHROUGH		1
+
+/* In passthrough mode, the parsed lines are streamed out, annotated with
+ * their source, as they arrive, rather than stored until postparse.  Since
+ * the LintMode and LintConfigFile directives are themselves parsed lines,
+ * any lines which precede them are stored as usual, until both are seen.
+ */
+struct lint_stream {
+  pool *pool;
+  const char *path;
+  char *tmp_path;
+  pr_fh_t *fh;
+  struct lint_text_writer *w;
+  struct lint_state *state;
+  uint64_t lines_hash;
+
+  /* The source files already hashed into the state. */
+  pr_table_t *seen_files;
+
+  int failed;
 };
 
-static array_header *associated_configs = NULL;
-static xaset_t *parsed_lines = NULL;
+static int lint_mode = LINT_MODE_NORMALIZE;
+
+/* LintMaxMemory: beyond this many bytes, the parsed lines are spilled to
+ * disk.  Like LintMode, this is applied as soon as it is parsed.
+ */
+static size_t lint_max_memory = 0;
+static const char *lint_stream_path = NULL;
+static struct lint_stream *lint_stream = NULL;
+
+/* The generated header includes a timestamp, and thus is excluded when
+ * checking whether the generated config has changed.
+ */
+#define LINT_HEADER_PREFIX		"# AUTO-GENERATED BY "
+
+/* The parsed lines are held in an arena of anonymous mappings, rather than
+ * in lint_pool, so that once we are done with them, their memory is returned
+ * to the OS, instead of bloating the daemon process and every session
+ * process forked from it.
+ */
+static struct lint_arena *parsed_arena = NULL;
+
+static struct lint_capture *parsed_capture = NULL;
+static int lint_vhost_line_pending = FALSE;
+static struct lint_store *parsed_lines = NULL;
+static struct lint_symtab *parsed_symbols = NULL;
 
 static const char *trace_channel = "lint";
 
 static int lint_add_config_set(pool *p, array_header *bl, xaset_t *set,
-  char *indent);
+  unsigned int depth);
+
+static const char *lint_get_tmp_dir(void) {
+  const char *tmp_dir;
+
+  tmp_dir = getenv("TMPDIR");
+  if (tmp_dir == NULL) {
+    tmp_dir = "/tmp";
+  }
+
+  return tmp_dir;
+}
+
+static void lint_set_max_memory(void) {
+  if (parsed_arena == NULL) {
+    return;
+  }
+
+  if (lint_arena_set_spill(parsed_arena, lint_max_memory,
+      lint_max_memory > 0 ? lint_get_tmp_dir() : NULL) < 0) {
+    pr_trace_msg(trace_channel, 3, "error setting LintMaxMemory: %s",
+      strerror(errno));
+  }
+}
 
 static void lint_pool_cleanup(void *user_data) {
+  struct lint_arena_stats stats;
+
+  if (lint_arena_get_stats(parsed_arena, &stats) == 0) {
+    pr_trace_msg(trace_channel, 5,
+      "parsed config peak usage: %lu bytes in memory, %lu bytes spilled "
+      "(LintMaxMemory %lu)", (unsigned long) stats.peak_mapped,
+      (unsigned long) stats.peak_spilled, (unsigned long) lint_max_memory);
+  }
+
+  lint_arena_destroy(parsed_arena);
+  parsed_arena = NULL;
+  parsed_capture = NULL;
   parsed_lines = NULL;
-  associated_configs = NULL;
+  parsed_symbols = NULL;
 }
 
-static module *lint_find_handling_module(const char *directive) {
-  conftable *conftab = NULL;
-  int idx = -1;
-  unsigned int hash = 0;
+/* Allocates the arena, and the structures within it, for this run. */
+static int lint_alloc_parsed(void) {
+  if (parsed_arena != NULL) {
+    return 0;
+  }
+
+  parsed_arena = lint_arena_create(0);
+  if (parsed_arena == NULL) {
+    return -1;
+  }
+
+  lint_set_max_memory();
+
+  parsed_capture = lint_capture_alloc(parsed_arena);
+  parsed_lines = lint_store_alloc(parsed_arena);
+  parsed_symbols = lint_symtab_alloc(parsed_arena);
+
+  if (parsed_capture == NULL ||
+      parsed_lines == NULL ||
+      parsed_symbols == NULL) {
+    int xerrno = errno;
 
-  conftab = pr_stash_get_symbol2(PR_SYM_CONF, directive, NULL, &idx, &hash);
-  if (conftab != NULL) {
-    return conftab->m;
+    lint_arena_destroy(parsed_arena);
+    parsed_arena = NULL;
+    parsed_capture = NULL;
+    parsed_lines = NULL;
+    parsed_symbols = NULL;
+
+    errno = xerrno;
+    return -1;
   }
 
-  pr_trace_msg(trace_channel, 2, "found no module to handle '%s' directive",
-    directive);
-  errno = ENOENT;
-  return NULL;
+  return 0;
 }
 
-/* Note: To iterate through all parsed lines for the same directive, use:
- *
- *   struct lint_parsed_line *parsed_line;
- *
- *   parsed_line = lint_find_parsed_line("Foo", NULL);
- *   while (parsed_line != NULL) {
- *     parsed_line = lint_find_parsed_line(parsed_line->directive,
- *       parsed_line->next);
- *   }
- */
-static struct lint_parsed_line *lint_find_parsed_line(const char *directive,
-    struct lint_parsed_line *next_line) {
-  struct lint_parsed_line *parsed_line;
+static const struct lint_cop *lint_find_config_cop(config_rec *c,
+    struct lint_cop_ctx *ctx) {
+  lint_perf.counts[LINT_PERF_COUNT_LOOKUPS]++;
 
-  if (parsed_lines == NULL) {
-    return NULL;
+  if (parsed_symbols != NULL) {
+    return lint_symtab_get_cop(parsed_symbols, c, ctx);
   }
 
-  if (next_line != NULL) {
-    parsed_line = next_line;
+  return lint_cop_get_config_cop(c, ctx);
+}
+
+/* Returns the text of the first parsed line for the given directive. */
+static const char *lint_find_parsed_text(const char *directive) {
+  int idx;
 
-  } else {
-    parsed_line = (struct lint_parsed_line *) parsed_lines->xas_list;
+  if (parsed_lines == NULL) {
+    return NULL;
   }
 
-  for (; parsed_line != NULL; parsed_line = parsed_line->next) {
-    if (strcmp(parsed_line->directive, directive) == 0) {
-      return parsed_line;
-    }
+  lint_perf.counts[LINT_PERF_COUNT_LOOKUPS]++;
+  idx = lint_store_find_line(parsed_lines, directive);
+  if (idx < 0) {
+    return NULL;
   }
 
-  return NULL;
+  return lint_store_get_text(parsed_lines, idx, NULL);
 }
 
-static int lint_write_header(pool *p, pr_fh_t *fh) {
+static int lint_write_header(pool *p, struct lint_text_writer *w) {
   int res;
   pool *tmp_pool;
   const char *text;
@@ -135,17 +299,17 @@ static int lint_write_header(pool *p, pr_fh_t *fh) {
     const char *time_fmt = "%Y-%m-%d %H:%M:%S %z";
 
     strftime(ts, sizeof(ts)-1, time_fmt, tm);
-    text = pstrcat(tmp_pool, "# AUTO-GENERATED BY ", MOD_LINT_VERSION, " on ",
+    text = pstrcat(tmp_pool, LINT_HEADER_PREFIX, MOD_LINT_VERSION, " on ",
       ts, "\n", NULL);
 
   } else {
-    text = pstrcat(tmp_pool, "# AUTO-GENERATED BY ", MOD_LINT_VERSION, "\n",
+    text = pstrcat(tmp_pool, LINT_HEADER_PREFIX, MOD_LINT_VERSION, "\n",
       NULL);
   }
 
   textsz = strlen(text);
 
-  res = lint_text_write_text(fh, text, textsz);
+  res = lint_text_writer_text(w, text, textsz);
   destroy_pool(tmp_pool);
   return res;
 }
@@ -167,10 +331,259 @@ static int is_static_module(module *m) {
 }
 #endif /* PR_USE_DSO */
 
+/* Adds a line of parsed text, at the given indentation depth. */
+static int lint_add_text(pool *p, array_header *buffered_lines,
+    unsigned int depth, const char *text) {
+  struct lint_buffered_line *bl;
+
+  bl = lint_text_line_create(p);
+  if (bl == NULL) {
+    return -1;
+  }
+
+  (void) lint_text_line_add_indent(bl, depth);
+  (void) lint_text_line_add_str(bl, text);
+  return lint_text_add_line(buffered_lines, bl);
+}
+
+static struct lint_buffered_line *lint_create_directive(pool *p,
+    unsigned int depth, const char *directive) {
+  struct lint_buffered_line *bl;
+
+  bl = lint_text_line_create(p);
+  if (bl == NULL) {
+    return NULL;
+  }
+
+  (void) lint_text_line_add_indent(bl, depth);
+  (void) lint_text_line_add_str(bl, directive);
+  (void) lint_text_line_add_str(bl, " ");
+  return bl;
+}
+
+static int lint_add_directive_str(pool *p, array_header *buffered_lines,
+    const char *directive, const char *value, int quoted) {
+  struct lint_buffered_line *bl;
+
+  bl = lint_create_directive(p, 0, directive);
+  if (bl == NULL) {
+    return -1;
+  }
+
+  if (quoted == TRUE) {
+    (void) lint_text_line_add_quoted(bl, value);
+
+  } else {
+    (void) lint_text_line_add_str(bl, value);
+  }
+
+  return lint_text_add_line(buffered_lines, bl);
+}
+
+static int lint_add_directive_uint(pool *p, array_header *buffered_lines,
+    const char *directive, unsigned long value) {
+  struct lint_buffered_line *bl;
+
+  bl = lint_create_directive(p, 0, directive);
+  if (bl == NULL) {
+    return -1;
+  }
+
+  (void) lint_text_line_add_uint(bl, value);
+  return lint_text_add_line(buffered_lines, bl);
+}
+
+static int lint_add_directive_int(pool *p, array_header *buffered_lines,
+    const char *directive, long value) {
+  struct lint_buffered_line *bl;
+
+  bl = lint_create_directive(p, 0, directive);
+  if (bl == NULL) {
+    return -1;
+  }
+
+  (void) lint_text_line_add_int(bl, value);
+  return lint_text_add_line(buffered_lines, bl);
+}
+
+static int lint_add_directive_bool(pool *p, array_header *buffered_lines,
+    const char *directive, int value) {
+  struct lint_buffered_line *bl;
+
+  bl = lint_create_directive(p, 0, directive);
+  if (bl == NULL) {
+    return -1;
+  }
+
+  (void) lint_text_line_add_bool(bl, value);
+  return lint_text_add_line(buffered_lines, bl);
+}
+
+/* Returns the index of the parsed line which added the given config, if that
+ * is a line for the given directive.  Checking the directive guards against
+ * configs which were not added by a line, e.g. copies of <Global> configs,
+ * reusing the memory of one which was.
+ */
+static int lint_find_config_line(const config_rec *c, const char *directive) {
+  int idx;
+
+  if (parsed_lines == NULL) {
+    return -1;
+  }
+
+  lint_perf.counts[LINT_PERF_COUNT_LOOKUPS]++;
+  idx = lint_store_find_config_line(parsed_lines, c);
+  if (idx < 0 ||
+      strcasecmp(lint_store_get_directive(parsed_lines, idx), directive) != 0) {
+    return -1;
+  }
+
+  return idx;
+}
+
+/* Adds a section, e.g. <Directory>, as one block: its opening line, its
+ * lines and configs, sorted, and its closing line.  The block is then
+ * sorted as a whole, by its opening line, among its siblings.
+ */
+static int lint_add_section(pool *p, array_header *buffered_lines,
+    unsigned int depth, const char *open_text, const char *close_text,
+    array_header *section_lines, xaset_t *set) {
+  struct lint_buffered_line *bl;
+
+  if (set != NULL &&
+      lint_add_config_set(p, section_lines, set, depth + 1) < 0) {
+    return -1;
+  }
+
+  lint_text_sort_buffered_lines(section_lines);
+
+  bl = lint_text_line_create(p);
+  if (bl == NULL) {
+    return -1;
+  }
+
+  (void) lint_text_line_add_indent(bl, depth);
+  (void) lint_text_line_add_str(bl, open_text);
+  (void) lint_text_line_add_str(bl, "\n");
+  (void) lint_text_line_add_lines(bl, section_lines);
+  (void) lint_text_line_add_indent(bl, depth);
+  (void) lint_text_line_add_str(bl, close_text);
+  return lint_text_add_line(buffered_lines, bl);
+}
+
+/* Returns the parsed text opening the given section config, if known. */
+static const char *lint_find_section_text(const config_rec *c,
+    const char *directive) {
+  int idx;
+
+  idx = lint_find_config_line(c, directive);
+  if (idx < 0) {
+    return NULL;
+  }
+
+  return lint_store_get_text(parsed_lines, idx, NULL);
+}
+
+static int lint_add_param(pool *p, array_header *buffered_lines,
+    config_rec *c, unsigned int depth, int *last_idx) {
+  struct lint_cop_ctx cop_ctx;
+  const char *directive, *text;
+  int idx;
+
+  if (lint_find_config_cop(c, &cop_ctx) == NULL) {
+    return 0;
+  }
+
+  directive = lint_cop_get_directive(&cop_ctx, p, c);
+  if (directive == NULL) {
+    return 0;
+  }
+
+  idx = lint_find_config_line(c, directive);
+  if (idx >= 0) {
+    /* Some directives add several configs, e.g. Umask; their line is only
+     * emitted once.
+     */
+    if (idx == *last_idx) {
+      return 0;
+    }
+
+    *last_idx = idx;
+    text = lint_store_get_text(parsed_lines, idx, NULL);
+
+  } else {
+    text = lint_find_parsed_text(directive);
+    if (text == NULL) {
+      pr_trace_msg(trace_channel, 1, "found no matching parsed line for %s",
+        directive);
+      return 0;
+    }
+  }
+
+  /* Some modules' sections, e.g. <IfUser>, are params with subsets. */
+  if (c->subset != NULL &&
+      *directive == '<') {
+    const char *close_text;
+
+    close_text = pstrcat(p, "</", directive + 1,
+      directive[strlen(directive)-1] != '>' ? ">" : "", NULL);
+    return lint_add_section(p, buffered_lines, depth, text, close_text,
+      make_array(p, 10, sizeof(struct lint_buffered_line *)), c->subset);
+  }
+
+  return lint_add_text(p, buffered_lines, depth, text);
+}
+
+static int lint_add_directory(pool *p, array_header *buffered_lines,
+    config_rec *c, unsigned int depth) {
+  const char *text;
+
+  text = lint_find_section_text(c, "<Directory>");
+  if (text == NULL) {
+    text = pstrcat(p, "<Directory ", c->name, ">", NULL);
+  }
+
+  return lint_add_section(p, buffered_lines, depth, text, "</Directory>",
+    make_array(p, 10, sizeof(struct lint_buffered_line *)), c->subset);
+}
+
+static int lint_add_anonymous(pool *p, array_header *buffered_lines,
+    config_rec *c, unsigned int depth) {
+  const char *text;
+
+  text = lint_find_section_text(c, "<Anonymous>");
+  if (text == NULL) {
+    text = pstrcat(p, "<Anonymous ", c->name, ">", NULL);
+  }
+
+  return lint_add_section(p, buffered_lines, depth, text, "</Anonymous>",
+    make_array(p, 10, sizeof(struct lint_buffered_line *)), c->subset);
+}
+
+static int lint_add_limit(pool *p, array_header *buffered_lines,
+    config_rec *c, unsigned int depth) {
+  const char *text;
+
+  text = lint_find_section_text(c, "<Limit>");
+  if (text == NULL) {
+    register unsigned int i;
+
+    /* The config's arguments are the limited commands. */
+    text = "<Limit";
+    for (i = 0; i < c->argc && c->argv[i] != NULL; i++) {
+      text = pstrcat(p, text, " ", (char *) c->argv[i], NULL);
+    }
+
+    text = pstrcat(p, text, ">", NULL);
+  }
+
+  return lint_add_section(p, buffered_lines, depth, text, "</Limit>",
+    make_array(p, 10, sizeof(struct lint_buffered_line *)), c->subset);
+}
+
 static int lint_add_config_rec(pool *p, array_header *buffered_lines,
-    config_rec *c, const char *indent) {
-  int res = 0;
-  struct lint_parsed_line *parsed_line;
+    config_rec *c, unsigned int depth, int *last_idx) {
+  lint_perf.counts[LINT_PERF_COUNT_CONFIG_RECS]++;
 
   /* Skip directives that start with an underscore. */
   if (c->name != NULL &&
@@ -178,93 +591,58 @@ static int lint_add_config_rec(pool *p, array_header *buffered_lines,
     return 0;
   }
 
-  /* XXX TODO: watch for c->config_type: CONF_DIR, CONF_ANON, CONF_VIRTUAL,
-   *  etc.
-   *
-   * Start with CONF_PARAM.
-   */
-
-  /* To look up the cop for this config, we need the module.  Chicken, egg.
-   * config_rec->server?  The related parsed_line has the module -- but
-   * we need to know what directive to search for, to find that parsed_line.
+  /* Configs merged down into sections, from their enclosing sections, are
+   * recreated when the emitted config is parsed.
    */
+  if (c->flags & CF_MERGED) {
+    return 0;
+  }
 
   switch (c->config_type) {
-    /* TODO: Break these out into their own separate, specialized write
-     * functions.
-     */
-    case CONF_PARAM: {
-      const struct lint_cop *cop;
-      const char *directive;
-
-      cop = lint_cop_get_config_cop(c);
+    case CONF_PARAM:
+      return lint_add_param(p, buffered_lines, c, depth, last_idx);
 
-      directive = lint_cop_get_directive(cop, p, c);
-      if (directive == NULL) {
-        return 0;
-      }
+    case CONF_DIR:
+      return lint_add_directory(p, buffered_lines, c, depth);
 
-      parsed_line = lint_find_parsed_line(directive, NULL);
-      if (parsed_line != NULL) {
-        res = lint_text_add_fmt(p, buffered_lines, "%s%s\n", indent,
-          parsed_line->text);
+    case CONF_ANON:
+      return lint_add_anonymous(p, buffered_lines, c, depth);
 
-      } else {
-        pr_trace_msg(trace_channel, 1, "found no matching parsed line for %s",
-          directive);
-      }
-      break;
-    }
+    case CONF_LIMIT:
+      return lint_add_limit(p, buffered_lines, c, depth);
 
     case CONF_ROOT:
-    case CONF_DIR:
-    case CONF_ANON:
-    case CONF_LIMIT:
     case CONF_VIRTUAL:
-    case CONF_GLOBAL: /* We don't expect to see this */
+    case CONF_GLOBAL:
     case CONF_CLASS:
     default:
-      pr_trace_msg(trace_channel, 7, "config type %d not implemented yet",
+      /* <VirtualHost> sections are servers, not configs; <Class> sections
+       * are written from the classes; and <Global> sections are copied
+       * into every server by the time we see them.
+       */
+      pr_trace_msg(trace_channel, 7, "ignoring unexpected config type %d",
         c->config_type);
       return 0;
   }
-
-  return res;
 }
 
 static int lint_add_config_set(pool *p, array_header *buffered_lines,
-    xaset_t *set, char *indent) {
-  int res;
+    xaset_t *set, unsigned int depth) {
+  int res, last_idx = -1;
   config_rec *c;
 
-  if (set->xas_list == NULL) {
+  if (set == NULL ||
+      set->xas_list == NULL) {
     return 0;
   }
 
-  if (indent == NULL) {
-    indent = "";
-  }
-
   for (c = (config_rec *) set->xas_list; c; c = c->next) {
     pr_signals_handle();
 
-    res = lint_add_config_rec(p, buffered_lines, c, indent);
+    res = lint_add_config_rec(p, buffered_lines, c, depth, &last_idx);
     if (res < 0) {
       return -1;
     }
-
-    if (c->subset != NULL) {
-      pool *iter_pool;
-
-      iter_pool = make_sub_pool(p);
-      res = lint_add_config_set(p, buffered_lines, c->subset,
-        pstrcat(iter_pool, indent, "  ", NULL));
-      destroy_pool(iter_pool);
-
-      if (res < 0) {
-        return -1;
-      }
-    }
   }
 
   return 0;
@@ -279,7 +657,7 @@ static int lint_add_server_rec(pool *p, array_header *buffered_lines,
     return 0;
   }
 
-  res = lint_add_config_set(p, buffered_lines, s->conf, NULL);
+  res = lint_add_config_set(p, buffered_lines, s->conf, 0);
   if (res < 0) {
     return -1;
   }
@@ -287,25 +665,52 @@ static int lint_add_server_rec(pool *p, array_header *buffered_lines,
   return 0;
 }
 
-static int lint_write_defines(pool *p, pr_fh_t *fh) {
-  /* XXX TODO: Scan the parsed lines for ALL Define lines! */
-  /* XXX TODO: write lint_find_all_parsed_lines(p, directive), returns
-   *  array_header of all results.
+static int lint_write_defines(pool *p, struct lint_text_writer *w) {
+  int idx, res;
+
+  if (parsed_lines == NULL) {
+    return 0;
+  }
+
+  lint_perf.counts[LINT_PERF_COUNT_LOOKUPS]++;
+  idx = lint_store_find_line(parsed_lines, "Define");
+  if (idx < 0) {
+    return 0;
+  }
+
+  res = lint_text_writer_fmt(w, "%s", "\n# Defines\n\n");
+  if (res < 0) {
+    return -1;
+  }
+
+  /* Unlike other directives, Defines are emitted in order of appearance,
+   * since later Defines may rely on earlier ones.
    */
+  while (idx >= 0) {
+    res = lint_text_writer_fmt(w, "%s\n",
+      lint_store_get_text(parsed_lines, idx, NULL));
+    if (res < 0) {
+      return -1;
+    }
+
+    idx = lint_store_next_line(parsed_lines, idx);
+  }
+
   return 0;
 }
 
-static int lint_write_modules(pool *p, pr_fh_t *fh) {
+static int lint_write_modules(pool *p, struct lint_text_writer *w) {
 #if defined(PR_USE_DSO)
   int res, have_shared_modules = FALSE;
   module *m;
   pool *ctx_pool;
   array_header *buffered_lines = NULL;
-  struct lint_parsed_line *parsed_line;
+  struct lint_buffered_line *bl;
+  const char *text;
 
-  parsed_line = lint_find_parsed_line("ModulePath", NULL);
-  if (parsed_line != NULL) {
-    res = lint_text_write_fmt(fh, "\n# Modules\n\n%s\n", parsed_line->text);
+  text = lint_find_parsed_text("ModulePath");
+  if (text != NULL) {
+    res = lint_text_writer_fmt(w, "\n# Modules\n\n%s\n", text);
     if (res < 0) {
       return -1;
     }
@@ -324,8 +729,13 @@ static int lint_write_modules(pool *p, pr_fh_t *fh) {
       continue;
     }
 
-    res = lint_text_add_fmt(ctx_pool, buffered_lines,
-      "  LoadModule mod_%s.c\n", m->name);
+    bl = lint_text_line_create(ctx_pool);
+    (void) lint_text_line_add_indent(bl, 1);
+    (void) lint_text_line_add_str(bl, "LoadModule mod_");
+    (void) lint_text_line_add_str(bl, m->name);
+    (void) lint_text_line_add_str(bl, ".c");
+
+    res = lint_text_add_line(buffered_lines, bl);
     if (res < 0) {
       return -1;
     }
@@ -334,19 +744,19 @@ static int lint_write_modules(pool *p, pr_fh_t *fh) {
   }
 
   if (have_shared_modules == TRUE) {
-    res = lint_text_write_fmt(fh, "\n%s<IfModule mod_dso.c>\n",
-      parsed_line == NULL ? "# Modules\n\n" : "");
+    res = lint_text_writer_fmt(w, "\n%s<IfModule mod_dso.c>\n",
+      text == NULL ? "# Modules\n\n" : "");
     if (res < 0) {
       return -1;
     }
 
-    res = lint_text_write_buffered_lines(fh, buffered_lines);
+    res = lint_text_writer_buffered_lines(w, buffered_lines);
     if (res < 0) {
       destroy_pool(ctx_pool);
       return -1;
     }
 
-    res = lint_text_write_fmt(fh, "%s", "<IfModule>\n");
+    res = lint_text_writer_fmt(w, "%s", "<IfModule>\n");
     if (res < 0) {
       return -1;
     }
@@ -358,13 +768,13 @@ static int lint_write_modules(pool *p, pr_fh_t *fh) {
   return 0;
 }
 
-static int lint_write_server_config(pool *p, pr_fh_t *fh) {
+static int lint_write_server_config(pool *p, struct lint_text_writer *w) {
   int res;
   pool *ctx_pool;
-  struct lint_parsed_line *parsed_line;
+  const char *text;
   array_header *buffered_lines;
 
-  res = lint_text_write_fmt(fh, "%s", "\n# Server Config\n\n");
+  res = lint_text_writer_fmt(w, "%s", "\n# Server Config\n\n");
   if (res < 0) {
     return -1;
   }
@@ -377,18 +787,17 @@ static int lint_write_server_config(pool *p, pr_fh_t *fh) {
   buffered_lines = make_array(ctx_pool, 10,
     sizeof(struct lint_buffered_line *));
 
-  res = lint_text_add_fmt(ctx_pool, buffered_lines, "DefaultAddress %s\n",
-    main_server->ServerAddress);
+  res = lint_add_directive_str(ctx_pool, buffered_lines, "DefaultAddress",
+    main_server->ServerAddress, FALSE);
   if (res < 0) {
     destroy_pool(ctx_pool);
     return -1;
   }
 
   /* MaxConnectionRate changes variables that are scoped to mod_core only. */
-  parsed_line = lint_find_parsed_line("MaxConnectionRate", NULL);
-  if (parsed_line != NULL) {
-    res = lint_text_add_fmt(ctx_pool, buffered_lines, "%s\n",
-      parsed_line->text);
+  text = lint_find_parsed_text("MaxConnectionRate");
+  if (text != NULL) {
+    res = lint_add_text(ctx_pool, buffered_lines, 0, text);
     if (res < 0) {
       destroy_pool(ctx_pool);
       return -1;
@@ -396,7 +805,7 @@ static int lint_write_server_config(pool *p, pr_fh_t *fh) {
   }
 
   if (ServerMaxInstances > 0) {
-    res = lint_text_add_fmt(ctx_pool, buffered_lines, "MaxInstances %lu\n",
+    res = lint_add_directive_uint(ctx_pool, buffered_lines, "MaxInstances",
       ServerMaxInstances);
     if (res < 0) {
       destroy_pool(ctx_pool);
@@ -404,37 +813,37 @@ static int lint_write_server_config(pool *p, pr_fh_t *fh) {
     }
   }
 
-  res = lint_text_add_fmt(ctx_pool, buffered_lines, "PidFile %s\n",
-    pr_pidfile_get());
+  res = lint_add_directive_str(ctx_pool, buffered_lines, "PidFile",
+    pr_pidfile_get(), FALSE);
   if (res < 0) {
     destroy_pool(ctx_pool);
     return -1;
   }
 
-  res = lint_text_add_fmt(ctx_pool, buffered_lines, "Port %u\n",
+  res = lint_add_directive_uint(ctx_pool, buffered_lines, "Port",
     main_server->ServerPort);
   if (res < 0) {
     destroy_pool(ctx_pool);
     return -1;
   }
 
-  res = lint_text_add_fmt(ctx_pool, buffered_lines, "ScoreboardFile %s\n",
-    pr_get_scoreboard());
+  res = lint_add_directive_str(ctx_pool, buffered_lines, "ScoreboardFile",
+    pr_get_scoreboard(), FALSE);
   if (res < 0) {
     destroy_pool(ctx_pool);
     return -1;
   }
 
-  res = lint_text_add_fmt(ctx_pool, buffered_lines, "ScoreboardMutex %s\n",
-    pr_get_scoreboard_mutex());
+  res = lint_add_directive_str(ctx_pool, buffered_lines, "ScoreboardMutex",
+    pr_get_scoreboard_mutex(), FALSE);
   if (res < 0) {
     destroy_pool(ctx_pool);
     return -1;
   }
 
   if (main_server->ServerAdmin != NULL) {
-    res = lint_text_add_fmt(ctx_pool, buffered_lines, "ServerAdmin \"%s\"\n",
-      main_server->ServerAdmin);
+    res = lint_add_directive_str(ctx_pool, buffered_lines, "ServerAdmin",
+      main_server->ServerAdmin, TRUE);
     if (res < 0) {
       destroy_pool(ctx_pool);
       return -1;
@@ -442,84 +851,80 @@ static int lint_write_server_config(pool *p, pr_fh_t *fh) {
   }
 
   if (main_server->ServerName != NULL) {
-    res = lint_text_add_fmt(ctx_pool, buffered_lines, "ServerName \"%s\"\n",
-      main_server->ServerName);
+    res = lint_add_directive_str(ctx_pool, buffered_lines, "ServerName",
+      main_server->ServerName, TRUE);
     if (res < 0) {
       destroy_pool(ctx_pool);
       return -1;
     }
   }
 
-  res = lint_text_add_fmt(ctx_pool, buffered_lines, "ServerType %s\n",
-    ServerType == SERVER_STANDALONE ? "standalone" : "inetd");
+  res = lint_add_directive_str(ctx_pool, buffered_lines, "ServerType",
+    ServerType == SERVER_STANDALONE ? "standalone" : "inetd", FALSE);
   if (res < 0) {
     destroy_pool(ctx_pool);
     return -1;
   }
 
-  res = lint_text_add_fmt(ctx_pool, buffered_lines, "SocketBindTight %s\n",
-    SocketBindTight ? "on" : "off");
+  res = lint_add_directive_bool(ctx_pool, buffered_lines, "SocketBindTight",
+    SocketBindTight);
   if (res < 0) {
     destroy_pool(ctx_pool);
     return -1;
   }
 
-  parsed_line = lint_find_parsed_line("SocketOptions", NULL);
-  if (parsed_line != NULL) {
-    res = lint_text_add_fmt(ctx_pool, buffered_lines, "%s\n",
-      parsed_line->text);
+  text = lint_find_parsed_text("SocketOptions");
+  if (text != NULL) {
+    res = lint_add_text(ctx_pool, buffered_lines, 0, text);
     if (res < 0) {
       destroy_pool(ctx_pool);
       return -1;
     }
   }
 
-  res = lint_text_add_fmt(ctx_pool, buffered_lines, "TCPBacklog %d\n",
+  res = lint_add_directive_int(ctx_pool, buffered_lines, "TCPBacklog",
     tcpBackLog);
   if (res < 0) {
     destroy_pool(ctx_pool);
     return -1;
   }
 
-  parsed_line = lint_find_parsed_line("TraceLog", NULL);
-  if (parsed_line != NULL) {
-    res = lint_text_add_fmt(ctx_pool, buffered_lines, "%s\n",
-      parsed_line->text);
+  text = lint_find_parsed_text("TraceLog");
+  if (text != NULL) {
+    res = lint_add_text(ctx_pool, buffered_lines, 0, text);
     if (res < 0) {
       destroy_pool(ctx_pool);
       return -1;
     }
   }
 
-  parsed_line = lint_find_parsed_line("Trace", NULL);
-  if (parsed_line != NULL) {
-    res = lint_text_add_fmt(ctx_pool, buffered_lines, "%s\n",
-      parsed_line->text);
+  text = lint_find_parsed_text("Trace");
+  if (text != NULL) {
+    res = lint_add_text(ctx_pool, buffered_lines, 0, text);
     if (res < 0) {
       destroy_pool(ctx_pool);
       return -1;
     }
   }
 
-  parsed_line = lint_find_parsed_line("TraceOptions", NULL);
-  if (parsed_line != NULL) {
-    res = lint_text_add_fmt(ctx_pool, buffered_lines, "%s\n",
-      parsed_line->text);
+  text = lint_find_parsed_text("TraceOptions");
+  if (text != NULL) {
+    res = lint_add_text(ctx_pool, buffered_lines, 0, text);
     if (res < 0) {
       destroy_pool(ctx_pool);
       return -1;
     }
   }
 
-  res = lint_text_add_fmt(ctx_pool, buffered_lines, "UseIPv6 %s\n",
-    pr_netaddr_use_ipv6() ? "on" : "off");
+  res = lint_add_directive_bool(ctx_pool, buffered_lines, "UseIPv6",
+    pr_netaddr_use_ipv6());
   if (res < 0) {
     destroy_pool(ctx_pool);
     return -1;
   }
 
-  res = lint_text_add_fmt(ctx_pool, buffered_lines, "UseReverseDNS %s\n",
-    ServerUseReverseDNS ? "on" : "off");
+  res = lint_add_directive_bool(ctx_pool, buffered_lines, "UseReverseDNS",
+    ServerUseReverseDNS);
   if (res < 0) {
     destroy_pool(ctx_pool);
     return -1;
@@ -531,7 +936,7 @@ static int lint_write_server_config(pool *p, pr_fh_t *fh) {
     return -1;
   }
 
-  res = lint_text_write_buffered_lines(fh, buffered_lines);
+  res = lint_text_writer_buffered_lines(w, buffered_lines);
   if (res < 0) {
     destroy_pool(ctx_pool);
     return -1;
@@ -541,76 +946,178 @@ static int lint_write_server_config(pool *p, pr_fh_t *fh) {
   return 0;
 }
 
-static int lint_write_classes(pool *p, pr_fh_t *fh) {
-  int res;
-  const pr_class_t *cls;
+/* The parsed From lines of a <Class> section. */
+struct lint_class_lines {
+  const char *name;
+  array_header *from_texts;
+};
 
-  res = lint_text_write_fmt(fh, "%s", "\n# Classes\n");
-  if (res < 0) {
-    return -1;
-  }
+/* Collects the From lines of each parsed <Class> section: those between its
+ * opening line, and the next </Class> line.
+ */
+static array_header *lint_find_class_lines(pool *p) {
+  int idx, close_idx, from_idx;
+  array_header *classes;
 
-  cls = pr_class_get(NULL);
-  if (cls == NULL) {
-    return 0;
+  classes = make_array(p, 4, sizeof(struct lint_class_lines));
+  if (parsed_lines == NULL) {
+    return classes;
   }
 
-  while (cls != NULL) {
-    register unsigned int i;
-    const pr_netacl_t **acls;
+  lint_perf.counts[LINT_PERF_COUNT_LOOKUPS] += 3;
+  idx = lint_store_find_line(parsed_lines, "<Class>");
+  close_idx = lint_store_find_line(parsed_lines, "</Class>");
+  from_idx = lint_store_find_line(parsed_lines, "From");
 
-    pr_signals_handle();
+  for (; idx >= 0; idx = lint_store_next_line(parsed_lines, idx)) {
+    struct lint_class_lines *cl;
+    const char *text, *ptr;
 
-    res = lint_text_write_fmt(fh, "\n<Class %s>\n", cls->cls_name);
-    if (res < 0) {
-      return -1;
+    while (close_idx >= 0 &&
+           close_idx < idx) {
+      close_idx = lint_store_next_line(parsed_lines, close_idx);
     }
 
-    /* Note: it is tempting to try to use pr_netacl_get_str(), but that
-     * only returns a description, not the actual raw text needed to
-     * re-create the given ACL.  And, worse, the definition for
-     * struct pr_netacl_t is scoped to netacl.c, making it private.  Thus
-     * this will require some core changes, a new NetACL API,
-     * e.g. pr_netacl_to_text().
-     *
-     * Since there will be multiple From directives, using
-     * lint_find_parsed_line() might not work well...could make it work!
-     */
+    /* The class name follows "<Class", up to the closing '>'. */
+    text = lint_store_get_text(parsed_lines, idx, NULL) + 6;
+    for (; *text && PR_ISSPACE(*text); text++) {
+    }
 
-    acls = cls->cls_acls->elts;
-    for (i = 0; i < cls->cls_acls->nelts; i++) {
-      /* XXX TODO: Fix to use to_text() function once available. */
-      res = lint_text_write_fmt(fh, "  # From %s\n",
-        pr_netacl_get_str(p, acls[i]));
-      if (res < 0) {
-        return -1;
-      }
+    for (ptr = text; *ptr && *ptr != '>' && !PR_ISSPACE(*ptr); ptr++) {
     }
 
-    res = lint_text_write_fmt(fh, "  Satisfy %s\n",
-      cls->cls_satisfy == PR_CLASS_SATISFY_ANY ? "any" : "all");
-    if (res < 0) {
-      return -1;
+    cl = push_array(classes);
+    cl->name = pstrndup(p, text, ptr - text);
+    cl->from_texts = make_array(p, 4, sizeof(const char *));
+
+    for (; from_idx >= 0 && (close_idx < 0 || from_idx < close_idx);
+         from_idx = lint_store_next_line(parsed_lines, from_idx)) {
+      if (from_idx > idx) {
+        *((const char **) push_array(cl->from_texts)) =
+          lint_store_get_text(parsed_lines, from_idx, NULL);
+      }
     }
+  }
 
-    res = lint_text_write_fmt(fh, "%s", "</Class>\n");
-    if (res < 0) {
+  return classes;
+}
+
+static int lint_add_class(pool *p, array_header *buffered_lines,
+    const pr_class_t *cls, array_header *classes) {
+  register unsigned int i;
+  array_header *section_lines, *from_texts = NULL;
+  struct lint_class_lines *cl;
+  struct lint_buffered_line *bl;
+
+  section_lines = make_array(p, 10, sizeof(struct lint_buffered_line *));
+
+  cl = classes->elts;
+  for (i = 0; i < classes->nelts; i++) {
+    if (strcmp(cl[i].name, cls->cls_name) == 0) {
+      from_texts = cl[i].from_texts;
+      break;
+    }
+  }
+
+  /* Without the parsed From lines, the class cannot be written: the
+   * struct pr_netacl_t definition is private to netacl.c, and
+   * pr_netacl_get_str() provides a description, not the text needed to
+   * re-create the ACL.  Rather than write a class matching nothing, we fail.
+   */
+  if ((from_texts == NULL ||
+       from_texts->nelts == 0) &&
+      cls->cls_acls != NULL &&
+      cls->cls_acls->nelts > 0) {
+    pr_log_pri(PR_LOG_WARNING, MOD_LINT_VERSION
+      ": found no parsed From lines for <Class %s>, not writing config",
+      cls->cls_name);
+    errno = ENOENT;
+    return -1;
+  }
+
+  if (from_texts != NULL) {
+    const char **texts;
+
+    texts = from_texts->elts;
+    for (i = 0; i < from_texts->nelts; i++) {
+      if (lint_add_text(p, section_lines, 1, texts[i]) < 0) {
+        return -1;
+      }
+    }
+  }
+
+  bl = lint_create_directive(p, 1, "Satisfy");
+  if (bl == NULL) {
+    return -1;
+  }
+
+  (void) lint_text_line_add_str(bl,
+    cls->cls_satisfy == PR_CLASS_SATISFY_ANY ? "any" : "all");
+  if (lint_text_add_line(section_lines, bl) < 0) {
+    return -1;
+  }
+
+  return lint_add_section(p, buffered_lines, 0,
+    pstrcat(p, "<Class ", cls->cls_name, ">", NULL), "</Class>",
+    section_lines, NULL);
+}
+
+static int lint_write_classes(pool *p, struct lint_text_writer *w) {
+  register unsigned int i;
+  int res;
+  pool *ctx_pool;
+  const pr_class_t *cls;
+  array_header *buffered_lines, *classes;
+
+  res = lint_text_writer_fmt(w, "%s", "\n# Classes\n");
+  if (res < 0) {
+    return -1;
+  }
+
+  cls = pr_class_get(NULL);
+  if (cls == NULL) {
+    return 0;
+  }
+
+  ctx_pool = make_sub_pool(p);
+  pr_pool_tag(ctx_pool, "Lint <Class> context pool");
+
+  classes = lint_find_class_lines(ctx_pool);
+  buffered_lines = make_array(ctx_pool, 10,
+    sizeof(struct lint_buffered_line *));
+
+  while (cls != NULL) {
+    pr_signals_handle();
+
+    if (lint_add_class(ctx_pool, buffered_lines, cls, classes) < 0) {
+      destroy_pool(ctx_pool);
       return -1;
     }
 
     cls = pr_class_get(cls);
   }
 
+  /* Classes are matched in order, and so are not sorted. */
+  for (i = 0; i < buffered_lines->nelts; i++) {
+    if (lint_text_writer_text(w, "\n", 1) < 0 ||
+        lint_text_writer_line(w,
+          ((struct lint_buffered_line **) buffered_lines->elts)[i]) < 0) {
+      destroy_pool(ctx_pool);
+      return -1;
+    }
+  }
+
+  destroy_pool(ctx_pool);
   return 0;
 }
 
-static int lint_write_ctrls(pool *p, pr_fh_t *fh) {
+static int lint_write_ctrls(pool *p, struct lint_text_writer *w) {
 #if defined(PR_USE_CTRLS)
   int res;
 
   /* ControlsLog, Socket, etc. */
 
-  res = lint_text_write_fmt(fh, "%s", "\n# Controls\n\n");
+  res = lint_text_writer_fmt(w, "%s", "\n# Controls\n\n");
   if (res < 0) {
     return -1;
   }
@@ -619,135 +1126,1844 @@ static int lint_write_ctrls(pool *p, pr_fh_t *fh) {
   return 0;
 }
 
-static int lint_write_vhosts(pool *p, pr_fh_t *fh) {
-  int res;
-  pool *ctx_pool;
+/* Returns the milliseconds elapsed since the emitting started. */
+static uint64_t lint_timer_elapsed(void) {
+  uint64_t now_ns;
+
+  now_ns = lint_perf_now();
+  if (now_ns <= lint_timer.start_ns) {
+    return 0;
+  }
+
+  return (now_ns - lint_timer.start_ns) / 1000000;
+}
+
+static int lint_budget_exceeded(void) {
+  if (lint_time_budget == 0) {
+    return FALSE;
+  }
+
+  if (lint_timer.exceeded == FALSE &&
+      lint_timer_elapsed() > lint_time_budget) {
+    lint_timer.exceeded = TRUE;
+  }
+
+  return lint_timer.exceeded;
+}
+
+/* Records the first vhost which was omitted, due to the time budget. */
+static void lint_budget_omit_vhost(unsigned int idx, unsigned int nvhosts) {
+  if (lint_timer.nvhosts == 0) {
+    lint_timer.vhost_idx = idx;
+    lint_timer.nvhosts = nvhosts;
+  }
+}
+
+/* A <VirtualHost> to be written, with the parsed text which opened it. */
+struct lint_vhost {
   server_rec *s;
-  array_header *buffered_lines;
+  const char *text;
 
-  res = lint_text_write_fmt(fh, "%s", "\n# VirtualHosts\n");
-  if (res < 0) {
+  /* The hash of the vhost's parsed lines, and of the lines it shares with
+   * the other servers, keying its block in the vhost cache.
+   */
+  uint64_t key;
+
+  /* The rendered section, without its trailing newline, once known from
+   * the vhost cache, or once rendered.
+   */
+  const char *block;
+};
+
+static void lint_set_vhost_block(pool *p, struct lint_vhost *vhost,
+    const char *text) {
+  size_t textsz;
+
+  textsz = strlen(text);
+  if (textsz > 0 &&
+      text[textsz-1] == '\n') {
+    textsz--;
+  }
+
+  vhost->block = pstrndup(p, text, textsz);
+}
+
+/* Adds the <VirtualHost> section for the given vhost, preceded by a blank
+ * line.  Each section is one line, so that a run of vhosts has one record
+ * per vhost.
+ */
+static int lint_add_vhost(pool *p, array_header *buffered_lines,
+    const struct lint_vhost *vhost) {
+  server_rec *s;
+  array_header *section_lines;
+  struct lint_buffered_line *bl;
+  const char *text;
+
+  if (vhost->block != NULL) {
+    bl = lint_text_line_create(p);
+    if (bl == NULL) {
+      return -1;
+    }
+
+    (void) lint_text_line_add_str(bl, vhost->block);
+    return lint_text_add_line(buffered_lines, bl);
+  }
+
+  s = vhost->s;
+  section_lines = make_array(p, 10, sizeof(struct lint_buffered_line *));
+
+  /* These directives set fields of the server, rather than adding configs. */
+  if (s->ServerName != NULL) {
+    bl = lint_create_directive(p, 1, "ServerName");
+    if (bl == NULL) {
+      return -1;
+    }
+
+    (void) lint_text_line_add_quoted(bl, s->ServerName);
+    if (lint_text_add_line(section_lines, bl) < 0) {
+      return -1;
+    }
+  }
+
+  if (s->ServerAdmin != NULL) {
+    bl = lint_create_directive(p, 1, "ServerAdmin");
+    if (bl == NULL) {
+      return -1;
+    }
+
+    (void) lint_text_line_add_quoted(bl, s->ServerAdmin);
+    if (lint_text_add_line(section_lines, bl) < 0) {
+      return -1;
+    }
+  }
+
+  bl = lint_create_directive(p, 1, "Port");
+  if (bl == NULL) {
+    return -1;
+  }
+
+  (void) lint_text_line_add_uint(bl, s->ServerPort);
+  if (lint_text_add_line(section_lines, bl) < 0) {
     return -1;
   }
 
+  text = vhost->text;
+  if (text == NULL) {
+    text = pstrcat(p, "<VirtualHost ",
+      s->ServerAddress != NULL ? s->ServerAddress : "", ">", NULL);
+  }
+
+  text = pstrcat(p, "\n", text, NULL);
+
+  return lint_add_section(p, buffered_lines, 0, text, "</VirtualHost>",
+    section_lines, s->conf);
+}
+
+static int lint_add_vhosts(pool *p, array_header *buffered_lines,
+    array_header *vhosts, unsigned int start, unsigned int end) {
+  register unsigned int i;
+
+  for (i = start; i < end; i++) {
+    const struct lint_vhost *vhost;
+
+    pr_signals_handle();
+
+    if (lint_budget_exceeded() == TRUE) {
+      lint_budget_omit_vhost(i, vhosts->nelts);
+      errno = ETIMEDOUT;
+      return -1;
+    }
+
+    vhost = &(((struct lint_vhost *) vhosts->elts)[i]);
+    if (lint_add_vhost(p, buffered_lines, vhost) < 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/* Renders the given range of vhosts as a run, to the given path.
+ * If the time budget is exceeded, the vhosts rendered thus far are still
+ * written as a complete run, and -1 is returned, with errno set to
+ * ETIMEDOUT.
+ */
+static int lint_render_vhosts(pool *p, array_header *vhosts,
+    unsigned int start, unsigned int end, const char *path) {
+  int res, xerrno;
+  pool *ctx_pool;
+  array_header *buffered_lines;
+
   ctx_pool = make_sub_pool(p);
-  pr_pool_tag(ctx_pool, "Lint <VirtualHost> context pool");
+  pr_pool_tag(ctx_pool, "Lint <VirtualHost> worker pool");
   buffered_lines = make_array(ctx_pool, 10,
     sizeof(struct lint_buffered_line *));
 
-  for (s = (server_rec *) server_list->xas_list; s; s = s->next) {
-    pr_signals_handle();
+  res = lint_add_vhosts(ctx_pool, buffered_lines, vhosts, start, end);
+  xerrno = errno;
 
-    if (s == main_server) {
-      /* We wrote out the main_server config earlier. */
+  if (res == 0 ||
+      xerrno == ETIMEDOUT) {
+    if (lint_run_write(ctx_pool, path, buffered_lines) < 0) {
+      xerrno = errno;
+      res = -1;
+    }
+  }
+
+  destroy_pool(ctx_pool);
+
+  errno = xerrno;
+  return res;
+}
+
+/* The exit statuses of a vhost worker. */
+#define LINT_WORKER_EXIT_OK		0
+#define LINT_WORKER_EXIT_FAILED		1
+#define LINT_WORKER_EXIT_TIMEDOUT	2
+
+/* Partitions the vhosts into contiguous ranges, across forked worker
+ * processes, each of which renders its vhosts into a run; the runs are then
+ * written in partition order, producing the same output as rendering all
+ * vhosts in this process.  Any partition whose worker fails is rendered
+ * here instead.
+ *
+ * A worker exceeding the time budget still writes a complete run of the
+ * vhosts it rendered; since its exit status may be unknown, having been
+ * reaped elsewhere, a run shorter than its partition is taken as timed out.
+ * As when rendering in this process, the vhosts before the first one
+ * omitted are written, and the later partitions are not; ETIMEDOUT is then
+ * reported, once the runs are written.
+ */
+static int lint_write_vhosts_parallel(pool *p, struct lint_text_writer *w,
+    array_header *vhosts, unsigned int nworkers) {
+  register unsigned int i;
+  int res, timedout = FALSE, xerrno;
+  pid_t *pids;
+  unsigned int *starts;
+  array_header *paths, *run_paths;
+  const char *tmp_dir;
+
+  tmp_dir = lint_get_tmp_dir();
+  pids = pcalloc(p, sizeof(pid_t) * nworkers);
+  starts = pcalloc(p, sizeof(unsigned int) * (nworkers + 1));
+  paths = make_array(p, nworkers, sizeof(char *));
+  run_paths = make_array(p, nworkers, sizeof(char *));
+
+  for (i = 0; i <= nworkers; i++) {
+    starts[i] = (unsigned int) (((unsigned long) vhosts->nelts * i) / nworkers);
+  }
+
+  for (i = 0; i < nworkers; i++) {
+    char *path;
+    int fd;
+
+    path = pstrcat(p, tmp_dir, "/mod_lint.XXXXXX", NULL);
+    fd = mkstemp(path);
+    if (fd < 0) {
+      xerrno = errno;
+
+      pr_trace_msg(trace_channel, 1, "error creating temporary file: %s",
+        strerror(xerrno));
+      res = -1;
+      goto done;
+    }
+
+    (void) close(fd);
+    *((char **) push_array(paths)) = path;
+  }
+
+  for (i = 0; i < nworkers; i++) {
+    pids[i] = fork();
+
+    if (pids[i] == 0) {
+      /* We are the worker process now.  Note that we use _exit(2), to avoid
+       * running any of the master process' exit handlers.
+       */
+      (void) lint_arena_detach(parsed_arena);
+      res = lint_render_vhosts(p, vhosts, starts[i], starts[i+1],
+        ((char **) paths->elts)[i]);
+      if (res < 0) {
+        _exit(errno == ETIMEDOUT ? LINT_WORKER_EXIT_TIMEDOUT :
+          LINT_WORKER_EXIT_FAILED);
+      }
+
+      _exit(LINT_WORKER_EXIT_OK);
+    }
+
+    if (pids[i] < 0) {
+      pr_trace_msg(trace_channel, 3, "error forking worker %u: %s", i + 1,
+        strerror(errno));
+    }
+  }
+
+  for (i = 0; i < nworkers; i++) {
+    int ok = FALSE, reaped = FALSE, status = 0;
+    unsigned int nrendered = 0;
+    const char *path;
+
+    path = ((char **) paths->elts)[i];
+
+    if (pids[i] > 0) {
+      /* We deliberately do not handle signals here; the master process'
+       * SIGCHLD handling might reap our workers before we can, in which case
+       * their exit status is unknown, and we rely on verifying their runs.
+       */
+      while (TRUE) {
+        if (waitpid(pids[i], &status, 0) == pids[i]) {
+          reaped = TRUE;
+          break;
+        }
+
+        if (errno != EINTR) {
+          break;
+        }
+      }
+
+      /* A worker which exited normally, or whose status is unknown, may
+       * have left a complete run, of all or some of its vhosts.
+       */
+      if (reaped == FALSE ||
+          (WIFEXITED(status) &&
+           (WEXITSTATUS(status) == LINT_WORKER_EXIT_OK ||
+            WEXITSTATUS(status) == LINT_WORKER_EXIT_TIMEDOUT))) {
+        if (lint_run_verify(p, path, &nrendered) == 0) {
+          ok = TRUE;
+        }
+      }
+    }
+
+    if (timedout == TRUE) {
+      /* A previous partition was cut short; the later ones are omitted. */
       continue;
     }
 
-    res = lint_add_server_rec(ctx_pool, buffered_lines, s);
-    if (res < 0) {
-      destroy_pool(ctx_pool);
-      return -1;
+    if (ok == TRUE) {
+      /* Each vhost is one record of the run; whatever the exit status, a
+       * short run means that the worker exceeded the time budget.
+       */
+      if (nrendered < starts[i+1] - starts[i]) {
+        pr_trace_msg(trace_channel, 3,
+          "worker %u exceeded the time budget after %u of its vhosts (%u-%u)",
+          i + 1, nrendered, starts[i] + 1, starts[i+1]);
+        lint_timer.exceeded = TRUE;
+        lint_budget_omit_vhost(starts[i] + nrendered, vhosts->nelts);
+        timedout = TRUE;
+      }
+
+      *((char **) push_array(run_paths)) = (char *) path;
+      continue;
     }
+
+    if (lint_budget_exceeded() == TRUE) {
+      /* No time left to render these vhosts here; they are omitted. */
+      pr_trace_msg(trace_channel, 3,
+        "worker %u failed, omitting its vhosts (%u-%u): time budget exceeded",
+        i + 1, starts[i] + 1, starts[i+1]);
+      lint_budget_omit_vhost(starts[i], vhosts->nelts);
+      timedout = TRUE;
+      continue;
+    }
+
+    pr_trace_msg(trace_channel, 3,
+      "worker %u failed, rendering its vhosts (%u-%u) in process", i + 1,
+      starts[i] + 1, starts[i+1]);
+
+    if (lint_render_vhosts(p, vhosts, starts[i], starts[i+1], path) < 0) {
+      if (errno != ETIMEDOUT) {
+        xerrno = errno;
+        res = -1;
+        goto done;
+      }
+
+      timedout = TRUE;
+    }
+
+    *((char **) push_array(run_paths)) = (char *) path;
   }
 
-  res = lint_text_write_buffered_lines(fh, buffered_lines);
-  if (res < 0) {
-    destroy_pool(ctx_pool);
+  res = lint_run_concat(p, w, run_paths);
+  xerrno = errno;
+
+  if (res == 0 &&
+      timedout == TRUE) {
+    xerrno = ETIMEDOUT;
+    res = -1;
+  }
+
+  /* For the vhost cache, collect the blocks the workers rendered; each vhost
+   * is one record of its partition's run.
+   */
+  if (res == 0 &&
+      lint_vhost_cache_path != NULL) {
+    for (i = 0; i < nworkers; i++) {
+      register unsigned int j;
+      array_header *texts;
+
+      texts = lint_run_read(p, ((char **) paths->elts)[i]);
+      if (texts == NULL ||
+          texts->nelts != starts[i+1] - starts[i]) {
+        continue;
+      }
+
+      for (j = 0; j < texts->nelts; j++) {
+        struct lint_vhost *vhost;
+
+        vhost = &(((struct lint_vhost *) vhosts->elts)[starts[i] + j]);
+        if (vhost->block == NULL) {
+          lint_set_vhost_block(p, vhost, ((char **) texts->elts)[j]);
+        }
+      }
+    }
+  }
+
+done:
+  for (i = 0; i < paths->nelts; i++) {
+    (void) unlink(((char **) paths->elts)[i]);
+  }
+
+  errno = xerrno;
+  return res;
+}
+
+/* Returns the index of the vhost for the given server, if any, else -1.  The
+ * search starts after the previous match, as lines are usually in server
+ * order.
+ */
+static int lint_find_vhost(array_header *vhosts, server_rec *s,
+    unsigned int *next_vhost) {
+  register unsigned int i;
+  struct lint_vhost *elts;
+
+  if (s == NULL ||
+      s == main_server) {
     return -1;
   }
 
-  destroy_pool(ctx_pool);
-  return 0;
+  elts = vhosts->elts;
+  for (i = 0; i < vhosts->nelts; i++) {
+    unsigned int j;
+
+    j = (*next_vhost + i) % vhosts->nelts;
+    if (elts[j].s == s) {
+      *next_vhost = j + 1;
+      return (int) j;
+    }
+  }
+
+  return -1;
+}
+
+/* Keys each vhost by the hash of its own parsed lines, with their source
+ * files, and of the lines of the main server (e.g. <Global> and LoadModule
+ * lines), which every vhost shares.
+ */
+static void lint_get_vhost_keys(array_header *vhosts) {
+  register unsigned int i;
+  struct lint_vhost *elts;
+  uint64_t shared_hash;
+  unsigned int next_vhost = 0;
+
+  elts = vhosts->elts;
+  for (i = 0; i < vhosts->nelts; i++) {
+    elts[i].key = LINT_HASH_INIT;
+  }
+
+  /* Blocks rendered by other versions are not reused. */
+  shared_hash = lint_hash_update(LINT_HASH_INIT, MOD_LINT_VERSION,
+    strlen(MOD_LINT_VERSION));
+
+  for (i = 0; parsed_lines != NULL && i < lint_store_count(parsed_lines);
+       i++) {
+    const char *text, *source_file;
+    size_t textsz;
+    int idx;
+
+    text = lint_store_get_text(parsed_lines, i, &textsz);
+
+    idx = lint_find_vhost(vhosts,
+      lint_store_get_server(parsed_lines, i), &next_vhost);
+    if (idx < 0) {
+      shared_hash = lint_hash_update(shared_hash, text, textsz + 1);
+      continue;
+    }
+
+    source_file = lint_store_get_source_file(parsed_lines, i);
+    elts[idx].key = lint_hash_update(elts[idx].key, source_file,
+      strlen(source_file) + 1);
+    elts[idx].key = lint_hash_update(elts[idx].key, text, textsz + 1);
+  }
+
+  for (i = 0; i < vhosts->nelts; i++) {
+    elts[i].key = lint_hash_update(elts[i].key, &shared_hash,
+      sizeof(shared_hash));
+  }
+}
+
+/* The vhost cache is a run, one record per vhost: the key, in hex, and the
+ * rendered block.
+ */
+#define LINT_VHOST_CACHE_KEYSZ		16
+
+static void lint_read_vhost_cache(pool *p, array_header *vhosts) {
+  register unsigned int i;
+  array_header *texts;
+  pr_table_t *blocks;
+  struct lint_vhost *elts;
+  unsigned int max_ents, ncached = 0;
+
+  texts = lint_run_read(p, lint_vhost_cache_path);
+  if (texts == NULL) {
+    pr_trace_msg(trace_channel, 9, "error reading vhost cache '%s': %s",
+      lint_vhost_cache_path, strerror(errno));
+    return;
+  }
+
+  max_ents = texts->nelts + 1;
+  blocks = pr_table_nalloc(p, 0, 64);
+  (void) pr_table_ctl(blocks, PR_TABLE_CTL_SET_MAX_ENTS, &max_ents);
+
+  for (i = 0; i < texts->nelts; i++) {
+    char *text;
+
+    text = ((char **) texts->elts)[i];
+    if (strlen(text) <= LINT_VHOST_CACHE_KEYSZ) {
+      continue;
+    }
+
+    (void) pr_table_add(blocks, pstrndup(p, text, LINT_VHOST_CACHE_KEYSZ),
+      text + LINT_VHOST_CACHE_KEYSZ,
+      strlen(text + LINT_VHOST_CACHE_KEYSZ) + 1);
+  }
+
+  elts = vhosts->elts;
+  for (i = 0; i < vhosts->nelts; i++) {
+    char key[LINT_VHOST_CACHE_KEYSZ + 1];
+    const char *text;
+
+    pr_snprintf(key, sizeof(key), "%016llx",
+      (unsigned long long) elts[i].key);
+    text = pr_table_get(blocks, key, NULL);
+    if (text != NULL) {
+      lint_set_vhost_block(p, &(elts[i]), text);
+      ncached++;
+    }
+  }
+
+  pr_trace_msg(trace_channel, 9, "reusing %u of %u cached vhosts", ncached,
+    vhosts->nelts);
+}
+
+static int lint_write_vhost_cache(pool *p, array_header *vhosts) {
+  register unsigned int i;
+  array_header *buffered_lines;
+  struct lint_vhost *elts;
+  char *tmp_path;
+  int fd, xerrno;
+
+  buffered_lines = make_array(p, vhosts->nelts,
+    sizeof(struct lint_buffered_line *));
+
+  elts = vhosts->elts;
+  for (i = 0; i < vhosts->nelts; i++) {
+    struct lint_buffered_line *bl;
+    char *key;
+
+    if (elts[i].block == NULL) {
+      /* Not every vhost was rendered; keep the previous cache. */
+      return 0;
+    }
+
+    key = pcalloc(p, LINT_VHOST_CACHE_KEYSZ + 1);
+    pr_snprintf(key, LINT_VHOST_CACHE_KEYSZ + 1, "%016llx",
+      (unsigned long long) elts[i].key);
+
+    bl = lint_text_line_create(p);
+    if (bl == NULL) {
+      return -1;
+    }
+
+    (void) lint_text_line_add_str(bl, key);
+    (void) lint_text_line_add_str(bl, elts[i].block);
+    (void) lint_text_add_line(buffered_lines, bl);
+  }
+
+  tmp_path = pstrcat(p, lint_vhost_cache_path, ".XXXXXX", NULL);
+  fd = mkstemp(tmp_path);
+  if (fd < 0) {
+    return -1;
+  }
+
+  (void) close(fd);
+
+  if (lint_run_write(p, tmp_path, buffered_lines) < 0 ||
+      pr_fsio_rename(tmp_path, lint_vhost_cache_path) < 0) {
+    xerrno = errno;
+
+    (void) pr_fsio_unlink(tmp_path);
+    errno = xerrno;
+    return -1;
+  }
+
+  return 0;
+}
+
+/* Writes the <VirtualHost> sections, in server_list order, which matters,
+ * e.g. for the default name-based vhost of an address.
+ */
+static int lint_write_vhosts(pool *p, struct lint_text_writer *w) {
+  register unsigned int i;
+  int idx, res;
+  pool *ctx_pool;
+  server_rec *s;
+  array_header *buffered_lines, *vhosts;
+  struct lint_vhost *elts;
+  unsigned int nworkers, next_vhost = 0;
+
+  res = lint_text_writer_fmt(w, "%s", "\n# VirtualHosts\n");
+  if (res < 0) {
+    return -1;
+  }
+
+  ctx_pool = make_sub_pool(p);
+  pr_pool_tag(ctx_pool, "Lint <VirtualHost> context pool");
+
+  vhosts = make_array(ctx_pool, 10, sizeof(struct lint_vhost));
+  for (s = (server_rec *) server_list->xas_list; s; s = s->next) {
+    struct lint_vhost *vhost;
+
+    if (s == main_server) {
+      /* We wrote out the main_server config earlier. */
+      continue;
+    }
+
+    vhost = push_array(vhosts);
+    vhost->s = s;
+    vhost->text = NULL;
+    vhost->block = NULL;
+  }
+
+  /* Each <VirtualHost> line is recorded with the server it opened; lines
+   * of vhosts dropped at startup match no server.
+   */
+  idx = -1;
+  if (parsed_lines != NULL) {
+    lint_perf.counts[LINT_PERF_COUNT_LOOKUPS]++;
+    idx = lint_store_find_line(parsed_lines, "<VirtualHost>");
+  }
+
+  elts = vhosts->elts;
+  for (; idx >= 0; idx = lint_store_next_line(parsed_lines, idx)) {
+    int vhost_idx;
+
+    vhost_idx = lint_find_vhost(vhosts,
+      lint_store_get_server(parsed_lines, idx), &next_vhost);
+    if (vhost_idx >= 0 &&
+        elts[vhost_idx].text == NULL) {
+      elts[vhost_idx].text = lint_store_get_text(parsed_lines, idx, NULL);
+    }
+  }
+
+  if (lint_vhost_cache_path != NULL) {
+    lint_get_vhost_keys(vhosts);
+    lint_read_vhost_cache(ctx_pool, vhosts);
+  }
+
+  nworkers = lint_workers;
+  if (nworkers > vhosts->nelts) {
+    nworkers = vhosts->nelts;
+  }
+
+  if (nworkers > 1) {
+    pr_trace_msg(trace_channel, 9, "rendering %u vhosts using %u workers",
+      vhosts->nelts, nworkers);
+
+    res = lint_write_vhosts_parallel(ctx_pool, w, vhosts, nworkers);
+    if (res < 0) {
+      int xerrno = errno;
+
+      destroy_pool(ctx_pool);
+      errno = xerrno;
+      return -1;
+    }
+
+  } else {
+    buffered_lines = make_array(ctx_pool, 10,
+      sizeof(struct lint_buffered_line *));
+
+    /* If the time budget is exceeded, we still write out the vhosts
+     * rendered thus far.
+     */
+    res = lint_add_vhosts(ctx_pool, buffered_lines, vhosts, 0, vhosts->nelts);
+    if (res < 0 &&
+        errno != ETIMEDOUT) {
+      destroy_pool(ctx_pool);
+      return -1;
+    }
+
+    for (i = 0; i < buffered_lines->nelts; i++) {
+      struct lint_buffered_line *bl;
+
+      bl = ((struct lint_buffered_line **) buffered_lines->elts)[i];
+      if (lint_text_writer_line(w, bl) < 0) {
+        destroy_pool(ctx_pool);
+        return -1;
+      }
+
+      if (lint_vhost_cache_path != NULL &&
+          elts[i].block == NULL) {
+        lint_set_vhost_block(ctx_pool, &(elts[i]),
+          lint_text_line_get_text(ctx_pool, bl));
+      }
+    }
+
+    if (res < 0) {
+      destroy_pool(ctx_pool);
+      errno = ETIMEDOUT;
+      return -1;
+    }
+  }
+
+  if (lint_vhost_cache_path != NULL &&
+      lint_write_vhost_cache(ctx_pool, vhosts) < 0) {
+    pr_trace_msg(trace_channel, 3, "error writing vhost cache '%s': %s",
+      lint_vhost_cache_path, strerror(errno));
+  }
+
+  destroy_pool(ctx_pool);
+  return 0;
+}
+
+static const struct lint_section {
+  const char *name;
+  unsigned int phase;
+  int (*write)(pool *, struct lint_text_writer *);
+} lint_sections[] = {
+  { "header", LINT_PERF_PHASE_HEADER, lint_write_header },
+  { "defines", LINT_PERF_PHASE_DEFINES, lint_write_defines },
+  { "modules", LINT_PERF_PHASE_MODULES, lint_write_modules },
+  { "server config", LINT_PERF_PHASE_SERVER_CONFIG, lint_write_server_config },
+  { "classes", LINT_PERF_PHASE_CLASSES, lint_write_classes },
+  { "controls", LINT_PERF_PHASE_CTRLS, lint_write_ctrls },
+  { "vhosts", LINT_PERF_PHASE_VHOSTS, lint_write_vhosts },
+  { NULL, 0, NULL }
+};
+
+/* Writes each section in turn, timing each.  If the time budget is
+ * exceeded, the remaining sections are skipped, and *partial is set.
+ */
+static int lint_write_sections(pool *p, struct lint_text_writer *w,
+    int *partial) {
+  register unsigned int i;
+
+  memset(&lint_timer, 0, sizeof(lint_timer));
+  lint_timer.start_ns = lint_perf_now();
+  *partial = FALSE;
+
+  for (i = 0; lint_sections[i].name != NULL; i++) {
+    uint64_t start_ns;
+    int res, xerrno;
+
+    lint_timer.section = lint_sections[i].name;
+    if (lint_budget_exceeded() == TRUE) {
+      *partial = TRUE;
+      break;
+    }
+
+    start_ns = lint_perf_now();
+    res = (lint_sections[i].write)(p, w);
+    xerrno = errno;
+
+    (void) lint_perf_add_time(&lint_perf, lint_sections[i].phase, start_ns);
+    lint_timer.nsections++;
+
+    pr_trace_msg(trace_channel, 8, "wrote %s section in %lu us",
+      lint_sections[i].name,
+      (unsigned long) (lint_perf.phase_ns[lint_sections[i].phase] / 1000));
+
+    if (res < 0) {
+      if (xerrno == ETIMEDOUT) {
+        *partial = TRUE;
+        break;
+      }
+
+      errno = xerrno;
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/* Appends the marker, and section timings, to a partial config. */
+static int lint_write_partial_marker(struct lint_text_writer *w) {
+  register unsigned int i;
+
+  if (lint_text_writer_fmt(w,
+      "\n# PARTIAL OUTPUT: LintTimeBudget of %lu ms exceeded in section '%s'",
+      (unsigned long) lint_time_budget, lint_timer.section) < 0) {
+    return -1;
+  }
+
+  if (lint_timer.nvhosts > 0) {
+    if (lint_text_writer_fmt(w, " (at vhost %u of %u)",
+        lint_timer.vhost_idx + 1, lint_timer.nvhosts) < 0) {
+      return -1;
+    }
+  }
+
+  if (lint_text_writer_fmt(w, "%s", "\n") < 0) {
+    return -1;
+  }
+
+  for (i = 0; i < lint_timer.nsections; i++) {
+    const struct lint_section *section;
+
+    section = &(lint_sections[i]);
+    if (lint_text_writer_fmt(w, "#   %s: %lu ms\n", section->name,
+        (unsigned long) (lint_perf.phase_ns[section->phase] / 1000000)) < 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int lint_sync_dir(pool *p, const char *path) {
+  int fd, res, xerrno;
+  char *dir_path, *ptr;
+
+  dir_path = pstrdup(p, path);
+  ptr = strrchr(dir_path, '/');
+  if (ptr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (ptr == dir_path) {
+    /* The file is in the root directory. */
+    ptr++;
+  }
+  *ptr = '\0';
+
+  fd = open(dir_path, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+
+  res = fsync(fd);
+  xerrno = errno;
+  (void) close(fd);
+
+  errno = xerrno;
+  return res;
+}
+
+/* Returns TRUE if the given file and the existing config have the same
+ * content, ignoring their headers.
+ */
+static int lint_config_unchanged(pool *p, const char *tmp_path,
+    const char *path) {
+  uint64_t hash, tmp_hash;
+  off_t filesz, tmp_filesz;
+
+  if (lint_hash_file(p, path, LINT_HEADER_PREFIX, &hash, &filesz) < 0) {
+    return FALSE;
+  }
+
+  if (lint_hash_file(p, tmp_path, LINT_HEADER_PREFIX, &tmp_hash,
+      &tmp_filesz) < 0) {
+    return FALSE;
+  }
+
+  /* Note that the header lengths, and thus the file sizes, may differ. */
+  pr_trace_msg(trace_channel, 17,
+    "existing '%s' (%lu bytes, hash %016llx), new '%s' (%lu bytes, "
+    "hash %016llx)", path, (unsigned long) filesz, (unsigned long long) hash,
+    tmp_path, (unsigned long) tmp_filesz, (unsigned long long) tmp_hash);
+
+  return hash == tmp_hash ? TRUE : FALSE;
+}
+
+/* The config is written to a temporary file in the same directory as the
+ * final path, which is then renamed into place, so that readers never see
+ * a partially written config.
+ */
+static struct lint_text_writer *lint_open_config(pool *p, const char *path,
+    char **tmp_path, pr_fh_t **fh) {
+  struct lint_text_writer *w;
+  struct stat st;
+  int fd, xerrno;
+  mode_t perms = 0644;
+
+  /* TODO: Will we want/need root privs here? */
+
+  *tmp_path = pstrcat(p, path, ".XXXXXX", NULL);
+  fd = mkstemp(*tmp_path);
+  xerrno = errno;
+  if (fd < 0) {
+    pr_trace_msg(trace_channel, 1, "error creating temporary file for '%s': %s",
+      path, strerror(xerrno));
+    errno = xerrno;
+    return NULL;
+  }
+
+  /* Preserve the permissions of any existing file. */
+  if (pr_fsio_stat(path, &st) == 0) {
+    perms = st.st_mode & 07777;
+  }
+
+  (void) fchmod(fd, perms);
+  (void) close(fd);
+
+  *fh = pr_fsio_open(*tmp_path, O_WRONLY|O_TRUNC);
+  xerrno = errno;
+  if (*fh == NULL) {
+    pr_trace_msg(trace_channel, 1, "error opening '%s': %s", *tmp_path,
+      strerror(xerrno));
+    (void) pr_fsio_unlink(*tmp_path);
+    errno = xerrno;
+    return NULL;
+  }
+
+  w = lint_text_writer_create(p, *fh);
+  if (w == NULL) {
+    xerrno = errno;
+
+    (void) pr_fsio_close(*fh);
+    (void) pr_fsio_unlink(*tmp_path);
+    errno = xerrno;
+    return NULL;
+  }
+
+  return w;
+}
+
+static void lint_abort_config(struct lint_text_writer *w,
+    const char *tmp_path) {
+  int xerrno;
+
+  xerrno = errno;
+  (void) lint_text_writer_close(w);
+  (void) pr_fsio_unlink(tmp_path);
+  errno = xerrno;
+}
+
+/* Closes the temporary file, and renames it into place.  If the content is
+ * unchanged, the existing file is left as is.
+ */
+static int lint_commit_config(pool *p, struct lint_text_writer *w,
+    pr_fh_t *fh, const char *tmp_path, const char *path) {
+  int xerrno;
+  uint64_t start_ns;
+  struct lint_text_writer_stats stats;
+
+  start_ns = lint_perf_now();
+
+  /* Flush any pending blocks first, so that the writer stats are complete. */
+  if (lint_text_writer_flush(w) < 0) {
+    pr_trace_msg(trace_channel, 1, "error writing '%s': %s", tmp_path,
+      strerror(errno));
+    lint_abort_config(w, tmp_path);
+    return -1;
+  }
+
+  if (lint_text_writer_get_stats(w, &stats) == 0) {
+    lint_perf.counts[LINT_PERF_COUNT_BYTES_WRITTEN] += stats.bytes_written;
+    lint_perf.counts[LINT_PERF_COUNT_SYSCALLS] += stats.nwrites;
+  }
+
+  if (lint_sync_policy != LINT_SYNC_POLICY_NONE) {
+    lint_perf.counts[LINT_PERF_COUNT_SYSCALLS]++;
+
+    if (pr_fsio_fsync(fh) < 0) {
+      pr_trace_msg(trace_channel, 1, "error syncing '%s': %s", tmp_path,
+        strerror(errno));
+      lint_abort_config(w, tmp_path);
+      return -1;
+    }
+  }
+
+  if (lint_text_writer_close(w) < 0) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 1, "error writing '%s': %s", tmp_path,
+      strerror(xerrno));
+    (void) pr_fsio_unlink(tmp_path);
+    errno = xerrno;
+    return -1;
+  }
+
+  if (lint_config_unchanged(p, tmp_path, path) == TRUE) {
+    pr_trace_msg(trace_channel, 9, "config for '%s' unchanged, skipping",
+      path);
+    (void) pr_fsio_unlink(tmp_path);
+    (void) lint_perf_add_time(&lint_perf, LINT_PERF_PHASE_COMMIT, start_ns);
+    return 0;
+  }
+
+  lint_perf.counts[LINT_PERF_COUNT_SYSCALLS]++;
+  if (pr_fsio_rename(tmp_path, path) < 0) {
+    xerrno = errno;
+
+    pr_trace_msg(trace_channel, 1, "error renaming '%s' to '%s': %s",
+      tmp_path, path, strerror(xerrno));
+    (void) pr_fsio_unlink(tmp_path);
+    errno = xerrno;
+    return -1;
+  }
+
+  if (lint_sync_policy == LINT_SYNC_POLICY_DIRECTORY) {
+    lint_perf.counts[LINT_PERF_COUNT_SYSCALLS]++;
+
+    if (lint_sync_dir(p, path) < 0) {
+      pr_trace_msg(trace_channel, 3, "error syncing directory for '%s': %s",
+        path, strerror(errno));
+    }
+  }
+
+  (void) lint_perf_add_time(&lint_perf, LINT_PERF_PHASE_COMMIT, start_ns);
+  return 0;
+}
+
+/* Reports the phase timings and counters, and, if configured, writes them
+ * to a JSON stats file alongside the generated config.
+ */
+static void lint_report_perf(pool *p, const char *path) {
+  lint_perf_trace(&lint_perf);
+
+  if (lint_opts & LINT_OPT_PERF_STATS) {
+    const char *stats_path;
+
+    stats_path = pstrcat(p, path, ".stats.json", NULL);
+    if (lint_perf_write_json(p, &lint_perf, stats_path) < 0) {
+      pr_trace_msg(trace_channel, 3, "error writing stats file '%s': %s",
+        stats_path, strerror(errno));
+    }
+  }
+}
+
+/* Writes the config.  If the time budget is exceeded, the partial config is
+ * written alongside, with a ".partial" suffix, leaving any previous config
+ * in place, and *partial is set.
+ */
+static int lint_write_config(pool *p, const char *path, int *partial) {
+  pr_fh_t *fh = NULL;
+  struct lint_text_writer *w;
+  char *tmp_path = NULL;
+
+  w = lint_open_config(p, path, &tmp_path, &fh);
+  if (w == NULL) {
+    return -1;
+  }
+
+  if (lint_write_sections(p, w, partial) < 0) {
+    lint_abort_config(w, tmp_path);
+    return -1;
+  }
+
+  if (*partial == TRUE) {
+    pr_trace_msg(trace_channel, 1,
+      "LintTimeBudget (%lu ms) exceeded after %lu ms in section '%s', "
+      "writing partial config to '%s.partial'", (unsigned long) lint_time_budget,
+      (unsigned long) lint_timer_elapsed(), lint_timer.section, path);
+
+    if (lint_write_partial_marker(w) < 0) {
+      lint_abort_config(w, tmp_path);
+      return -1;
+    }
+
+    return lint_commit_config(p, w, fh, tmp_path,
+      pstrcat(p, path, ".partial", NULL));
+  }
+
+  if (lint_commit_config(p, w, fh, tmp_path, path) < 0) {
+    return -1;
+  }
+
+  /* Remove any stale partial config from a previous attempt. */
+  (void) pr_fsio_unlink(pstrcat(p, path, ".partial", NULL));
+  return 0;
+}
+
+/* Builds the state of the parsed config: the content hash of every source
+ * file, and a hash of all of the parsed lines.  The latter catches changes
+ * not reflected in the files themselves, e.g. via Defines from the command
+ * line.
+ */
+static struct lint_state *lint_get_config_state(pool *p) {
+  register unsigned int i;
+  struct lint_state *state;
+  pr_table_t *seen_files;
+  uint64_t lines_hash = LINT_HASH_INIT;
+
+  state = lint_state_alloc(p);
+  if (parsed_lines == NULL) {
+    return state;
+  }
+
+  seen_files = pr_table_nalloc(p, 0, 32);
+
+  for (i = 0; i < lint_store_count(parsed_lines); i++) {
+    const char *text, *source_file;
+    size_t textsz;
+
+    pr_signals_handle();
+
+    text = lint_store_get_text(parsed_lines, i, &textsz);
+    lines_hash = lint_hash_update(lines_hash, text, textsz + 1);
+
+    /* Each file is hashed once, even if its lines are interleaved with
+     * those of the files it includes.
+     */
+    source_file = lint_store_get_source_file(parsed_lines, i);
+    if (pr_table_get(seen_files, source_file, NULL) == NULL) {
+      if (lint_state_add_file(state, source_file) < 0) {
+        pr_trace_msg(trace_channel, 3, "error adding '%s' to state: %s",
+          source_file, strerror(errno));
+      }
+
+      (void) pr_table_add(seen_files, source_file, "", 1);
+    }
+  }
+
+  (void) lint_state_add_hash(state, "parsed-lines", lines_hash);
+  return state;
+}
+
+static void lint_add_config_file_state(pool *p, struct lint_state *state,
+    const char *path) {
+  uint64_t hash;
+
+  if (lint_hash_file(p, path, LINT_HEADER_PREFIX, &hash, NULL) == 0) {
+    (void) lint_state_add_hash(state, "LintConfigFile", hash);
+  }
+}
+
+/* With NumericAddresses, the resolved addresses, and the numeric config
+ * written from them, are recorded too; a changed resolution, or a missing
+ * or altered numeric config, means the config is emitted again.
+ */
+static void lint_add_numeric_state(pool *p, struct lint_state *state,
+    const char *path) {
+  uint64_t hash;
+
+  if (!(lint_opts & LINT_OPT_NUMERIC_ADDRESSES) ||
+      lint_dns == NULL) {
+    return;
+  }
+
+  if (lint_dns_hash(lint_dns, &hash) == 0) {
+    (void) lint_state_add_hash(state, "LintNumericAddresses", hash);
+  }
+
+  if (lint_hash_file(p, pstrcat(p, path, ".numeric", NULL),
+      LINT_HEADER_PREFIX, &hash, NULL) == 0) {
+    (void) lint_state_add_hash(state, "LintNumericFile", hash);
+  }
+}
+
+/* Returns TRUE if the config, as recorded in the given state file, is
+ * unchanged, and the previously generated config files are intact.
+ */
+static int lint_config_is_current(pool *p, struct lint_state *state,
+    const char *state_path, const char *path) {
+  struct lint_state *prev_state;
+  array_header *changed;
+  int count;
+
+  prev_state = lint_state_read(p, state_path);
+  if (prev_state == NULL) {
+    return FALSE;
+  }
+
+  lint_add_config_file_state(p, state, path);
+  lint_add_numeric_state(p, state, path);
+
+  changed = make_array(p, 0, sizeof(char *));
+  count = lint_state_compare(state, prev_state, changed);
+  if (count == 0) {
+    return TRUE;
+  }
+
+  if (pr_trace_get_level(trace_channel) >= 5) {
+    register unsigned int i;
+    char **names;
+
+    names = changed->elts;
+    for (i = 0; i < changed->nelts; i++) {
+      pr_trace_msg(trace_channel, 5, "config state changed: %s", names[i]);
+    }
+  }
+
+  return FALSE;
+}
+
+/* Writes the config, and then, if configured, records the state from which
+ * it was generated.
+ */
+static int lint_emit_config(pool *p, const char *path,
+    struct lint_state *state, const char *state_path) {
+  int partial = FALSE;
+
+  if (lint_write_config(p, path, &partial) < 0) {
+    return -1;
+  }
+
+  lint_report_perf(p, path);
+
+  if ((lint_opts & LINT_OPT_NUMERIC_ADDRESSES) &&
+      lint_dns != NULL &&
+      partial == FALSE) {
+    const char *numeric_path;
+
+    numeric_path = pstrcat(p, path, ".numeric", NULL);
+    if (lint_dns_write_numeric(lint_dns, path, numeric_path) < 0) {
+      pr_trace_msg(trace_channel, 1, "error writing '%s': %s", numeric_path,
+        strerror(errno));
+    }
+  }
+
+  /* A partial config is not recorded, so that the next startup tries
+   * again.
+   */
+  if (state != NULL &&
+      partial == FALSE) {
+    lint_add_config_file_state(p, state, path);
+    lint_add_numeric_state(p, state, path);
+
+    if (lint_state_write(state, state_path) < 0) {
+      pr_trace_msg(trace_channel, 1, "error writing state file '%s': %s",
+        state_path, strerror(errno));
+    }
+  }
+
+  return 0;
+}
+
+static void lint_lower_priority(void) {
+  if (setpriority(PRIO_PROCESS, 0, LINT_BACKGROUND_NICENESS) < 0) {
+    pr_trace_msg(trace_channel, 3, "error setting niceness to %d: %s",
+      LINT_BACKGROUND_NICENESS, strerror(errno));
+  }
+
+#if defined(__linux__) && defined(SYS_ioprio_set)
+  /* These values are from linux/ioprio.h, which is not always available.
+   * We want the IOPRIO_CLASS_IDLE class, for IOPRIO_WHO_PROCESS.
+   */
+  if (syscall(SYS_ioprio_set, 1, 0, (3 << 13)) < 0) {
+    pr_trace_msg(trace_channel, 3, "error setting idle I/O priority: %s",
+      strerror(errno));
+  }
+#endif /* Linux and SYS_ioprio_set */
+}
+
+/* Emits the config from a forked child process, so that the master process
+ * need not wait for it.  The child reports its success or failure via
+ * trace logging, and its exit status.
+ */
+static int lint_emit_config_bg(pool *p, const char *path,
+    struct lint_state *state, const char *state_path) {
+  pid_t pid;
+  int res;
+
+  pid = fork();
+  if (pid < 0) {
+    int xerrno = errno;
+
+    pr_trace_msg(trace_channel, 1,
+      "unable to fork background emitter (%s), emitting config in foreground",
+      strerror(xerrno));
+    return lint_emit_config(p, path, state, state_path);
+  }
+
+  if (pid != 0) {
+    pr_trace_msg(trace_channel, 9,
+      "emitting config file to '%s' in background process (PID %lu)", path,
+      (unsigned long) pid);
+    return 0;
+  }
+
+  /* We are the child process now. */
+  (void) lint_arena_detach(parsed_arena);
+  lint_lower_priority();
+
+  res = lint_emit_config(p, path, state, state_path);
+  if (res < 0) {
+    pr_trace_msg(trace_channel, 1,
+      "background process (PID %lu) failed to emit config file to '%s': %s",
+      (unsigned long) getpid(), path, strerror(errno));
+
+    /* Note that we use _exit(2) here, to avoid running any of the master
+     * process' exit handlers.
+     */
+    _exit(1);
+  }
+
+  pr_trace_msg(trace_channel, 9,
+    "background process (PID %lu) emitted config file to '%s'",
+    (unsigned long) getpid(), path);
+  _exit(0);
+}
+
+/* Returns the names, recorded by the DNS rule, which required resolution,
+ * without reporting its findings.
+ */
+static struct lint_dns *lint_get_dns(pool *p) {
+  pool *tmp_pool;
+  struct lint_rule_engine *engine;
+  struct lint_dns *dns;
+
+  tmp_pool = make_sub_pool(p);
+  pr_pool_tag(tmp_pool, "Lint DNS rule pool");
+
+  engine = lint_rule_engine_alloc(tmp_pool);
+
+  dns = lint_dns_alloc(p);
+  (void) lint_rule_engine_add(engine, lint_rule_get_dns_rule(), dns);
+
+  if (lint_rule_engine_run(engine, parsed_lines, server_list) < 0) {
+    pr_trace_msg(trace_channel, 3, "error running DNS rule: %s",
+      strerror(errno));
+  }
+
+  destroy_pool(tmp_pool);
+
+  pr_trace_msg(trace_channel, 9, "found %u names requiring DNS resolution",
+    lint_dns_count(dns));
+  return dns;
+}
+
+/* Runs the rules over the parsed lines and configs, logging their findings.
+ */
+static void lint_check_rules(pool *p) {
+  register unsigned int i;
+  pool *tmp_pool;
+  struct lint_rule_engine *engine;
+  struct lint_rule_inetd_data inetd_data;
+  struct lint_rule_finding *findings;
+  array_header *list;
+
+  tmp_pool = make_sub_pool(p);
+  pr_pool_tag(tmp_pool, "Lint rule check pool");
+
+  engine = lint_rule_engine_alloc(tmp_pool);
+
+  /* The names have already been recorded, if needed, by lint_get_dns(). */
+  (void) lint_rule_engine_add(engine, lint_rule_get_dns_rule(), NULL);
+
+  if (ServerType == SERVER_INETD) {
+    memset(&inetd_data, 0, sizeof(inetd_data));
+    inetd_data.parse_ns = lint_perf.phase_ns[LINT_PERF_PHASE_INGEST] +
+      lint_perf.phase_ns[LINT_PERF_PHASE_ASSOCIATE];
+    (void) lint_rule_engine_add(engine, lint_rule_get_inetd_rule(),
+      &inetd_data);
+  }
+
+  if (lint_rule_engine_run(engine, parsed_lines, server_list) < 0) {
+    pr_trace_msg(trace_channel, 3, "error running rules: %s",
+      strerror(errno));
+  }
+
+  list = lint_rule_engine_get_findings(engine);
+  findings = list->elts;
+  for (i = 0; i < list->nelts; i++) {
+    if (findings[i].source_file != NULL) {
+      pr_log_pri(PR_LOG_NOTICE, MOD_LINT_VERSION ": %s:%u: %s",
+        findings[i].source_file, findings[i].source_lineno,
+        findings[i].text);
+
+    } else {
+      pr_log_pri(PR_LOG_NOTICE, MOD_LINT_VERSION ": %s", findings[i].text);
+    }
+  }
+
+  destroy_pool(tmp_pool);
+}
+
+/* Writes the parse profile report, and its folded stacks, for flame graph
+ * tools, alongside.
+ */
+static void lint_write_profile(const char *path) {
+  const char *folded_path;
+
+  if (lint_profile_write(lint_profile, path) < 0) {
+    pr_trace_msg(trace_channel, 1, "error writing LintProfileFile '%s': %s",
+      path, strerror(errno));
+    return;
+  }
+
+  folded_path = pstrcat(lint_pool, path, ".folded", NULL);
+  if (lint_profile_write_folded(lint_profile, folded_path) < 0) {
+    pr_trace_msg(trace_channel, 1, "error writing '%s': %s", folded_path,
+      strerror(errno));
+    return;
+  }
+
+  pr_trace_msg(trace_channel, 9, "wrote parse profile to '%s'", path);
+}
+
+/* As for the parser, section directives are named with their closing '>',
+ * e.g. "<Directory>" for "<Directory /path>".  Returns the new length of
+ * the given directive name.
+ */
+static size_t lint_normalize_directive(char *directive, size_t len,
+    size_t directivesz) {
+  if (len > 0 &&
+      directive[0] == '<' &&
+      directive[len-1] != '>' &&
+      len + 1 < directivesz) {
+    directive[len++] = '>';
+    directive[len] = '\0';
+  }
+
+  return len;
+}
+
+static int lint_is_vhost_directive(const char *directive) {
+  char name[16];
+  size_t len;
+
+  len = strlen(directive);
+  if (len >= sizeof(name)) {
+    return FALSE;
+  }
+
+  memcpy(name, directive, len + 1);
+  (void) lint_normalize_directive(name, len, sizeof(name));
+  return strcasecmp(name, "<VirtualHost>") == 0 ? TRUE : FALSE;
+}
+
+/* In passthrough mode, the included files' lines are written in place of
+ * their Include lines, and only the lines of conditional sections which
+ * applied are seen; thus these lines are not written.
+ */
+static const char *lint_passthrough_skipped[] = {
+  "Include",
+  "<IfDefine>",
+  "</IfDefine>",
+  "<IfModule>",
+  "</IfModule>",
+  "<IfVersion>",
+  "</IfVersion>",
+  NULL
+};
+
+static int lint_is_passthrough_skipped(const char *directive) {
+  register unsigned int i;
+  char name[16];
+  size_t len;
+
+  len = strlen(directive);
+  if (len >= sizeof(name)) {
+    return FALSE;
+  }
+
+  memcpy(name, directive, len + 1);
+  (void) lint_normalize_directive(name, len, sizeof(name));
+
+  for (i = 0; lint_passthrough_skipped[i] != NULL; i++) {
+    if (strcasecmp(name, lint_passthrough_skipped[i]) == 0) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+static int lint_resolve_line(void *data, const char *text, size_t textsz,
+    server_rec *s, const char *source_file, unsigned int source_lineno) {
+  char directive[128];
+  const char *ptr;
+  size_t len;
+  int idx;
+
+  pr_trace_msg(trace_channel, 7, "%s # %s:%u", text, source_file,
+    source_lineno);
+
+  /* Skip past any leading whitespace. */
+  for (; *text && PR_ISSPACE(*text); text++, textsz--) {
+  }
+
+  /* The directive name is the first word of the line. */
+  for (ptr = text; *ptr && !PR_ISSPACE(*ptr); ptr++) {
+  }
+
+  len = ptr - text;
+  if (len == 0 ||
+      len >= sizeof(directive)) {
+    pr_trace_msg(trace_channel, 9, "ignoring unexpected line '%s'", text);
+    return 0;
+  }
+
+  memcpy(directive, text, len);
+  directive[len] = '\0';
+  (void) lint_normalize_directive(directive, len, sizeof(directive));
+
+  /* This may be a misspelled/unknown directive; make sure we handle it
+   * accordingly.
+   */
+  lint_perf.counts[LINT_PERF_COUNT_LOOKUPS]++;
+  if (lint_symtab_get_module(parsed_symbols, directive) == NULL) {
+    pr_trace_msg(trace_channel, 9, "ignoring unknown directive '%s'",
+      directive);
+    lint_perf.counts[LINT_PERF_COUNT_UNKNOWN]++;
+    return 0;
+  }
+
+  idx = lint_store_add_line(parsed_lines, directive, text, textsz,
+    source_file, source_lineno);
+  if (idx < 0) {
+    pr_trace_msg(trace_channel, 1, "error storing '%s' parsed line: %s",
+      directive, strerror(errno));
+    return 0;
+  }
+
+  (void) lint_store_set_server(parsed_lines, idx, s);
+  return 0;
+}
+
+static int lint_resolve_config(void *data, const config_rec *c) {
+  if (c->name != NULL) {
+    pr_trace_msg(trace_channel, 7, "%s (type %d) config added", c->name,
+      c->config_type);
+
+  } else {
+    pr_trace_msg(trace_channel, 7, "%d-type config added", c->config_type);
+  }
+
+  if (lint_store_add_config(parsed_lines, c) < 0) {
+    pr_trace_msg(trace_channel, 3, "error associating config: %s",
+      strerror(errno));
+  }
+
+  return 0;
+}
+
+/* Resolves the captured lines in one pass: skipping unknown directives,
+ * trimming, and storing the lines, and associating their configs.  The
+ * capture log is then discarded.
+ */
+static void lint_resolve_captured(void) {
+  struct lint_capture_visitor visitor;
+  uint64_t start_ns;
+
+  if (parsed_capture == NULL ||
+      lint_capture_count(parsed_capture) == 0) {
+    return;
+  }
+
+  visitor.line = lint_resolve_line;
+  visitor.config = lint_resolve_config;
+
+  pr_trace_msg(trace_channel, 9, "resolving %u captured lines",
+    lint_capture_count(parsed_capture));
+  lint_perf.counts[LINT_PERF_COUNT_LINES] += lint_capture_count(parsed_capture);
+
+  start_ns = lint_perf_now();
+  (void) lint_capture_visit(parsed_capture, &visitor, NULL);
+  (void) lint_perf_add_time(&lint_perf, LINT_PERF_PHASE_ASSOCIATE, start_ns);
+
+  parsed_capture = NULL;
+}
+
+/* Writes a parsed line, preceded by a comment noting its source. */
+static void lint_stream_line(const char *text, size_t textsz,
+    const char *source_file, unsigned int source_lineno) {
+  struct lint_stream *stream;
+
+  stream = lint_stream;
+  if (stream->failed == TRUE) {
+    return;
+  }
+
+  stream->lines_hash = lint_hash_update(stream->lines_hash, text, textsz + 1);
+
+  if (pr_table_get(stream->seen_files, source_file, NULL) == NULL) {
+    if (lint_state_add_file(stream->state, source_file) < 0) {
+      pr_trace_msg(trace_channel, 3, "error adding '%s' to state: %s",
+        source_file, strerror(errno));
+    }
+
+    (void) pr_table_add(stream->seen_files,
+      pstrdup(stream->pool, source_file), "", 1);
+  }
+
+  if (lint_text_writer_fmt(stream->w, "# %s:%u\n", source_file,
+        source_lineno) < 0 ||
+      lint_text_writer_text(stream->w, text, textsz) < 0 ||
+      lint_text_writer_text(stream->w, "\n", 1) < 0) {
+    pr_trace_msg(trace_channel, 1, "error streaming to '%s': %s",
+      stream->tmp_path, strerror(errno));
+    stream->failed = TRUE;
+  }
+}
+
+/* Switches to passthrough mode: opens the generated config, writes out any
+ * lines stored so far, and releases them.  Only the symbol table is kept.
+ */
+static int lint_stream_open(const char *path) {
+  register unsigned int i;
+  struct lint_stream *stream;
+  pool *stream_pool;
+
+  stream_pool = make_sub_pool(lint_pool);
+  pr_pool_tag(stream_pool, "Lint stream pool");
+
+  stream = pcalloc(stream_pool, sizeof(struct lint_stream));
+  stream->pool = stream_pool;
+  stream->path = pstrdup(stream_pool, path);
+  stream->lines_hash = LINT_HASH_INIT;
+
+  /* Whether there is a LintStateFile may not be known yet, thus the state
+   * is always tracked.
+   */
+  stream->state = lint_state_alloc(stream_pool);
+  stream->seen_files = pr_table_nalloc(stream_pool, 0, 32);
+
+  stream->w = lint_open_config(stream_pool, stream->path, &(stream->tmp_path),
+    &(stream->fh));
+  if (stream->w == NULL) {
+    int xerrno = errno;
+
+    destroy_pool(stream_pool);
+    errno = xerrno;
+    return -1;
+  }
+
+  if (lint_write_header(stream_pool, stream->w) < 0) {
+    int xerrno = errno;
+
+    lint_abort_config(stream->w, stream->tmp_path);
+    destroy_pool(stream_pool);
+    errno = xerrno;
+    return -1;
+  }
+
+  lint_stream = stream;
+
+  pr_trace_msg(trace_channel, 9, "streaming parsed lines to '%s'",
+    stream->tmp_path);
+
+  lint_resolve_captured();
+
+  if (parsed_lines != NULL) {
+    for (i = 0; i < lint_store_count(parsed_lines); i++) {
+      const char *text;
+      size_t textsz;
+
+      if (lint_is_passthrough_skipped(
+          lint_store_get_directive(parsed_lines, i)) == TRUE) {
+        continue;
+      }
+
+      text = lint_store_get_text(parsed_lines, i, &textsz);
+      lint_stream_line(text, textsz,
+        lint_store_get_source_file(parsed_lines, i),
+        lint_store_get_source_lineno(parsed_lines, i));
+    }
+  }
+
+  lint_arena_destroy(parsed_arena);
+  parsed_capture = NULL;
+  parsed_lines = NULL;
+  parsed_symbols = NULL;
+
+  parsed_arena = lint_arena_create(0);
+  if (parsed_arena != NULL) {
+    lint_set_max_memory();
+    parsed_symbols = lint_symtab_alloc(parsed_arena);
+  }
+
+  return 0;
+}
+
+/* Finishes passthrough mode, renaming the generated config into place, and
+ * recording the state, if configured.
+ */
+static int lint_stream_close(const char *state_path) {
+  struct lint_stream *stream;
+  int res;
+
+  stream = lint_stream;
+  lint_stream = NULL;
+
+  if (stream->failed == TRUE) {
+    lint_abort_config(stream->w, stream->tmp_path);
+    destroy_pool(stream->pool);
+    errno = EIO;
+    return -1;
+  }
+
+  res = lint_commit_config(stream->pool, stream->w, stream->fh,
+    stream->tmp_path, stream->path);
+  if (res == 0 &&
+      state_path != NULL) {
+    (void) lint_state_add_hash(stream->state, "parsed-lines",
+      stream->lines_hash);
+    lint_add_config_file_state(stream->pool, stream->state, stream->path);
+
+    if (lint_state_write(stream->state, state_path) < 0) {
+      pr_trace_msg(trace_channel, 1, "error writing state file '%s': %s",
+        state_path, strerror(errno));
+    }
+  }
+
+  if (res == 0) {
+    lint_report_perf(stream->pool, stream->path);
+  }
+
+  destroy_pool(stream->pool);
+  return res;
+}
+
+static void lint_stream_abort(void) {
+  struct lint_stream *stream;
+
+  stream = lint_stream;
+  lint_stream = NULL;
+
+  lint_abort_config(stream->w, stream->tmp_path);
+  destroy_pool(stream->pool);
+}
+
+/* Configuration handlers
+ */
+
+/* usage: LintConfigFile path */
+MODRET set_lintconfigfile(cmd_rec *cmd) {
+  CHECK_ARGS(cmd, 1);
+  CHECK_CONF(cmd, CONF_ROOT);
+
+  if (pr_fs_valid_path(cmd->argv[1]) < 0) {
+    CONF_ERROR(cmd, "must be an absolute path");
+  }
+
+  add_config_param_str(cmd->argv[0], 1, cmd->argv[1]);
+  return PR_HANDLED(cmd);
+}
+
+/* usage: LintEngine on|off */
+MODRET set_lintengine(cmd_rec *cmd) {
+  int engine = -1;
+  config_rec *c = NULL;
+
+  CHECK_ARGS(cmd, 1);
+  CHECK_CONF(cmd, CONF_ROOT);
+
+  engine = get_boolean(cmd, 1);
+  if (engine == -1) {
+    CONF_ERROR(cmd, "expected Boolean parameter");
+  }
+
+  c = add_config_param(cmd->argv[0], 1, NULL);
+  c->argv[0] = pcalloc(c->pool, sizeof(int));
+  *((int *) c->argv[0]) = engine;
+
+  return PR_HANDLED(cmd);
+}
+
+/* usage: LintMaxMemory bytes [units] */
+MODRET set_lintmaxmemory(cmd_rec *cmd) {
+  config_rec *c;
+  off_t nbytes = 0;
+
+  if (cmd->argc < 2 ||
+      cmd->argc > 3) {
+    CONF_ERROR(cmd, "wrong number of parameters");
+  }
+
+  CHECK_CONF(cmd, CONF_ROOT);
+
+  if (pr_str_get_nbytes(cmd->argv[1], cmd->argc == 3 ? cmd->argv[2] : NULL,
+      &nbytes) < 0) {
+    CONF_ERROR(cmd, pstrcat(cmd->tmp_pool, "badly formatted parameter: ",
+      (char *) cmd->argv[1], NULL));
+  }
+
+  c = add_config_param(cmd->argv[0], 1, NULL);
+  c->argv[0] = pcalloc(c->pool, sizeof(off_t));
+  *((off_t *) c->argv[0]) = nbytes;
+
+  return PR_HANDLED(cmd);
 }
 
-static int lint_write_config(pool *p, const char *path) {
-  pr_fh_t *fh;
-  int xerrno;
+/* usage: LintMode normalize|passthrough */
+MODRET set_lintmode(cmd_rec *cmd) {
+  int mode;
+  config_rec *c;
 
-  /* TODO: Will we want/need root privs here? */
+  CHECK_ARGS(cmd, 1);
+  CHECK_CONF(cmd, CONF_ROOT);
 
-  fh = pr_fsio_open(path, O_CREAT|O_WRONLY|O_TRUNC);
-  xerrno = errno;
-  if (fh == NULL) {
-    pr_trace_msg(trace_channel, 1, "error opening '%s': %s", path,
-      strerror(xerrno));
-    errno = xerrno;
-    return -1;
-  }
+  if (strcasecmp(cmd->argv[1], "normalize") == 0) {
+    mode = LINT_MODE_NORMALIZE;
 
-  if (lint_write_header(p, fh) < 0) {
-    xerrno = errno;
+  } else if (strcasecmp(cmd->argv[1], "passthrough") == 0) {
+    mode = LINT_MODE_PASSTHROUGH;
 
-    (void) pr_fsio_close(fh);
-    errno = xerrno;
-    return -1;
+  } else {
+    CONF_ERROR(cmd, pstrcat(cmd->tmp_pool, "unknown mode: ",
+      (char *) cmd->argv[1], NULL));
   }
 
-  if (lint_write_defines(p, fh) < 0) {
-    xerrno = errno;
+  c = add_config_param(cmd->argv[0], 1, NULL);
+  c->argv[0] = pcalloc(c->pool, sizeof(int));
+  *((int *) c->argv[0]) = mode;
 
-    (void) pr_fsio_close(fh);
-    errno = xerrno;
-    return -1;
-  }
+  return PR_HANDLED(cmd);
+}
 
-  if (lint_write_modules(p, fh) < 0) {
-    xerrno = errno;
+/* usage: LintOptions opt1 ... optN */
+MODRET set_lintoptions(cmd_rec *cmd) {
+  register unsigned int i;
+  config_rec *c;
+  unsigned long opts = 0UL;
 
-    (void) pr_fsio_close(fh);
-    errno = xerrno;
-    return -1;
+  if (cmd->argc-1 == 0) {
+    CONF_ERROR(cmd, "wrong number of parameters");
   }
 
-  if (lint_write_server_config(p, fh) < 0) {
-    xerrno = errno;
+  CHECK_CONF(cmd, CONF_ROOT);
 
-    (void) pr_fsio_close(fh);
-    errno = xerrno;
-    return -1;
-  }
+  c = add_config_param(cmd->argv[0], 1, NULL);
 
-  if (lint_write_classes(p, fh) < 0) {
-    xerrno = errno;
+  for (i = 1; i < cmd->argc; i++) {
+    if (strcmp(cmd->argv[i], "Background") == 0) {
+      opts |= LINT_OPT_BACKGROUND;
 
-    (void) pr_fsio_close(fh);
-    errno = xerrno;
-    return -1;
-  }
+    } else if (strcmp(cmd->argv[i], "PerfStats") == 0) {
+      opts |= LINT_OPT_PERF_STATS;
 
-  if (lint_write_ctrls(p, fh) < 0) {
-    xerrno = errno;
+    } else if (strcmp(cmd->argv[i], "NumericAddresses") == 0) {
+      opts |= LINT_OPT_NUMERIC_ADDRESSES;
 
-    (void) pr_fsio_close(fh);
-    errno = xerrno;
-    return -1;
+    } else {
+      CONF_ERROR(cmd, pstrcat(cmd->tmp_pool, ": unknown LintOption '",
+        (char *) cmd->argv[i], "'", NULL));
+    }
   }
 
-  if (lint_write_vhosts(p, fh) < 0) {
-    xerrno = errno;
+  c->argv[0] = pcalloc(c->pool, sizeof(unsigned long));
+  *((unsigned long *) c->argv[0]) = opts;
 
-    (void) pr_fsio_close(fh);
-    errno = xerrno;
-    return -1;
-  }
+  return PR_HANDLED(cmd);
+}
 
-  if (pr_fsio_close(fh) < 0) {
-    xerrno = errno;
+/* usage: LintStateFile path */
+MODRET set_lintstatefile(cmd_rec *cmd) {
+  CHECK_ARGS(cmd, 1);
+  CHECK_CONF(cmd, CONF_ROOT);
 
-    pr_trace_msg(trace_channel, 1, "error writing '%s': %s", path,
-      strerror(xerrno));
-    errno = xerrno;
-    return -1;
+  if (pr_fs_valid_path(cmd->argv[1]) < 0) {
+    CONF_ERROR(cmd, "must be an absolute path");
   }
 
-  return 0;
+  add_config_param_str(cmd->argv[0], 1, cmd->argv[1]);
+  return PR_HANDLED(cmd);
 }
 
-/* Configuration handlers
- */
-
-/* usage: LintConfigFile path */
-MODRET set_lintconfigfile(cmd_rec *cmd) {
+/* usage: LintProfileFile path */
+MODRET set_lintprofilefile(cmd_rec *cmd) {
   CHECK_ARGS(cmd, 1);
   CHECK_CONF(cmd, CONF_ROOT);
 
@@ -759,22 +2975,81 @@ MODRET set_lintconfigfile(cmd_rec *cmd) {
   return PR_HANDLED(cmd);
 }
 
-/* usage: LintEngine on|off */
-MODRET set_lintengine(cmd_rec *cmd) {
-  int engine = -1;
-  config_rec *c = NULL;
+/* usage: LintSyncPolicy none|file|directory */
+MODRET set_lintsyncpolicy(cmd_rec *cmd) {
+  int sync_policy;
+  config_rec *c;
 
   CHECK_ARGS(cmd, 1);
   CHECK_CONF(cmd, CONF_ROOT);
 
-  engine = get_boolean(cmd, 1);
-  if (engine == -1) {
-    CONF_ERROR(cmd, "expected Boolean parameter");
+  if (strcasecmp(cmd->argv[1], "none") == 0) {
+    sync_policy = LINT_SYNC_POLICY_NONE;
+
+  } else if (strcasecmp(cmd->argv[1], "file") == 0) {
+    sync_policy = LINT_SYNC_POLICY_FILE;
+
+  } else if (strcasecmp(cmd->argv[1], "directory") == 0) {
+    sync_policy = LINT_SYNC_POLICY_DIRECTORY;
+
+  } else {
+    CONF_ERROR(cmd, pstrcat(cmd->tmp_pool, "unknown sync policy: ",
+      (char *) cmd->argv[1], NULL));
   }
 
   c = add_config_param(cmd->argv[0], 1, NULL);
   c->argv[0] = pcalloc(c->pool, sizeof(int));
-  *((int *) c->argv[0]) = engine;
+  *((int *) c->argv[0]) = sync_policy;
+
+  return PR_HANDLED(cmd);
+}
+
+/* usage: LintTimeBudget secs */
+MODRET set_linttimebudget(cmd_rec *cmd) {
+  double secs;
+  char *ptr = NULL;
+  config_rec *c;
+
+  CHECK_ARGS(cmd, 1);
+  CHECK_CONF(cmd, CONF_ROOT);
+
+  secs = strtod(cmd->argv[1], &ptr);
+  if (ptr == NULL ||
+      *ptr != '\0' ||
+      secs <= 0.0 ||
+      secs > 86400.0) {
+    CONF_ERROR(cmd, "requires a positive number of seconds");
+  }
+
+  c = add_config_param(cmd->argv[0], 1, NULL);
+  c->argv[0] = pcalloc(c->pool, sizeof(uint64_t));
+  *((uint64_t *) c->argv[0]) = (uint64_t) (secs * 1000.0);
+  if (*((uint64_t *) c->argv[0]) == 0) {
+    *((uint64_t *) c->argv[0]) = 1;
+  }
+
+  return PR_HANDLED(cmd);
+}
+
+/* usage: LintWorkers count */
+MODRET set_lintworkers(cmd_rec *cmd) {
+  int workers;
+  char *ptr = NULL;
+  config_rec *c;
+
+  CHECK_ARGS(cmd, 1);
+  CHECK_CONF(cmd, CONF_ROOT);
+
+  workers = (int) strtol(cmd->argv[1], &ptr, 10);
+  if (ptr == NULL ||
+      *ptr != '\0' ||
+      workers < 1) {
+    CONF_ERROR(cmd, "requires a positive number of workers");
+  }
+
+  c = add_config_param(cmd->argv[0], 1, NULL);
+  c->argv[0] = pcalloc(c->pool, sizeof(unsigned int));
+  *((unsigned int *) c->argv[0]) = (unsigned int) workers;
 
   return PR_HANDLED(cmd);
 }
@@ -783,138 +3058,201 @@ MODRET set_lintengine(cmd_rec *cmd) {
  */
 
 static void lint_added_config_ev(const void *event_data, void *user_data) {
-  const config_rec *c;
-
-  c = event_data;
-  if (c->name != NULL) {
-    pr_trace_msg(trace_channel, 7, "%s (type %d) config added", c->name,
-      c->config_type);
-
-  } else {
-    pr_trace_msg(trace_channel, 7, "%d-type config added", c->config_type);
+  if (lint_profile != NULL) {
+    (void) lint_profile_add_config(lint_profile, lint_perf_now());
   }
 
-  if (associated_configs != NULL) {
-    *((const config_rec **) push_array(associated_configs)) = c;
+  /* Assume that the config is associated with the most recently parsed
+   * line.
+   */
+  if (parsed_capture != NULL &&
+      lint_capture_add_config(parsed_capture, event_data) < 0) {
+    pr_trace_msg(trace_channel, 3, "error capturing config: %s",
+      strerror(errno));
   }
 }
 
-#if defined(PR_SHARED_MODULE)
 static void lint_mod_unload_ev(const void *event_data, void *user_data) {
-  if (strcmp((const char *) event_data, "mod_lint.c") != 0) {
+  const char *module_file;
+
+  module_file = event_data;
+  if (strcmp(module_file, "mod_lint.c") != 0) {
+    /* Forget any cops which the unloaded module registered. */
+    (void) lint_cop_unregister_module(module_file);
     return;
   }
 
+#if defined(PR_SHARED_MODULE)
   /* Unregister ourselves from all events. */
   pr_event_unregister(&lint_module, NULL, NULL);
 
+  lint_cop_free();
   destroy_pool(lint_pool);
   lint_pool = NULL;
-}
 #endif /* PR_SHARED_MODULE */
+}
 
-static void lint_parsed_line_ev(const void *event_data, void *user_data) {
-  const pr_parsed_line_t *parsed_data;
-  struct lint_parsed_line *parsed_line;
-  const char *text;
-  module *handling_module;
+/* Watches for the directives which take effect while the config is still
+ * being parsed: LintMaxMemory, and LintMode and LintConfigFile, switching
+ * to passthrough mode once both of the latter are seen.
+ */
+static void lint_watch_directive(cmd_rec *cmd) {
+  const char *directive;
 
-  parsed_data = event_data;
-  pr_trace_msg(trace_channel, 7, "%s # %s:%u", parsed_data->text,
-    parsed_data->source_file, parsed_data->source_lineno);
+  if (cmd->argc < 2) {
+    return;
+  }
 
-  /* This may be a misspelled/unknown directive; make sure we handle it
-   * accordingly.
-   */
-  handling_module = lint_find_handling_module(parsed_data->cmd->argv[0]);
-  if (handling_module == NULL) {
-    pr_trace_msg(trace_channel, 9, "ignoring unknown directive '%s'",
-      (char *) parsed_data->cmd->argv[0]);
+  directive = cmd->argv[0];
+  if (strcasecmp(directive, "LintMaxMemory") == 0) {
+    off_t nbytes = 0;
+
+    if (pr_str_get_nbytes(cmd->argv[1], cmd->argc > 2 ? cmd->argv[2] : NULL,
+        &nbytes) == 0) {
+      lint_max_memory = (size_t) nbytes;
+      lint_set_max_memory();
+    }
+
+    return;
+  }
+
+  if (strcasecmp(directive, "LintProfileFile") == 0) {
+    if (lint_profile == NULL) {
+      lint_profile = lint_profile_alloc(lint_pool);
+    }
+
+    lint_profile_path = pstrdup(lint_pool, cmd->argv[1]);
+    return;
+  }
+
+  if (lint_stream != NULL) {
+    return;
+  }
+
+  if (strcasecmp(directive, "LintMode") == 0) {
+    lint_mode = strcasecmp(cmd->argv[1], "passthrough") == 0 ?
+      LINT_MODE_PASSTHROUGH : LINT_MODE_NORMALIZE;
+
+  } else if (strcasecmp(directive, "LintConfigFile") == 0) {
+    lint_stream_path = pstrdup(lint_pool, cmd->argv[1]);
+
+  } else {
+    return;
+  }
+
+  if (lint_mode != LINT_MODE_PASSTHROUGH ||
+      lint_stream_path == NULL) {
     return;
   }
 
+  if (lint_stream_open(lint_stream_path) < 0) {
+    pr_trace_msg(trace_channel, 1,
+      "error streaming to '%s', using normalize mode: %s", lint_stream_path,
+      strerror(errno));
+    lint_mode = LINT_MODE_NORMALIZE;
+  }
+}
+
+/* This runs for every line, on the parser's critical path, thus it only
+ * captures a copy of the line; see lint_resolve_captured() for the rest.
+ */
+static void lint_parsed_line_ev(const void *event_data, void *user_data) {
+  const pr_parsed_line_t *parsed_data;
+  const char *directive;
+
+  parsed_data = event_data;
+
   if (lint_pool == NULL) {
     lint_pool = make_sub_pool(permanent_pool);
     pr_pool_tag(lint_pool, MOD_LINT_VERSION);
     register_cleanup2(lint_pool, NULL, lint_pool_cleanup);
   }
 
-  /* Keep a list of these text lines, in order of appearance.  First phase
-   * is simply to write them back out, in order, generating the single
-   * config file.
-   */
-  if (parsed_lines == NULL) {
-    parsed_lines = xaset_create(lint_pool, NULL);
+  if (lint_alloc_parsed() < 0) {
+    pr_trace_msg(trace_channel, 1, "error allocating parsed lines: %s",
+      strerror(errno));
+    return;
+  }
+
+  if (lint_ingest_start_ns == 0) {
+    lint_ingest_start_ns = lint_perf_now();
   }
 
-  parsed_line = pcalloc(lint_pool, sizeof(struct lint_parsed_line));
-  parsed_line->directive = pstrdup(lint_pool, parsed_data->cmd->argv[0]);
-  parsed_line->handling_module = handling_module;
+  directive = parsed_data->cmd->argv[0];
+  if (*directive == 'L' ||
+      *directive == 'l') {
+    lint_watch_directive(parsed_data->cmd);
+  }
 
-  text = parsed_data->text;
+  if (lint_profile != NULL) {
+    module *m;
 
-  /* Skip past any leading whitespace. */
-  for (; *text && PR_ISSPACE(*text); text++) {
+    m = lint_symtab_get_module(parsed_symbols, directive);
+    (void) lint_profile_add_line(lint_profile, lint_perf_now(),
+      parsed_data->source_file, parsed_data->source_lineno, directive,
+      m != NULL ? m->name : NULL);
   }
 
-  parsed_line->text = pstrdup(lint_pool, text);
+  if (lint_stream != NULL) {
+    const char *text;
 
-  parsed_line->source_file = pstrdup(lint_pool, parsed_data->source_file);
-  parsed_line->source_lineno = parsed_data->source_lineno;
+    lint_perf.counts[LINT_PERF_COUNT_LINES]++;
 
-  xaset_insert_end(parsed_lines, (xasetmember_t *) parsed_line);
+    /* This may be a misspelled/unknown directive; make sure we handle it
+     * accordingly.
+     */
+    lint_perf.counts[LINT_PERF_COUNT_LOOKUPS]++;
+    if (lint_symtab_get_module(parsed_symbols, directive) == NULL) {
+      pr_trace_msg(trace_channel, 9, "ignoring unknown directive '%s'",
+        directive);
+      lint_perf.counts[LINT_PERF_COUNT_UNKNOWN]++;
+      return;
+    }
 
-  if (associated_configs != NULL) {
-    if (associated_configs->nelts > 0) {
-      struct lint_parsed_line *prev_parsed_line;
+    if (lint_is_passthrough_skipped(directive) == TRUE) {
+      pr_trace_msg(trace_channel, 9, "skipping '%s' line in passthrough mode",
+        directive);
+      return;
+    }
 
-      /* Assume that all accumulated configs are associated with the
-       * previous parsed line.
-       */
-      prev_parsed_line = (struct lint_parsed_line *) (((xasetmember_t *) parsed_line)->prev);
-      prev_parsed_line->associated_configs = copy_array(lint_pool,
-        associated_configs);
-      clear_array(associated_configs);
+    text = parsed_data->text;
 
-      pr_trace_msg(trace_channel, 9,
-        "added associated configs (%d) to '%s' parsed line",
-        prev_parsed_line->associated_configs->nelts,
-        prev_parsed_line->directive);
+    /* Skip past any leading whitespace. */
+    for (; *text && PR_ISSPACE(*text); text++) {
     }
 
-  } else {
-    associated_configs = make_array(lint_pool, 0, sizeof(const config_rec **));
+    lint_stream_line(text, strlen(text), parsed_data->source_file,
+      parsed_data->source_lineno);
+    return;
   }
-}
-
-static void lint_postparse_ev(const void *event_data, void *user_data) {
-  int res;
-  config_rec *c;
 
-  /* Watch for any dangling configs, associated with the very last line
-   * parsed.
+  /* A <VirtualHost> line is parsed before its server is created; that is
+   * the server in which the next line is parsed.
    */
-  if (associated_configs != NULL &&
-      associated_configs->nelts > 0) {
-    struct lint_parsed_line *parsed_line;
-
-    /* Assume that all accumulated configs are associated with the
-     * last parsed line.
-     */
-
-    parsed_line = (struct lint_parsed_line *) parsed_lines->xas_list;
-    while (parsed_line != NULL &&
-           parsed_line->next != NULL) {
-      parsed_line = parsed_line->next;
-    }
+  if (lint_vhost_line_pending == TRUE) {
+    (void) lint_capture_set_server(parsed_capture, parsed_data->cmd->server);
+    lint_vhost_line_pending = FALSE;
+  }
 
-    parsed_line->associated_configs = copy_array(lint_pool, associated_configs);
-    clear_array(associated_configs);
+  if (lint_capture_add_line(parsed_capture, parsed_data->text,
+      strlen(parsed_data->text), parsed_data->cmd->server,
+      parsed_data->source_file, parsed_data->source_lineno) < 0) {
+    pr_trace_msg(trace_channel, 1, "error capturing '%s' parsed line: %s",
+      directive, strerror(errno));
+    return;
+  }
 
-    pr_trace_msg(trace_channel, 9,
-      "added associated configs (%d) to '%s' parsed line",
-      parsed_line->associated_configs->nelts, parsed_line->directive);
+  if (*directive == '<' &&
+      lint_is_vhost_directive(directive) == TRUE) {
+    lint_vhost_line_pending = TRUE;
   }
+}
+
+static void lint_postparse_ev(const void *event_data, void *user_data) {
+  int res;
+  config_rec *c;
+  const char *config_path, *state_path = NULL;
+  struct lint_state *state = NULL;
 
   /* At this point in time, we no longer care about parsed lines, as for
    * .ftpaccess files.
@@ -922,10 +3260,27 @@ static void lint_postparse_ev(const void *event_data, void *user_data) {
   pr_event_unregister(&lint_module, "core.added-config", NULL);
   pr_event_unregister(&lint_module, "core.parsed-line", NULL);
 
+  if (lint_ingest_start_ns != 0) {
+    (void) lint_perf_add_time(&lint_perf, LINT_PERF_PHASE_INGEST,
+      lint_ingest_start_ns);
+    lint_ingest_start_ns = 0;
+  }
+
+  if (lint_profile != NULL) {
+    (void) lint_profile_finish(lint_profile, lint_perf_now());
+  }
+
+  lint_resolve_captured();
+
   c = find_config(main_server->conf, CONF_PARAM, "LintEngine", FALSE);
   if (c != NULL) {
     lint_engine = *((int *) c->argv[0]);
     if (lint_engine == FALSE) {
+      if (lint_stream != NULL) {
+        lint_stream_abort();
+      }
+
+      lint_profile = NULL;
       destroy_pool(lint_pool);
       lint_pool = NULL;
 
@@ -933,10 +3288,60 @@ static void lint_postparse_ev(const void *event_data, void *user_data) {
     }
   }
 
+  if (lint_profile != NULL) {
+    lint_write_profile(lint_profile_path);
+    lint_profile = NULL;
+  }
+
   /* At this point in time, the config tree should be usable; servers have
    * been fixed up, etc.
    */
 
+  c = find_config(main_server->conf, CONF_PARAM, "LintOptions", FALSE);
+  while (c != NULL) {
+    unsigned long opts;
+
+    pr_signals_handle();
+
+    opts = *((unsigned long *) c->argv[0]);
+    lint_opts |= opts;
+
+    c = find_config_next(c, c->next, CONF_PARAM, "LintOptions", FALSE);
+  }
+
+  c = find_config(main_server->conf, CONF_PARAM, "LintSyncPolicy", FALSE);
+  if (c != NULL) {
+    lint_sync_policy = *((int *) c->argv[0]);
+  }
+
+  c = find_config(main_server->conf, CONF_PARAM, "LintTimeBudget", FALSE);
+  if (c != NULL) {
+    lint_time_budget = *((uint64_t *) c->argv[0]);
+  }
+
+  c = find_config(main_server->conf, CONF_PARAM, "LintWorkers", FALSE);
+  if (c != NULL) {
+    lint_workers = *((unsigned int *) c->argv[0]);
+  }
+
+  if (lint_stream != NULL) {
+    c = find_config(main_server->conf, CONF_PARAM, "LintStateFile", FALSE);
+    if (c != NULL) {
+      state_path = c->argv[0];
+    }
+
+    config_path = lint_stream->path;
+    if (lint_stream_close(state_path) < 0) {
+      pr_trace_msg(trace_channel, 1, "failed to emit config file to '%s': %s",
+        config_path, strerror(errno));
+    }
+
+    destroy_pool(lint_pool);
+    lint_pool = NULL;
+
+    return;
+  }
+
   c = find_config(main_server->conf, CONF_PARAM, "LintConfigFile", FALSE);
   if (c == NULL) {
     pr_trace_msg(trace_channel, 1, "%s",
@@ -947,15 +3352,66 @@ static void lint_postparse_ev(const void *event_data, void *user_data) {
     return;
   }
 
-  res = lint_write_config(lint_pool, c->argv[0]);
+  config_path = c->argv[0];
+
+  c = find_config(main_server->conf, CONF_PARAM, "LintStateFile", FALSE);
+  if (c != NULL) {
+    state_path = c->argv[0];
+
+  } else if (ServerType == SERVER_INETD) {
+    /* For inetd, the config is parsed for every connection; we do not want
+     * to emit it every time, too.
+     */
+    state_path = pstrcat(lint_pool, config_path, ".state", NULL);
+  }
+
+  /* The numeric config depends on the resolved addresses, which are thus
+   * needed to tell whether the existing config is current.
+   */
+  if (lint_opts & LINT_OPT_NUMERIC_ADDRESSES) {
+    lint_dns = lint_get_dns(lint_pool);
+  }
+
+  if (state_path != NULL) {
+    lint_vhost_cache_path = pstrcat(lint_pool, state_path, ".vhosts", NULL);
+    state = lint_get_config_state(lint_pool);
+
+    if (lint_config_is_current(lint_pool, state, state_path,
+        config_path) == TRUE) {
+      pr_trace_msg(trace_channel, 5,
+        "config unchanged since last run, keeping existing '%s'",
+        config_path);
+      lint_dns = NULL;
+      lint_vhost_cache_path = NULL;
+      destroy_pool(lint_pool);
+      lint_pool = NULL;
+
+      return;
+    }
+  }
+
+  /* Findings are only reported when the config has changed, lest they be
+   * repeated for every inetd connection.
+   */
+  lint_check_rules(lint_pool);
+
+  if (lint_opts & LINT_OPT_BACKGROUND) {
+    res = lint_emit_config_bg(lint_pool, config_path, state, state_path);
+
+  } else {
+    res = lint_emit_config(lint_pool, config_path, state, state_path);
+  }
+
   if (res < 0) {
     pr_trace_msg(trace_channel, 1, "failed to emit config file to '%s': %s",
-      c->argv[0], strerror(errno));
+      config_path, strerror(errno));
   }
 
   /* Once we're done, we can destroy our pool; no need to keep it lingering
    * around.
    */
+  lint_dns = NULL;
+  lint_vhost_cache_path = NULL;
   destroy_pool(lint_pool);
   lint_pool = NULL;
 }
@@ -969,6 +3425,20 @@ static void lint_restart_ev(const void *event_data, void *user_data) {
   pr_event_register(&lint_module, "core.parsed-line", lint_parsed_line_ev,
     NULL);
   lint_engine = TRUE;
+  lint_opts = 0UL;
+  lint_sync_policy = LINT_SYNC_POLICY_NONE;
+  lint_workers = 1;
+  lint_vhost_cache_path = NULL;
+  lint_time_budget = 0;
+  lint_mode = LINT_MODE_NORMALIZE;
+  lint_perf_reset(&lint_perf);
+  lint_ingest_start_ns = 0;
+  lint_vhost_line_pending = FALSE;
+  lint_max_memory = 0;
+  lint_stream_path = NULL;
+  lint_profile_path = NULL;
+  lint_profile = NULL;
+  lint_dns = NULL;
 }
 
 /* Initialization functions
@@ -979,10 +3449,8 @@ static int lint_init(void) {
   pr_pool_tag(lint_pool, MOD_LINT_VERSION);
   register_cleanup2(lint_pool, NULL, lint_pool_cleanup);
 
-#if defined(PR_SHARED_MODULE)
   pr_event_register(&lint_module, "core.module-unload", lint_mod_unload_ev,
     NULL);
-#endif /* PR_SHARED_MODULE */
   pr_event_register(&lint_module, "core.added-config", lint_added_config_ev,
     NULL);
   pr_event_register(&lint_module, "core.parsed-line", lint_parsed_line_ev,
@@ -999,6 +3467,14 @@ static int lint_init(void) {
 static conftable lint_conftab[] = {
   { "LintConfigFile",		set_lintconfigfile, NULL },
   { "LintEngine",		set_lintengine,	NULL },
+  { "LintMaxMemory",		set_lintmaxmemory,	NULL },
+  { "LintMode",			set_lintmode,		NULL },
+  { "LintOptions",		set_lintoptions,	NULL },
+  { "LintProfileFile",		set_lintprofilefile,	NULL },
+  { "LintStateFile",		set_lintstatefile,	NULL },
+  { "LintSyncPolicy",		set_lintsyncpolicy,	NULL },
+  { "LintTimeBudget",		set_linttimebudget,	NULL },
+  { "LintWorkers",		set_lintworkers,	NULL },
   { NULL }
 };
 
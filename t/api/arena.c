@@ -0,0 +1,338 @@
+/*
+ * ProFTPD - mod_lint API testsuite
+ * Copyright (c) 2021 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* Arena API tests. */
+
+#include "tests.h"
+#include "lint/arena.h"
+
+static pool *p = NULL;
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = permanent_pool = make_sub_pool(NULL);
+  }
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.arena", 1, 20);
+  }
+
+  mark_point();
+}
+
+static void tear_down(void) {
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.arena", 0, 0);
+  }
+
+  if (p != NULL) {
+    destroy_pool(p);
+    p = permanent_pool = NULL;
+  }
+}
+
+START_TEST (arena_create_test) {
+  struct lint_arena *arena;
+
+  mark_point();
+  lint_arena_destroy(NULL);
+
+  mark_point();
+  arena = lint_arena_create(0);
+  fail_unless(arena != NULL, "Failed to create arena: %s", strerror(errno));
+  fail_unless(lint_arena_mapped(arena) > 0, "Expected mapped memory");
+
+  lint_arena_destroy(arena);
+}
+END_TEST
+
+START_TEST (arena_alloc_test) {
+  register unsigned int i;
+  struct lint_arena *arena;
+  char *ptr, *ptr2;
+  size_t mapped;
+
+  mark_point();
+  ptr = lint_arena_alloc(NULL, 0);
+  fail_unless(ptr == NULL, "Failed to handle null arena");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  arena = lint_arena_create(4096);
+  mapped = lint_arena_mapped(arena);
+
+  ptr = lint_arena_calloc(arena, 32);
+  fail_unless(ptr != NULL, "Failed to allocate: %s", strerror(errno));
+  for (i = 0; i < 32; i++) {
+    fail_unless(ptr[i] == 0, "Expected zero-filled memory");
+  }
+
+  fail_unless(((unsigned long) ptr % sizeof(void *)) == 0,
+    "Expected aligned allocation");
+
+  ptr2 = lint_arena_alloc(arena, 3);
+  fail_unless(ptr2 != NULL, "Failed to allocate: %s", strerror(errno));
+  fail_unless(ptr2 >= ptr + 32, "Expected distinct allocations");
+
+  /* Exhaust the first chunk. */
+  for (i = 0; i < 1000; i++) {
+    ptr = lint_arena_alloc(arena, 100);
+    fail_unless(ptr != NULL, "Failed to allocate: %s", strerror(errno));
+    memset(ptr, 'A', 100);
+  }
+
+  fail_unless(lint_arena_mapped(arena) > mapped,
+    "Expected additional mappings");
+
+  /* Large allocations get their own mapping. */
+  ptr = lint_arena_alloc(arena, 1024 * 1024);
+  fail_unless(ptr != NULL, "Failed to allocate: %s", strerror(errno));
+  memset(ptr, 'B', 1024 * 1024);
+
+  fail_unless(lint_arena_mapped(arena) > 1024 * 1024,
+    "Expected dedicated mapping");
+
+  lint_arena_destroy(arena);
+}
+END_TEST
+
+START_TEST (arena_strdup_test) {
+  struct lint_arena *arena;
+  char *dup;
+
+  mark_point();
+  dup = lint_arena_strdup(NULL, NULL);
+  fail_unless(dup == NULL, "Failed to handle null arena");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  arena = lint_arena_create(0);
+  dup = lint_arena_strdup(arena, NULL);
+  fail_unless(dup == NULL, "Failed to handle null string");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  dup = lint_arena_strdup(arena, "foo bar");
+  fail_unless(dup != NULL, "Failed to dup string: %s", strerror(errno));
+  fail_unless(strcmp(dup, "foo bar") == 0, "Expected 'foo bar', got '%s'",
+    dup);
+
+  lint_arena_destroy(arena);
+}
+END_TEST
+
+START_TEST (arena_realloc_test) {
+  register unsigned int i;
+  struct lint_arena *arena;
+  uint32_t *ptr, *ptr2;
+  unsigned int nelts = 16;
+  size_t mapped;
+
+  mark_point();
+  ptr = lint_arena_realloc(NULL, NULL, 0, 0);
+  fail_unless(ptr == NULL, "Failed to handle null arena");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  arena = lint_arena_create(0);
+  ptr = lint_arena_realloc(arena, NULL, 0, sizeof(uint32_t) * nelts);
+  fail_unless(ptr != NULL, "Failed to allocate: %s", strerror(errno));
+  for (i = 0; i < nelts; i++) {
+    ptr[i] = i;
+  }
+
+  /* The most recent allocation grows in place. */
+  ptr2 = lint_arena_realloc(arena, ptr, sizeof(uint32_t) * nelts,
+    sizeof(uint32_t) * nelts * 2);
+  fail_unless(ptr2 == ptr, "Expected in-place growth");
+
+  /* Keep growing, past the point of needing dedicated mappings. */
+  while (nelts < 1024 * 1024) {
+    ptr = lint_arena_realloc(arena, ptr, sizeof(uint32_t) * nelts,
+      sizeof(uint32_t) * nelts * 2);
+    fail_unless(ptr != NULL, "Failed to grow to %u elements: %s", nelts * 2,
+      strerror(errno));
+
+    for (i = nelts; i < nelts * 2; i++) {
+      ptr[i] = i;
+    }
+
+    nelts *= 2;
+  }
+
+  for (i = 0; i < nelts; i++) {
+    fail_unless(ptr[i] == i, "Expected %u, got %u", i, ptr[i]);
+  }
+
+  /* Outgrown dedicated mappings are released. */
+  mapped = lint_arena_mapped(arena);
+  fail_unless(mapped < (sizeof(uint32_t) * nelts * 2),
+    "Expected outgrown mappings to be released (mapped %lu)",
+    (unsigned long) mapped);
+
+  lint_arena_destroy(arena);
+}
+END_TEST
+
+START_TEST (arena_spill_test) {
+  register unsigned int i;
+  int res;
+  struct lint_arena *arena;
+  struct lint_arena_stats stats;
+  char *ptrs[32];
+  size_t sz = 64 * 1024;
+
+  mark_point();
+  res = lint_arena_set_spill(NULL, 0, NULL);
+  fail_unless(res < 0, "Failed to handle null arena");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  arena = lint_arena_create(0);
+  fail_unless(arena != NULL, "Failed to create arena: %s", strerror(errno));
+
+  mark_point();
+  res = lint_arena_set_spill(arena, 1024, NULL);
+  fail_unless(res < 0, "Failed to handle null spill dir");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_arena_get_stats(arena, NULL);
+  fail_unless(res < 0, "Failed to handle null stats");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = lint_arena_set_spill(arena, 512 * 1024, "/tmp");
+  fail_unless(res == 0, "Failed to set spill: %s", strerror(errno));
+
+  /* Allocate well past the budget; the contents must survive, whether in
+   * memory or spilled.
+   */
+  for (i = 0; i < 32; i++) {
+    ptrs[i] = lint_arena_calloc(arena, sz);
+    fail_unless(ptrs[i] != NULL, "Failed to allocate: %s", strerror(errno));
+    fail_unless(ptrs[i][0] == 0 && ptrs[i][sz-1] == 0,
+      "Expected zero-filled memory");
+    memset(ptrs[i], 'a' + (i % 26), sz);
+  }
+
+  for (i = 0; i < 32; i++) {
+    fail_unless(ptrs[i][0] == 'a' + (i % 26) &&
+      ptrs[i][sz-1] == 'a' + (i % 26), "Unexpected contents for %u", i);
+  }
+
+  res = lint_arena_get_stats(arena, &stats);
+  fail_unless(res == 0, "Failed to get stats: %s", strerror(errno));
+  fail_unless(stats.spilled > 0, "Expected spilled bytes");
+  fail_unless(stats.mapped - stats.spilled <= 512 * 1024,
+    "Expected at most %lu bytes in memory, got %lu", 512UL * 1024,
+    (unsigned long) (stats.mapped - stats.spilled));
+  fail_unless(stats.peak_mapped <= 512 * 1024,
+    "Expected peak of at most %lu bytes, got %lu", 512UL * 1024,
+    (unsigned long) stats.peak_mapped);
+  fail_unless(stats.peak_spilled >= stats.spilled, "Unexpected spill peak");
+
+  /* Growing a spilled allocation keeps its contents. */
+  mark_point();
+  ptrs[0] = lint_arena_realloc(arena, ptrs[31], sz, sz * 4);
+  fail_unless(ptrs[0] != NULL, "Failed to realloc: %s", strerror(errno));
+  fail_unless(ptrs[0][sz-1] == 'a' + (31 % 26), "Unexpected contents");
+
+  lint_arena_destroy(arena);
+}
+END_TEST
+
+START_TEST (arena_detach_test) {
+  int res, status;
+  struct lint_arena *arena;
+  char *ptr;
+  pid_t pid;
+  size_t sz = 512 * 1024;
+
+  mark_point();
+  res = lint_arena_detach(NULL);
+  fail_unless(res < 0, "Failed to handle null arena");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  arena = lint_arena_create(0);
+  res = lint_arena_detach(arena);
+  fail_unless(res == 0, "Failed to detach unspilled arena: %s",
+    strerror(errno));
+
+  res = lint_arena_set_spill(arena, 256 * 1024, "/tmp");
+  fail_unless(res == 0, "Failed to set spill: %s", strerror(errno));
+
+  ptr = lint_arena_alloc(arena, sz);
+  fail_unless(ptr != NULL, "Failed to allocate: %s", strerror(errno));
+  memset(ptr, 'A', sz);
+
+  /* A detached child's writes are not seen by its parent. */
+  pid = fork();
+  fail_unless(pid >= 0, "Failed to fork: %s", strerror(errno));
+
+  if (pid == 0) {
+    if (lint_arena_detach(arena) < 0 ||
+        ptr[0] != 'A') {
+      _exit(1);
+    }
+
+    memset(ptr, 'B', sz);
+    _exit(lint_arena_alloc(arena, sz) != NULL ? 0 : 1);
+  }
+
+  fail_unless(waitpid(pid, &status, 0) == pid, "Failed to wait: %s",
+    strerror(errno));
+  fail_unless(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+    "Child failed to detach");
+  fail_unless(ptr[0] == 'A' && ptr[sz-1] == 'A',
+    "Expected parent's memory to be unchanged");
+
+  lint_arena_destroy(arena);
+}
+END_TEST
+
+Suite *tests_get_arena_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("arena");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, arena_create_test);
+  tcase_add_test(testcase, arena_alloc_test);
+  tcase_add_test(testcase, arena_strdup_test);
+  tcase_add_test(testcase, arena_realloc_test);
+  tcase_add_test(testcase, arena_spill_test);
+  tcase_add_test(testcase, arena_detach_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
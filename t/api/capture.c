@@ -0,0 +1,360 @@
+/*
+ * ProFTPD - mod_lint API testsuite
+ * Copyright (c) 2021 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* Capture API tests. */
+
+#include "tests.h"
+#include "lint/capture.h"
+
+static pool *p = NULL;
+static struct lint_arena *arena = NULL;
+
+/* Tracks what a visit saw. */
+struct visit_state {
+  unsigned int nlines;
+  unsigned int nconfigs;
+  unsigned int last_lineno;
+  const char *last_file;
+  server_rec *servers[8];
+  unsigned int config_linenos[8];
+  int stop_after;
+};
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = permanent_pool = make_sub_pool(NULL);
+  }
+
+  if (arena == NULL) {
+    arena = lint_arena_create(0);
+  }
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.capture", 1, 20);
+  }
+
+  mark_point();
+}
+
+static void tear_down(void) {
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.capture", 0, 0);
+  }
+
+  if (arena != NULL) {
+    lint_arena_destroy(arena);
+    arena = NULL;
+  }
+
+  if (p != NULL) {
+    destroy_pool(p);
+    p = permanent_pool = NULL;
+  }
+}
+
+static int visit_line(void *data, const char *text, size_t textsz,
+    server_rec *s, const char *source_file, unsigned int source_lineno) {
+  struct visit_state *state;
+  char expected[64];
+
+  state = data;
+
+  pr_snprintf(expected, sizeof(expected), "Directive%u value",
+    source_lineno);
+  if (strlen(text) != textsz ||
+      strcmp(text, expected) != 0) {
+    return -1;
+  }
+
+  if (state->nlines < 8) {
+    state->servers[state->nlines] = s;
+  }
+
+  state->nlines++;
+  state->last_lineno = source_lineno;
+  state->last_file = source_file;
+
+  if (state->stop_after > 0 &&
+      state->nlines == (unsigned int) state->stop_after) {
+    return -1;
+  }
+
+  return 0;
+}
+
+static int visit_config(void *data, const config_rec *c) {
+  struct visit_state *state;
+
+  state = data;
+  if (state->nconfigs < 8) {
+    state->config_linenos[state->nconfigs] = state->last_lineno;
+  }
+
+  state->nconfigs++;
+  return 0;
+}
+
+START_TEST (capture_alloc_test) {
+  struct lint_capture *cap;
+
+  mark_point();
+  cap = lint_capture_alloc(NULL);
+  fail_unless(cap == NULL, "Failed to handle null arena");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  cap = lint_capture_alloc(arena);
+  fail_unless(cap != NULL, "Failed to allocate capture: %s", strerror(errno));
+  fail_unless(lint_capture_count(cap) == 0, "Expected empty capture");
+}
+END_TEST
+
+START_TEST (capture_add_line_test) {
+  register unsigned int i;
+  int res;
+  struct lint_capture *cap;
+  struct lint_capture_visitor visitor;
+  struct visit_state state;
+  char text[64], *file;
+
+  cap = lint_capture_alloc(arena);
+
+  mark_point();
+  res = lint_capture_add_line(NULL, NULL, 0, NULL, NULL, 0);
+  fail_unless(res < 0, "Failed to handle null capture");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_capture_add_line(cap, NULL, 0, NULL, NULL, 0);
+  fail_unless(res < 0, "Failed to handle null text");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* Enough lines to span several record and text chunks.  The text and
+   * file buffers are reused, as the parser's are, so the capture must copy
+   * them.
+   */
+  file = pstrdup(p, "/etc/proftpd/a.conf");
+  for (i = 1; i <= 10000; i++) {
+    size_t textsz;
+
+    if (i == 5001) {
+      sstrncpy(file, "/etc/proftpd/b.conf", strlen(file) + 1);
+    }
+
+    textsz = pr_snprintf(text, sizeof(text), "Directive%u value", i);
+    res = lint_capture_add_line(cap, text, textsz, NULL, file, i);
+    fail_unless(res == 0, "Failed to capture line: %s", strerror(errno));
+  }
+
+  fail_unless(lint_capture_count(cap) == 10000, "Expected 10000, got %u",
+    lint_capture_count(cap));
+
+  mark_point();
+  memset(&state, 0, sizeof(state));
+  visitor.line = visit_line;
+  visitor.config = visit_config;
+
+  res = lint_capture_visit(cap, &visitor, &state);
+  fail_unless(res == 0, "Failed to visit capture: %s", strerror(errno));
+  fail_unless(state.nlines == 10000, "Expected 10000 lines, got %u",
+    state.nlines);
+  fail_unless(strcmp(state.last_file, "/etc/proftpd/b.conf") == 0,
+    "Expected '/etc/proftpd/b.conf', got '%s'", state.last_file);
+
+  /* Visiting stops when a callback fails. */
+  mark_point();
+  memset(&state, 0, sizeof(state));
+  state.stop_after = 3;
+
+  res = lint_capture_visit(cap, &visitor, &state);
+  fail_unless(res < 0, "Failed to stop visiting");
+  fail_unless(state.nlines == 3, "Expected 3 lines, got %u", state.nlines);
+}
+END_TEST
+
+START_TEST (capture_add_config_test) {
+  register unsigned int i;
+  int res;
+  struct lint_capture *cap;
+  struct lint_capture_visitor visitor;
+  struct visit_state state;
+  config_rec *c;
+  char text[64];
+
+  cap = lint_capture_alloc(arena);
+  c = pcalloc(p, sizeof(config_rec));
+
+  mark_point();
+  res = lint_capture_add_config(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null capture");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_capture_add_config(cap, c);
+  fail_unless(res < 0, "Failed to handle config without line");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  /* Two configs after line 1, none after line 2, one after line 3; then
+   * enough configs to span chunks.
+   */
+  for (i = 1; i <= 3; i++) {
+    size_t textsz;
+
+    textsz = pr_snprintf(text, sizeof(text), "Directive%u value", i);
+    res = lint_capture_add_line(cap, text, textsz, NULL,
+      "/etc/proftpd.conf", i);
+    fail_unless(res == 0, "Failed to capture line: %s", strerror(errno));
+
+    if (i == 1) {
+      lint_capture_add_config(cap, c);
+      lint_capture_add_config(cap, c);
+
+    } else if (i == 3) {
+      for (res = 0; res < 5000; res++) {
+        fail_unless(lint_capture_add_config(cap, c) == 0,
+          "Failed to capture config: %s", strerror(errno));
+      }
+    }
+  }
+
+  mark_point();
+  memset(&state, 0, sizeof(state));
+  visitor.line = visit_line;
+  visitor.config = visit_config;
+
+  res = lint_capture_visit(cap, &visitor, &state);
+  fail_unless(res == 0, "Failed to visit capture: %s", strerror(errno));
+  fail_unless(state.nconfigs == 5002, "Expected 5002 configs, got %u",
+    state.nconfigs);
+  fail_unless(state.config_linenos[0] == 1, "Expected line 1, got %u",
+    state.config_linenos[0]);
+  fail_unless(state.config_linenos[1] == 1, "Expected line 1, got %u",
+    state.config_linenos[1]);
+  fail_unless(state.config_linenos[2] == 3, "Expected line 3, got %u",
+    state.config_linenos[2]);
+}
+END_TEST
+
+START_TEST (capture_set_server_test) {
+  register unsigned int i;
+  int res;
+  struct lint_capture *cap;
+  struct lint_capture_visitor visitor;
+  struct visit_state state;
+  server_rec *main_srv, *vhost_srv;
+  char text[64];
+
+  cap = lint_capture_alloc(arena);
+  main_srv = pcalloc(p, sizeof(server_rec));
+  vhost_srv = pcalloc(p, sizeof(server_rec));
+
+  mark_point();
+  res = lint_capture_set_server(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null capture");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_capture_set_server(cap, vhost_srv);
+  fail_unless(res < 0, "Failed to handle server without line");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  /* Line 2 opens a section whose server is only known once line 3 is
+   * parsed.
+   */
+  for (i = 1; i <= 3; i++) {
+    size_t textsz;
+
+    if (i == 3) {
+      res = lint_capture_set_server(cap, vhost_srv);
+      fail_unless(res == 0, "Failed to set server: %s", strerror(errno));
+    }
+
+    textsz = pr_snprintf(text, sizeof(text), "Directive%u value", i);
+    res = lint_capture_add_line(cap, text, textsz,
+      i == 3 ? vhost_srv : main_srv, "/etc/proftpd.conf", i);
+    fail_unless(res == 0, "Failed to capture line: %s", strerror(errno));
+  }
+
+  mark_point();
+  memset(&state, 0, sizeof(state));
+  visitor.line = visit_line;
+  visitor.config = visit_config;
+
+  res = lint_capture_visit(cap, &visitor, &state);
+  fail_unless(res == 0, "Failed to visit capture: %s", strerror(errno));
+  fail_unless(state.servers[0] == main_srv, "Expected main server for line 1");
+  fail_unless(state.servers[1] == vhost_srv, "Expected vhost for line 2");
+  fail_unless(state.servers[2] == vhost_srv, "Expected vhost for line 3");
+}
+END_TEST
+
+START_TEST (capture_long_line_test) {
+  int res;
+  struct lint_capture *cap;
+  char *text;
+  size_t textsz = 256 * 1024;
+
+  cap = lint_capture_alloc(arena);
+
+  /* Lines longer than a text chunk get their own allocation. */
+  text = pcalloc(p, textsz + 1);
+  memset(text, 'A', textsz);
+
+  mark_point();
+  res = lint_capture_add_line(cap, text, textsz, NULL, "/etc/proftpd.conf",
+    1);
+  fail_unless(res == 0, "Failed to capture long line: %s", strerror(errno));
+
+  res = lint_capture_add_line(cap, "Foo bar", 7, NULL, "/etc/proftpd.conf", 2);
+  fail_unless(res == 0, "Failed to capture line: %s", strerror(errno));
+  fail_unless(lint_capture_count(cap) == 2, "Expected 2, got %u",
+    lint_capture_count(cap));
+}
+END_TEST
+
+Suite *tests_get_capture_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("capture");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, capture_alloc_test);
+  tcase_add_test(testcase, capture_add_line_test);
+  tcase_add_test(testcase, capture_add_config_test);
+  tcase_add_test(testcase, capture_set_server_test);
+  tcase_add_test(testcase, capture_long_line_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
@@ -46,6 +46,8 @@ static void tear_down(void) {
     pr_trace_set_levels("lint.cop", 0, 0);
   }
 
+  lint_cop_free();
+
   if (p != NULL) {
     destroy_pool(p);
     p = permanent_pool = NULL;
@@ -57,28 +59,28 @@ START_TEST (cop_get_config_cop_test) {
   config_rec *c;
 
   mark_point();
-  cop = lint_cop_get_config_cop(NULL);
+  cop = lint_cop_get_config_cop(NULL, NULL);
   fail_unless(cop == NULL, "Failed to handle null config");
   fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
     strerror(errno), errno);
 
   mark_point();
   c = pcalloc(p, sizeof(config_rec));
-  cop = lint_cop_get_config_cop(c);
+  cop = lint_cop_get_config_cop(c, NULL);
   fail_unless(cop == NULL, "Failed to handle null config");
   fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
     strerror(errno), errno);
 
   mark_point();
   c->name = pstrdup(p, "LintEngine");
-  cop = lint_cop_get_config_cop(c);
+  cop = lint_cop_get_config_cop(c, NULL);
   fail_unless(cop == NULL, "Failed to handle null config");
   fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
     strerror(errno), errno);
 
   mark_point();
   c->config_type = CONF_PARAM;
-  cop = lint_cop_get_config_cop(c);
+  cop = lint_cop_get_config_cop(c, NULL);
   fail_unless(cop == NULL, "Failed to handle unknown config");
   fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
     strerror(errno), errno);
@@ -89,40 +91,43 @@ START_TEST (cop_get_module_cop_test) {
   const struct lint_cop *cop;
 
   mark_point();
-  cop = lint_cop_get_module_cop(NULL);
+  cop = lint_cop_get_module_cop(NULL, NULL);
   fail_unless(cop == NULL, "Failed to handle null module");
   fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
     strerror(errno), errno);
 
   mark_point();
-  cop = lint_cop_get_module_cop(&lint_module);
+  cop = lint_cop_get_module_cop(&lint_module, NULL);
   fail_unless(cop != NULL, "Failed to handle lint module: %s", strerror(errno));
 }
 END_TEST
 
 START_TEST (cop_get_directive_test) {
   const struct lint_cop *cop;
+  struct lint_cop_ctx ctx;
   const char *res;
   config_rec *c;
 
   mark_point();
   res = lint_cop_get_directive(NULL, NULL, NULL);
-  fail_unless(res == NULL, "Failed to handle null cop");
+  fail_unless(res == NULL, "Failed to handle null context");
   fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
     strerror(errno), errno);
 
   mark_point();
-  cop = lint_cop_get_module_cop(&lint_module);
+  cop = lint_cop_get_module_cop(&lint_module, &ctx);
   fail_unless(cop != NULL, "Failed to handle lint module: %s", strerror(errno));
+  fail_unless(ctx.cop == cop, "Expected cop in context");
+  fail_unless(ctx.m == &lint_module, "Expected module in context");
 
   mark_point();
-  res = lint_cop_get_directive(cop, NULL, NULL);
+  res = lint_cop_get_directive(&ctx, NULL, NULL);
   fail_unless(res == NULL, "Failed to handle null pool");
   fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
     strerror(errno), errno);
 
   mark_point();
-  res = lint_cop_get_directive(cop, p, NULL);
+  res = lint_cop_get_directive(&ctx, p, NULL);
   fail_unless(res == NULL, "Failed to handle null config");
   fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
     strerror(errno), errno);
@@ -131,13 +136,200 @@ START_TEST (cop_get_directive_test) {
   c = pcalloc(p, sizeof(config_rec));
   c->config_type = CONF_PARAM;
   c->name = "FooBar";
-  res = lint_cop_get_directive(cop, p, c);
+  res = lint_cop_get_directive(&ctx, p, c);
   fail_unless(res != NULL, "Failed to get directive: %s", strerror(errno));
   fail_unless(strcmp(res, c->name) == 0,
     "Expected '%s', got '%s'", c->name, res);
 }
 END_TEST
 
+START_TEST (cop_get_core_directive_test) {
+  const struct lint_cop *cop;
+  struct lint_cop_ctx ctx;
+  const char *res;
+  config_rec *c;
+
+  mark_point();
+  c = pcalloc(p, sizeof(config_rec));
+  c->config_type = CONF_PARAM;
+  c->name = pstrdup(p, "UserName");
+
+  cop = lint_cop_get_config_cop(c, &ctx);
+  fail_unless(cop != NULL, "Failed to get cop for %s: %s", c->name,
+    strerror(errno));
+
+  res = lint_cop_get_directive(&ctx, p, c);
+  fail_unless(res != NULL, "Failed to get directive: %s", strerror(errno));
+  fail_unless(strcmp(res, "User") == 0, "Expected 'User', got '%s'", res);
+
+  mark_point();
+  c->name = pstrdup(p, "GroupName");
+  res = lint_cop_get_directive(&ctx, p, c);
+  fail_unless(res != NULL, "Failed to get directive: %s", strerror(errno));
+  fail_unless(strcmp(res, "Group") == 0, "Expected 'Group', got '%s'", res);
+
+  mark_point();
+  c->name = pstrdup(p, "UserID");
+  res = lint_cop_get_directive(&ctx, p, c);
+  fail_unless(res == NULL, "Expected no directive for %s", c->name);
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  c->name = pstrdup(p, "DirUmask");
+  res = lint_cop_get_directive(&ctx, p, c);
+  fail_unless(res == NULL, "Expected no directive for %s", c->name);
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  c->name = pstrdup(p, "ServerName");
+  res = lint_cop_get_directive(&ctx, p, c);
+  fail_unless(res != NULL, "Failed to get directive: %s", strerror(errno));
+  fail_unless(strcmp(res, c->name) == 0, "Expected '%s', got '%s'", c->name,
+    res);
+}
+END_TEST
+
+static const char *test_get_directive(pool *cop_pool,
+    const struct lint_cop_ctx *ctx, config_rec *c) {
+  return "TestDirective";
+}
+
+static const struct lint_cop test_cop = {
+  "test", test_get_directive
+};
+
+START_TEST (cop_register_test) {
+  int res;
+  module m;
+  const struct lint_cop *cop;
+  config_rec *c;
+
+  memset(&m, 0, sizeof(m));
+  m.name = "test";
+
+  mark_point();
+  res = lint_cop_register(NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null module");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_cop_register(&m, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null cop");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_cop_unregister(&m, NULL);
+  fail_unless(res < 0, "Failed to handle unregistered cop");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_cop_register(&m, NULL, &test_cop);
+  fail_unless(res == 0, "Failed to register cop: %s", strerror(errno));
+
+  res = lint_cop_register(&m, NULL, &test_cop);
+  fail_unless(res < 0, "Failed to handle duplicate registration");
+  fail_unless(errno == EEXIST, "Expected EEXIST (%d), got %s (%d)", EEXIST,
+    strerror(errno), errno);
+
+  cop = lint_cop_get_module_cop(&m, NULL);
+  fail_unless(cop == &test_cop, "Expected registered cop");
+
+  mark_point();
+  c = pcalloc(p, sizeof(config_rec));
+  c->config_type = CONF_PARAM;
+  c->name = pstrdup(p, "TestInternalName");
+
+  cop = lint_cop_get_config_cop(c, NULL);
+  fail_unless(cop == NULL, "Failed to handle unknown config");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  res = lint_cop_register(&m, c->name, &test_cop);
+  fail_unless(res == 0, "Failed to register cop: %s", strerror(errno));
+
+  cop = lint_cop_get_config_cop(c, NULL);
+  fail_unless(cop == &test_cop, "Expected registered cop");
+
+  mark_point();
+  res = lint_cop_unregister(&m, c->name);
+  fail_unless(res == 0, "Failed to unregister cop: %s", strerror(errno));
+
+  cop = lint_cop_get_config_cop(c, NULL);
+  fail_unless(cop == NULL, "Expected no cop after unregistering");
+
+  res = lint_cop_unregister(&m, NULL);
+  fail_unless(res == 0, "Failed to unregister cop: %s", strerror(errno));
+
+  cop = lint_cop_get_module_cop(&m, NULL);
+  fail_unless(cop != &test_cop, "Expected default cop after unregistering");
+}
+END_TEST
+
+START_TEST (cop_unregister_module_test) {
+  int res;
+  module m;
+  const struct lint_cop *cop;
+
+  memset(&m, 0, sizeof(m));
+  m.name = "test";
+
+  mark_point();
+  res = lint_cop_unregister_module(NULL);
+  fail_unless(res < 0, "Failed to handle null module");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_cop_unregister_module("mod_test.c");
+  fail_unless(res == 0, "Expected 0 cops, got %d", res);
+
+  (void) lint_cop_register(&m, NULL, &test_cop);
+  (void) lint_cop_register(&m, "TestA", &test_cop);
+  (void) lint_cop_register(&m, "TestB", &test_cop);
+
+  mark_point();
+  res = lint_cop_unregister_module("mod_other.c");
+  fail_unless(res == 0, "Expected 0 cops, got %d", res);
+
+  res = lint_cop_unregister_module("mod_test.c");
+  fail_unless(res == 3, "Expected 3 cops, got %d", res);
+
+  cop = lint_cop_get_module_cop(&m, NULL);
+  fail_unless(cop != &test_cop, "Expected default cop after unloading");
+}
+END_TEST
+
+START_TEST (cop_ctx_test) {
+  module m1, m2;
+  const struct lint_cop *cop1, *cop2;
+  struct lint_cop_ctx ctx1, ctx2;
+
+  memset(&m1, 0, sizeof(m1));
+  m1.name = "test1";
+  memset(&m2, 0, sizeof(m2));
+  m2.name = "test2";
+
+  /* Both modules share the default cop, but each lookup has its own
+   * module context.
+   */
+  mark_point();
+  cop1 = lint_cop_get_module_cop(&m1, &ctx1);
+  fail_unless(cop1 != NULL, "Failed to get cop: %s", strerror(errno));
+
+  cop2 = lint_cop_get_module_cop(&m2, &ctx2);
+  fail_unless(cop2 != NULL, "Failed to get cop: %s", strerror(errno));
+
+  fail_unless(cop1 == cop2, "Expected the same (default) cop");
+  fail_unless(ctx1.m == &m1, "Expected first module in first context");
+  fail_unless(ctx2.m == &m2, "Expected second module in second context");
+}
+END_TEST
+
 Suite *tests_get_cop_suite(void) {
   Suite *suite;
   TCase *testcase;
@@ -151,6 +343,10 @@ Suite *tests_get_cop_suite(void) {
   tcase_add_test(testcase, cop_get_module_cop_test);
 
   tcase_add_test(testcase, cop_get_directive_test);
+  tcase_add_test(testcase, cop_get_core_directive_test);
+  tcase_add_test(testcase, cop_ctx_test);
+  tcase_add_test(testcase, cop_register_test);
+  tcase_add_test(testcase, cop_unregister_module_test);
 
   suite_add_tcase(suite, testcase);
   return suite;
@@ -0,0 +1,316 @@
+/*
+ * ProFTPD - mod_lint API testsuite
+ * Copyright (c) 2021 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+/* DNS API tests. */
+
+#include "tests.h"
+#include "lint/dns.h"
+
+static pool *p = NULL;
+
+static const char *src_path = "/tmp/lint-test-dns.conf";
+static const char *dst_path = "/tmp/lint-test-dns.conf.numeric";
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = permanent_pool = make_sub_pool(NULL);
+  }
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.dns", 1, 20);
+  }
+
+  mark_point();
+}
+
+static void tear_down(void) {
+  (void) unlink(src_path);
+  (void) unlink(dst_path);
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.dns", 0, 0);
+  }
+
+  if (p != NULL) {
+    destroy_pool(p);
+    p = permanent_pool = NULL;
+  }
+}
+
+START_TEST (dns_parse_line_test) {
+  array_header *args;
+  char **elts;
+
+  mark_point();
+  args = lint_dns_parse_line(NULL, NULL);
+  fail_unless(args == NULL, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  args = lint_dns_parse_line(p, NULL);
+  fail_unless(args == NULL, "Failed to handle null text");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  args = lint_dns_parse_line(p, "ServerName \"ftp.example.com\"");
+  fail_unless(args == NULL, "Failed to handle non-address directive");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  /* Only the full directive name matches. */
+  args = lint_dns_parse_line(p, "BindFoo ftp.example.com");
+  fail_unless(args == NULL, "Failed to handle non-address directive");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  args = lint_dns_parse_line(p,
+    "  <VirtualHost ftp.example.com 10.0.0.1 \"ftp2.example.com\">");
+  fail_unless(args != NULL, "Failed to parse line: %s", strerror(errno));
+  fail_unless(args->nelts == 3, "Expected 3 args, got %u", args->nelts);
+
+  elts = args->elts;
+  fail_unless(strcmp(elts[0], "ftp.example.com") == 0,
+    "Expected 'ftp.example.com', got '%s'", elts[0]);
+  fail_unless(strcmp(elts[1], "10.0.0.1") == 0,
+    "Expected '10.0.0.1', got '%s'", elts[1]);
+  fail_unless(strcmp(elts[2], "ftp2.example.com") == 0,
+    "Expected 'ftp2.example.com', got '%s'", elts[2]);
+
+  mark_point();
+  args = lint_dns_parse_line(p, "defaultaddress localhost");
+  fail_unless(args != NULL, "Failed to parse line: %s", strerror(errno));
+  fail_unless(args->nelts == 1, "Expected 1 arg, got %u", args->nelts);
+}
+END_TEST
+
+START_TEST (dns_is_name_test) {
+  mark_point();
+  fail_unless(lint_dns_is_name(NULL) == FALSE, "Failed to handle null");
+  fail_unless(lint_dns_is_name("127.0.0.1") == FALSE,
+    "Expected IPv4 address to be numeric");
+  fail_unless(lint_dns_is_name("::1") == FALSE,
+    "Expected IPv6 address to be numeric");
+  fail_unless(lint_dns_is_name("[2001:db8::1]") == FALSE,
+    "Expected bracketed IPv6 address to be numeric");
+  fail_unless(lint_dns_is_name("localhost") == TRUE,
+    "Expected 'localhost' to be a name");
+  fail_unless(lint_dns_is_name("ftp.example.com") == TRUE,
+    "Expected 'ftp.example.com' to be a name");
+  fail_unless(lint_dns_is_name("[foo]") == TRUE,
+    "Expected '[foo]' to be a name");
+}
+END_TEST
+
+START_TEST (dns_add_name_test) {
+  int res;
+  struct lint_dns *dns;
+  const char *addr;
+
+  mark_point();
+  dns = lint_dns_alloc(NULL);
+  fail_unless(dns == NULL, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  dns = lint_dns_alloc(p);
+  fail_unless(dns != NULL, "Failed to allocate: %s", strerror(errno));
+  fail_unless(lint_dns_count(dns) == 0, "Expected no names");
+
+  mark_point();
+  res = lint_dns_add_name(NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null dns");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = lint_dns_add_name(dns, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null name");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_dns_add_name(dns, "FTP.example.com", NULL);
+  fail_unless(res == 0, "Failed to add name: %s", strerror(errno));
+
+  addr = lint_dns_get_addr(dns, "ftp.example.com");
+  fail_unless(addr == NULL, "Expected no address, got '%s'", addr);
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  /* A later resolution of the same name fills in the address. */
+  res = lint_dns_add_name(dns, "ftp.example.com", "192.0.2.1");
+  fail_unless(res == 0, "Failed to add name: %s", strerror(errno));
+  fail_unless(lint_dns_count(dns) == 1, "Expected 1 name, got %u",
+    lint_dns_count(dns));
+
+  addr = lint_dns_get_addr(dns, "ftp.EXAMPLE.com");
+  fail_unless(addr != NULL, "Failed to get address: %s", strerror(errno));
+  fail_unless(strcmp(addr, "192.0.2.1") == 0,
+    "Expected '192.0.2.1', got '%s'", addr);
+
+  mark_point();
+  addr = lint_dns_get_addr(NULL, NULL);
+  fail_unless(addr == NULL, "Failed to handle null dns");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+}
+END_TEST
+
+START_TEST (dns_hash_test) {
+  int res;
+  struct lint_dns *dns, *dns2;
+  uint64_t hash, hash2;
+
+  mark_point();
+  res = lint_dns_hash(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null dns");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  dns = lint_dns_alloc(p);
+  res = lint_dns_hash(dns, NULL);
+  fail_unless(res < 0, "Failed to handle null hash");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* The order in which names are added does not matter. */
+  mark_point();
+  (void) lint_dns_add_name(dns, "ftp.example.com", "192.0.2.1");
+  (void) lint_dns_add_name(dns, "vhost.example.com", "192.0.2.2");
+  res = lint_dns_hash(dns, &hash);
+  fail_unless(res == 0, "Failed to hash: %s", strerror(errno));
+
+  dns2 = lint_dns_alloc(p);
+  (void) lint_dns_add_name(dns2, "VHOST.example.com", "192.0.2.2");
+  (void) lint_dns_add_name(dns2, "ftp.example.com", "192.0.2.1");
+  res = lint_dns_hash(dns2, &hash2);
+  fail_unless(res == 0, "Failed to hash: %s", strerror(errno));
+  fail_unless(hash == hash2, "Expected %016llx, got %016llx",
+    (unsigned long long) hash, (unsigned long long) hash2);
+
+  /* But the addresses to which they resolved do. */
+  mark_point();
+  dns2 = lint_dns_alloc(p);
+  (void) lint_dns_add_name(dns2, "ftp.example.com", "192.0.2.1");
+  (void) lint_dns_add_name(dns2, "vhost.example.com", "192.0.2.3");
+  res = lint_dns_hash(dns2, &hash2);
+  fail_unless(res == 0, "Failed to hash: %s", strerror(errno));
+  fail_unless(hash != hash2, "Expected different hashes, got %016llx",
+    (unsigned long long) hash);
+
+  dns2 = lint_dns_alloc(p);
+  (void) lint_dns_add_name(dns2, "ftp.example.com", "192.0.2.1");
+  (void) lint_dns_add_name(dns2, "vhost.example.com", NULL);
+  res = lint_dns_hash(dns2, &hash2);
+  fail_unless(res == 0, "Failed to hash: %s", strerror(errno));
+  fail_unless(hash != hash2, "Expected different hashes, got %016llx",
+    (unsigned long long) hash);
+}
+END_TEST
+
+START_TEST (dns_write_numeric_test) {
+  int fd, res;
+  struct lint_dns *dns;
+  char buf[1024];
+  ssize_t len;
+  const char *text =
+    "# Server Config\n"
+    "DefaultAddress ftp.example.com\n"
+    "ServerName \"ftp.example.com\"\n"
+    "  <VirtualHost 10.0.0.1 vhost.example.com unresolved.example.com>\n"
+    "    Bind vhost.example.com\n"
+    "  </VirtualHost>\n";
+  const char *expected =
+    "# Server Config\n"
+    "DefaultAddress 192.0.2.1\n"
+    "ServerName \"ftp.example.com\"\n"
+    "  <VirtualHost 10.0.0.1 192.0.2.2 unresolved.example.com>\n"
+    "    Bind 192.0.2.2\n"
+    "  </VirtualHost>\n";
+
+  mark_point();
+  res = lint_dns_write_numeric(NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null dns");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  dns = lint_dns_alloc(p);
+  res = lint_dns_write_numeric(dns, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null source path");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_dns_write_numeric(dns, src_path, dst_path);
+  fail_unless(res < 0, "Failed to handle missing source file");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  fd = open(src_path, O_CREAT|O_WRONLY|O_TRUNC, 0644);
+  fail_unless(fd >= 0, "Failed to open '%s': %s", src_path, strerror(errno));
+  fail_unless(write(fd, text, strlen(text)) == (ssize_t) strlen(text),
+    "Failed to write '%s': %s", src_path, strerror(errno));
+  (void) close(fd);
+
+  (void) lint_dns_add_name(dns, "ftp.example.com", "192.0.2.1");
+  (void) lint_dns_add_name(dns, "vhost.example.com", "192.0.2.2");
+  (void) lint_dns_add_name(dns, "unresolved.example.com", NULL);
+
+  mark_point();
+  res = lint_dns_write_numeric(dns, src_path, dst_path);
+  fail_unless(res == 3, "Expected 3 substitutions, got %d (%s)", res,
+    strerror(errno));
+
+  fd = open(dst_path, O_RDONLY);
+  fail_unless(fd >= 0, "Failed to open '%s': %s", dst_path, strerror(errno));
+  len = read(fd, buf, sizeof(buf)-1);
+  (void) close(fd);
+  fail_unless(len > 0, "Failed to read '%s': %s", dst_path, strerror(errno));
+  buf[len] = '\0';
+
+  fail_unless(strcmp(buf, expected) == 0, "Expected '%s', got '%s'",
+    expected, buf);
+}
+END_TEST
+
+Suite *tests_get_dns_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("dns");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, dns_parse_line_test);
+  tcase_add_test(testcase, dns_is_name_test);
+  tcase_add_test(testcase, dns_add_name_test);
+  tcase_add_test(testcase, dns_hash_test);
+  tcase_add_test(testcase, dns_write_numeric_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
@@ -0,0 +1,161 @@
+/*
+ * ProFTPD - mod_lint API testsuite
+ * Copyright (c) 2021 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* Hash API tests. */
+
+#include "tests.h"
+#include "lint/hash.h"
+
+static pool *p = NULL;
+
+static const char *hash_path = "/tmp/lint-test-hash.conf";
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = permanent_pool = make_sub_pool(NULL);
+  }
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.hash", 1, 20);
+  }
+
+  mark_point();
+}
+
+static void tear_down(void) {
+  (void) unlink(hash_path);
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.hash", 0, 0);
+  }
+
+  if (p != NULL) {
+    destroy_pool(p);
+    p = permanent_pool = NULL;
+  }
+}
+
+static int write_file(const char *path, const char *text) {
+  int fd, res;
+
+  fd = open(path, O_CREAT|O_WRONLY|O_TRUNC, 0644);
+  if (fd < 0) {
+    return -1;
+  }
+
+  res = write(fd, text, strlen(text));
+  (void) close(fd);
+  return res;
+}
+
+START_TEST (hash_data_test) {
+  uint64_t hash;
+
+  mark_point();
+  hash = lint_hash_data("", 0);
+  fail_unless(hash == LINT_HASH_INIT, "Unexpected hash for empty data");
+
+  mark_point();
+  hash = lint_hash_data("a", 1);
+  fail_unless(hash == 0xaf63dc4c8601ec8cULL, "Unexpected hash for 'a'");
+
+  mark_point();
+  hash = lint_hash_data("foobar", 6);
+  fail_unless(hash == 0x85944171f73967e8ULL, "Unexpected hash for 'foobar'");
+
+  mark_point();
+  hash = lint_hash_update(lint_hash_data("foo", 3), "bar", 3);
+  fail_unless(hash == 0x85944171f73967e8ULL,
+    "Unexpected incremental hash for 'foobar'");
+}
+END_TEST
+
+START_TEST (hash_file_test) {
+  int res;
+  uint64_t hash, expected;
+  off_t filesz;
+
+  mark_point();
+  res = lint_hash_file(NULL, NULL, NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_hash_file(p, NULL, NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null path");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_hash_file(p, hash_path, NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null hash");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_hash_file(p, hash_path, NULL, &hash, NULL);
+  fail_unless(res < 0, "Failed to handle nonexistent file");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  res = write_file(hash_path, "# Header\nfoobar");
+  fail_unless(res > 0, "Failed to write '%s': %s", hash_path, strerror(errno));
+
+  res = lint_hash_file(p, hash_path, NULL, &hash, &filesz);
+  fail_unless(res == 0, "Failed to hash '%s': %s", hash_path, strerror(errno));
+  fail_unless(filesz == 15, "Expected file size 15, got %lu",
+    (unsigned long) filesz);
+  expected = lint_hash_data("# Header\nfoobar", 15);
+  fail_unless(hash == expected, "Unexpected hash for full file");
+
+  mark_point();
+  res = lint_hash_file(p, hash_path, "# Header", &hash, NULL);
+  fail_unless(res == 0, "Failed to hash '%s': %s", hash_path, strerror(errno));
+  fail_unless(hash == 0x85944171f73967e8ULL,
+    "Unexpected hash when skipping header");
+
+  mark_point();
+  res = lint_hash_file(p, hash_path, "# Other", &hash, NULL);
+  fail_unless(res == 0, "Failed to hash '%s': %s", hash_path, strerror(errno));
+  fail_unless(hash == expected, "Unexpected hash for unmatched prefix");
+}
+END_TEST
+
+Suite *tests_get_hash_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("hash");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, hash_data_test);
+  tcase_add_test(testcase, hash_file_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
@@ -0,0 +1,207 @@
+/*
+ * ProFTPD - mod_lint API testsuite
+ * Copyright (c) 2021 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* Performance API tests. */
+
+#include "tests.h"
+#include "lint/perf.h"
+
+static pool *p = NULL;
+
+static const char *stats_path = "/tmp/lint-test-stats.json";
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = permanent_pool = make_sub_pool(NULL);
+  }
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.perf", 1, 20);
+  }
+
+  mark_point();
+}
+
+static void tear_down(void) {
+  (void) unlink(stats_path);
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.perf", 0, 0);
+  }
+
+  if (p != NULL) {
+    destroy_pool(p);
+    p = permanent_pool = NULL;
+  }
+}
+
+START_TEST (perf_add_time_test) {
+  int res;
+  uint64_t now_ns, start_ns;
+  struct lint_perf perf;
+
+  mark_point();
+  lint_perf_reset(NULL);
+  lint_perf_reset(&perf);
+  fail_unless(perf.phase_ns[LINT_PERF_PHASE_INGEST] == 0,
+    "Expected zero ingest time");
+
+  mark_point();
+  start_ns = lint_perf_now();
+  fail_unless(start_ns > 0, "Expected non-zero time");
+
+  now_ns = lint_perf_now();
+  fail_unless(now_ns >= start_ns, "Expected monotonic time");
+
+  mark_point();
+  res = lint_perf_add_time(NULL, LINT_PERF_PHASE_INGEST, start_ns);
+  fail_unless(res < 0, "Failed to handle null perf");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = lint_perf_add_time(&perf, LINT_PERF_NPHASES, start_ns);
+  fail_unless(res < 0, "Failed to handle unknown phase");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_perf_add_time(&perf, LINT_PERF_PHASE_VHOSTS, start_ns - 1000);
+  fail_unless(res == 0, "Failed to add time: %s", strerror(errno));
+  fail_unless(perf.phase_ns[LINT_PERF_PHASE_VHOSTS] >= 1000,
+    "Expected at least 1000 ns, got %lu",
+    (unsigned long) perf.phase_ns[LINT_PERF_PHASE_VHOSTS]);
+
+  /* A start time in the future adds nothing. */
+  res = lint_perf_add_time(&perf, LINT_PERF_PHASE_COMMIT,
+    lint_perf_now() + 1000000000ULL);
+  fail_unless(res == 0, "Failed to add time: %s", strerror(errno));
+  fail_unless(perf.phase_ns[LINT_PERF_PHASE_COMMIT] == 0,
+    "Expected zero commit time, got %lu",
+    (unsigned long) perf.phase_ns[LINT_PERF_PHASE_COMMIT]);
+}
+END_TEST
+
+START_TEST (perf_get_names_test) {
+  register unsigned int i;
+  const char *name;
+
+  mark_point();
+  name = lint_perf_get_phase_name(LINT_PERF_NPHASES);
+  fail_unless(name == NULL, "Failed to handle unknown phase");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  name = lint_perf_get_count_name(LINT_PERF_NCOUNTS);
+  fail_unless(name == NULL, "Failed to handle unknown counter");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  for (i = 0; i < LINT_PERF_NPHASES; i++) {
+    name = lint_perf_get_phase_name(i);
+    fail_unless(name != NULL, "Expected name for phase %u", i);
+  }
+
+  name = lint_perf_get_phase_name(LINT_PERF_PHASE_SERVER_CONFIG);
+  fail_unless(strcmp(name, "server_config") == 0,
+    "Expected 'server_config', got '%s'", name);
+
+  for (i = 0; i < LINT_PERF_NCOUNTS; i++) {
+    name = lint_perf_get_count_name(i);
+    fail_unless(name != NULL, "Expected name for counter %u", i);
+  }
+
+  name = lint_perf_get_count_name(LINT_PERF_COUNT_BYTES_WRITTEN);
+  fail_unless(strcmp(name, "bytes_written") == 0,
+    "Expected 'bytes_written', got '%s'", name);
+}
+END_TEST
+
+START_TEST (perf_write_json_test) {
+  int fd, res;
+  struct lint_perf perf;
+  char buf[2048];
+  ssize_t len;
+
+  mark_point();
+  res = lint_perf_write_json(NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = lint_perf_write_json(p, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null perf");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  lint_perf_reset(&perf);
+  res = lint_perf_write_json(p, &perf, NULL);
+  fail_unless(res < 0, "Failed to handle null path");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  perf.phase_ns[LINT_PERF_PHASE_MODULES] = 12345;
+  perf.counts[LINT_PERF_COUNT_LINES] = 42;
+  perf.counts[LINT_PERF_COUNT_SYSCALLS] = 7;
+  lint_perf_trace(&perf);
+
+  res = lint_perf_write_json(p, &perf, stats_path);
+  fail_unless(res == 0, "Failed to write '%s': %s", stats_path,
+    strerror(errno));
+
+  fd = open(stats_path, O_RDONLY);
+  fail_unless(fd >= 0, "Failed to open '%s': %s", stats_path, strerror(errno));
+  len = read(fd, buf, sizeof(buf)-1);
+  (void) close(fd);
+  fail_unless(len > 0, "Failed to read '%s': %s", stats_path, strerror(errno));
+  buf[len] = '\0';
+
+  fail_unless(buf[0] == '{' && buf[len-2] == '}',
+    "Expected JSON object, got '%s'", buf);
+  fail_unless(strstr(buf, "\"modules\": 12345,") != NULL,
+    "Expected modules phase time in '%s'", buf);
+  fail_unless(strstr(buf, "\"lines\": 42,") != NULL,
+    "Expected lines count in '%s'", buf);
+  fail_unless(strstr(buf, "\"syscalls\": 7\n") != NULL,
+    "Expected syscalls count in '%s'", buf);
+}
+END_TEST
+
+Suite *tests_get_perf_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("perf");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, perf_add_time_test);
+  tcase_add_test(testcase, perf_get_names_test);
+  tcase_add_test(testcase, perf_write_json_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
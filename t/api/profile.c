@@ -0,0 +1,248 @@
+/*
+ * ProFTPD - mod_lint API testsuite
+ * Copyright (c) 2021 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+
+/* Parse profile API tests. */
+
+#include "tests.h"
+#include "lint/profile.h"
+
+static pool *p = NULL;
+
+static const char *profile_path = "/tmp/lint-test-profile.txt";
+static const char *folded_path = "/tmp/lint-test-profile.folded";
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = permanent_pool = make_sub_pool(NULL);
+  }
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.profile", 1, 20);
+  }
+
+  mark_point();
+}
+
+static void tear_down(void) {
+  (void) unlink(profile_path);
+  (void) unlink(folded_path);
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.profile", 0, 0);
+  }
+
+  if (p != NULL) {
+    destroy_pool(p);
+    p = permanent_pool = NULL;
+  }
+}
+
+static char *read_file(const char *path) {
+  int fd;
+  ssize_t len;
+  static char buf[8192];
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  len = read(fd, buf, sizeof(buf)-1);
+  (void) close(fd);
+  if (len < 0) {
+    return NULL;
+  }
+
+  buf[len] = '\0';
+  return buf;
+}
+
+START_TEST (profile_alloc_test) {
+  struct lint_profile *prof;
+
+  mark_point();
+  prof = lint_profile_alloc(NULL);
+  fail_unless(prof == NULL, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  prof = lint_profile_alloc(p);
+  fail_unless(prof != NULL, "Failed to allocate profile: %s", strerror(errno));
+}
+END_TEST
+
+START_TEST (profile_add_line_test) {
+  int res;
+  struct lint_profile *prof;
+
+  mark_point();
+  res = lint_profile_add_line(NULL, 0, NULL, 0, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null profile");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  prof = lint_profile_alloc(p);
+
+  res = lint_profile_add_line(prof, 0, NULL, 0, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null source file");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = lint_profile_add_line(prof, 0, "/etc/proftpd.conf", 1, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null directive");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_profile_add_config(NULL, 0);
+  fail_unless(res < 0, "Failed to handle null profile");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = lint_profile_finish(NULL, 0);
+  fail_unless(res < 0, "Failed to handle null profile");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_profile_add_line(prof, 1000, "/etc/proftpd.conf", 1,
+    "ServerName", "mod_core.c");
+  fail_unless(res == 0, "Failed to add line: %s", strerror(errno));
+
+  res = lint_profile_add_config(prof, 2000);
+  fail_unless(res == 0, "Failed to add config: %s", strerror(errno));
+
+  res = lint_profile_finish(prof, 3000);
+  fail_unless(res == 0, "Failed to finish profile: %s", strerror(errno));
+}
+END_TEST
+
+START_TEST (profile_write_test) {
+  int res;
+  struct lint_profile *prof;
+  const char *text;
+  uint64_t ms = 1000000ULL;
+
+  mark_point();
+  res = lint_profile_write(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null profile");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = lint_profile_write_folded(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null profile");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  prof = lint_profile_alloc(p);
+
+  res = lint_profile_write(prof, NULL);
+  fail_unless(res < 0, "Failed to handle null path");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* An Include taking 10ms to expand, whose included file has one slow
+   * directive (30ms), then back to the including file.
+   */
+  mark_point();
+  (void) lint_profile_add_line(prof, 1 * ms, "/etc/proftpd.conf", 1,
+    "ServerName", "mod_core.c");
+  (void) lint_profile_add_config(prof, 2 * ms);
+  (void) lint_profile_add_line(prof, 3 * ms, "/etc/proftpd.conf", 2,
+    "Include", "mod_core.c");
+  (void) lint_profile_add_line(prof, 13 * ms, "/etc/conf.d/a.conf", 1,
+    "SQLNamedQuery", "mod_sql.c");
+  (void) lint_profile_add_config(prof, 40 * ms);
+  (void) lint_profile_add_line(prof, 43 * ms, "/etc/conf.d/a.conf", 2,
+    "Bogus", NULL);
+  (void) lint_profile_add_line(prof, 44 * ms, "/etc/proftpd.conf", 3,
+    "ServerName", "mod_core.c");
+  (void) lint_profile_finish(prof, 50 * ms);
+
+  mark_point();
+  res = lint_profile_write(prof, profile_path);
+  fail_unless(res == 0, "Failed to write '%s': %s", profile_path,
+    strerror(errno));
+
+  text = read_file(profile_path);
+  fail_unless(text != NULL, "Failed to read '%s': %s", profile_path,
+    strerror(errno));
+
+  fail_unless(strstr(text, "5 lines, 2 configs, 49.000 ms total "
+    "(6.000 ms after the last line)") != NULL,
+    "Expected totals in '%s'", text);
+
+  /* Files, ranked: a.conf (31ms), then proftpd.conf (12ms); the 6ms after
+   * the last line are not attributed.
+   */
+  fail_unless(strstr(text, "31.000  63.3%        2        1  "
+    "/etc/conf.d/a.conf\n        12.000") != NULL,
+    "Expected ranked files in '%s'", text);
+
+  /* Directives, ranked: SQLNamedQuery, then Include. */
+  fail_unless(strstr(text, "30.000  61.2%        1        1  SQLNamedQuery\n"
+    "        10.000  20.4%        1        0  Include\n") != NULL,
+    "Expected ranked directives in '%s'", text);
+
+  fail_unless(strstr(text, "(unknown)") != NULL,
+    "Expected unknown module in '%s'", text);
+  fail_unless(strstr(text, "  30.000  /etc/conf.d/a.conf:1 SQLNamedQuery\n")
+    != NULL, "Expected slowest line in '%s'", text);
+
+  mark_point();
+  res = lint_profile_write_folded(prof, folded_path);
+  fail_unless(res == 0, "Failed to write '%s': %s", folded_path,
+    strerror(errno));
+
+  text = read_file(folded_path);
+  fail_unless(text != NULL, "Failed to read '%s': %s", folded_path,
+    strerror(errno));
+
+  fail_unless(strstr(text,
+    "/etc/proftpd.conf;/etc/conf.d/a.conf;mod_sql.c;SQLNamedQuery 30000\n")
+    != NULL, "Expected included stack in '%s'", text);
+  fail_unless(strstr(text,
+    "/etc/proftpd.conf;mod_core.c;ServerName 2000\n") != NULL,
+    "Expected stack in '%s'", text);
+}
+END_TEST
+
+Suite *tests_get_profile_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("profile");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, profile_alloc_test);
+  tcase_add_test(testcase, profile_add_line_test);
+  tcase_add_test(testcase, profile_write_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
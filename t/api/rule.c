@@ -0,0 +1,479 @@
+/*
+ * ProFTPD - mod_lint API testsuite
+ * Copyright (c) 2021 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* Rule API tests. */
+
+#include "tests.h"
+#include "lint/rule.h"
+#include "lint/dns.h"
+
+static pool *p = NULL;
+static struct lint_arena *arena = NULL;
+
+/* Records what the test rule was given. */
+struct test_rule_data {
+  unsigned int nlines;
+  unsigned int nconfigs;
+  unsigned int nfinished;
+  server_rec *line_servers[8];
+};
+
+static const char *test_directives[] = { "ServerName", "Bind", NULL };
+static const char *test_config_names[] = { "ServerName", NULL };
+static const char *all_names[] = { "*", NULL };
+
+static int test_check_line(struct lint_rule_ctx *ctx, unsigned int idx) {
+  struct test_rule_data *data;
+
+  data = ctx->data;
+  if (data->nlines < 8) {
+    data->line_servers[data->nlines] = ctx->server;
+  }
+
+  data->nlines++;
+  return lint_rule_add_finding(ctx, idx, "line %u", idx);
+}
+
+static int test_check_config(struct lint_rule_ctx *ctx, config_rec *c) {
+  struct test_rule_data *data;
+
+  data = ctx->data;
+  data->nconfigs++;
+  return 0;
+}
+
+static int test_finish(struct lint_rule_ctx *ctx) {
+  struct test_rule_data *data;
+
+  data = ctx->data;
+  data->nfinished++;
+  return lint_rule_add_finding(ctx, -1, "finished");
+}
+
+static const struct lint_rule test_rule = {
+  "test", test_directives, test_config_names, 0, test_check_line,
+  test_check_config, test_finish
+};
+
+static const struct lint_rule all_rule = {
+  "all", all_names, all_names, 0, test_check_line, test_check_config, NULL
+};
+
+static const struct lint_rule type_rule = {
+  "type", NULL, NULL, CONF_ANON|CONF_DIR, NULL, test_check_config, NULL
+};
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = permanent_pool = make_sub_pool(NULL);
+  }
+
+  if (arena == NULL) {
+    arena = lint_arena_create(0);
+  }
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.rule", 1, 20);
+  }
+
+  mark_point();
+}
+
+static void tear_down(void) {
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.rule", 0, 0);
+  }
+
+  if (arena != NULL) {
+    lint_arena_destroy(arena);
+    arena = NULL;
+  }
+
+  if (p != NULL) {
+    destroy_pool(p);
+    p = permanent_pool = NULL;
+  }
+}
+
+static config_rec *add_config(xaset_t *set, const char *name, void *arg) {
+  config_rec *c;
+
+  c = pcalloc(p, sizeof(config_rec));
+  c->pool = p;
+  c->name = pstrdup(p, name);
+  c->config_type = CONF_PARAM;
+  c->argc = 1;
+  c->argv = pcalloc(p, sizeof(void *) * 2);
+  c->argv[0] = arg;
+
+  (void) xaset_insert_end(set, (xasetmember_t *) c);
+  return c;
+}
+
+static server_rec *add_server(xaset_t *servers) {
+  server_rec *s;
+
+  s = pcalloc(p, sizeof(server_rec));
+  s->pool = p;
+  s->conf = xaset_create(p, NULL);
+
+  (void) xaset_insert_end(servers, (xasetmember_t *) s);
+  return s;
+}
+
+static void add_line(struct lint_store *store, const char *directive,
+    const char *text, server_rec *s, unsigned int lineno) {
+  int idx;
+
+  idx = lint_store_add_line(store, directive, text, strlen(text),
+    "/etc/proftpd.conf", lineno);
+  if (idx >= 0) {
+    (void) lint_store_set_server(store, idx, s);
+  }
+}
+
+START_TEST (rule_engine_alloc_test) {
+  struct lint_rule_engine *engine;
+
+  mark_point();
+  engine = lint_rule_engine_alloc(NULL);
+  fail_unless(engine == NULL, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  engine = lint_rule_engine_alloc(p);
+  fail_unless(engine != NULL, "Failed to allocate engine: %s",
+    strerror(errno));
+  fail_unless(lint_rule_engine_get_findings(engine)->nelts == 0,
+    "Expected no findings");
+}
+END_TEST
+
+START_TEST (rule_engine_add_test) {
+  int res;
+  struct lint_rule_engine *engine;
+  struct lint_rule rule;
+
+  mark_point();
+  res = lint_rule_engine_add(NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null engine");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  engine = lint_rule_engine_alloc(p);
+
+  mark_point();
+  res = lint_rule_engine_add(engine, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null rule");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  memset(&rule, 0, sizeof(rule));
+  rule.name = "empty";
+  res = lint_rule_engine_add(engine, &rule, NULL);
+  fail_unless(res < 0, "Failed to handle rule without callbacks");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_rule_engine_add(engine, &test_rule, NULL);
+  fail_unless(res == 0, "Failed to add rule: %s", strerror(errno));
+}
+END_TEST
+
+START_TEST (rule_engine_run_test) {
+  int res;
+  struct lint_rule_engine *engine;
+  struct lint_store *store;
+  struct test_rule_data test_data, all_data, type_data;
+  struct lint_rule_finding *findings;
+  array_header *list;
+  xaset_t *servers;
+  server_rec *main_srv, *vhost_srv;
+  config_rec *c;
+
+  mark_point();
+  res = lint_rule_engine_run(NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null engine");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  engine = lint_rule_engine_alloc(p);
+
+  mark_point();
+  res = lint_rule_engine_run(engine, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null servers");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  servers = xaset_create(p, NULL);
+  main_srv = add_server(servers);
+  vhost_srv = add_server(servers);
+
+  (void) add_config(main_srv->conf, "ServerName", "main");
+  c = add_config(main_srv->conf, "Anonymous", NULL);
+  c->config_type = CONF_ANON;
+  c->subset = xaset_create(p, NULL);
+  (void) add_config(c->subset, "ServerName", "anon");
+  c = add_config(c->subset, "/pub", NULL);
+  c->config_type = CONF_DIR|CONF_DYNDIR;
+  (void) add_config(vhost_srv->conf, "ServerName", "vhost");
+  (void) add_config(vhost_srv->conf, "Port", NULL);
+
+  store = lint_store_alloc(arena);
+  add_line(store, "ServerName", "ServerName \"main\"", main_srv, 1);
+  add_line(store, "<VirtualHost>", "<VirtualHost 1.2.3.4>", vhost_srv, 2);
+  add_line(store, "ServerName", "ServerName \"vhost\"", vhost_srv, 3);
+  add_line(store, "</VirtualHost>", "</VirtualHost>", vhost_srv, 4);
+  add_line(store, "Port", "Port 2121", NULL, 5);
+  add_line(store, "bind", "bind 127.0.0.1", NULL, 6);
+
+  memset(&test_data, 0, sizeof(test_data));
+  memset(&all_data, 0, sizeof(all_data));
+  memset(&type_data, 0, sizeof(type_data));
+  (void) lint_rule_engine_add(engine, &test_rule, &test_data);
+  (void) lint_rule_engine_add(engine, &all_rule, &all_data);
+  (void) lint_rule_engine_add(engine, &type_rule, &type_data);
+
+  mark_point();
+  res = lint_rule_engine_run(engine, store, servers);
+  fail_unless(res == 0, "Failed to run rules: %s", strerror(errno));
+
+  /* Only the subscribed lines, and configs, are dispatched; directives
+   * are matched ignoring case.
+   */
+  fail_unless(test_data.nlines == 3, "Expected 3 lines, got %u",
+    test_data.nlines);
+  fail_unless(test_data.line_servers[0] == main_srv,
+    "Expected main server for line 1");
+  fail_unless(test_data.line_servers[1] == vhost_srv,
+    "Expected vhost server for line 3");
+  fail_unless(test_data.nconfigs == 3, "Expected 3 configs, got %u",
+    test_data.nconfigs);
+  fail_unless(test_data.line_servers[2] == main_srv,
+    "Expected main server for line 6");
+  fail_unless(test_data.nfinished == 1, "Expected 1 finish, got %u",
+    test_data.nfinished);
+
+  fail_unless(all_data.nlines == 6, "Expected 6 lines, got %u",
+    all_data.nlines);
+  fail_unless(all_data.line_servers[1] == vhost_srv,
+    "Expected vhost server for <VirtualHost> line");
+  fail_unless(all_data.line_servers[3] == vhost_srv,
+    "Expected vhost server for </VirtualHost> line");
+  fail_unless(all_data.line_servers[4] == main_srv,
+    "Expected main server for line 5");
+  fail_unless(all_data.nconfigs == 6, "Expected 6 configs, got %u",
+    all_data.nconfigs);
+
+  /* The <Anonymous> and <Directory> configs, by type. */
+  fail_unless(type_data.nconfigs == 2, "Expected 2 configs, got %u",
+    type_data.nconfigs);
+
+  list = lint_rule_engine_get_findings(engine);
+  fail_unless(list->nelts == 10, "Expected 10 findings, got %u", list->nelts);
+
+  findings = list->elts;
+  fail_unless(strcmp(findings[0].rule, "test") == 0,
+    "Expected 'test', got '%s'", findings[0].rule);
+  fail_unless(strcmp(findings[0].text, "line 0") == 0,
+    "Expected 'line 0', got '%s'", findings[0].text);
+  fail_unless(strcmp(findings[0].source_file, "/etc/proftpd.conf") == 0,
+    "Expected '/etc/proftpd.conf', got '%s'", findings[0].source_file);
+  fail_unless(findings[0].source_lineno == 1, "Expected line 1, got %u",
+    findings[0].source_lineno);
+
+  fail_unless(strcmp(findings[9].text, "finished") == 0,
+    "Expected 'finished', got '%s'", findings[9].text);
+  fail_unless(findings[9].source_file == NULL,
+    "Expected no source file, got '%s'", findings[9].source_file);
+}
+END_TEST
+
+START_TEST (rule_dns_test) {
+  int res;
+  struct lint_rule_engine *engine;
+  struct lint_store *store;
+  struct lint_dns *dns;
+  struct lint_rule_finding *findings;
+  array_header *list;
+  xaset_t *servers;
+  config_rec *c;
+  const char *addr;
+
+  servers = xaset_create(p, NULL);
+  (void) add_server(servers);
+
+  store = lint_store_alloc(arena);
+  add_line(store, "Bind", "Bind 127.0.0.2 ftp.example.com", NULL, 7);
+
+  c = pcalloc(p, sizeof(config_rec));
+  c->name = "_bind_";
+  c->argv = pcalloc(p, sizeof(void *));
+  c->argv[0] = "127.0.0.2";
+  (void) lint_store_add_config(store, c);
+
+  c = pcalloc(p, sizeof(config_rec));
+  c->name = "_bind_";
+  c->argv = pcalloc(p, sizeof(void *));
+  c->argv[0] = "1.2.3.4";
+  (void) lint_store_add_config(store, c);
+
+  dns = lint_dns_alloc(p);
+  engine = lint_rule_engine_alloc(p);
+  (void) lint_rule_engine_add(engine, lint_rule_get_dns_rule(), dns);
+
+  mark_point();
+  res = lint_rule_engine_run(engine, store, servers);
+  fail_unless(res == 0, "Failed to run rules: %s", strerror(errno));
+
+  list = lint_rule_engine_get_findings(engine);
+  fail_unless(list->nelts == 1, "Expected 1 finding, got %u", list->nelts);
+
+  findings = list->elts;
+  fail_unless(strcmp(findings[0].text, "Bind address 'ftp.example.com' "
+    "requires DNS resolution at startup; resolved to 1.2.3.4") == 0,
+    "Got unexpected finding '%s'", findings[0].text);
+  fail_unless(findings[0].source_lineno == 7, "Expected line 7, got %u",
+    findings[0].source_lineno);
+
+  addr = lint_dns_get_addr(dns, "ftp.example.com");
+  fail_unless(addr != NULL, "Failed to get address: %s", strerror(errno));
+  fail_unless(strcmp(addr, "1.2.3.4") == 0, "Expected '1.2.3.4', got '%s'",
+    addr);
+}
+END_TEST
+
+START_TEST (rule_dns_vhost_test) {
+  int res;
+  struct lint_rule_engine *engine;
+  struct lint_store *store;
+  struct lint_dns *dns;
+  xaset_t *servers;
+  server_rec *dropped_srv, *vhost_srv;
+  const char *addr;
+
+  /* The first <VirtualHost> has no server in the list, e.g. as for a
+   * vhost dropped at startup; its line must not be given the address of
+   * the next vhost.
+   */
+  servers = xaset_create(p, NULL);
+  (void) add_server(servers);
+  vhost_srv = add_server(servers);
+  vhost_srv->addr = pr_netaddr_get_addr(p, "10.0.0.2", NULL);
+
+  dropped_srv = pcalloc(p, sizeof(server_rec));
+  dropped_srv->addr = pr_netaddr_get_addr(p, "10.0.0.1", NULL);
+
+  store = lint_store_alloc(arena);
+  add_line(store, "<VirtualHost>", "<VirtualHost a.example.com>",
+    dropped_srv, 1);
+  add_line(store, "</VirtualHost>", "</VirtualHost>", dropped_srv, 2);
+  add_line(store, "<VirtualHost>", "<virtualhost b.example.com>",
+    vhost_srv, 3);
+  add_line(store, "</VirtualHost>", "</VirtualHost>", vhost_srv, 4);
+
+  dns = lint_dns_alloc(p);
+  engine = lint_rule_engine_alloc(p);
+  (void) lint_rule_engine_add(engine, lint_rule_get_dns_rule(), dns);
+
+  mark_point();
+  res = lint_rule_engine_run(engine, store, servers);
+  fail_unless(res == 0, "Failed to run rules: %s", strerror(errno));
+  fail_unless(lint_rule_engine_get_findings(engine)->nelts == 2,
+    "Expected 2 findings, got %u",
+    lint_rule_engine_get_findings(engine)->nelts);
+
+  addr = lint_dns_get_addr(dns, "a.example.com");
+  fail_unless(addr != NULL, "Failed to get address: %s", strerror(errno));
+  fail_unless(strcmp(addr, "10.0.0.1") == 0, "Expected '10.0.0.1', got '%s'",
+    addr);
+
+  addr = lint_dns_get_addr(dns, "b.example.com");
+  fail_unless(addr != NULL, "Failed to get address: %s", strerror(errno));
+  fail_unless(strcmp(addr, "10.0.0.2") == 0, "Expected '10.0.0.2', got '%s'",
+    addr);
+}
+END_TEST
+
+START_TEST (rule_inetd_test) {
+  int res;
+  struct lint_rule_engine *engine;
+  struct lint_store *store;
+  struct lint_rule_inetd_data data;
+  struct lint_rule_finding *findings;
+  array_header *list;
+  xaset_t *servers;
+
+  servers = xaset_create(p, NULL);
+  (void) add_server(servers);
+
+  store = lint_store_alloc(arena);
+  add_line(store, "ServerName", "ServerName \"ftp\"", NULL, 1);
+  add_line(store, "Port", "Port 21", NULL, 2);
+
+  memset(&data, 0, sizeof(data));
+  data.parse_ns = 2000000;
+
+  engine = lint_rule_engine_alloc(p);
+  (void) lint_rule_engine_add(engine, lint_rule_get_inetd_rule(), &data);
+
+  mark_point();
+  res = lint_rule_engine_run(engine, store, servers);
+  fail_unless(res == 0, "Failed to run rules: %s", strerror(errno));
+  fail_unless(data.nlines == 2, "Expected 2 lines, got %u", data.nlines);
+  fail_unless(data.nbytes == 25, "Expected 25 bytes, got %lu",
+    (unsigned long) data.nbytes);
+
+  list = lint_rule_engine_get_findings(engine);
+  fail_unless(list->nelts == 1, "Expected 1 finding, got %u", list->nelts);
+
+  findings = list->elts;
+  fail_unless(strstr(findings[0].text, "(2 lines, 25 bytes); parsing took "
+    "2.000 ms (1000.0 us per line), i.e. about 2.0 secs per 1000 "
+    "connections") != NULL, "Got unexpected finding '%s'", findings[0].text);
+}
+END_TEST
+
+Suite *tests_get_rule_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("rule");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, rule_engine_alloc_test);
+  tcase_add_test(testcase, rule_engine_add_test);
+  tcase_add_test(testcase, rule_engine_run_test);
+  tcase_add_test(testcase, rule_dns_test);
+  tcase_add_test(testcase, rule_dns_vhost_test);
+  tcase_add_test(testcase, rule_inetd_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
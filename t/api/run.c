@@ -0,0 +1,342 @@
+/*
+ * ProFTPD - mod_lint API testsuite
+ * Copyright (c) 2021 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* Run API tests. */
+
+#include "tests.h"
+#include "lint/run.h"
+
+static pool *p = NULL;
+
+static const char *run_paths[] = {
+  "/tmp/mod_lint-run1.dat",
+  "/tmp/mod_lint-run2.dat",
+  "/tmp/mod_lint-run3.dat",
+  NULL
+};
+
+static const char *concat_path = "/tmp/mod_lint-concat.txt";
+static const char *serial_path = "/tmp/mod_lint-serial.txt";
+
+static void set_up(void) {
+  register unsigned int i;
+
+  for (i = 0; run_paths[i] != NULL; i++) {
+    (void) unlink(run_paths[i]);
+  }
+
+  (void) unlink(concat_path);
+  (void) unlink(serial_path);
+
+  if (p == NULL) {
+    p = permanent_pool = make_sub_pool(NULL);
+  }
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.run", 1, 20);
+  }
+
+  mark_point();
+}
+
+static void tear_down(void) {
+  register unsigned int i;
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.run", 0, 0);
+  }
+
+  if (p != NULL) {
+    destroy_pool(p);
+    p = permanent_pool = NULL;
+  }
+
+  for (i = 0; run_paths[i] != NULL; i++) {
+    (void) unlink(run_paths[i]);
+  }
+
+  (void) unlink(concat_path);
+  (void) unlink(serial_path);
+}
+
+static char *read_file(const char *path, size_t *len) {
+  int fd;
+  struct stat st;
+  char *data;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  if (fstat(fd, &st) < 0) {
+    (void) close(fd);
+    return NULL;
+  }
+
+  data = pcalloc(p, st.st_size + 1);
+  if (read(fd, data, st.st_size) != st.st_size) {
+    (void) close(fd);
+    return NULL;
+  }
+
+  (void) close(fd);
+  *len = st.st_size;
+  return data;
+}
+
+static struct lint_text_writer *open_writer(const char *path) {
+  pr_fh_t *fh;
+
+  fh = pr_fsio_open(path, O_WRONLY|O_CREAT|O_TRUNC);
+  if (fh == NULL) {
+    return NULL;
+  }
+
+  return lint_text_writer_create(p, fh);
+}
+
+START_TEST (run_write_test) {
+  int res;
+  array_header *buffered_lines;
+
+  mark_point();
+  res = lint_run_write(NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_run_write(p, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null path");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_run_write(p, run_paths[0], NULL);
+  fail_unless(res < 0, "Failed to handle null lines");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  buffered_lines = make_array(p, 0, sizeof(struct lint_buffered_line *));
+  res = lint_run_write(p, run_paths[0], buffered_lines);
+  fail_unless(res == 0, "Failed to write empty run: %s", strerror(errno));
+
+  res = lint_run_verify(p, run_paths[0], NULL);
+  fail_unless(res == 0, "Failed to verify empty run: %s", strerror(errno));
+}
+END_TEST
+
+START_TEST (run_verify_test) {
+  int res, fd;
+  unsigned int nrecords = 0;
+  array_header *buffered_lines;
+  struct stat st;
+
+  mark_point();
+  res = lint_run_verify(NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_run_verify(p, run_paths[0], NULL);
+  fail_unless(res < 0, "Failed to handle nonexistent run");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  buffered_lines = make_array(p, 0, sizeof(struct lint_buffered_line *));
+  (void) lint_text_add_fmt(p, buffered_lines, "%s\n", "Foo");
+  (void) lint_text_add_fmt(p, buffered_lines, "%s\n", "Bar");
+  res = lint_run_write(p, run_paths[0], buffered_lines);
+  fail_unless(res == 0, "Failed to write run: %s", strerror(errno));
+
+  res = lint_run_verify(p, run_paths[0], &nrecords);
+  fail_unless(res == 0, "Failed to verify run: %s", strerror(errno));
+  fail_unless(nrecords == 2, "Expected 2 records, got %u", nrecords);
+
+  /* Truncate the run, as if its worker died partway. */
+  mark_point();
+  fail_unless(stat(run_paths[0], &st) == 0, "Failed to stat run: %s",
+    strerror(errno));
+  fd = open(run_paths[0], O_WRONLY);
+  fail_unless(fd >= 0, "Failed to open run: %s", strerror(errno));
+  fail_unless(ftruncate(fd, st.st_size - 6) == 0, "Failed to truncate: %s",
+    strerror(errno));
+  (void) close(fd);
+
+  res = lint_run_verify(p, run_paths[0], NULL);
+  fail_unless(res < 0, "Failed to handle truncated run");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+}
+END_TEST
+
+START_TEST (run_read_test) {
+  array_header *buffered_lines, *texts;
+
+  mark_point();
+  texts = lint_run_read(NULL, NULL);
+  fail_unless(texts == NULL, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  texts = lint_run_read(p, run_paths[0]);
+  fail_unless(texts == NULL, "Failed to handle nonexistent run");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  buffered_lines = make_array(p, 0, sizeof(struct lint_buffered_line *));
+  (void) lint_text_add_fmt(p, buffered_lines, "%s\n", "Foo");
+  (void) lint_text_add_fmt(p, buffered_lines, "%s\n", "Bar");
+  fail_unless(lint_run_write(p, run_paths[0], buffered_lines) == 0,
+    "Failed to write run: %s", strerror(errno));
+
+  texts = lint_run_read(p, run_paths[0]);
+  fail_unless(texts != NULL, "Failed to read run: %s", strerror(errno));
+  fail_unless(texts->nelts == 2, "Expected 2 lines, got %u", texts->nelts);
+  fail_unless(strcmp(((char **) texts->elts)[0], "Foo\n") == 0,
+    "Expected 'Foo', got '%s'", ((char **) texts->elts)[0]);
+  fail_unless(strcmp(((char **) texts->elts)[1], "Bar\n") == 0,
+    "Expected 'Bar', got '%s'", ((char **) texts->elts)[1]);
+
+  /* An incomplete run is not read. */
+  mark_point();
+  fail_unless(truncate(run_paths[0], 12) == 0, "Failed to truncate run: %s",
+    strerror(errno));
+  texts = lint_run_read(p, run_paths[0]);
+  fail_unless(texts == NULL, "Failed to handle incomplete run");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+}
+END_TEST
+
+START_TEST (run_concat_test) {
+  register unsigned int i;
+  int res;
+  array_header *all_lines, *paths;
+  struct lint_text_writer *w;
+  char *concat, *serial;
+  size_t concat_len, serial_len;
+
+  mark_point();
+  res = lint_run_concat(NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* Split unsorted lines across runs, and compare the concatenated runs
+   * against writing all of the lines at once, in order.
+   */
+  all_lines = make_array(p, 0, sizeof(struct lint_buffered_line *));
+  paths = make_array(p, 0, sizeof(char *));
+
+  for (i = 0; run_paths[i] != NULL; i++) {
+    register unsigned int j;
+    array_header *buffered_lines;
+
+    buffered_lines = make_array(p, 0, sizeof(struct lint_buffered_line *));
+    for (j = 0; j < 1000; j++) {
+      unsigned int n;
+
+      n = ((j * 7919) + (i * 104729)) % 1500;
+      (void) lint_text_add_fmt(p, buffered_lines, "  Directive%u %u\n", n,
+        j % 3);
+      (void) lint_text_add_fmt(p, all_lines, "  Directive%u %u\n", n, j % 3);
+    }
+
+    res = lint_run_write(p, run_paths[i], buffered_lines);
+    fail_unless(res == 0, "Failed to write run: %s", strerror(errno));
+
+    *((const char **) push_array(paths)) = run_paths[i];
+  }
+
+  mark_point();
+  w = open_writer(concat_path);
+  fail_unless(w != NULL, "Failed to open writer: %s", strerror(errno));
+  res = lint_run_concat(p, w, paths);
+  fail_unless(res == 0, "Failed to concatenate runs: %s", strerror(errno));
+  fail_unless(lint_text_writer_close(w) == 0, "Failed to close writer: %s",
+    strerror(errno));
+
+  mark_point();
+  w = open_writer(serial_path);
+  fail_unless(w != NULL, "Failed to open writer: %s", strerror(errno));
+  for (i = 0; i < all_lines->nelts; i++) {
+    res = lint_text_writer_line(w,
+      ((struct lint_buffered_line **) all_lines->elts)[i]);
+    fail_unless(res == 0, "Failed to write line: %s", strerror(errno));
+  }
+  fail_unless(lint_text_writer_close(w) == 0, "Failed to close writer: %s",
+    strerror(errno));
+
+  concat = read_file(concat_path, &concat_len);
+  fail_unless(concat != NULL, "Failed to read concatenated output");
+  serial = read_file(serial_path, &serial_len);
+  fail_unless(serial != NULL, "Failed to read serial output");
+
+  fail_unless(concat_len == serial_len, "Expected %lu bytes, got %lu",
+    (unsigned long) serial_len, (unsigned long) concat_len);
+  fail_unless(memcmp(concat, serial, serial_len) == 0,
+    "Expected concatenated output to match serial output");
+
+  /* An incomplete run means nothing is written. */
+  mark_point();
+  res = truncate(run_paths[1], 100);
+  fail_unless(res == 0, "Failed to truncate run: %s", strerror(errno));
+
+  w = open_writer(concat_path);
+  res = lint_run_concat(p, w, paths);
+  fail_unless(res < 0, "Failed to handle incomplete run");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+  (void) lint_text_writer_close(w);
+
+  concat = read_file(concat_path, &concat_len);
+  fail_unless(concat_len == 0, "Expected no output, got %lu bytes",
+    (unsigned long) concat_len);
+}
+END_TEST
+
+Suite *tests_get_run_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("run");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, run_write_test);
+  tcase_add_test(testcase, run_verify_test);
+  tcase_add_test(testcase, run_read_test);
+  tcase_add_test(testcase, run_concat_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
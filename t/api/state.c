@@ -0,0 +1,316 @@
+/*
+ * ProFTPD - mod_lint API testsuite
+ * Copyright (c) 2021 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* State API tests. */
+
+#include "tests.h"
+#include "lint/state.h"
+
+static pool *p = NULL;
+
+static const char *state_path = "/tmp/lint-test.state";
+static const char *source_path = "/tmp/lint-test-source.conf";
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = permanent_pool = make_sub_pool(NULL);
+  }
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.state", 1, 20);
+  }
+
+  mark_point();
+}
+
+static void tear_down(void) {
+  (void) unlink(state_path);
+  (void) unlink(source_path);
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.state", 0, 0);
+  }
+
+  if (p != NULL) {
+    destroy_pool(p);
+    p = permanent_pool = NULL;
+  }
+}
+
+static int write_file(const char *path, const char *text) {
+  int fd, res;
+
+  fd = open(path, O_CREAT|O_WRONLY|O_TRUNC, 0644);
+  if (fd < 0) {
+    return -1;
+  }
+
+  res = write(fd, text, strlen(text));
+  (void) close(fd);
+  return res;
+}
+
+START_TEST (state_alloc_test) {
+  struct lint_state *state;
+
+  mark_point();
+  state = lint_state_alloc(NULL);
+  fail_unless(state == NULL, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  state = lint_state_alloc(p);
+  fail_unless(state != NULL, "Failed to allocate state: %s", strerror(errno));
+  fail_unless(lint_state_count(state) == 0, "Expected empty state");
+}
+END_TEST
+
+START_TEST (state_add_file_test) {
+  int res;
+  struct lint_state *state;
+
+  mark_point();
+  res = lint_state_add_file(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null state");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  state = lint_state_alloc(p);
+  res = lint_state_add_file(state, NULL);
+  fail_unless(res < 0, "Failed to handle null path");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_state_add_file(state, source_path);
+  fail_unless(res < 0, "Failed to handle nonexistent file");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  res = write_file(source_path, "ServerName \"Test\"\n");
+  fail_unless(res > 0, "Failed to write '%s': %s", source_path,
+    strerror(errno));
+
+  res = lint_state_add_file(state, source_path);
+  fail_unless(res == 0, "Failed to add file: %s", strerror(errno));
+  fail_unless(lint_state_count(state) == 1, "Expected 1 item, got %u",
+    lint_state_count(state));
+
+  /* Adding the same file again is a no-op. */
+  res = lint_state_add_file(state, source_path);
+  fail_unless(res == 0, "Failed to add file: %s", strerror(errno));
+  fail_unless(lint_state_count(state) == 1, "Expected 1 item, got %u",
+    lint_state_count(state));
+}
+END_TEST
+
+START_TEST (state_add_hash_test) {
+  int res;
+  struct lint_state *state;
+
+  mark_point();
+  res = lint_state_add_hash(NULL, NULL, 0);
+  fail_unless(res < 0, "Failed to handle null state");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  state = lint_state_alloc(p);
+  res = lint_state_add_hash(state, NULL, 0);
+  fail_unless(res < 0, "Failed to handle null name");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_state_add_hash(state, "foo", 1);
+  fail_unless(res == 0, "Failed to add hash: %s", strerror(errno));
+
+  res = lint_state_add_hash(state, "foo", 2);
+  fail_unless(res == 0, "Failed to replace hash: %s", strerror(errno));
+  fail_unless(lint_state_count(state) == 1, "Expected 1 item, got %u",
+    lint_state_count(state));
+}
+END_TEST
+
+START_TEST (state_compare_test) {
+  int res;
+  struct lint_state *state, *prev;
+  array_header *changed;
+
+  mark_point();
+  res = lint_state_compare(NULL, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null state");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  state = lint_state_alloc(p);
+  res = lint_state_compare(state, NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null previous state");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  prev = lint_state_alloc(p);
+  (void) lint_state_add_hash(state, "foo", 1);
+  (void) lint_state_add_hash(state, "bar", 2);
+  (void) lint_state_add_hash(prev, "foo", 1);
+  (void) lint_state_add_hash(prev, "bar", 2);
+
+  res = lint_state_compare(state, prev, NULL);
+  fail_unless(res == 0, "Expected no changes, got %d", res);
+
+  mark_point();
+  (void) lint_state_add_hash(state, "bar", 3);
+  (void) lint_state_add_hash(state, "baz", 4);
+  (void) lint_state_add_hash(prev, "quxx", 5);
+
+  changed = make_array(p, 0, sizeof(char *));
+  res = lint_state_compare(state, prev, changed);
+  fail_unless(res == 3, "Expected 3 changes, got %d", res);
+  fail_unless(changed->nelts == 3, "Expected 3 changed names, got %u",
+    changed->nelts);
+  fail_unless(strcmp(((char **) changed->elts)[0], "bar") == 0,
+    "Expected 'bar', got '%s'", ((char **) changed->elts)[0]);
+}
+END_TEST
+
+START_TEST (state_read_write_test) {
+  int res;
+  struct lint_state *state, *prev;
+
+  mark_point();
+  prev = lint_state_read(NULL, NULL);
+  fail_unless(prev == NULL, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  prev = lint_state_read(p, NULL);
+  fail_unless(prev == NULL, "Failed to handle null path");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  prev = lint_state_read(p, state_path);
+  fail_unless(prev == NULL, "Failed to handle nonexistent file");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_state_write(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null state");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = write_file(source_path, "ServerName \"Test\"\n");
+  fail_unless(res > 0, "Failed to write '%s': %s", source_path,
+    strerror(errno));
+
+  state = lint_state_alloc(p);
+  (void) lint_state_add_file(state, source_path);
+  (void) lint_state_add_hash(state, "foo", 0xdeadbeefULL);
+
+  res = lint_state_write(state, state_path);
+  fail_unless(res == 0, "Failed to write state: %s", strerror(errno));
+
+  mark_point();
+  prev = lint_state_read(p, state_path);
+  fail_unless(prev != NULL, "Failed to read state: %s", strerror(errno));
+  fail_unless(lint_state_count(prev) == 2, "Expected 2 items, got %u",
+    lint_state_count(prev));
+
+  res = lint_state_compare(state, prev, NULL);
+  fail_unless(res == 0, "Expected no changes, got %d", res);
+
+  mark_point();
+  res = write_file(source_path, "ServerName \"Changed\"\n");
+  fail_unless(res > 0, "Failed to write '%s': %s", source_path,
+    strerror(errno));
+
+  state = lint_state_alloc(p);
+  (void) lint_state_add_file(state, source_path);
+  (void) lint_state_add_hash(state, "foo", 0xdeadbeefULL);
+
+  res = lint_state_compare(state, prev, NULL);
+  fail_unless(res == 1, "Expected 1 change, got %d", res);
+}
+END_TEST
+
+START_TEST (state_many_items_test) {
+  register unsigned int i;
+  int res;
+  struct lint_state *state, *prev;
+
+  /* More items than the default table entry limit. */
+  mark_point();
+  state = lint_state_alloc(p);
+  for (i = 0; i < 10000; i++) {
+    char name[32];
+
+    pr_snprintf(name, sizeof(name), "item%u", i);
+    res = lint_state_add_hash(state, name, (uint64_t) i);
+    fail_unless(res == 0, "Failed to add '%s': %s", name, strerror(errno));
+  }
+
+  fail_unless(lint_state_count(state) == 10000, "Expected 10000 items, got %u",
+    lint_state_count(state));
+
+  res = lint_state_write(state, state_path);
+  fail_unless(res == 0, "Failed to write state: %s", strerror(errno));
+
+  mark_point();
+  prev = lint_state_read(p, state_path);
+  fail_unless(prev != NULL, "Failed to read state: %s", strerror(errno));
+  fail_unless(lint_state_count(prev) == 10000, "Expected 10000 items, got %u",
+    lint_state_count(prev));
+
+  res = lint_state_compare(state, prev, NULL);
+  fail_unless(res == 0, "Expected no changes, got %d", res);
+}
+END_TEST
+
+Suite *tests_get_state_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("state");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, state_alloc_test);
+  tcase_add_test(testcase, state_add_file_test);
+  tcase_add_test(testcase, state_add_hash_test);
+  tcase_add_test(testcase, state_compare_test);
+  tcase_add_test(testcase, state_read_write_test);
+  tcase_add_test(testcase, state_many_items_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
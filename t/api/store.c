@@ -0,0 +1,482 @@
+/*
+ * ProFTPD - mod_lint API testsuite
+ * Copyright (c) 2021 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* Store API tests. */
+
+#include "tests.h"
+#include "lint/store.h"
+
+static pool *p = NULL;
+static struct lint_arena *arena = NULL;
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = permanent_pool = make_sub_pool(NULL);
+  }
+
+  if (arena == NULL) {
+    arena = lint_arena_create(0);
+  }
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.store", 1, 20);
+  }
+
+  mark_point();
+}
+
+static void tear_down(void) {
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.store", 0, 0);
+  }
+
+  if (arena != NULL) {
+    lint_arena_destroy(arena);
+    arena = NULL;
+  }
+
+  if (p != NULL) {
+    destroy_pool(p);
+    p = permanent_pool = NULL;
+  }
+}
+
+START_TEST (store_alloc_test) {
+  struct lint_store *store;
+
+  mark_point();
+  store = lint_store_alloc(NULL);
+  fail_unless(store == NULL, "Failed to handle null arena");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  store = lint_store_alloc(arena);
+  fail_unless(store != NULL, "Failed to allocate store: %s", strerror(errno));
+  fail_unless(lint_store_count(store) == 0, "Expected empty store");
+}
+END_TEST
+
+START_TEST (store_intern_test) {
+  int id, id2;
+  struct lint_store *store;
+  const char *str;
+
+  mark_point();
+  id = lint_store_intern(NULL, NULL);
+  fail_unless(id < 0, "Failed to handle null store");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  store = lint_store_alloc(arena);
+  id = lint_store_intern(store, NULL);
+  fail_unless(id < 0, "Failed to handle null string");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  id = lint_store_intern(store, "ServerName");
+  fail_unless(id >= 0, "Failed to intern string: %s", strerror(errno));
+
+  id2 = lint_store_intern(store, "ServerName");
+  fail_unless(id2 == id, "Expected ID %d, got %d", id, id2);
+
+  id2 = lint_store_intern(store, "ServerAdmin");
+  fail_unless(id2 != id, "Expected different ID for different string");
+
+  mark_point();
+  str = lint_store_get_interned(store, id);
+  fail_unless(str != NULL, "Failed to get interned string: %s",
+    strerror(errno));
+  fail_unless(strcmp(str, "ServerName") == 0,
+    "Expected 'ServerName', got '%s'", str);
+
+  str = lint_store_get_interned(store, 1000);
+  fail_unless(str == NULL, "Failed to handle unknown ID");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+}
+END_TEST
+
+START_TEST (store_add_line_test) {
+  register unsigned int i;
+  int idx;
+  struct lint_store *store;
+  const char *text, *source_file, *text2;
+  size_t textsz;
+  char buf[64];
+
+  mark_point();
+  idx = lint_store_add_line(NULL, NULL, NULL, 0, NULL, 0);
+  fail_unless(idx < 0, "Failed to handle null store");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  store = lint_store_alloc(arena);
+  idx = lint_store_add_line(store, NULL, NULL, 0, NULL, 0);
+  fail_unless(idx < 0, "Failed to handle null directive");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  idx = lint_store_add_line(store, "ServerName", "ServerName \"Test\"", 17,
+    "/etc/proftpd.conf", 7);
+  fail_unless(idx == 0, "Expected index 0, got %d", idx);
+
+  /* Add enough lines to exercise the growth of the columns and slab. */
+  for (i = 0; i < 10000; i++) {
+    int len;
+
+    len = snprintf(buf, sizeof(buf), "Port %u", i);
+    idx = lint_store_add_line(store, "Port", buf, len, "/etc/proftpd.conf",
+      i + 8);
+    fail_unless(idx == (int) i + 1, "Expected index %u, got %d", i + 1, idx);
+  }
+
+  fail_unless(lint_store_count(store) == 10001, "Expected 10001 lines, got %u",
+    lint_store_count(store));
+
+  mark_point();
+  text = lint_store_get_text(store, 0, &textsz);
+  fail_unless(text != NULL, "Failed to get text: %s", strerror(errno));
+  fail_unless(strcmp(text, "ServerName \"Test\"") == 0,
+    "Expected 'ServerName \"Test\"', got '%s'", text);
+  fail_unless(textsz == 17, "Expected 17, got %lu", (unsigned long) textsz);
+
+  text = lint_store_get_text(store, 10000, &textsz);
+  fail_unless(strcmp(text, "Port 9999") == 0, "Expected 'Port 9999', got '%s'",
+    text);
+  fail_unless(textsz == 9, "Expected 9, got %lu", (unsigned long) textsz);
+
+  text = lint_store_get_text(store, 10001, NULL);
+  fail_unless(text == NULL, "Failed to handle out-of-range index");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  text = lint_store_get_directive(store, 5);
+  fail_unless(strcmp(text, "Port") == 0, "Expected 'Port', got '%s'", text);
+
+  source_file = lint_store_get_source_file(store, 5);
+  fail_unless(strcmp(source_file, "/etc/proftpd.conf") == 0,
+    "Expected '/etc/proftpd.conf', got '%s'", source_file);
+
+  /* Source files are interned, thus the same pointer. */
+  text2 = lint_store_get_source_file(store, 0);
+  fail_unless(text2 == source_file, "Expected interned source file");
+
+  fail_unless(lint_store_get_source_lineno(store, 5) == 12,
+    "Expected line 12, got %u", lint_store_get_source_lineno(store, 5));
+}
+END_TEST
+
+START_TEST (store_find_line_test) {
+  register unsigned int i;
+  int idx;
+  struct lint_store *store;
+
+  mark_point();
+  idx = lint_store_find_line(NULL, NULL);
+  fail_unless(idx < 0, "Failed to handle null store");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  store = lint_store_alloc(arena);
+  idx = lint_store_find_line(store, NULL);
+  fail_unless(idx < 0, "Failed to handle null directive");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  idx = lint_store_find_line(store, "Define");
+  fail_unless(idx < 0, "Failed to handle unknown directive");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  (void) lint_store_add_line(store, "Define", "Define A", 8, "/a.conf", 1);
+  (void) lint_store_add_line(store, "Port", "Port 21", 7, "/a.conf", 2);
+  (void) lint_store_add_line(store, "Define", "Define B", 8, "/b.conf", 1);
+  (void) lint_store_add_line(store, "define", "define C", 8, "/b.conf", 2);
+
+  /* Interned source files are not directives. */
+  mark_point();
+  idx = lint_store_find_line(store, "/a.conf");
+  fail_unless(idx < 0, "Failed to handle non-directive string");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  fail_unless(lint_store_count_lines(store, "Define") == 3,
+    "Expected 3 Define lines, got %u", lint_store_count_lines(store, "Define"));
+
+  /* Directives are matched ignoring case, as the parser does. */
+  idx = lint_store_find_line(store, "DEFINE");
+  fail_unless(idx == 0, "Expected index 0, got %d", idx);
+  fail_unless(strcmp(lint_store_get_directive(store, 3), "Define") == 0,
+    "Expected 'Define', got '%s'", lint_store_get_directive(store, 3));
+
+  idx = lint_store_next_line(store, idx);
+  fail_unless(idx == 2, "Expected index 2, got %d", idx);
+
+  idx = lint_store_next_line(store, idx);
+  fail_unless(idx == 3, "Expected index 3, got %d", idx);
+
+  idx = lint_store_next_line(store, idx);
+  fail_unless(idx < 0, "Expected no more lines, got %d", idx);
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  /* Directive IDs */
+  mark_point();
+  idx = lint_store_find_directive_id(store, "/b.conf");
+  fail_unless(idx < 0, "Failed to handle non-directive string");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  idx = lint_store_find_directive_id(store, "Port");
+  fail_unless(idx >= 0, "Failed to find Port directive ID: %s",
+    strerror(errno));
+  fail_unless(lint_store_get_directive_id(store, 1) == idx,
+    "Expected directive ID %d, got %d", idx,
+    lint_store_get_directive_id(store, 1));
+  fail_unless(lint_store_get_directive_id(store, 0) ==
+    lint_store_get_directive_id(store, 3), "Expected same Define IDs");
+
+  idx = lint_store_get_directive_id(store, 4);
+  fail_unless(idx < 0, "Failed to handle out-of-range index");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* Enough directives to grow the directive index. */
+  mark_point();
+  for (i = 0; i < 200; i++) {
+    char directive[32];
+
+    pr_snprintf(directive, sizeof(directive), "Directive%u", i);
+    (void) lint_store_add_line(store, directive, directive,
+      strlen(directive), "/c.conf", i + 1);
+  }
+
+  for (i = 0; i < 200; i++) {
+    char directive[32];
+
+    pr_snprintf(directive, sizeof(directive), "DIRECTIVE%u", i);
+    idx = lint_store_find_line(store, directive);
+    fail_unless(idx == (int) i + 4, "Expected index %u for '%s', got %d",
+      i + 4, directive, idx);
+  }
+}
+END_TEST
+
+START_TEST (store_configs_test) {
+  register unsigned int i;
+  int res;
+  unsigned int count;
+  struct lint_store *store;
+  const config_rec **configs;
+  config_rec c1, c2, c3;
+
+  mark_point();
+  res = lint_store_add_config(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null store");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  store = lint_store_alloc(arena);
+  res = lint_store_add_config(store, NULL);
+  fail_unless(res < 0, "Failed to handle null config");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_store_add_config(store, &c1);
+  fail_unless(res < 0, "Failed to handle missing line");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  mark_point();
+  configs = lint_store_get_configs(store, 0, &count);
+  fail_unless(configs == NULL, "Failed to handle out-of-range index");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  (void) lint_store_add_line(store, "Port", "Port 21", 7, "/a.conf", 1);
+  res = lint_store_add_config(store, &c1);
+  fail_unless(res == 0, "Failed to add config: %s", strerror(errno));
+
+  (void) lint_store_add_line(store, "Umask", "Umask 022", 9, "/a.conf", 2);
+  (void) lint_store_add_line(store, "Group", "Group ftp", 9, "/a.conf", 3);
+  res = lint_store_add_config(store, &c2);
+  fail_unless(res == 0, "Failed to add config: %s", strerror(errno));
+  res = lint_store_add_config(store, &c3);
+  fail_unless(res == 0, "Failed to add config: %s", strerror(errno));
+
+  configs = lint_store_get_configs(store, 0, &count);
+  fail_unless(configs != NULL, "Expected configs");
+  fail_unless(count == 1, "Expected 1 config, got %u", count);
+  fail_unless(configs[0] == &c1, "Expected first config");
+
+  configs = lint_store_get_configs(store, 1, &count);
+  fail_unless(configs == NULL, "Expected no configs");
+  fail_unless(count == 0, "Expected 0 configs, got %u", count);
+
+  configs = lint_store_get_configs(store, 2, &count);
+  fail_unless(count == 2, "Expected 2 configs, got %u", count);
+  fail_unless(configs[0] == &c2, "Expected second config");
+  fail_unless(configs[1] == &c3, "Expected third config");
+
+  /* Enough configs to exercise the growth of the array. */
+  for (i = 0; i < 1000; i++) {
+    (void) lint_store_add_line(store, "Port", "Port 21", 7, "/a.conf", i + 4);
+    (void) lint_store_add_config(store, &c1);
+  }
+
+  configs = lint_store_get_configs(store, 2, &count);
+  fail_unless(count == 2, "Expected 2 configs, got %u", count);
+  fail_unless(configs[1] == &c3, "Expected third config");
+
+  configs = lint_store_get_configs(store, 1002, &count);
+  fail_unless(count == 1, "Expected 1 config, got %u", count);
+  fail_unless(configs[0] == &c1, "Expected first config");
+}
+END_TEST
+
+START_TEST (store_find_config_line_test) {
+  register unsigned int i;
+  int idx;
+  struct lint_store *store;
+  config_rec c1, c2, *many;
+
+  mark_point();
+  idx = lint_store_find_config_line(NULL, NULL);
+  fail_unless(idx < 0, "Failed to handle null store");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  store = lint_store_alloc(arena);
+
+  mark_point();
+  idx = lint_store_find_config_line(store, NULL);
+  fail_unless(idx < 0, "Failed to handle null config");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  idx = lint_store_find_config_line(store, &c1);
+  fail_unless(idx < 0, "Failed to handle missing configs");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  (void) lint_store_add_line(store, "Port", "Port 21", 7, "/a.conf", 1);
+  (void) lint_store_add_line(store, "Umask", "Umask 022", 9, "/a.conf", 2);
+  (void) lint_store_add_config(store, &c1);
+
+  mark_point();
+  idx = lint_store_find_config_line(store, &c1);
+  fail_unless(idx == 1, "Expected line 1, got %d", idx);
+
+  idx = lint_store_find_config_line(store, &c2);
+  fail_unless(idx < 0, "Failed to handle unknown config");
+  fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+    strerror(errno), errno);
+
+  /* Configs added after a lookup are found too. */
+  mark_point();
+  (void) lint_store_add_config(store, &c2);
+  idx = lint_store_find_config_line(store, &c2);
+  fail_unless(idx == 1, "Expected line 1, got %d", idx);
+
+  many = pcalloc(p, sizeof(config_rec) * 500);
+  for (i = 0; i < 500; i++) {
+    (void) lint_store_add_line(store, "Port", "Port 21", 7, "/a.conf", i + 3);
+    (void) lint_store_add_config(store, &(many[i]));
+  }
+
+  for (i = 0; i < 500; i++) {
+    idx = lint_store_find_config_line(store, &(many[i]));
+    fail_unless(idx == (int) i + 2, "Expected line %u, got %d", i + 2, idx);
+  }
+}
+END_TEST
+
+START_TEST (store_server_test) {
+  int res;
+  struct lint_store *store;
+  server_rec s;
+
+  mark_point();
+  res = lint_store_set_server(NULL, 0, NULL);
+  fail_unless(res < 0, "Failed to handle null store");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  store = lint_store_alloc(arena);
+
+  mark_point();
+  res = lint_store_set_server(store, 0, &s);
+  fail_unless(res < 0, "Failed to handle missing line");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  (void) lint_store_add_line(store, "Port", "Port 21", 7, "/a.conf", 1);
+  (void) lint_store_add_line(store, "Port", "Port 2121", 9, "/a.conf", 2);
+
+  mark_point();
+  fail_unless(lint_store_get_server(store, 0) == NULL,
+    "Expected no server for unset line");
+
+  res = lint_store_set_server(store, 1, &s);
+  fail_unless(res == 0, "Failed to set server: %s", strerror(errno));
+  fail_unless(lint_store_get_server(store, 1) == &s,
+    "Expected server for line 1");
+  fail_unless(lint_store_get_server(store, 0) == NULL,
+    "Expected no server for line 0");
+}
+END_TEST
+
+Suite *tests_get_store_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("store");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, store_alloc_test);
+  tcase_add_test(testcase, store_intern_test);
+  tcase_add_test(testcase, store_add_line_test);
+  tcase_add_test(testcase, store_find_line_test);
+  tcase_add_test(testcase, store_configs_test);
+  tcase_add_test(testcase, store_find_config_line_test);
+  tcase_add_test(testcase, store_server_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
@@ -0,0 +1,185 @@
+/*
+ * ProFTPD - mod_lint API testsuite
+ * Copyright (c) 2021 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* Symbol table API tests. */
+
+#include "tests.h"
+#include "lint/symtab.h"
+
+static pool *p = NULL;
+static struct lint_arena *arena = NULL;
+
+static void set_up(void) {
+  if (p == NULL) {
+    p = permanent_pool = make_sub_pool(NULL);
+  }
+
+  if (arena == NULL) {
+    arena = lint_arena_create(0);
+  }
+
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.symtab", 1, 20);
+  }
+
+  mark_point();
+}
+
+static void tear_down(void) {
+  if (getenv("TEST_VERBOSE") != NULL) {
+    pr_trace_set_levels("lint.symtab", 0, 0);
+  }
+
+  if (arena != NULL) {
+    lint_arena_destroy(arena);
+    arena = NULL;
+  }
+
+  if (p != NULL) {
+    destroy_pool(p);
+    p = permanent_pool = NULL;
+  }
+}
+
+START_TEST (symtab_alloc_test) {
+  struct lint_symtab *symtab;
+
+  mark_point();
+  symtab = lint_symtab_alloc(NULL);
+  fail_unless(symtab == NULL, "Failed to handle null arena");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  symtab = lint_symtab_alloc(arena);
+  fail_unless(symtab != NULL, "Failed to allocate symtab: %s",
+    strerror(errno));
+}
+END_TEST
+
+START_TEST (symtab_get_module_test) {
+  register unsigned int i;
+  struct lint_symtab *symtab;
+  module *m;
+  char name[32];
+
+  mark_point();
+  m = lint_symtab_get_module(NULL, NULL);
+  fail_unless(m == NULL, "Failed to handle null symtab");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  symtab = lint_symtab_alloc(arena);
+  m = lint_symtab_get_module(symtab, NULL);
+  fail_unless(m == NULL, "Failed to handle null directive");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  /* Unknown directives are remembered as such, too. */
+  for (i = 0; i < 2; i++) {
+    mark_point();
+    m = lint_symtab_get_module(symtab, "FooBar");
+    fail_unless(m == NULL, "Failed to handle unknown directive");
+    fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+      strerror(errno), errno);
+  }
+
+  /* Enough symbols to exercise the growth of the table. */
+  for (i = 0; i < 1000; i++) {
+    snprintf(name, sizeof(name), "Directive%u", i);
+    m = lint_symtab_get_module(symtab, name);
+    fail_unless(m == NULL, "Failed to handle unknown directive");
+    fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+      strerror(errno), errno);
+  }
+}
+END_TEST
+
+START_TEST (symtab_get_cop_test) {
+  register unsigned int i;
+  struct lint_symtab *symtab;
+  const struct lint_cop *cop;
+  config_rec *c;
+
+  mark_point();
+  cop = lint_symtab_get_cop(NULL, NULL, NULL);
+  fail_unless(cop == NULL, "Failed to handle null symtab");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  symtab = lint_symtab_alloc(arena);
+  cop = lint_symtab_get_cop(symtab, NULL, NULL);
+  fail_unless(cop == NULL, "Failed to handle null config");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  c = pcalloc(p, sizeof(config_rec));
+  c->name = pstrdup(p, "LintEngine");
+  cop = lint_symtab_get_cop(symtab, c, NULL);
+  fail_unless(cop == NULL, "Failed to handle non-param config");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  c->config_type = CONF_PARAM;
+  for (i = 0; i < 2; i++) {
+    mark_point();
+    cop = lint_symtab_get_cop(symtab, c, NULL);
+    fail_unless(cop == NULL, "Failed to handle unknown config");
+    fail_unless(errno == ENOENT, "Expected ENOENT (%d), got %s (%d)", ENOENT,
+      strerror(errno), errno);
+  }
+
+  c->name = pstrdup(p, "UserName");
+  for (i = 0; i < 2; i++) {
+    struct lint_cop_ctx ctx;
+
+    mark_point();
+    cop = lint_symtab_get_cop(symtab, c, &ctx);
+    fail_unless(cop != NULL, "Failed to get cop: %s", strerror(errno));
+    fail_unless(strcmp(cop->name, "core") == 0,
+      "Expected 'core', got '%s'", cop->name);
+    fail_unless(ctx.cop == cop, "Expected cop in context");
+  }
+}
+END_TEST
+
+Suite *tests_get_symtab_suite(void) {
+  Suite *suite;
+  TCase *testcase;
+
+  suite = suite_create("symtab");
+  testcase = tcase_create("base");
+
+  tcase_add_checked_fixture(testcase, set_up, tear_down);
+
+  tcase_add_test(testcase, symtab_alloc_test);
+  tcase_add_test(testcase, symtab_get_module_test);
+  tcase_add_test(testcase, symtab_get_cop_test);
+
+  suite_add_tcase(suite, testcase);
+  return suite;
+}
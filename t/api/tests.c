@@ -32,6 +32,17 @@ struct testsuite_info {
 static struct testsuite_info suites[] = {
   { "text",		tests_get_text_suite },
   { "cop",		tests_get_cop_suite },
+  { "hash",		tests_get_hash_suite },
+  { "state",		tests_get_state_suite },
+  { "store",		tests_get_store_suite },
+  { "arena",		tests_get_arena_suite },
+  { "capture",		tests_get_capture_suite },
+  { "symtab",		tests_get_symtab_suite },
+  { "run",		tests_get_run_suite },
+  { "perf",		tests_get_perf_suite },
+  { "profile",		tests_get_profile_suite },
+  { "dns",		tests_get_dns_suite },
+  { "rule",		tests_get_rule_suite },
 
   { NULL, NULL }
 };
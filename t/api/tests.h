@@ -39,6 +39,17 @@ int tests_mkpath(pool *p, const char *path);
 int tests_rmpath(pool *p, const char *path);
 
 Suite *tests_get_cop_suite(void);
+Suite *tests_get_hash_suite(void);
+Suite *tests_get_state_suite(void);
+Suite *tests_get_store_suite(void);
+Suite *tests_get_arena_suite(void);
+Suite *tests_get_capture_suite(void);
+Suite *tests_get_symtab_suite(void);
+Suite *tests_get_run_suite(void);
+Suite *tests_get_perf_suite(void);
+Suite *tests_get_profile_suite(void);
+Suite *tests_get_dns_suite(void);
+Suite *tests_get_rule_suite(void);
 Suite *tests_get_text_suite(void);
 
 extern volatile unsigned int recvd_signal_flags;
@@ -29,6 +29,8 @@
 
 static pool *p = NULL;
 
+static const char *writer_path = "/tmp/lint-test-writer.conf";
+
 static void set_up(void) {
   if (p == NULL) {
     p = permanent_pool = make_sub_pool(NULL);
@@ -42,6 +44,8 @@ static void set_up(void) {
 }
 
 static void tear_down(void) {
+  (void) unlink(writer_path);
+
   if (getenv("TEST_VERBOSE") != NULL) {
     pr_trace_set_levels("lint.text", 0, 0);
   }
@@ -186,6 +190,395 @@ START_TEST (text_write_buffered_lines_test) {
 }
 END_TEST
 
+static int sorted_linecmp(const void *a, const void *b) {
+  const struct lint_buffered_line *bla, *blb;
+
+  bla = *((const struct lint_buffered_line **) a);
+  blb = *((const struct lint_buffered_line **) b);
+  return strcmp(lint_text_line_get_text(p, bla),
+    lint_text_line_get_text(p, blb));
+}
+
+START_TEST (text_sort_buffered_lines_test) {
+  register unsigned int i;
+  int res;
+  array_header *list, *expected;
+  struct lint_buffered_line **lines, **expected_lines;
+  const char *prefixes[] = {
+    "", "  ", "  <", "Allow", "AllowOverwrite", "AllowOverride", "\xe9t", NULL
+  };
+
+  mark_point();
+  lint_text_sort_buffered_lines(NULL);
+
+  /* Enough lines to use the radix sort, with shared prefixes, lines shorter
+   * than the key, and duplicates.
+   */
+  list = make_array(p, 0, sizeof(struct lint_buffered_line *));
+  for (i = 0; i < 5000; i++) {
+    const char *prefix;
+
+    prefix = prefixes[(i * 31 + 3) % 7];
+    if (i % 5 == 0) {
+      res = lint_text_add_fmt(p, list, "%s\n", prefix);
+
+    } else if (i % 3 == 0) {
+      struct lint_buffered_line *bl;
+
+      /* Segmented lines must sort the same as formatted ones. */
+      bl = lint_text_line_create(p);
+      lint_text_line_add_str(bl, prefix);
+      lint_text_line_add_str(bl, " ");
+      lint_text_line_add_uint(bl, (i * 7919) % 1000);
+      res = lint_text_add_line(list, bl);
+
+    } else {
+      res = lint_text_add_fmt(p, list, "%s %u\n", prefix, (i * 7919) % 1000);
+    }
+
+    fail_unless(res == 0, "Failed to add line: %s", strerror(errno));
+  }
+
+  expected = copy_array(p, list);
+  qsort(expected->elts, expected->nelts, sizeof(struct lint_buffered_line *),
+    sorted_linecmp);
+
+  mark_point();
+  lint_text_sort_buffered_lines(list);
+  fail_unless(list->nelts == expected->nelts, "Expected %u lines, got %u",
+    expected->nelts, list->nelts);
+
+  lines = list->elts;
+  expected_lines = expected->elts;
+  for (i = 0; i < list->nelts; i++) {
+    const char *text, *expected_text;
+
+    text = lint_text_line_get_text(p, lines[i]);
+    expected_text = lint_text_line_get_text(p, expected_lines[i]);
+    fail_unless(strcmp(text, expected_text) == 0,
+      "Expected '%s' at %u, got '%s'", expected_text, i, text);
+
+    /* Equal lines stay in insertion order. */
+    if (i > 0 &&
+        strcmp(lint_text_line_get_text(p, lines[i-1]), text) == 0) {
+      fail_unless(lines[i-1]->seq < lines[i]->seq,
+        "Expected stable order for '%s' at %u", text, i);
+    }
+  }
+}
+END_TEST
+
+START_TEST (text_add_fmt_long_test) {
+  int res;
+  array_header *list;
+  struct lint_buffered_line *bl;
+  char *long_text;
+  size_t long_len = 64 * 1024;
+
+  long_text = pcalloc(p, long_len + 1);
+  memset(long_text, 'A', long_len);
+
+  list = make_array(p, 0, sizeof(struct lint_buffered_line *));
+  res = lint_text_add_fmt(p, list, "Directive %s\n", long_text);
+  fail_unless(res == 0, "Failed to add long line: %s", strerror(errno));
+
+  /* Long lines are kept whole, not truncated. */
+  bl = ((struct lint_buffered_line **) list->elts)[0];
+  fail_unless(bl->textsz == long_len + 11, "Expected %lu, got %lu",
+    (unsigned long) long_len + 11, (unsigned long) bl->textsz);
+  fail_unless(strlen(lint_text_line_get_text(p, bl)) == long_len + 11,
+    "Expected full text of long line");
+}
+END_TEST
+
+START_TEST (text_line_builder_test) {
+  int res;
+  array_header *list;
+  struct lint_buffered_line *bl;
+  const char *text, *name = "Example Server";
+
+  mark_point();
+  bl = lint_text_line_create(NULL);
+  fail_unless(bl == NULL, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_text_line_add_str(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null line");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_text_add_line(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null list");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  list = make_array(p, 0, sizeof(struct lint_buffered_line *));
+
+  /* More segments than are held inline. */
+  mark_point();
+  bl = lint_text_line_create(p);
+  fail_unless(bl != NULL, "Failed to create line: %s", strerror(errno));
+  lint_text_line_add_indent(bl, 2);
+  lint_text_line_add_str(bl, "ServerName ");
+  lint_text_line_add_quoted(bl, name);
+  lint_text_line_add_str(bl, " ");
+  lint_text_line_add_uint(bl, 0);
+  lint_text_line_add_str(bl, " ");
+  lint_text_line_add_int(bl, -42);
+  lint_text_line_add_str(bl, " ");
+  lint_text_line_add_bool(bl, TRUE);
+  lint_text_line_add_str(bl, " ");
+  lint_text_line_add_bool(bl, FALSE);
+  res = lint_text_add_line(list, bl);
+  fail_unless(res == 0, "Failed to add line: %s", strerror(errno));
+
+  text = lint_text_line_get_text(p, bl);
+  fail_unless(strcmp(text,
+    "    ServerName \"Example Server\" 0 -42 on off\n") == 0,
+    "Expected built line, got '%s'", text);
+  fail_unless(bl->textsz == strlen(text), "Expected %lu, got %lu",
+    (unsigned long) strlen(text), (unsigned long) bl->textsz);
+
+  /* Strings are referenced, not copied. */
+  fail_unless(bl->segs[bl->nsegs-1].iov_base != name, "Unexpected segment");
+  fail_unless(bl->segs[3].iov_base == name, "Expected referenced string");
+
+  /* Deep indentation spans multiple segments. */
+  mark_point();
+  bl = lint_text_line_create(p);
+  lint_text_line_add_indent(bl, 40);
+  lint_text_line_add_str(bl, "Umask 022");
+  res = lint_text_add_line(list, bl);
+  fail_unless(res == 0, "Failed to add line: %s", strerror(errno));
+  fail_unless(bl->textsz == 90, "Expected 90, got %lu",
+    (unsigned long) bl->textsz);
+}
+END_TEST
+
+START_TEST (text_line_add_lines_test) {
+  int res;
+  array_header *list, *nested;
+  struct lint_buffered_line *bl;
+  const char *text;
+
+  mark_point();
+  res = lint_text_line_add_lines(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null line");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  bl = lint_text_line_create(p);
+
+  mark_point();
+  res = lint_text_line_add_lines(bl, NULL);
+  fail_unless(res < 0, "Failed to handle null list");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  nested = make_array(p, 0, sizeof(struct lint_buffered_line *));
+  (void) lint_text_add_fmt(p, nested, "%s\n", "  Umask 077");
+  (void) lint_text_add_fmt(p, nested, "%s\n", "  AllowOverwrite on");
+  lint_text_sort_buffered_lines(nested);
+
+  mark_point();
+  lint_text_line_add_str(bl, "<Directory /tmp>\n");
+  res = lint_text_line_add_lines(bl, nested);
+  fail_unless(res == 0, "Failed to add lines: %s", strerror(errno));
+  lint_text_line_add_str(bl, "</Directory>");
+
+  list = make_array(p, 0, sizeof(struct lint_buffered_line *));
+  res = lint_text_add_line(list, bl);
+  fail_unless(res == 0, "Failed to add line: %s", strerror(errno));
+
+  /* The block is sorted by its first line. */
+  (void) lint_text_add_fmt(p, list, "%s\n", "Umask 022");
+  (void) lint_text_add_fmt(p, list, "%s\n", "AllowOverwrite off");
+  lint_text_sort_buffered_lines(list);
+
+  text = lint_text_line_get_text(p,
+    ((struct lint_buffered_line **) list->elts)[0]);
+  fail_unless(strcmp(text, "<Directory /tmp>\n  AllowOverwrite on\n"
+    "  Umask 077\n</Directory>\n") == 0, "Expected block, got '%s'", text);
+}
+END_TEST
+
+START_TEST (text_writer_create_test) {
+  struct lint_text_writer *w;
+  pr_fh_t *fh;
+
+  mark_point();
+  w = lint_text_writer_create(NULL, NULL);
+  fail_unless(w == NULL, "Failed to handle null pool");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  w = lint_text_writer_create(p, NULL);
+  fail_unless(w == NULL, "Failed to handle null fh");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  fh = pr_fsio_open(writer_path, O_CREAT|O_WRONLY|O_TRUNC);
+  fail_unless(fh != NULL, "Failed to open '%s': %s", writer_path,
+    strerror(errno));
+
+  w = lint_text_writer_create(p, fh);
+  fail_unless(w != NULL, "Failed to create writer: %s", strerror(errno));
+
+  mark_point();
+  (void) lint_text_writer_close(w);
+}
+END_TEST
+
+START_TEST (text_writer_fmt_test) {
+  int res;
+  struct lint_text_writer *w;
+
+  mark_point();
+  res = lint_text_writer_fmt(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null writer");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  /* We don't need a real writer for this test. */
+  w = (struct lint_text_writer *) 10;
+  res = lint_text_writer_fmt(w, NULL);
+  fail_unless(res < 0, "Failed to handle null fmt");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+}
+END_TEST
+
+START_TEST (text_writer_text_test) {
+  int res;
+  struct lint_text_writer *w;
+
+  mark_point();
+  res = lint_text_writer_text(NULL, NULL, 0);
+  fail_unless(res < 0, "Failed to handle null writer");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  /* We don't need a real writer for this test. */
+  w = (struct lint_text_writer *) 11;
+  res = lint_text_writer_text(w, NULL, 0);
+  fail_unless(res < 0, "Failed to handle null text");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_text_writer_text(w, "foobar", 0);
+  fail_unless(res == 0, "Failed to handle zero text len: %s", strerror(errno));
+}
+END_TEST
+
+START_TEST (text_writer_buffered_lines_test) {
+  int res;
+  struct lint_text_writer *w;
+
+  mark_point();
+  res = lint_text_writer_buffered_lines(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null writer");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  /* We don't need a real writer for this test. */
+  w = (struct lint_text_writer *) 12;
+  res = lint_text_writer_buffered_lines(w, NULL);
+  fail_unless(res == 0, "Failed to handle null list: %s", strerror(errno));
+}
+END_TEST
+
+START_TEST (text_writer_close_test) {
+  register unsigned int i;
+  int res;
+  struct lint_text_writer *w;
+  pr_fh_t *fh;
+  array_header *list;
+  struct stat st;
+  struct lint_text_writer_stats stats;
+  size_t expected_len = 0;
+
+  mark_point();
+  res = lint_text_writer_flush(NULL);
+  fail_unless(res < 0, "Failed to handle null writer");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  res = lint_text_writer_close(NULL);
+  fail_unless(res < 0, "Failed to handle null writer");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  mark_point();
+  fh = pr_fsio_open(writer_path, O_CREAT|O_WRONLY|O_TRUNC);
+  fail_unless(fh != NULL, "Failed to open '%s': %s", writer_path,
+    strerror(errno));
+
+  w = lint_text_writer_create(p, fh);
+  fail_unless(w != NULL, "Failed to create writer: %s", strerror(errno));
+
+  /* Write enough lines to span multiple blocks, and multiple flushes. */
+  list = make_array(p, 0, sizeof(struct lint_buffered_line *));
+  for (i = 0; i < 100000; i++) {
+    res = lint_text_add_fmt(p, list, "Directive%06u value\n", i);
+    fail_unless(res == 0, "Failed to add line: %s", strerror(errno));
+    expected_len += 22;
+  }
+
+  res = lint_text_writer_fmt(w, "# %s\n", "Header");
+  fail_unless(res == 0, "Failed to write text: %s", strerror(errno));
+  expected_len += 9;
+
+  res = lint_text_writer_buffered_lines(w, list);
+  fail_unless(res == 0, "Failed to write lines: %s", strerror(errno));
+
+  res = lint_text_writer_flush(w);
+  fail_unless(res == 0, "Failed to flush writer: %s", strerror(errno));
+
+  mark_point();
+  res = lint_text_writer_get_stats(NULL, NULL);
+  fail_unless(res < 0, "Failed to handle null writer");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = lint_text_writer_get_stats(w, NULL);
+  fail_unless(res < 0, "Failed to handle null stats");
+  fail_unless(errno == EINVAL, "Expected EINVAL (%d), got %s (%d)", EINVAL,
+    strerror(errno), errno);
+
+  res = lint_text_writer_get_stats(w, &stats);
+  fail_unless(res == 0, "Failed to get writer stats: %s", strerror(errno));
+  fail_unless(stats.bytes_written == expected_len,
+    "Expected %lu bytes written, got %lu", (unsigned long) expected_len,
+    (unsigned long) stats.bytes_written);
+  fail_unless(stats.nwrites > 0, "Expected writes, got none");
+
+  res = lint_text_writer_fmt(w, "%s", "# Footer\n");
+  fail_unless(res == 0, "Failed to write text: %s", strerror(errno));
+  expected_len += 9;
+
+  mark_point();
+  res = lint_text_writer_close(w);
+  fail_unless(res == 0, "Failed to close writer: %s", strerror(errno));
+
+  res = stat(writer_path, &st);
+  fail_unless(res == 0, "Failed to stat '%s': %s", writer_path,
+    strerror(errno));
+  fail_unless((size_t) st.st_size == expected_len,
+    "Expected %lu bytes, got %lu", (unsigned long) expected_len,
+    (unsigned long) st.st_size);
+}
+END_TEST
+
 Suite *tests_get_text_suite(void) {
   Suite *suite;
   TCase *testcase;
@@ -203,6 +596,16 @@ Suite *tests_get_text_suite(void) {
   tcase_add_test(testcase, text_write_text_test);
 
   tcase_add_test(testcase, text_write_buffered_lines_test);
+  tcase_add_test(testcase, text_sort_buffered_lines_test);
+  tcase_add_test(testcase, text_add_fmt_long_test);
+  tcase_add_test(testcase, text_line_builder_test);
+  tcase_add_test(testcase, text_line_add_lines_test);
+
+  tcase_add_test(testcase, text_writer_create_test);
+  tcase_add_test(testcase, text_writer_fmt_test);
+  tcase_add_test(testcase, text_writer_text_test);
+  tcase_add_test(testcase, text_writer_buffered_lines_test);
+  tcase_add_test(testcase, text_writer_close_test);
 
   suite_add_tcase(suite, testcase);
   return suite;
@@ -0,0 +1,207 @@
+/*
+ * ProFTPD - mod_lint capture benchmark
+ * Copyright (c) 2021 TJ Saunders <tj@castaglia.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+ *
+ * As a special exemption, TJ Saunders and other respective copyright holders
+ * give permission to link this program with OpenSSL, and distribute the
+ * resulting executable, without including the source code for OpenSSL in the
+ * source distribution.
+ */
+
+/* Measures the per-line cost, at parse time, of capturing a parsed line,
+ * against that of resolving and storing it there and then, as the
+ * core.parsed-line listener used to do.  Run via "make bench-capture" in
+ * the t/ directory; the number of lines, and of distinct directives, may
+ * be given as arguments.
+ */
+
+#include "tests.h"
+#include "lint/capture.h"
+#include "lint/perf.h"
+#include "lint/store.h"
+#include "lint/symtab.h"
+
+#define BENCH_DEFAULT_NLINES		1000000
+#define BENCH_DEFAULT_NDIRECTIVES	200
+
+static module bench_module;
+static char **directives = NULL;
+static unsigned int ndirectives = BENCH_DEFAULT_NDIRECTIVES;
+
+/* Registers the directives, as handled by our module, so that they are
+ * known to the symbol table, as they would be in a running server.
+ */
+static void register_directives(pool *p) {
+  register unsigned int i;
+  conftable *conftab;
+
+  bench_module.name = "mod_bench.c";
+
+  directives = pcalloc(p, sizeof(char *) * ndirectives);
+  conftab = pcalloc(p, sizeof(conftable) * (ndirectives + 1));
+
+  for (i = 0; i < ndirectives; i++) {
+    char name[64];
+
+    pr_snprintf(name, sizeof(name)-1, "BenchDirective%u", i);
+    directives[i] = pstrdup(p, name);
+
+    conftab[i].directive = directives[i];
+    conftab[i].m = &bench_module;
+    (void) pr_stash_add_symbol(PR_SYM_CONF, &conftab[i]);
+  }
+
+  bench_module.conftable = conftab;
+}
+
+/* Generates the i'th synthetic line, returning its length. */
+static size_t make_line(char *buf, size_t bufsz, unsigned int i) {
+  int len;
+
+  len = pr_snprintf(buf, bufsz, "  %s value%u", directives[i % ndirectives],
+    i);
+  return (size_t) len;
+}
+
+static uint64_t bench_generate(unsigned int nlines) {
+  register unsigned int i;
+  uint64_t start_ns;
+  char buf[128];
+  volatile size_t total = 0;
+
+  start_ns = lint_perf_now();
+  for (i = 0; i < nlines; i++) {
+    total += make_line(buf, sizeof(buf), i);
+  }
+
+  return lint_perf_now() - start_ns;
+}
+
+static uint64_t bench_capture(unsigned int nlines) {
+  register unsigned int i;
+  struct lint_arena *arena;
+  struct lint_capture *cap;
+  uint64_t elapsed_ns, start_ns;
+  char buf[128];
+
+  arena = lint_arena_create(0);
+  cap = lint_capture_alloc(arena);
+
+  start_ns = lint_perf_now();
+  for (i = 0; i < nlines; i++) {
+    size_t len;
+
+    len = make_line(buf, sizeof(buf), i);
+    (void) lint_capture_add_line(cap, buf, len, NULL, "/etc/proftpd.conf",
+      i + 1);
+  }
+  elapsed_ns = lint_perf_now() - start_ns;
+
+  lint_arena_destroy(arena);
+  return elapsed_ns;
+}
+
+/* The work which the listener used to do for each line: looking up the
+ * directive, trimming the text, and storing it.
+ */
+static uint64_t bench_resolve(unsigned int nlines) {
+  register unsigned int i;
+  struct lint_arena *arena;
+  struct lint_symtab *symtab;
+  struct lint_store *store;
+  uint64_t elapsed_ns, start_ns;
+  char buf[128];
+
+  arena = lint_arena_create(0);
+  symtab = lint_symtab_alloc(arena);
+  store = lint_store_alloc(arena);
+
+  start_ns = lint_perf_now();
+  for (i = 0; i < nlines; i++) {
+    const char *directive, *text;
+    size_t len;
+
+    len = make_line(buf, sizeof(buf), i);
+    directive = directives[i % ndirectives];
+
+    if (lint_symtab_get_module(symtab, directive) == NULL) {
+      continue;
+    }
+
+    for (text = buf; *text && PR_ISSPACE(*text); text++, len--) {
+    }
+
+    (void) lint_store_add_line(store, directive, text, len,
+      "/etc/proftpd.conf", i + 1);
+  }
+  elapsed_ns = lint_perf_now() - start_ns;
+
+  lint_arena_destroy(arena);
+  return elapsed_ns;
+}
+
+static void report(const char *label, uint64_t elapsed_ns, uint64_t base_ns,
+    unsigned int nlines) {
+  double per_line_ns;
+
+  per_line_ns = elapsed_ns > base_ns ?
+    (double) (elapsed_ns - base_ns) / nlines : 0.0;
+  printf("%-8s %10.1f ms total, %8.1f ns/line\n", label,
+    elapsed_ns / 1000000.0, per_line_ns);
+}
+
+int main(int argc, char *argv[]) {
+  pool *p;
+  unsigned int nlines = BENCH_DEFAULT_NLINES;
+  uint64_t generate_ns, capture_ns, resolve_ns;
+
+  if (argc > 1) {
+    nlines = (unsigned int) strtoul(argv[1], NULL, 10);
+  }
+
+  if (argc > 2) {
+    ndirectives = (unsigned int) strtoul(argv[2], NULL, 10);
+  }
+
+  if (nlines == 0 ||
+      ndirectives == 0) {
+    fprintf(stderr, "usage: %s [nlines [ndirectives]]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  p = permanent_pool = make_sub_pool(NULL);
+  init_stash();
+  register_directives(p);
+
+  printf("%u lines, %u distinct directives; the per-line costs of capture "
+    "and resolve exclude generating the lines\n", nlines, ndirectives);
+
+  /* Warm up the allocator, and the caches, before measuring. */
+  (void) bench_capture(nlines / 10 + 1);
+  (void) bench_resolve(nlines / 10 + 1);
+
+  generate_ns = bench_generate(nlines);
+  capture_ns = bench_capture(nlines);
+  resolve_ns = bench_resolve(nlines);
+
+  report("generate", generate_ns, 0, nlines);
+  report("capture", capture_ns, generate_ns, nlines);
+  report("resolve", resolve_ns, generate_ns, nlines);
+
+  destroy_pool(p);
+  return EXIT_SUCCESS;
+}
@@ -32,6 +32,41 @@ my $TESTS = {
     test_class => [qw(feature_dso forking)],
   },
 
+  lint_options_background => {
+    order => ++$order,
+    test_class => [qw(forking)],
+  },
+
+  lint_mode_passthrough => {
+    order => ++$order,
+    test_class => [qw(forking)],
+  },
+
+  lint_profile_file => {
+    order => ++$order,
+    test_class => [qw(forking)],
+  },
+
+  lint_sections_round_trip => {
+    order => ++$order,
+    test_class => [qw(forking)],
+  },
+
+  lint_options_numeric_addresses => {
+    order => ++$order,
+    test_class => [qw(forking)],
+  },
+
+  lint_state_file_numeric_addresses => {
+    order => ++$order,
+    test_class => [qw(forking)],
+  },
+
+  lint_state_file_vhost_cache => {
+    order => ++$order,
+    test_class => [qw(forking)],
+  },
+
 };
 
 sub new {
@@ -317,4 +352,699 @@ sub lint_dso {
   test_cleanup($setup->{log_file}, $ex);
 }
 
+sub lint_options_background {
+  my $self = shift;
+  my $tmpdir = $self->{tmpdir};
+  my $setup = test_setup($tmpdir, 'lint');
+
+  my $lint_config_file = File::Spec->rel2abs("$tmpdir/generated.conf");
+
+  my $config = {
+    PidFile => $setup->{pid_file},
+    ScoreboardFile => $setup->{scoreboard_file},
+    SystemLog => $setup->{log_file},
+    TraceLog => $setup->{log_file},
+    Trace => 'lint:20',
+
+    AuthUserFile => $setup->{auth_user_file},
+    AuthGroupFile => $setup->{auth_group_file},
+
+    IfModules => {
+      'mod_lint.c' => {
+        LintConfigFile => $lint_config_file,
+        LintOptions => 'Background',
+      },
+    },
+  };
+
+  my ($port, $config_user, $config_group) = config_write($setup->{config_file},
+    $config);
+
+  server_start($setup->{config_file}, $setup->{pid_file});
+
+  # Give the background process time to emit the config.
+  sleep(2);
+
+  server_stop($setup->{pid_file});
+
+  my $ex;
+
+  eval { assert_lint_config_ok($setup->{log_file}, $lint_config_file) };
+  if ($@) {
+    $ex = $@;
+  }
+
+  test_cleanup($setup->{log_file}, $ex);
+}
+
+sub lint_mode_passthrough {
+  my $self = shift;
+  my $tmpdir = $self->{tmpdir};
+  my $setup = test_setup($tmpdir, 'lint');
+
+  my $lint_config_file = File::Spec->rel2abs("$tmpdir/generated.conf");
+  my $include_file = File::Spec->rel2abs("$tmpdir/included.conf");
+
+  my $config = {
+    PidFile => $setup->{pid_file},
+    ScoreboardFile => $setup->{scoreboard_file},
+    SystemLog => $setup->{log_file},
+    TraceLog => $setup->{log_file},
+    Trace => 'lint:20',
+
+    AuthUserFile => $setup->{auth_user_file},
+    AuthGroupFile => $setup->{auth_group_file},
+
+    AllowOverwrite => 'on',
+
+    IfModules => {
+      'mod_lint.c' => {
+        LintConfigFile => $lint_config_file,
+        LintMode => 'passthrough',
+      },
+    },
+  };
+
+  my ($port, $config_user, $config_group) = config_write($setup->{config_file},
+    $config);
+
+  # The included lines are written in place of the Include line.
+  if (open(my $fh, "> $include_file")) {
+    print $fh "MaxLoginAttempts 5\n";
+    unless (close($fh)) {
+      die("Can't write $include_file: $!");
+    }
+
+  } else {
+    die("Can't open $include_file: $!");
+  }
+
+  if (open(my $fh, ">> $setup->{config_file}")) {
+    print $fh "Include $include_file\n";
+    unless (close($fh)) {
+      die("Can't write $setup->{config_file}: $!");
+    }
+
+  } else {
+    die("Can't open $setup->{config_file}: $!");
+  }
+
+  server_start($setup->{config_file}, $setup->{pid_file});
+  server_stop($setup->{pid_file});
+
+  my $ex;
+
+  eval {
+    my $config_file = $setup->{config_file};
+    my $annotations = 0;
+    my $saw_overwrite = 0;
+    my $saw_included = 0;
+    my $skipped_lines = 0;
+
+    if (open(my $fh, "< $lint_config_file")) {
+      my $prev_line = '';
+
+      while (my $line = <$fh>) {
+        chomp($line);
+
+        if ($ENV{TEST_VERBOSE}) {
+          print STDERR "$line\n";
+        }
+
+        if ($line =~ /^# \Q$config_file\E:\d+$/) {
+          $annotations++;
+        }
+
+        if ($line =~ /^AllowOverwrite on$/i &&
+            $prev_line =~ /^# \Q$config_file\E:\d+$/) {
+          $saw_overwrite = 1;
+        }
+
+        if ($line =~ /^MaxLoginAttempts 5$/ &&
+            $prev_line =~ /^# \Q$include_file\E:1$/) {
+          $saw_included = 1;
+        }
+
+        if ($line =~ /^(Include\s|<\/?IfModule)/i) {
+          $skipped_lines++;
+        }
+
+        $prev_line = $line;
+      }
+
+      close($fh);
+
+    } else {
+      die("Can't read $lint_config_file: $!");
+    }
+
+    $self->assert($annotations > 0,
+      test_msg("Expected source annotations in $lint_config_file"));
+    $self->assert($saw_overwrite,
+      test_msg("Expected annotated AllowOverwrite line in $lint_config_file"));
+    $self->assert($saw_included,
+      test_msg("Expected included MaxLoginAttempts line in $lint_config_file"));
+    $self->assert($skipped_lines == 0,
+      test_msg("Expected no Include or <IfModule> lines in $lint_config_file"));
+
+    # The generated config must load.
+    server_test_config($lint_config_file);
+  };
+  if ($@) {
+    $ex = $@;
+  }
+
+  test_cleanup($setup->{log_file}, $ex);
+}
+
+sub lint_profile_file {
+  my $self = shift;
+  my $tmpdir = $self->{tmpdir};
+  my $setup = test_setup($tmpdir, 'lint');
+
+  my $lint_config_file = File::Spec->rel2abs("$tmpdir/generated.conf");
+  my $lint_profile_file = File::Spec->rel2abs("$tmpdir/profile.txt");
+
+  my $config = {
+    PidFile => $setup->{pid_file},
+    ScoreboardFile => $setup->{scoreboard_file},
+    SystemLog => $setup->{log_file},
+    TraceLog => $setup->{log_file},
+    Trace => 'lint:20',
+
+    AuthUserFile => $setup->{auth_user_file},
+    AuthGroupFile => $setup->{auth_group_file},
+
+    IfModules => {
+      'mod_lint.c' => {
+        LintConfigFile => $lint_config_file,
+        LintProfileFile => $lint_profile_file,
+      },
+    },
+  };
+
+  my ($port, $config_user, $config_group) = config_write($setup->{config_file},
+    $config);
+
+  server_start($setup->{config_file}, $setup->{pid_file});
+  server_stop($setup->{pid_file});
+
+  my $ex;
+
+  eval {
+    my $saw_header = 0;
+    my $saw_files = 0;
+    my $saw_directive = 0;
+
+    if (open(my $fh, "< $lint_profile_file")) {
+      while (my $line = <$fh>) {
+        chomp($line);
+
+        if ($ENV{TEST_VERBOSE}) {
+          print STDERR "$line\n";
+        }
+
+        if ($line =~ /^# mod_lint\/\S+ parse profile$/) {
+          $saw_header = 1;
+        }
+
+        if ($line =~ /^# Files \(self time\)$/) {
+          $saw_files = 1;
+        }
+
+        if ($line =~ /\s+LintProfileFile$/) {
+          $saw_directive = 1;
+        }
+      }
+
+      close($fh);
+
+    } else {
+      die("Can't read $lint_profile_file: $!");
+    }
+
+    $self->assert($saw_header,
+      test_msg("Expected header in $lint_profile_file"));
+    $self->assert($saw_files,
+      test_msg("Expected files section in $lint_profile_file"));
+    $self->assert($saw_directive,
+      test_msg("Expected LintProfileFile directive in $lint_profile_file"));
+
+    $self->assert(-f "$lint_profile_file.folded",
+      test_msg("Expected $lint_profile_file.folded to exist"));
+  };
+  if ($@) {
+    $ex = $@;
+  }
+
+  test_cleanup($setup->{log_file}, $ex);
+}
+
+sub read_lint_config {
+  my $lint_config_file = shift;
+  my $lines = [];
+
+  if (open(my $fh, "< $lint_config_file")) {
+    while (my $line = <$fh>) {
+      chomp($line);
+
+      if ($ENV{TEST_VERBOSE}) {
+        print STDERR "$line\n";
+      }
+
+      # Skip the timestamped header, and our own output path.
+      next if $line =~ /^# AUTO-GENERATED BY /;
+      next if $line =~ /^LintConfigFile /;
+
+      push(@$lines, $line);
+    }
+
+    close($fh);
+
+  } else {
+    croak("Can't read $lint_config_file: $!");
+  }
+
+  return $lines;
+}
+
+sub lint_sections_round_trip {
+  my $self = shift;
+  my $tmpdir = $self->{tmpdir};
+  my $setup = test_setup($tmpdir, 'lint');
+
+  my $lint_config_file = File::Spec->rel2abs("$tmpdir/generated.conf");
+  my $round_trip_config_file = File::Spec->rel2abs("$tmpdir/round-trip.conf");
+  my $round_trip_lint_config_file = File::Spec->rel2abs(
+    "$tmpdir/round-trip-generated.conf");
+
+  my $sub_dir = File::Spec->rel2abs("$tmpdir/sub.d");
+  create_test_dir($setup, $sub_dir);
+
+  my $config = {
+    PidFile => $setup->{pid_file},
+    ScoreboardFile => $setup->{scoreboard_file},
+    SystemLog => $setup->{log_file},
+    TraceLog => $setup->{log_file},
+    Trace => 'lint:20',
+
+    AuthUserFile => $setup->{auth_user_file},
+    AuthGroupFile => $setup->{auth_group_file},
+
+    IfModules => {
+      'mod_lint.c' => {
+        LintConfigFile => $lint_config_file,
+      },
+    },
+  };
+
+  my ($port, $config_user, $config_group) = config_write($setup->{config_file},
+    $config);
+
+  my $vhost_port = $port + 17;
+
+  if (open(my $fh, ">> $setup->{config_file}")) {
+    print $fh <<EOC;
+<Class local>
+  From 127.0.0.1
+  From ::1
+</Class>
+
+<Directory $sub_dir>
+  AllowOverwrite off
+  <Limit WRITE>
+    DenyAll
+  </Limit>
+  Umask 077
+</Directory>
+
+<Directory $tmpdir>
+  AllowOverwrite on
+</Directory>
+
+<Anonymous $sub_dir>
+  User $config_user
+  Group $config_group
+  UserAlias anonymous $config_user
+  <Limit LOGIN>
+    AllowAll
+  </Limit>
+</Anonymous>
+
+<VirtualHost 127.0.0.1>
+  Port $vhost_port
+  ServerName "Round Trip Server"
+  AuthUserFile $setup->{auth_user_file}
+  AuthGroupFile $setup->{auth_group_file}
+
+  <Directory $sub_dir>
+    AllowOverwrite on
+  </Directory>
+</VirtualHost>
+EOC
+    unless (close($fh)) {
+      die("Can't write $setup->{config_file}: $!");
+    }
+
+  } else {
+    die("Can't open $setup->{config_file}: $!");
+  }
+
+  server_start($setup->{config_file}, $setup->{pid_file});
+  server_stop($setup->{pid_file});
+
+  my $ex;
+
+  eval {
+    assert_lint_config_ok($setup->{log_file}, $lint_config_file);
+
+    my $lines = read_lint_config($lint_config_file);
+    my $text = join("\n", @$lines);
+
+    # Each section keeps its own configs, sorted; nested sections sort
+    # first.
+    $self->assert($text =~ /<Directory \Q$sub_dir\E>\n  <Limit WRITE>\n    DenyAll\n  <\/Limit>\n  AllowOverwrite off\n  Umask 077\n<\/Directory>/,
+      test_msg("Expected <Directory $sub_dir> section in $lint_config_file"));
+    $self->assert($text =~ /<Directory \Q$tmpdir\E>\n  AllowOverwrite on\n<\/Directory>/,
+      test_msg("Expected <Directory $tmpdir> section in $lint_config_file"));
+    $self->assert($text =~ /<Anonymous \Q$sub_dir\E>\n/,
+      test_msg("Expected <Anonymous> section in $lint_config_file"));
+    $self->assert($text =~ /# VirtualHosts\n\n<VirtualHost 127\.0\.0\.1>\n/,
+      test_msg("Expected <VirtualHost> section in $lint_config_file"));
+    $self->assert($text =~ /  Port $vhost_port\n/,
+      test_msg("Expected vhost Port in $lint_config_file"));
+    $self->assert($text =~ /<Class local>\n  From 127\.0\.0\.1\n  From ::1\n  Satisfy any\n<\/Class>/,
+      test_msg("Expected <Class> section in $lint_config_file"));
+
+    # Now load the generated config, and generate it again; the result
+    # should be the same.
+    if (open(my $in, "< $lint_config_file")) {
+      if (open(my $out, "> $round_trip_config_file")) {
+        while (my $line = <$in>) {
+          $line =~ s/^LintConfigFile .*$/LintConfigFile $round_trip_lint_config_file/;
+          print $out $line;
+        }
+
+        unless (close($out)) {
+          die("Can't write $round_trip_config_file: $!");
+        }
+
+      } else {
+        die("Can't open $round_trip_config_file: $!");
+      }
+
+      close($in);
+
+    } else {
+      die("Can't read $lint_config_file: $!");
+    }
+
+    server_start($round_trip_config_file, $setup->{pid_file});
+    server_stop($setup->{pid_file});
+
+    my $round_trip_lines = read_lint_config($round_trip_lint_config_file);
+    $self->assert_deep_equals($lines, $round_trip_lines,
+      test_msg("Expected same config from round trip"));
+  };
+  if ($@) {
+    $ex = $@;
+  }
+
+  test_cleanup($setup->{log_file}, $ex);
+}
+
+sub lint_options_numeric_addresses {
+  my $self = shift;
+  my $tmpdir = $self->{tmpdir};
+  my $setup = test_setup($tmpdir, 'lint');
+
+  my $lint_config_file = File::Spec->rel2abs("$tmpdir/generated.conf");
+  my $numeric_config_file = "$lint_config_file.numeric";
+
+  my $config = {
+    PidFile => $setup->{pid_file},
+    ScoreboardFile => $setup->{scoreboard_file},
+    SystemLog => $setup->{log_file},
+    TraceLog => $setup->{log_file},
+    Trace => 'lint:20 lint.rule:20',
+
+    AuthUserFile => $setup->{auth_user_file},
+    AuthGroupFile => $setup->{auth_group_file},
+
+    IfModules => {
+      'mod_lint.c' => {
+        LintConfigFile => $lint_config_file,
+        LintOptions => 'NumericAddresses',
+      },
+    },
+  };
+
+  my ($port, $config_user, $config_group) = config_write($setup->{config_file},
+    $config);
+
+  my $vhost_port = $port + 17;
+
+  if (open(my $fh, ">> $setup->{config_file}")) {
+    print $fh <<EOC;
+<VirtualHost localhost>
+  Port $vhost_port
+  ServerName "Named Server"
+</VirtualHost>
+EOC
+    unless (close($fh)) {
+      die("Can't write $setup->{config_file}: $!");
+    }
+
+  } else {
+    die("Can't open $setup->{config_file}: $!");
+  }
+
+  server_start($setup->{config_file}, $setup->{pid_file});
+  server_stop($setup->{pid_file});
+
+  my $ex;
+
+  eval {
+    my $addr;
+
+    if (open(my $fh, "< $setup->{log_file}")) {
+      while (my $line = <$fh>) {
+        if ($line =~ /<VirtualHost> address 'localhost' requires DNS resolution at startup; resolved to (\S+)/) {
+          $addr = $1;
+          last;
+        }
+      }
+
+      close($fh);
+
+    } else {
+      die("Can't read $setup->{log_file}: $!");
+    }
+
+    $self->assert(defined($addr),
+      test_msg("Expected <VirtualHost> DNS finding in $setup->{log_file}"));
+
+    my $lines = read_lint_config($numeric_config_file);
+    my $text = join("\n", @$lines);
+
+    $self->assert($text =~ /<VirtualHost \Q$addr\E>/,
+      test_msg("Expected <VirtualHost $addr> in $numeric_config_file"));
+    $self->assert($text !~ /<VirtualHost localhost>/,
+      test_msg("Unexpected <VirtualHost localhost> in $numeric_config_file"));
+  };
+  if ($@) {
+    $ex = $@;
+  }
+
+  test_cleanup($setup->{log_file}, $ex);
+}
+
+sub lint_state_file_numeric_addresses {
+  my $self = shift;
+  my $tmpdir = $self->{tmpdir};
+  my $setup = test_setup($tmpdir, 'lint');
+
+  my $lint_config_file = File::Spec->rel2abs("$tmpdir/generated.conf");
+  my $numeric_config_file = "$lint_config_file.numeric";
+  my $lint_state_file = File::Spec->rel2abs("$tmpdir/lint.state");
+
+  my $config = {
+    PidFile => $setup->{pid_file},
+    ScoreboardFile => $setup->{scoreboard_file},
+    SystemLog => $setup->{log_file},
+    TraceLog => $setup->{log_file},
+    Trace => 'lint:20',
+
+    AuthUserFile => $setup->{auth_user_file},
+    AuthGroupFile => $setup->{auth_group_file},
+
+    IfModules => {
+      'mod_lint.c' => {
+        LintConfigFile => $lint_config_file,
+        LintOptions => 'NumericAddresses',
+        LintStateFile => $lint_state_file,
+      },
+    },
+  };
+
+  my ($port, $config_user, $config_group) = config_write($setup->{config_file},
+    $config);
+
+  my $vhost_port = $port + 17;
+
+  if (open(my $fh, ">> $setup->{config_file}")) {
+    print $fh <<EOC;
+<VirtualHost localhost>
+  Port $vhost_port
+  ServerName "Named Server"
+</VirtualHost>
+EOC
+    unless (close($fh)) {
+      die("Can't write $setup->{config_file}: $!");
+    }
+
+  } else {
+    die("Can't open $setup->{config_file}: $!");
+  }
+
+  server_start($setup->{config_file}, $setup->{pid_file});
+  server_stop($setup->{pid_file});
+
+  my $ex;
+
+  eval {
+    $self->assert(-f $numeric_config_file,
+      test_msg("Expected $numeric_config_file to exist"));
+
+    # The config is unchanged, but a deleted numeric variant must still be
+    # written again.
+    unlink($numeric_config_file);
+
+    server_start($setup->{config_file}, $setup->{pid_file});
+    server_stop($setup->{pid_file});
+
+    $self->assert(-f $numeric_config_file,
+      test_msg("Expected $numeric_config_file to be written again"));
+
+    my $lines = read_lint_config($numeric_config_file);
+    my $text = join("\n", @$lines);
+
+    $self->assert($text !~ /<VirtualHost localhost>/,
+      test_msg("Unexpected <VirtualHost localhost> in $numeric_config_file"));
+  };
+  if ($@) {
+    $ex = $@;
+  }
+
+  test_cleanup($setup->{log_file}, $ex);
+}
+
+sub lint_state_file_vhost_cache {
+  my $self = shift;
+  my $tmpdir = $self->{tmpdir};
+  my $setup = test_setup($tmpdir, 'lint');
+
+  my $lint_config_file = File::Spec->rel2abs("$tmpdir/generated.conf");
+  my $lint_state_file = File::Spec->rel2abs("$tmpdir/lint.state");
+  my $vhost_cache_file = "$lint_state_file.vhosts";
+
+  my $config = {
+    PidFile => $setup->{pid_file},
+    ScoreboardFile => $setup->{scoreboard_file},
+    SystemLog => $setup->{log_file},
+    TraceLog => $setup->{log_file},
+    Trace => 'lint:20',
+
+    AuthUserFile => $setup->{auth_user_file},
+    AuthGroupFile => $setup->{auth_group_file},
+
+    IfModules => {
+      'mod_lint.c' => {
+        LintConfigFile => $lint_config_file,
+        LintStateFile => $lint_state_file,
+      },
+    },
+  };
+
+  my $write_config = sub {
+    my $server_name = shift;
+
+    my ($port, $config_user, $config_group) = config_write(
+      $setup->{config_file}, $config);
+
+    my $vhost_port1 = $port + 17;
+    my $vhost_port2 = $port + 18;
+
+    if (open(my $fh, ">> $setup->{config_file}")) {
+      print $fh <<EOC;
+<VirtualHost 127.0.0.1>
+  Port $vhost_port1
+  ServerName "Unchanged Server"
+</VirtualHost>
+
+<VirtualHost 127.0.0.1>
+  Port $vhost_port2
+  ServerName "$server_name"
+</VirtualHost>
+EOC
+      unless (close($fh)) {
+        die("Can't write $setup->{config_file}: $!");
+      }
+
+    } else {
+      die("Can't open $setup->{config_file}: $!");
+    }
+  };
+
+  $write_config->('First Server');
+  server_start($setup->{config_file}, $setup->{pid_file});
+  server_stop($setup->{pid_file});
+
+  # Change only the second vhost; the first is reused from the cache.
+  $write_config->('Second Server');
+  server_start($setup->{config_file}, $setup->{pid_file});
+  server_stop($setup->{pid_file});
+
+  my $ex;
+
+  eval {
+    $self->assert(-f $vhost_cache_file,
+      test_msg("Expected vhost cache $vhost_cache_file"));
+
+    my $reused = 0;
+
+    if (open(my $fh, "< $setup->{log_file}")) {
+      while (my $line = <$fh>) {
+        if ($line =~ /reusing 1 of 2 cached vhosts/) {
+          $reused = 1;
+          last;
+        }
+      }
+
+      close($fh);
+
+    } else {
+      die("Can't read $setup->{log_file}: $!");
+    }
+
+    $self->assert($reused,
+      test_msg("Expected reused vhost in $setup->{log_file}"));
+
+    my $lines = read_lint_config($lint_config_file);
+    my $text = join("\n", @$lines);
+
+    $self->assert($text =~ /ServerName "Unchanged Server"/,
+      test_msg("Expected cached vhost in $lint_config_file"));
+    $self->assert($text =~ /ServerName "Second Server"/,
+      test_msg("Expected changed vhost in $lint_config_file"));
+    $self->assert($text !~ /ServerName "First Server"/,
+      test_msg("Unexpected stale vhost in $lint_config_file"));
+  };
+  if ($@) {
+    $ex = $@;
+  }
+
+  test_cleanup($setup->{log_file}, $ex);
+}
+
 1;